@@ -0,0 +1,259 @@
+#pragma once
+#include "romfs.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <wuhb_utils/utils.h>
+#include <zlib.h>
+
+/*
+ * Shared helpers for the host benchmarks.
+ * Every benchmark writes one JSON object per line ("JSON Lines") so results of different
+ * library versions can be compared with standard tools.
+ */
+
+using BenchClock = std::chrono::steady_clock;
+
+static inline uint64_t BenchNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now().time_since_epoch()).count();
+}
+
+struct BenchArgs {
+    std::string outPath;
+    std::string filter;
+    std::string workDir;
+    bool quick = false;
+};
+
+static inline void BenchPrintUsage(const char *name) {
+    fprintf(stderr, "Usage: %s [--out <file.jsonl>] [--filter <benchmark>] [--workdir <dir>] [--quick]\n", name);
+}
+
+static inline bool BenchParseArgs(int argc, char **argv, BenchArgs &args) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--quick") {
+            args.quick = true;
+        } else if (arg == "--out" && i + 1 < argc) {
+            args.outPath = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            args.filter = argv[++i];
+        } else if (arg == "--workdir" && i + 1 < argc) {
+            args.workDir = argv[++i];
+        } else {
+            BenchPrintUsage(argv[0]);
+            return false;
+        }
+    }
+    if (args.workDir.empty()) {
+        args.workDir = std::filesystem::temp_directory_path().string();
+    }
+    return true;
+}
+
+static inline bool BenchEnabled(const BenchArgs &args, const char *name) {
+    return args.filter.empty() || args.filter == name;
+}
+
+class JsonLine {
+public:
+    JsonLine &Add(const char *key, const std::string &val) {
+        Key(key);
+        mLine += '"';
+        for (char c : val) {
+            if (c == '"' || c == '\\') {
+                mLine += '\\';
+            }
+            mLine += c;
+        }
+        mLine += '"';
+        return *this;
+    }
+    JsonLine &Add(const char *key, const char *val) { return Add(key, std::string(val)); }
+    JsonLine &Add(const char *key, bool val) {
+        Key(key);
+        mLine += val ? "true" : "false";
+        return *this;
+    }
+    JsonLine &Add(const char *key, uint64_t val) {
+        Key(key);
+        mLine += std::to_string(val);
+        return *this;
+    }
+    JsonLine &Add(const char *key, int64_t val) {
+        Key(key);
+        mLine += std::to_string(val);
+        return *this;
+    }
+    JsonLine &Add(const char *key, uint32_t val) { return Add(key, (uint64_t) val); }
+    JsonLine &Add(const char *key, int32_t val) { return Add(key, (int64_t) val); }
+    JsonLine &Add(const char *key, double val) {
+        Key(key);
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.3f", val);
+        mLine += buf;
+        return *this;
+    }
+
+    [[nodiscard]] std::string Str() const { return mLine + "}"; }
+
+private:
+    void Key(const char *key) {
+        mLine += mLine.size() > 1 ? ",\"" : "\"";
+        mLine += key;
+        mLine += "\":";
+    }
+
+    std::string mLine = "{";
+};
+
+class BenchOutput {
+public:
+    explicit BenchOutput(const BenchArgs &args) {
+        mFile = args.outPath.empty() ? stdout : fopen(args.outPath.c_str(), "w");
+        if (!mFile) {
+            fprintf(stderr, "Failed to open %s\n", args.outPath.c_str());
+            exit(1);
+        }
+    }
+    ~BenchOutput() {
+        if (mFile != stdout) {
+            fclose(mFile);
+        }
+    }
+
+    void Write(const JsonLine &line) {
+        fprintf(mFile, "%s\n", line.Str().c_str());
+        fflush(mFile);
+    }
+
+private:
+    FILE *mFile;
+};
+
+/**
+ * Collects per-call latencies in nanoseconds.
+ */
+class LatencyStats {
+public:
+    void Reserve(size_t count) { mSamples.reserve(count); }
+    void Add(uint64_t ns) {
+        mSamples.push_back(ns);
+        mTotal += ns;
+    }
+
+    [[nodiscard]] uint64_t Count() const { return mSamples.size(); }
+    [[nodiscard]] uint64_t TotalNs() const { return mTotal; }
+
+    /**
+     * Adds count, total time and latency percentiles to "line".
+     */
+    void AddTo(JsonLine &line) {
+        std::sort(mSamples.begin(), mSamples.end());
+        line.Add("calls", (uint64_t) mSamples.size());
+        line.Add("total_ns", mTotal);
+        line.Add("mean_ns", mSamples.empty() ? 0.0 : (double) mTotal / mSamples.size());
+        line.Add("p50_ns", Percentile(0.50));
+        line.Add("p90_ns", Percentile(0.90));
+        line.Add("p99_ns", Percentile(0.99));
+        line.Add("max_ns", mSamples.empty() ? 0 : mSamples.back());
+    }
+
+private:
+    [[nodiscard]] uint64_t Percentile(double p) const {
+        if (mSamples.empty()) {
+            return 0;
+        }
+        return mSamples[std::min(mSamples.size() - 1, (size_t) (p * (mSamples.size() - 1) + 0.5))];
+    }
+
+    std::vector<uint64_t> mSamples;
+    uint64_t mTotal = 0;
+};
+
+static inline double BenchMBPerSec(uint64_t bytes, uint64_t ns) {
+    return ns == 0 ? 0.0 : ((double) bytes / (1024.0 * 1024.0)) / ((double) ns / 1e9);
+}
+
+/**
+ * Generates deterministic test data. Compressible data consists of words so it compresses roughly like text assets.
+ */
+static inline std::vector<uint8_t> BenchGenerateData(size_t size, uint32_t seed, bool compressible) {
+    static const char *words[] = {"wuhb ", "bundle ", "texture ", "sound ", "model ", "level ", "shader ", "font ", "\n"};
+    std::vector<uint8_t> data(size);
+    uint32_t state = seed * 2654435761u + 1;
+    size_t i       = 0;
+    while (i < size) {
+        state = state * 1664525u + 1013904223u;
+        if (compressible) {
+            const char *word = words[(state >> 16) % (sizeof(words) / sizeof(words[0]))];
+            while (*word && i < size) {
+                data[i++] = *word++;
+            }
+        } else {
+            data[i++] = state >> 24;
+        }
+    }
+    return data;
+}
+
+static inline std::vector<uint8_t> BenchGzip(const std::vector<uint8_t> &data) {
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "deflateInit2 failed\n");
+        exit(1);
+    }
+    std::vector<uint8_t> out(deflateBound(&zs, data.size()));
+    zs.next_in   = (Bytef *) data.data();
+    zs.avail_in  = data.size();
+    zs.next_out  = out.data();
+    zs.avail_out = out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+static inline void BenchCheck(WUHBUtilsStatus res, const char *what) {
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        fprintf(stderr, "%s failed: %s\n", what, WUHBUtils_GetStatusStr(res));
+        exit(1);
+    }
+}
+
+static inline void BenchWriteBundle(const RomFSBuilder &builder, const std::string &path) {
+    if (!builder.Write(path)) {
+        fprintf(stderr, "Failed to write %s\n", path.c_str());
+        exit(1);
+    }
+}
+
+static inline void BenchMount(const char *name, const std::string &path) {
+    int32_t outRes = -1;
+    BenchCheck(WUHBUtils_MountBundle(name, path.c_str(), BundleSource_FileDescriptor, &outRes), "WUHBUtils_MountBundle");
+    if (outRes < 0) {
+        fprintf(stderr, "Failed to mount %s\n", path.c_str());
+        exit(1);
+    }
+}
+
+/**
+ * Writes a line describing the environment the benchmark ran in.
+ */
+static inline void BenchWriteMeta(BenchOutput &out, const char *benchmark, const BenchArgs &args) {
+    WUHBUtilsVersion version = WUHB_UTILS_MODULE_VERSION_ERROR;
+    WUHBUtils_GetVersion(&version);
+    out.Write(JsonLine()
+                      .Add("benchmark", "meta")
+                      .Add("suite", benchmark)
+                      .Add("module_version", version)
+                      .Add("compiler", __VERSION__)
+                      .Add("quick", args.quick)
+                      .Add("timestamp", (int64_t) std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+}
@@ -0,0 +1,110 @@
+#include "bench.h"
+#include <malloc.h>
+#include <random>
+#include <wuhb_utils/allocator.h>
+
+/*
+ * Loading all files of a level and throwing them away again, with per-file heap allocations vs. an arena.
+ *
+ *   level_load   WUHBUtils_ReadWholeFile + WUHBUtils_Free per file vs. WUHBUtils_ArenaReadWholeFile + WUHBUtils_ArenaReset,
+ *                including the number of allocations made through the allocator hooks
+ */
+
+static uint64_t sAllocations = 0;
+
+static void *CountingAlloc(uint32_t size, uint32_t alignment, void *) {
+    sAllocations++;
+    return memalign(alignment, size);
+}
+
+static void CountingFree(void *ptr, void *) {
+    free(ptr);
+}
+
+static void LoadLevels(BenchOutput &out, const std::vector<std::string> &paths, uint64_t levelSize, uint32_t levels, bool arena) {
+    std::vector<uint8_t *> buffers(paths.size());
+    // Room for the padding between the files.
+    uint32_t arenaSize = levelSize + paths.size() * 0x40;
+    auto *arenaMemory  = (uint8_t *) memalign(0x40, arenaSize);
+    WUHBArena level;
+    BenchCheck(WUHBUtils_ArenaInit(&level, arenaMemory, arenaSize), "WUHBUtils_ArenaInit");
+
+    sAllocations = 0;
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < levels; i++) {
+        auto start = BenchNowNs();
+        for (size_t j = 0; j < paths.size(); j++) {
+            uint32_t size = 0;
+            if (arena) {
+                BenchCheck(WUHBUtils_ArenaReadWholeFile(&level, paths[j].c_str(), 0x40, &buffers[j], &size), "WUHBUtils_ArenaReadWholeFile");
+            } else {
+                BenchCheck(WUHBUtils_ReadWholeFile(paths[j].c_str(), &buffers[j], &size), "WUHBUtils_ReadWholeFile");
+            }
+            bytes += size;
+        }
+        // Unload the level.
+        if (arena) {
+            WUHBUtils_ArenaReset(&level);
+        } else {
+            for (auto *buffer : buffers) {
+                WUHBUtils_Free(buffer);
+            }
+        }
+        stats.Add(BenchNowNs() - start);
+    }
+    free(arenaMemory);
+
+    JsonLine line;
+    line.Add("benchmark", "level_load")
+            .Add("method", arena ? "arena" : "read_whole_file")
+            .Add("files", (uint32_t) paths.size())
+            .Add("level_size", levelSize)
+            .Add("levels", levels)
+            .Add("allocations_per_level", (double) sAllocations / levels)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = 256;
+    uint32_t levels    = args.quick ? 20 : 100;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    std::vector<std::string> paths;
+    std::mt19937 rng(1);
+    uint64_t levelSize = 0;
+    for (uint32_t i = 0; i < fileCount; i++) {
+        uint32_t size = 512 + rng() % (128 * 1024);
+        auto name     = "/level/file_" + std::to_string(i) + ".bin";
+        builder.AddFile(name, BenchGenerateData(size, i, false));
+        paths.push_back("bench:" + name);
+        levelSize += size;
+    }
+    auto bundlePath = args.workDir + "/wuhb_bench_alloc.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+    BenchCheck(WUHBUtils_SetAllocator(CountingAlloc, CountingFree, nullptr), "WUHBUtils_SetAllocator");
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "alloc", args);
+    if (BenchEnabled(args, "level_load")) {
+        fprintf(stderr, "Running level_load...\n");
+        for (bool arena : {false, true}) {
+            LoadLevels(out, paths, levelSize, levels, arena);
+        }
+    }
+
+    WUHBUtils_SetAllocator(nullptr, nullptr, nullptr);
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
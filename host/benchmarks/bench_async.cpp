@@ -0,0 +1,141 @@
+#include "bench.h"
+#include <wuhb_utils/async.h>
+
+/*
+ * Overlapping file I/O with work on the calling thread via the async API.
+ *
+ *   overlap   loads files and processes each of them (checksum passes), blocking WUHBUtils_ReadWholeFile vs.
+ *             WUHBUtils_ReadWholeFileAsync with 1-3 worker threads; reports wall time and how long the
+ *             calling thread was blocked
+ *   priority  time until a high priority request has finished while the queue is filled with low priority requests
+ */
+
+static std::string AssetPath(bool compressed, uint32_t i) {
+    return std::string("bench:/") + (compressed ? "packed" : "plain") + "/asset_" + std::to_string(i) + ".bin";
+}
+
+static uint32_t Process(const uint8_t *data, uint32_t size, uint32_t passes) {
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < passes; i++) {
+        crc = crc32(crc, data, size);
+    }
+    return crc;
+}
+
+static void BenchOverlap(BenchOutput &out, uint32_t fileCount, uint32_t fileSize) {
+    for (bool compressed : {false, true}) {
+        for (uint32_t passes : {0u, 4u}) {
+            for (uint32_t threads : {0u, 1u, 2u, 3u}) {
+                uint64_t blockedNs = 0;
+                auto start         = BenchNowNs();
+                if (threads == 0) {
+                    for (uint32_t i = 0; i < fileCount; i++) {
+                        uint8_t *buffer = nullptr;
+                        uint32_t size   = 0;
+                        auto readStart  = BenchNowNs();
+                        BenchCheck(WUHBUtils_ReadWholeFile(AssetPath(compressed, i).c_str(), &buffer, &size), "WUHBUtils_ReadWholeFile");
+                        blockedNs += BenchNowNs() - readStart;
+                        Process(buffer, size, passes);
+                        free(buffer);
+                    }
+                } else {
+                    BenchCheck(WUHBUtils_AsyncInit(threads), "WUHBUtils_AsyncInit");
+                    std::vector<WUHBAsyncRequest *> requests(fileCount);
+                    auto submitStart = BenchNowNs();
+                    for (uint32_t i = 0; i < fileCount; i++) {
+                        BenchCheck(WUHBUtils_ReadWholeFileAsync(AssetPath(compressed, i).c_str(), WUHB_ASYNC_PRIORITY_NORMAL, nullptr, nullptr, &requests[i]), "WUHBUtils_ReadWholeFileAsync");
+                    }
+                    blockedNs += BenchNowNs() - submitStart;
+                    for (auto *request : requests) {
+                        auto waitStart = BenchNowNs();
+                        BenchCheck(WUHBUtils_AsyncWait(request), "WUHBUtils_AsyncWait");
+                        blockedNs += BenchNowNs() - waitStart;
+                        WUHBUtilsStatus status;
+                        uint8_t *buffer = nullptr;
+                        uint32_t size   = 0;
+                        BenchCheck(WUHBUtils_AsyncGetResult(request, &status, &buffer, &size), "WUHBUtils_AsyncGetResult");
+                        BenchCheck(status, "WUHBUtils_ReadWholeFileAsync");
+                        Process(buffer, size, passes);
+                        free(buffer);
+                        WUHBUtils_AsyncFree(request);
+                    }
+                    WUHBUtils_AsyncDeInit();
+                }
+                auto ns = BenchNowNs() - start;
+                out.Write(JsonLine()
+                                  .Add("benchmark", "overlap")
+                                  .Add("method", threads == 0 ? "sync" : "async")
+                                  .Add("threads", threads)
+                                  .Add("compressed", compressed)
+                                  .Add("process_passes", passes)
+                                  .Add("files", fileCount)
+                                  .Add("file_size", fileSize)
+                                  .Add("total_ns", ns)
+                                  .Add("blocked_ns", blockedNs)
+                                  .Add("mb_per_s", BenchMBPerSec((uint64_t) fileCount * fileSize, ns)));
+            }
+        }
+    }
+}
+
+static void BenchPriority(BenchOutput &out, uint32_t fileCount) {
+    for (int32_t priority : {WUHB_ASYNC_PRIORITY_NORMAL, WUHB_ASYNC_PRIORITY_HIGH}) {
+        BenchCheck(WUHBUtils_AsyncInit(1), "WUHBUtils_AsyncInit");
+        std::vector<WUHBAsyncRequest *> requests(fileCount);
+        for (uint32_t i = 0; i < fileCount; i++) {
+            BenchCheck(WUHBUtils_ReadWholeFileAsync(AssetPath(false, i).c_str(), WUHB_ASYNC_PRIORITY_NORMAL, nullptr, nullptr, &requests[i]), "WUHBUtils_ReadWholeFileAsync");
+        }
+        WUHBAsyncRequest *urgent;
+        auto start = BenchNowNs();
+        BenchCheck(WUHBUtils_ReadWholeFileAsync(AssetPath(false, 0).c_str(), priority, nullptr, nullptr, &urgent), "WUHBUtils_ReadWholeFileAsync");
+        BenchCheck(WUHBUtils_AsyncWait(urgent), "WUHBUtils_AsyncWait");
+        auto ns = BenchNowNs() - start;
+        WUHBUtils_AsyncFree(urgent);
+        for (auto *request : requests) {
+            WUHBUtils_AsyncFree(request);
+        }
+        WUHBUtils_AsyncDeInit();
+        out.Write(JsonLine()
+                          .Add("benchmark", "priority")
+                          .Add("priority", priority)
+                          .Add("queued", fileCount)
+                          .Add("latency_ns", ns));
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = args.quick ? 32 : 128;
+    uint32_t fileSize  = 512 * 1024;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    for (uint32_t i = 0; i < fileCount; i++) {
+        auto data = BenchGenerateData(fileSize, i, true);
+        builder.AddFile("/packed/asset_" + std::to_string(i) + ".bin.gz", BenchGzip(data));
+        builder.AddFile("/plain/asset_" + std::to_string(i) + ".bin", std::move(data));
+    }
+    auto bundlePath = args.workDir + "/wuhb_bench_async.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "async", args);
+    if (BenchEnabled(args, "overlap")) {
+        fprintf(stderr, "Running overlap...\n");
+        BenchOverlap(out, fileCount, fileSize);
+    }
+    if (BenchEnabled(args, "priority")) {
+        fprintf(stderr, "Running priority...\n");
+        BenchPriority(out, fileCount);
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "bench.h"
+#include <wuhb_utils/buffered_reader.h>
+
+/*
+ * Compares small reads through WUHBUtils_FileRead with the buffered reader.
+ *
+ *   small_read   sequential reads of a fixed size, raw WUHBUtils_FileRead vs. WUHBUtils_BufferedRead
+ *   window_size  WUHBUtils_BufferedRead with different window sizes
+ *   read_line    line by line reading, byte-wise WUHBUtils_FileRead vs. WUHBUtils_BufferedReadLine
+ */
+
+static const uint32_t sReadSizes[]   = {1, 4, 16, 64, 256, 4096};
+static const uint32_t sWindowSizes[] = {4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024};
+
+static void WriteResult(BenchOutput &out, const char *benchmark, const char *path, const char *reader, uint32_t readSize, uint32_t windowSize, uint64_t bytes, uint64_t calls, uint64_t ns) {
+    out.Write(JsonLine()
+                      .Add("benchmark", benchmark)
+                      .Add("file", path)
+                      .Add("reader", reader)
+                      .Add("read_size", readSize)
+                      .Add("window_size", windowSize)
+                      .Add("bytes", bytes)
+                      .Add("calls", calls)
+                      .Add("total_ns", ns)
+                      .Add("ns_per_call", calls ? (double) ns / calls : 0.0)
+                      .Add("mb_per_s", BenchMBPerSec(bytes, ns)));
+}
+
+static void RunRaw(BenchOutput &out, const char *path, uint32_t readSize) {
+    uint8_t buffer[4096];
+    WUHBFileHandle handle;
+    BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+    uint64_t bytes = 0, calls = 0;
+    auto start     = BenchNowNs();
+    while (true) {
+        int32_t readRes = -1;
+        BenchCheck(WUHBUtils_FileRead(handle, buffer, readSize, &readRes), "WUHBUtils_FileRead");
+        calls++;
+        if (readRes <= 0) {
+            break;
+        }
+        bytes += readRes;
+    }
+    auto ns = BenchNowNs() - start;
+    WUHBUtils_FileClose(handle);
+    WriteResult(out, "small_read", path, "raw", readSize, 0, bytes, calls, ns);
+}
+
+static void RunBuffered(BenchOutput &out, const char *benchmark, const char *path, uint32_t readSize, uint32_t windowSize) {
+    uint8_t buffer[4096];
+    WUHBBufferedFile *file;
+    BenchCheck(WUHBUtils_BufferedOpen(path, windowSize, &file), "WUHBUtils_BufferedOpen");
+    uint64_t bytes = 0, calls = 0;
+    auto start     = BenchNowNs();
+    while (true) {
+        uint32_t read = 0;
+        BenchCheck(WUHBUtils_BufferedRead(file, buffer, readSize, &read), "WUHBUtils_BufferedRead");
+        calls++;
+        if (read == 0) {
+            break;
+        }
+        bytes += read;
+    }
+    auto ns = BenchNowNs() - start;
+    WUHBUtils_BufferedClose(file);
+    WriteResult(out, benchmark, path, "buffered", readSize, windowSize, bytes, calls, ns);
+}
+
+static void RunReadLine(BenchOutput &out, const char *path) {
+    char line[1024];
+    {
+        WUHBFileHandle handle;
+        BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+        uint64_t bytes = 0, lines = 0;
+        uint32_t length = 0;
+        auto start      = BenchNowNs();
+        while (true) {
+            int32_t readRes = -1;
+            BenchCheck(WUHBUtils_FileRead(handle, (uint8_t *) line + length, 1, &readRes), "WUHBUtils_FileRead");
+            if (readRes <= 0) {
+                break;
+            }
+            bytes++;
+            if (line[length] == '\n' || ++length == sizeof(line) - 1) {
+                lines++;
+                length = 0;
+            }
+        }
+        auto ns = BenchNowNs() - start;
+        WUHBUtils_FileClose(handle);
+        WriteResult(out, "read_line", path, "raw", 1, 0, bytes, lines, ns);
+    }
+    {
+        WUHBBufferedFile *file;
+        BenchCheck(WUHBUtils_BufferedOpen(path, 0, &file), "WUHBUtils_BufferedOpen");
+        uint64_t bytes = 0, lines = 0;
+        auto start     = BenchNowNs();
+        while (true) {
+            uint32_t length = 0;
+            BenchCheck(WUHBUtils_BufferedReadLine(file, line, sizeof(line), &length), "WUHBUtils_BufferedReadLine");
+            if (length == 0) {
+                break;
+            }
+            bytes += length;
+            lines++;
+        }
+        auto ns = BenchNowNs() - start;
+        WUHBUtils_BufferedClose(file);
+        WriteResult(out, "read_line", path, "buffered", 0, WUHB_BUFFERED_DEFAULT_WINDOW_SIZE, bytes, lines, ns);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileSize = args.quick ? 1024 * 1024 : 8 * 1024 * 1024;
+
+    RomFSBuilder builder;
+    builder.AddFile("/text.txt", BenchGenerateData(fileSize, 1, true));
+    builder.AddFile("/compressed.txt.gz", BenchGzip(BenchGenerateData(fileSize, 2, true)));
+    auto bundlePath = args.workDir + "/wuhb_bench_buffered.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "buffered", args);
+    if (BenchEnabled(args, "small_read")) {
+        for (auto *path : {"bench:/text.txt", "bench:/compressed.txt"}) {
+            for (uint32_t readSize : sReadSizes) {
+                RunRaw(out, path, readSize);
+                RunBuffered(out, "small_read", path, readSize, 0);
+            }
+        }
+    }
+    if (BenchEnabled(args, "window_size")) {
+        for (uint32_t windowSize : sWindowSizes) {
+            RunBuffered(out, "window_size", "bench:/text.txt", 16, windowSize);
+        }
+    }
+    if (BenchEnabled(args, "read_line")) {
+        RunReadLine(out, "bench:/text.txt");
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
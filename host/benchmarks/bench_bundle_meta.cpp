@@ -0,0 +1,101 @@
+#include "bench.h"
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/scan.h>
+
+/*
+ * A launcher loading the meta.ini and the icon/boot textures of every bundle in the apps folder.
+ *
+ *   bundle_meta  MountBundle + WUHBUtils_ArenaReadWholeFile per file + UnmountBundle vs. WUHBUtils_ReadBundleFiles,
+ *                both into one arena that is reset for every listing
+ */
+
+static const char *sMetaPaths[] = {WUHB_META_INI_PATH, WUHB_META_ICON_PATH, WUHB_META_BOOT_TV_PATH, WUHB_META_BOOT_DRC_PATH};
+static constexpr uint32_t META_FILE_COUNT = sizeof(sMetaPaths) / sizeof(sMetaPaths[0]);
+
+static void LoadMeta(BenchOutput &out, const std::vector<std::string> &bundles, WUHBArena *arena, uint32_t repeats, const char *method) {
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        WUHBUtils_ArenaReset(arena);
+        auto start = BenchNowNs();
+        for (auto &bundle : bundles) {
+            uint8_t *buffers[META_FILE_COUNT];
+            uint32_t sizes[META_FILE_COUNT];
+            if (strcmp(method, "mount_read") == 0) {
+                BenchMount("meta", bundle);
+                for (uint32_t j = 0; j < META_FILE_COUNT; j++) {
+                    auto path = std::string("meta:") + sMetaPaths[j];
+                    BenchCheck(WUHBUtils_ArenaReadWholeFile(arena, path.c_str(), 0x40, &buffers[j], &sizes[j]), "WUHBUtils_ArenaReadWholeFile");
+                }
+                int32_t outRes = -1;
+                BenchCheck(WUHBUtils_UnmountBundle("meta", &outRes), "WUHBUtils_UnmountBundle");
+            } else {
+                WUHBUtilsStatus status[META_FILE_COUNT];
+                BenchCheck(WUHBUtils_ReadBundleFiles(bundle.c_str(), BundleSource_FileDescriptor, sMetaPaths, META_FILE_COUNT, arena, 0x40, buffers, sizes, status), "WUHBUtils_ReadBundleFiles");
+                for (auto res : status) {
+                    BenchCheck(res, "WUHBUtils_ReadBundleFiles entry");
+                }
+            }
+            for (auto size : sizes) {
+                bytes += size;
+            }
+        }
+        stats.Add(BenchNowNs() - start);
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "bundle_meta")
+            .Add("method", method)
+            .Add("bundles", (uint32_t) bundles.size())
+            .Add("repeats", repeats)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t bundleCount = args.quick ? 100 : 300;
+    uint32_t repeats     = args.quick ? 3 : 10;
+
+    fprintf(stderr, "Generating test bundles...\n");
+    auto appsDir = args.workDir + "/wuhb_bench_bundle_meta";
+    std::filesystem::remove_all(appsDir);
+    std::filesystem::create_directories(appsDir);
+    std::vector<std::string> bundles;
+    for (uint32_t i = 0; i < bundleCount; i++) {
+        RomFSBuilder builder;
+        builder.AddFile("/code/app.rpx", BenchGenerateData(256 * 1024, i, false));
+        builder.AddFile(WUHB_META_INI_PATH, BenchGenerateData(512, i, true));
+        builder.AddFile(WUHB_META_ICON_PATH, BenchGenerateData(64 * 1024, i, false));
+        builder.AddFile(WUHB_META_BOOT_TV_PATH, BenchGenerateData(128 * 1024, i, false));
+        builder.AddFile(WUHB_META_BOOT_DRC_PATH, BenchGenerateData(96 * 1024, i, false));
+        for (uint32_t j = 0; j < 32; j++) {
+            builder.AddFile("/content/assets/file_" + std::to_string(j) + ".bin", BenchGenerateData(1024, i * 32 + j, true));
+        }
+        bundles.push_back(appsDir + "/app_" + std::to_string(i) + ".wuhb");
+        BenchWriteBundle(builder, bundles.back());
+    }
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+
+    // Large enough for the metadata of all bundles including the alignment padding.
+    std::vector<uint8_t> memory((size_t) bundleCount * 300 * 1024);
+    WUHBArena arena;
+    BenchCheck(WUHBUtils_ArenaInit(&arena, memory.data(), memory.size()), "WUHBUtils_ArenaInit");
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "bundle_meta", args);
+    if (BenchEnabled(args, "bundle_meta")) {
+        fprintf(stderr, "Running bundle_meta...\n");
+        for (auto *method : {"mount_read", "read_bundle_files"}) {
+            LoadMeta(out, bundles, &arena, repeats, method);
+        }
+    }
+
+    std::filesystem::remove_all(appsDir);
+    return 0;
+}
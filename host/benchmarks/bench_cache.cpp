@@ -0,0 +1,108 @@
+#include "bench.h"
+#include <random>
+#include <wuhb_utils/file_cache.h>
+
+/*
+ * Re-reading the same small files (e.g. fonts, icons, localisation tables when a screen is rebuilt).
+ *
+ *   ui_rebuild   reads of a skewed selection of small files via WUHBUtils_ReadWholeFile vs.
+ *                WUHBUtils_CacheReadWholeFile with different budgets (relative to the size of all files)
+ */
+
+static void RunRebuild(BenchOutput &out, const std::vector<std::string> &paths, uint64_t totalSize, uint32_t rebuilds, int32_t budgetPercent) {
+    uint32_t budget = budgetPercent < 0 ? 0 : (uint32_t) (totalSize * budgetPercent / 100);
+    WUHBUtils_CacheSetBudget(budget);
+    WUHBUtils_CacheInvalidate(nullptr);
+    WUHBUtils_CacheResetStats();
+
+    std::mt19937 rng(3);
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    for (uint32_t rebuild = 0; rebuild < rebuilds; rebuild++) {
+        for (int i = 0; i < 16; i++) {
+            // Skewed towards the first files, like a few fonts that are used by every screen.
+            auto index       = (uint32_t) ((uint64_t) (rng() % paths.size()) * (rng() % paths.size()) / paths.size());
+            const char *path = paths[index].c_str();
+            uint32_t size    = 0;
+            auto start       = BenchNowNs();
+            if (budgetPercent < 0) {
+                uint8_t *buffer = nullptr;
+                BenchCheck(WUHBUtils_ReadWholeFile(path, &buffer, &size), "WUHBUtils_ReadWholeFile");
+                free(buffer);
+            } else {
+                const uint8_t *buffer = nullptr;
+                BenchCheck(WUHBUtils_CacheReadWholeFile(path, &buffer, &size), "WUHBUtils_CacheReadWholeFile");
+                WUHBUtils_CacheRelease(buffer);
+            }
+            stats.Add(BenchNowNs() - start);
+            bytes += size;
+        }
+    }
+
+    WUHBCacheStats cacheStats;
+    WUHBUtils_CacheGetStats(&cacheStats);
+    JsonLine line;
+    line.Add("benchmark", "ui_rebuild")
+            .Add("method", budgetPercent < 0 ? "read_whole_file" : "cache")
+            .Add("budget_percent", budgetPercent < 0 ? 0 : budgetPercent)
+            .Add("budget", budget)
+            .Add("files", (uint32_t) paths.size())
+            .Add("total_size", totalSize)
+            .Add("bytes", bytes)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()))
+            .Add("hits", cacheStats.hits)
+            .Add("misses", cacheStats.misses)
+            .Add("evictions", cacheStats.evictions)
+            .Add("hit_rate", cacheStats.hits + cacheStats.misses ? (double) cacheStats.hits / (cacheStats.hits + cacheStats.misses) : 0.0);
+    stats.AddTo(line);
+    out.Write(line);
+    if (cacheStats.activeBuffers != 0) {
+        fprintf(stderr, "%u buffers have not been released\n", cacheStats.activeBuffers);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = 64;
+    uint32_t rebuilds  = args.quick ? 200 : 2000;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    std::vector<std::string> paths;
+    std::mt19937 rng(1);
+    uint64_t totalSize = 0;
+    for (uint32_t i = 0; i < fileCount; i++) {
+        uint32_t size = 1024 + rng() % (64 * 1024);
+        auto name     = "/ui/file_" + std::to_string(i) + ".bin";
+        // Every 4th file is stored compressed, like most text based assets.
+        if (i % 4 == 0) {
+            builder.AddFile(name + ".gz", BenchGzip(BenchGenerateData(size, i, true)));
+        } else {
+            builder.AddFile(name, BenchGenerateData(size, i, false));
+        }
+        paths.push_back("bench:" + name);
+        totalSize += size;
+    }
+    auto bundlePath = args.workDir + "/wuhb_bench_cache.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "cache", args);
+    if (BenchEnabled(args, "ui_rebuild")) {
+        fprintf(stderr, "Running ui_rebuild...\n");
+        for (int32_t budgetPercent : {-1, 0, 10, 25, 50, 100}) {
+            RunRebuild(out, paths, totalSize, rebuilds, budgetPercent);
+        }
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
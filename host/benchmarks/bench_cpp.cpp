@@ -0,0 +1,171 @@
+#include "bench.h"
+#include <array>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/utils.hpp>
+
+/*
+ * Overhead of the C++ layer in <wuhb_utils/utils.hpp> compared to the C calls it wraps.
+ *
+ *   open_close        WUHBUtils_FileOpen + WUHBUtils_FileClose vs. wuhb::File::open + destructor
+ *   file_read         reading a file in 4 KiB chunks via WUHBUtils_FileRead vs. wuhb::File::read into a std::array
+ *   read_whole_file   loading a file into a std::vector: WUHBUtils_ReadWholeFile + copy (what wrappers usually do) vs.
+ *                     wuhb::readAll into a reused vector, and WUHBUtils_ReadWholeFile + WUHBUtils_Free vs. wuhb::readWholeFile
+ *
+ * Every method computes the CRC-32 of the data it read, so all of them do the same work. The behaviour of the wrappers
+ * is tested by host/tests/test_cpp.cpp.
+ */
+
+static constexpr uint32_t FILE_SIZE = 4 * 1024 * 1024;
+
+static void WriteResult(BenchOutput &out, const char *benchmark, const char *method, uint64_t bytes, LatencyStats &stats) {
+    JsonLine line;
+    line.Add("benchmark", benchmark).Add("method", method);
+    if (bytes > 0) {
+        line.Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+    }
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+static void BenchOpenClose(BenchOutput &out, uint32_t iterations) {
+    for (bool cpp : {false, true}) {
+        LatencyStats stats;
+        stats.Reserve(iterations);
+        for (uint32_t i = 0; i < iterations; i++) {
+            auto start = BenchNowNs();
+            if (cpp) {
+                wuhb::File file;
+                BenchCheck(wuhb::File::open("bench:/small.bin", file), "wuhb::File::open");
+            } else {
+                WUHBFileHandle handle;
+                BenchCheck(WUHBUtils_FileOpen("bench:/small.bin", &handle), "WUHBUtils_FileOpen");
+                BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+            }
+            stats.Add(BenchNowNs() - start);
+        }
+        WriteResult(out, "open_close", cpp ? "cpp" : "c", 0, stats);
+    }
+}
+
+static void BenchFileRead(BenchOutput &out, uint32_t repeats) {
+    uint32_t sum = 0;
+    for (bool cpp : {false, true}) {
+        LatencyStats stats;
+        for (uint32_t i = 0; i < repeats; i++) {
+            std::array<uint8_t, 4096> chunk{};
+            uint32_t crc = 0;
+            auto start   = BenchNowNs();
+            if (cpp) {
+                wuhb::File file;
+                BenchCheck(wuhb::File::open("bench:/large.bin", file), "wuhb::File::open");
+                uint32_t read;
+                while (true) {
+                    BenchCheck(file.read(chunk, read), "wuhb::File::read");
+                    if (read == 0) {
+                        break;
+                    }
+                    crc = crc32(crc, chunk.data(), read);
+                }
+            } else {
+                WUHBFileHandle handle;
+                BenchCheck(WUHBUtils_FileOpen("bench:/large.bin", &handle), "WUHBUtils_FileOpen");
+                int32_t read = -1;
+                while (true) {
+                    BenchCheck(WUHBUtils_FileRead(handle, chunk.data(), chunk.size(), &read), "WUHBUtils_FileRead");
+                    if (read <= 0) {
+                        break;
+                    }
+                    crc = crc32(crc, chunk.data(), read);
+                }
+                WUHBUtils_FileClose(handle);
+            }
+            stats.Add(BenchNowNs() - start);
+            sum += crc;
+        }
+        WriteResult(out, "file_read", cpp ? "cpp" : "c", (uint64_t) FILE_SIZE * repeats, stats);
+    }
+    if (sum == 1) {
+        fprintf(stderr, "\n"); // keep the processing from being optimized away
+    }
+}
+
+static void BenchReadWholeFile(BenchOutput &out, uint32_t repeats) {
+    const char *methods[] = {"c_copy_to_vector", "cpp_read_all", "c_read_whole_file", "cpp_read_whole_file"};
+    std::vector<uint8_t> data;
+    uint32_t sum = 0;
+    for (uint32_t method = 0; method < 4; method++) {
+        LatencyStats stats;
+        for (uint32_t i = 0; i < repeats; i++) {
+            uint32_t crc = 0;
+            auto start   = BenchNowNs();
+            if (method == 0) {
+                uint8_t *buffer;
+                uint32_t size;
+                BenchCheck(WUHBUtils_ReadWholeFile("bench:/large.bin", &buffer, &size), "WUHBUtils_ReadWholeFile");
+                data.assign(buffer, buffer + size);
+                WUHBUtils_Free(buffer);
+                crc = crc32(0, data.data(), data.size());
+            } else if (method == 1) {
+                BenchCheck(wuhb::readAll("bench:/large.bin", data), "wuhb::readAll");
+                crc = crc32(0, data.data(), data.size());
+            } else if (method == 2) {
+                uint8_t *buffer;
+                uint32_t size;
+                BenchCheck(WUHBUtils_ReadWholeFile("bench:/large.bin", &buffer, &size), "WUHBUtils_ReadWholeFile");
+                crc = crc32(0, buffer, size);
+                WUHBUtils_Free(buffer);
+            } else {
+                wuhb::Buffer buffer;
+                uint32_t size;
+                BenchCheck(wuhb::readWholeFile("bench:/large.bin", buffer, size), "wuhb::readWholeFile");
+                crc = crc32(0, buffer.get(), size);
+            }
+            stats.Add(BenchNowNs() - start);
+            sum += crc;
+        }
+        WriteResult(out, "read_whole_file", methods[method], (uint64_t) FILE_SIZE * repeats, stats);
+    }
+    if (sum == 1) {
+        fprintf(stderr, "\n"); // keep the processing from being optimized away
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t iterations = args.quick ? 2000 : 20000;
+    uint32_t repeats    = args.quick ? 5 : 30;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    builder.AddFile("/large.bin", BenchGenerateData(FILE_SIZE, 1, false));
+    builder.AddFile("/small.bin", BenchGenerateData(1024, 2, false));
+    auto bundlePath = args.workDir + "/wuhb_bench_cpp.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchOutput out(args);
+    BenchWriteMeta(out, "cpp", args);
+    {
+        wuhb::Mount mount;
+        BenchCheck(wuhb::Mount::mount("bench", bundlePath.c_str(), BundleSource_FileDescriptor, mount), "wuhb::Mount::mount");
+        if (BenchEnabled(args, "open_close")) {
+            fprintf(stderr, "Running open_close...\n");
+            BenchOpenClose(out, iterations);
+        }
+        if (BenchEnabled(args, "file_read")) {
+            fprintf(stderr, "Running file_read...\n");
+            BenchFileRead(out, repeats);
+        }
+        if (BenchEnabled(args, "read_whole_file")) {
+            fprintf(stderr, "Running read_whole_file...\n");
+            BenchReadWholeFile(out, repeats);
+        }
+    }
+
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "bench.h"
+
+/*
+ * Enumerating large asset directories.
+ *
+ *   scan         WUHBUtils_OpenDir/ReadDirBatch/CloseDir with different batch sizes vs. probing a list of known names
+ *                via WUHBUtils_FileOpen/FileGetSize/FileClose, which is what's needed without directory enumeration
+ */
+
+static const uint32_t sFileCounts[] = {1000, 10000};
+static const uint32_t sBatchSizes[] = {1, 16, 128, 1024};
+static const uint32_t sScanRepeats  = 8;
+
+static std::string FileName(uint32_t i) {
+    return "tex_" + std::to_string(i) + ".bin";
+}
+
+static void ScanBatched(BenchOutput &out, uint32_t fileCount, uint32_t batchSize) {
+    std::vector<WUHBDirEntry> entries(batchSize);
+    LatencyStats stats;
+    uint64_t calls = 0;
+    for (uint32_t pass = 0; pass < sScanRepeats; pass++) {
+        uint32_t found = 0;
+        auto start     = BenchNowNs();
+        WUHBDirHandle handle;
+        BenchCheck(WUHBUtils_OpenDir("bench:/assets", &handle), "WUHBUtils_OpenDir");
+        uint32_t count;
+        do {
+            BenchCheck(WUHBUtils_ReadDirBatch(handle, entries.data(), batchSize, &count), "WUHBUtils_ReadDirBatch");
+            found += count;
+            calls++;
+        } while (count > 0);
+        BenchCheck(WUHBUtils_CloseDir(handle), "WUHBUtils_CloseDir");
+        stats.Add(BenchNowNs() - start);
+        if (found != fileCount) {
+            fprintf(stderr, "Expected %u entries, got %u\n", fileCount, found);
+            exit(1);
+        }
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "scan")
+            .Add("method", "read_dir_batch")
+            .Add("files", fileCount)
+            .Add("batch_size", batchSize)
+            .Add("calls_per_scan", (double) calls / sScanRepeats)
+            .Add("entries_per_s", stats.TotalNs() ? (double) fileCount * stats.Count() * 1e9 / stats.TotalNs() : 0.0);
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+static void ScanProbing(BenchOutput &out, uint32_t fileCount) {
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < fileCount; i++) {
+        paths.push_back("bench:/assets/" + FileName(i));
+    }
+    LatencyStats stats;
+    for (uint32_t pass = 0; pass < sScanRepeats; pass++) {
+        auto start = BenchNowNs();
+        for (auto &path : paths) {
+            WUHBFileHandle handle;
+            uint32_t size;
+            BenchCheck(WUHBUtils_FileOpen(path.c_str(), &handle), "WUHBUtils_FileOpen");
+            BenchCheck(WUHBUtils_FileGetSize(handle, &size), "WUHBUtils_FileGetSize");
+            BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+        }
+        stats.Add(BenchNowNs() - start);
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "scan")
+            .Add("method", "open_probe")
+            .Add("files", fileCount)
+            .Add("calls_per_scan", fileCount * 3)
+            .Add("entries_per_s", stats.TotalNs() ? (double) fileCount * stats.Count() * 1e9 / stats.TotalNs() : 0.0);
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchOutput out(args);
+    BenchWriteMeta(out, "dir", args);
+
+    for (uint32_t fileCount : sFileCounts) {
+        if (args.quick && fileCount > 1000) {
+            continue;
+        }
+        fprintf(stderr, "Generating test bundle with %u files...\n", fileCount);
+        RomFSBuilder builder;
+        for (uint32_t i = 0; i < fileCount; i++) {
+            std::vector<uint8_t> data(64, (uint8_t) i);
+            // Every 4th file is stored compressed.
+            if (i % 4 == 0) {
+                builder.AddFile("/assets/" + FileName(i) + ".gz", BenchGzip(data));
+            } else {
+                builder.AddFile("/assets/" + FileName(i), std::move(data));
+            }
+        }
+        auto bundlePath = args.workDir + "/wuhb_bench_dir.wuhb";
+        BenchWriteBundle(builder, bundlePath);
+        BenchMount("bench", bundlePath);
+
+        if (BenchEnabled(args, "scan")) {
+            for (uint32_t batchSize : sBatchSizes) {
+                ScanBatched(out, fileCount, batchSize);
+            }
+            ScanProbing(out, fileCount);
+        }
+
+        WUHBUtils_UnmountBundle("bench", nullptr);
+        remove(bundlePath.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,346 @@
+#include "bench.h"
+#include <fcntl.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <wuhb_host/host.h>
+
+/*
+ * Throughput and latency of the WUHBUtils_File* functions.
+ *
+ *   file_read        WUHBUtils_FileRead per chunk size, aligned/unaligned buffer, plain/compressed file
+ *   read_whole_file  WUHBUtils_ReadWholeFile per file size, with and without WUU_FileGetSize
+ *   open_close       WUHBUtils_FileOpen + WUHBUtils_FileClose over many paths
+ *   file_exists      WUHBUtils_FileExists over many existing and missing paths
+ *   read_v           loading header, vertex and index block of a model via WUHBUtils_FileRead vs. WUHBUtils_FileReadV
+ *   direct_read      streaming a file via WUHBUtils_FileRead vs. reading from the bundle file at the location returned by
+ *                    WUHBUtils_GetFileInfo
+ */
+
+static const uint32_t sChunkSizes[]     = {512, 4 * 1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+static const uint32_t sWholeFileSizes[] = {4 * 1024, 256 * 1024, 4 * 1024 * 1024, 32 * 1024 * 1024};
+
+static const uint32_t sModelParts[] = {64, 256 * 1024, 64 * 1024};
+
+static const uint32_t sDirectChunkSizes[] = {64 * 1024, 1024 * 1024};
+
+static std::string ManyFilePath(uint32_t i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "/many/dir_%02u/file_%05u.bin", i / 64, i);
+    return buf;
+}
+
+static void BenchFileRead(BenchOutput &out, const BenchArgs &args, uint32_t fileSize) {
+    uint64_t targetBytes = args.quick ? 16 * 1024 * 1024 : 64 * 1024 * 1024;
+    for (bool compressed : {false, true}) {
+        const char *path = compressed ? "bench:/read/packed.bin" : "bench:/read/plain.bin";
+        for (uint32_t chunk : sChunkSizes) {
+            for (bool aligned : {true, false}) {
+                auto *buffer = (uint8_t *) memalign(0x40, chunk + 0x40);
+                uint8_t *dst = aligned ? buffer : buffer + 1;
+                LatencyStats stats;
+                stats.Reserve(targetBytes / chunk + 16);
+                uint64_t bytes = 0;
+                while (bytes < targetBytes) {
+                    WUHBFileHandle handle;
+                    BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+                    while (true) {
+                        int32_t readRes = -1;
+                        auto start      = BenchNowNs();
+                        BenchCheck(WUHBUtils_FileRead(handle, dst, chunk, &readRes), "WUHBUtils_FileRead");
+                        stats.Add(BenchNowNs() - start);
+                        if (readRes <= 0) {
+                            break;
+                        }
+                        bytes += readRes;
+                    }
+                    BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+                }
+                free(buffer);
+
+                JsonLine line;
+                line.Add("benchmark", "file_read")
+                        .Add("compressed", compressed)
+                        .Add("file_size", fileSize)
+                        .Add("chunk_size", chunk)
+                        .Add("aligned", aligned)
+                        .Add("bytes", bytes)
+                        .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+                stats.AddTo(line);
+                out.Write(line);
+            }
+        }
+    }
+}
+
+static std::string BundlePath(const BenchArgs &args) {
+    return args.workDir + "/wuhb_bench_file_io.wuhb";
+}
+
+/**
+ * Re-initializes the library so it picks up the hidden exports. WUHBUtils_DeInitLibrary drops the bundle index,
+ * so the bundle is mounted again to keep the following benchmarks comparable.
+ */
+static void ReInitLibrary(const BenchArgs &args, const char *hiddenExports) {
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    WUHBUtils_DeInitLibrary();
+    WUHBHost_SetHiddenExports(hiddenExports);
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", BundlePath(args));
+}
+
+static void BenchReadWholeFile(BenchOutput &out, const BenchArgs &args) {
+    uint64_t targetBytes = args.quick ? 64 * 1024 * 1024 : 256 * 1024 * 1024;
+    for (bool exactSize : {true, false}) {
+        ReInitLibrary(args, exactSize ? "" : "WUU_FileGetSize");
+        for (uint32_t size : sWholeFileSizes) {
+            if (args.quick && size > 4 * 1024 * 1024) {
+                continue;
+            }
+            auto path       = "bench:/whole/file_" + std::to_string(size) + ".bin";
+            auto iterations = std::clamp<uint64_t>(targetBytes / size, 4, 2000);
+            LatencyStats stats;
+            for (uint64_t i = 0; i < iterations; i++) {
+                uint8_t *buffer = nullptr;
+                uint32_t read   = 0;
+                auto start      = BenchNowNs();
+                BenchCheck(WUHBUtils_ReadWholeFile(path.c_str(), &buffer, &read), "WUHBUtils_ReadWholeFile");
+                stats.Add(BenchNowNs() - start);
+                free(buffer);
+            }
+            JsonLine line;
+            line.Add("benchmark", "read_whole_file")
+                    .Add("mode", exactSize ? "exact_size" : "growing")
+                    .Add("file_size", size)
+                    .Add("bytes", (uint64_t) size * iterations)
+                    .Add("mb_per_s", BenchMBPerSec((uint64_t) size * iterations, stats.TotalNs()));
+            stats.AddTo(line);
+            out.Write(line);
+        }
+    }
+    ReInitLibrary(args, "");
+}
+
+static void BenchOpenClose(BenchOutput &out, uint32_t fileCount) {
+    LatencyStats openStats, closeStats;
+    for (int pass = 0; pass < 4; pass++) {
+        for (uint32_t i = 0; i < fileCount; i++) {
+            auto path = "bench:" + ManyFilePath(i);
+            WUHBFileHandle handle;
+            auto start = BenchNowNs();
+            BenchCheck(WUHBUtils_FileOpen(path.c_str(), &handle), "WUHBUtils_FileOpen");
+            auto mid = BenchNowNs();
+            BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+            closeStats.Add(BenchNowNs() - mid);
+            openStats.Add(mid - start);
+        }
+    }
+    for (auto *stats : {&openStats, &closeStats}) {
+        JsonLine line;
+        line.Add("benchmark", "open_close")
+                .Add("call", stats == &openStats ? "open" : "close")
+                .Add("paths", fileCount)
+                .Add("ops_per_s", stats->TotalNs() ? stats->Count() * 1e9 / stats->TotalNs() : 0.0);
+        stats->AddTo(line);
+        out.Write(line);
+    }
+}
+
+static void BenchFileExists(BenchOutput &out, uint32_t fileCount) {
+    for (bool hit : {true, false}) {
+        LatencyStats stats;
+        for (int pass = 0; pass < 4; pass++) {
+            for (uint32_t i = 0; i < fileCount; i++) {
+                auto path      = "bench:" + ManyFilePath(i) + (hit ? "" : ".missing");
+                int32_t exists = -1;
+                auto start     = BenchNowNs();
+                BenchCheck(WUHBUtils_FileExists(path.c_str(), &exists), "WUHBUtils_FileExists");
+                stats.Add(BenchNowNs() - start);
+                if (exists != hit) {
+                    fprintf(stderr, "Unexpected WUHBUtils_FileExists result for %s\n", path.c_str());
+                    exit(1);
+                }
+            }
+        }
+        JsonLine line;
+        line.Add("benchmark", "file_exists")
+                .Add("hit", hit)
+                .Add("paths", fileCount)
+                .Add("ops_per_s", stats.TotalNs() ? stats.Count() * 1e9 / stats.TotalNs() : 0.0);
+        stats.AddTo(line);
+        out.Write(line);
+    }
+}
+
+static void BenchReadV(BenchOutput &out, const BenchArgs &args) {
+    uint32_t iterations = args.quick ? 2000 : 10000;
+    uint32_t modelSize  = 0;
+    std::vector<uint8_t *> buffers;
+    std::vector<WUHBIoVec> vecs;
+    for (uint32_t size : sModelParts) {
+        buffers.push_back((uint8_t *) memalign(0x40, size));
+        vecs.push_back({buffers.back(), size});
+        modelSize += size;
+    }
+    for (const char *method : {"file_read", "read_v", "read_v_fallback"}) {
+        ReInitLibrary(args, strcmp(method, "read_v_fallback") == 0 ? "WUU_FileReadV" : "");
+        for (bool compressed : {false, true}) {
+            const char *path = compressed ? "bench:/model/packed.bin" : "bench:/model/plain.bin";
+            LatencyStats stats;
+            for (uint32_t i = 0; i < (compressed ? iterations / 10 : iterations); i++) {
+                WUHBFileHandle handle;
+                uint32_t total = 0;
+                auto start     = BenchNowNs();
+                BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+                if (strcmp(method, "file_read") == 0) {
+                    for (auto &vec : vecs) {
+                        int32_t readRes = -1;
+                        BenchCheck(WUHBUtils_FileRead(handle, vec.buffer, vec.size, &readRes), "WUHBUtils_FileRead");
+                        total += readRes > 0 ? readRes : 0;
+                    }
+                } else {
+                    BenchCheck(WUHBUtils_FileReadV(handle, vecs.data(), vecs.size(), &total), "WUHBUtils_FileReadV");
+                }
+                BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+                stats.Add(BenchNowNs() - start);
+                if (total != modelSize) {
+                    fprintf(stderr, "Short read of %s\n", path);
+                    exit(1);
+                }
+            }
+            JsonLine line;
+            line.Add("benchmark", "read_v")
+                    .Add("method", method)
+                    .Add("compressed", compressed)
+                    .Add("buffers", (uint32_t) vecs.size())
+                    .Add("file_size", modelSize);
+            stats.AddTo(line);
+            out.Write(line);
+        }
+    }
+    for (auto *buffer : buffers) {
+        free(buffer);
+    }
+    ReInitLibrary(args, "");
+}
+
+static void BenchDirectRead(BenchOutput &out, const BenchArgs &args, const std::string &bundlePath, uint32_t fileSize) {
+    uint64_t targetBytes = args.quick ? 64 * 1024 * 1024 : 256 * 1024 * 1024;
+    uint64_t offset, length;
+    bool compressed;
+    BenchCheck(WUHBUtils_GetFileInfo("bench:/read/plain.bin", &offset, &length, &compressed), "WUHBUtils_GetFileInfo");
+    int fd = open(bundlePath.c_str(), O_RDONLY);
+    if (fd < 0 || compressed || length != fileSize) {
+        fprintf(stderr, "Failed to open %s for direct reads\n", bundlePath.c_str());
+        exit(1);
+    }
+    for (uint32_t chunk : sDirectChunkSizes) {
+        auto *buffer = (uint8_t *) memalign(0x40, chunk);
+        for (bool direct : {false, true}) {
+            LatencyStats stats;
+            uint64_t bytes = 0;
+            while (bytes < targetBytes) {
+                WUHBFileHandle handle = 0;
+                if (!direct) {
+                    BenchCheck(WUHBUtils_FileOpen("bench:/read/plain.bin", &handle), "WUHBUtils_FileOpen");
+                }
+                for (uint64_t pos = 0; pos < length;) {
+                    int64_t readRes = -1;
+                    auto start      = BenchNowNs();
+                    if (direct) {
+                        readRes = pread(fd, buffer, std::min<uint64_t>(chunk, length - pos), offset + pos);
+                    } else {
+                        int32_t res = -1;
+                        BenchCheck(WUHBUtils_FileRead(handle, buffer, chunk, &res), "WUHBUtils_FileRead");
+                        readRes = res;
+                    }
+                    stats.Add(BenchNowNs() - start);
+                    if (readRes <= 0) {
+                        fprintf(stderr, "Short read\n");
+                        exit(1);
+                    }
+                    pos += readRes;
+                    bytes += readRes;
+                }
+                if (!direct) {
+                    BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+                }
+            }
+
+            JsonLine line;
+            line.Add("benchmark", "direct_read")
+                    .Add("method", direct ? "get_file_info" : "file_read")
+                    .Add("file_size", fileSize)
+                    .Add("chunk_size", chunk)
+                    .Add("bytes", bytes)
+                    .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+            stats.AddTo(line);
+            out.Write(line);
+        }
+        free(buffer);
+    }
+    close(fd);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t readFileSize = args.quick ? 4 * 1024 * 1024 : 16 * 1024 * 1024;
+    uint32_t fileCount    = args.quick ? 1024 : 4096;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    auto readData = BenchGenerateData(readFileSize, 1, true);
+    builder.AddFile("/read/packed.bin.gz", BenchGzip(readData));
+    builder.AddFile("/read/plain.bin", std::move(readData));
+    for (uint32_t size : sWholeFileSizes) {
+        builder.AddFile("/whole/file_" + std::to_string(size) + ".bin", BenchGenerateData(size, size, false));
+    }
+    for (uint32_t i = 0; i < fileCount; i++) {
+        builder.AddFile(ManyFilePath(i), BenchGenerateData(64, i, false));
+    }
+    uint32_t modelSize = 0;
+    for (uint32_t size : sModelParts) {
+        modelSize += size;
+    }
+    auto modelData = BenchGenerateData(modelSize, 2, true);
+    builder.AddFile("/model/packed.bin.gz", BenchGzip(modelData));
+    builder.AddFile("/model/plain.bin", std::move(modelData));
+    auto bundlePath = BundlePath(args);
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "file_io", args);
+    if (BenchEnabled(args, "file_read")) {
+        fprintf(stderr, "Running file_read...\n");
+        BenchFileRead(out, args, readFileSize);
+    }
+    if (BenchEnabled(args, "read_whole_file")) {
+        fprintf(stderr, "Running read_whole_file...\n");
+        BenchReadWholeFile(out, args);
+    }
+    if (BenchEnabled(args, "open_close")) {
+        fprintf(stderr, "Running open_close...\n");
+        BenchOpenClose(out, fileCount);
+    }
+    if (BenchEnabled(args, "file_exists")) {
+        fprintf(stderr, "Running file_exists...\n");
+        BenchFileExists(out, fileCount);
+    }
+    if (BenchEnabled(args, "read_v")) {
+        fprintf(stderr, "Running read_v...\n");
+        BenchReadV(out, args);
+    }
+    if (BenchEnabled(args, "direct_read")) {
+        fprintf(stderr, "Running direct_read...\n");
+        BenchDirectRead(out, args, bundlePath, readFileSize);
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
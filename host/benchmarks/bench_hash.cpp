@@ -0,0 +1,141 @@
+#include "bench.h"
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/hash.h>
+#include <zlib.h>
+
+/*
+ * Integrity checks of loaded files.
+ *
+ *   hash_kernel      throughput of CRC-32 and xxHash32 over a buffer in memory (zlib's crc32 as reference)
+ *   read_and_hash    WUHBUtils_ReadWholeFile followed by a separate hash pass vs. WUHBUtils_ReadWholeFileHashed vs.
+ *                    WUHBUtils_ReadWholeFile with manifest verification, every 4th file is stored compressed
+ */
+
+static const char *HashTypeName(WUHBHashType type) {
+    return type == WUHB_HASH_CRC32 ? "crc32" : "xxh32";
+}
+
+static void HashKernel(BenchOutput &out, const std::vector<uint8_t> &data, uint32_t repeats, const char *algorithm) {
+    LatencyStats stats;
+    for (uint32_t i = 0; i < repeats; i++) {
+        uint32_t hash;
+        auto start = BenchNowNs();
+        if (strcmp(algorithm, "zlib_crc32") == 0) {
+            hash = crc32(0, data.data(), data.size());
+        } else {
+            WUHBUtils_HashBuffer(strcmp(algorithm, "crc32") == 0 ? WUHB_HASH_CRC32 : WUHB_HASH_XXH32, data.data(), data.size(), &hash);
+        }
+        stats.Add(BenchNowNs() - start);
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "hash_kernel")
+            .Add("algorithm", algorithm)
+            .Add("size", (uint32_t) data.size())
+            .Add("repeats", repeats)
+            .Add("mb_per_s", BenchMBPerSec((uint64_t) data.size() * repeats, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+static void ReadAndHash(BenchOutput &out, const std::vector<std::string> &paths, uint32_t repeats, WUHBHashType type, const char *method) {
+    bool verify = strcmp(method, "read_verified") == 0;
+    WUHBUtils_SetHashVerification(verify);
+    if (verify) {
+        BenchCheck(WUHBUtils_LoadHashManifest("bench", type == WUHB_HASH_CRC32 ? "/meta/hashes_crc32.txt" : "/meta/hashes_xxh32.txt"), "WUHBUtils_LoadHashManifest");
+    }
+
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        for (auto &path : paths) {
+            uint8_t *buffer;
+            uint32_t size;
+            uint32_t hash;
+            auto start = BenchNowNs();
+            if (strcmp(method, "read_then_hash") == 0) {
+                BenchCheck(WUHBUtils_ReadWholeFile(path.c_str(), &buffer, &size), "WUHBUtils_ReadWholeFile");
+                WUHBUtils_HashBuffer(type, buffer, size, &hash);
+            } else if (strcmp(method, "read_hashed") == 0) {
+                BenchCheck(WUHBUtils_ReadWholeFileHashed(path.c_str(), type, &buffer, &size, &hash), "WUHBUtils_ReadWholeFileHashed");
+            } else {
+                BenchCheck(WUHBUtils_ReadWholeFile(path.c_str(), &buffer, &size), "WUHBUtils_ReadWholeFile");
+            }
+            stats.Add(BenchNowNs() - start);
+            bytes += size;
+            WUHBUtils_Free(buffer);
+        }
+    }
+    WUHBUtils_SetHashVerification(false);
+
+    JsonLine line;
+    line.Add("benchmark", "read_and_hash")
+            .Add("algorithm", HashTypeName(type))
+            .Add("method", method)
+            .Add("files", (uint32_t) paths.size())
+            .Add("repeats", repeats)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = 32;
+    uint32_t fileSize  = 1024 * 1024;
+    uint32_t repeats   = args.quick ? 3 : 20;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    std::vector<std::string> paths;
+    std::string manifests[2] = {"crc32\n", "xxh32\n"};
+    for (uint32_t i = 0; i < fileCount; i++) {
+        auto name = "/data/file_" + std::to_string(i) + ".bin";
+        auto data = BenchGenerateData(fileSize, i, true);
+        for (auto type : {WUHB_HASH_CRC32, WUHB_HASH_XXH32}) {
+            uint32_t hash;
+            WUHBUtils_HashBuffer(type, data.data(), data.size(), &hash);
+            char line[16];
+            snprintf(line, sizeof(line), "%08X ", hash);
+            manifests[type] += line + name.substr(1) + "\n";
+        }
+        if (i % 4 == 0) {
+            builder.AddFile(name + ".gz", BenchGzip(data));
+        } else {
+            builder.AddFile(name, std::move(data));
+        }
+        paths.push_back("bench:" + name);
+    }
+    builder.AddFile("/meta/hashes_crc32.txt", std::vector<uint8_t>(manifests[0].begin(), manifests[0].end()));
+    builder.AddFile("/meta/hashes_xxh32.txt", std::vector<uint8_t>(manifests[1].begin(), manifests[1].end()));
+    auto bundlePath = args.workDir + "/wuhb_bench_hash.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "hash", args);
+    if (BenchEnabled(args, "hash_kernel")) {
+        fprintf(stderr, "Running hash_kernel...\n");
+        auto data = BenchGenerateData(16 * 1024 * 1024, 1, false);
+        for (auto *algorithm : {"zlib_crc32", "crc32", "xxh32"}) {
+            HashKernel(out, data, repeats, algorithm);
+        }
+    }
+    if (BenchEnabled(args, "read_and_hash")) {
+        fprintf(stderr, "Running read_and_hash...\n");
+        for (auto type : {WUHB_HASH_CRC32, WUHB_HASH_XXH32}) {
+            for (auto *method : {"read_then_hash", "read_hashed", "read_verified"}) {
+                ReadAndHash(out, paths, repeats, type, method);
+            }
+        }
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
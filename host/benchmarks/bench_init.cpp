@@ -0,0 +1,149 @@
+#include "bench.h"
+#include <wuhb_host/host.h>
+
+/*
+ * Cost of binding the module exports and of dispatching a call to them.
+ *
+ *   init           WUHBUtils_InitLibrary after WUHBUtils_DeInitLibrary, with the number of OSDynLoad_FindExport calls
+ *                  it made. On the host an export is found via a map lookup, on the console OSDynLoad_FindExport
+ *                  searches the export table of the module, so the number of lookups is what carries over.
+ *   lazy_bind      first call of WUHBUtils_GetCapabilities after WUHBUtils_InitLibrary (looks up the lazy exports)
+ *                  vs. the following calls
+ *   dispatch       WUHBUtils_FileTell/WUHBUtils_FileGetSize on an open file vs. calling the module export directly,
+ *                  the difference is the overhead of the wrapper (version check, export lookup, error mapping)
+ */
+
+static void BenchInit(BenchOutput &out, uint32_t iterations) {
+    LatencyStats stats;
+    stats.Reserve(iterations);
+    unsigned int lookups = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        WUHBUtils_DeInitLibrary();
+        auto before = WUHBHost_GetFindExportCount();
+        auto start  = BenchNowNs();
+        BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+        stats.Add(BenchNowNs() - start);
+        lookups = WUHBHost_GetFindExportCount() - before;
+    }
+    JsonLine line;
+    line.Add("benchmark", "init").Add("find_export_calls", (uint32_t) lookups);
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+static void BenchLazyBind(BenchOutput &out, uint32_t iterations) {
+    LatencyStats first;
+    LatencyStats following;
+    unsigned int lookups  = 0;
+    uint32_t capabilities = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        WUHBUtils_DeInitLibrary();
+        BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+        auto before = WUHBHost_GetFindExportCount();
+        auto start  = BenchNowNs();
+        BenchCheck(WUHBUtils_GetCapabilities(&capabilities), "WUHBUtils_GetCapabilities");
+        first.Add(BenchNowNs() - start);
+        lookups = WUHBHost_GetFindExportCount() - before;
+
+        start = BenchNowNs();
+        BenchCheck(WUHBUtils_GetCapabilities(&capabilities), "WUHBUtils_GetCapabilities");
+        following.Add(BenchNowNs() - start);
+    }
+    for (bool isFirst : {true, false}) {
+        JsonLine line;
+        line.Add("benchmark", "lazy_bind").Add("method", isFirst ? "first_call" : "following_calls").Add("capabilities", capabilities);
+        if (isFirst) {
+            line.Add("find_export_calls", (uint32_t) lookups);
+        }
+        (isFirst ? first : following).AddTo(line);
+        out.Write(line);
+    }
+}
+
+WUHBUtilsApiErrorType FileTell(WUHBFileHandle, uint32_t *);
+WUHBUtilsApiErrorType FileGetSize(WUHBFileHandle, uint32_t *);
+
+static void WriteDispatch(BenchOutput &out, const char *function, const char *method, uint64_t calls, uint64_t ns) {
+    JsonLine line;
+    line.Add("benchmark", "dispatch").Add("function", function).Add("method", method).Add("calls", calls).Add("ns_per_call", (double) ns / calls);
+    out.Write(line);
+}
+
+static void BenchDispatch(BenchOutput &out, uint32_t calls) {
+    auto moduleTell    = reinterpret_cast<decltype(&FileTell)>(WUHBHost_FindModuleExport("WUU_FileTell"));
+    auto moduleGetSize = reinterpret_cast<decltype(&FileGetSize)>(WUHBHost_FindModuleExport("WUU_FileGetSize"));
+    if (!moduleTell || !moduleGetSize) {
+        fprintf(stderr, "Missing module export\n");
+        exit(1);
+    }
+
+    WUHBFileHandle handle;
+    BenchCheck(WUHBUtils_FileOpen("bench:/file.bin", &handle), "WUHBUtils_FileOpen");
+    for (bool getSize : {false, true}) {
+        const char *function = getSize ? "WUHBUtils_FileGetSize" : "WUHBUtils_FileTell";
+        uint32_t val         = 0;
+        uint64_t sum         = 0;
+
+        auto start = BenchNowNs();
+        for (uint32_t i = 0; i < calls; i++) {
+            auto res = getSize ? WUHBUtils_FileGetSize(handle, &val) : WUHBUtils_FileTell(handle, &val);
+            if (res != WUHB_UTILS_RESULT_SUCCESS) {
+                BenchCheck(res, function);
+            }
+            sum += val;
+        }
+        WriteDispatch(out, function, "wrapper", calls, BenchNowNs() - start);
+
+        start = BenchNowNs();
+        for (uint32_t i = 0; i < calls; i++) {
+            auto res = getSize ? moduleGetSize(handle, &val) : moduleTell(handle, &val);
+            if (res != WUHB_UTILS_API_ERROR_NONE) {
+                fprintf(stderr, "Module call failed\n");
+                exit(1);
+            }
+            sum += val;
+        }
+        WriteDispatch(out, function, "module_export", calls, BenchNowNs() - start);
+        if (sum == 1) {
+            fprintf(stderr, "\n"); // keep the calls from being optimized away
+        }
+    }
+    WUHBUtils_FileClose(handle);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t iterations = args.quick ? 2000 : 20000;
+    uint32_t calls      = args.quick ? 1000000 : 10000000;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    builder.AddFile("/file.bin", BenchGenerateData(64 * 1024, 1, false));
+    auto bundlePath = args.workDir + "/wuhb_bench_init.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchOutput out(args);
+    BenchWriteMeta(out, "init", args);
+    if (BenchEnabled(args, "init")) {
+        fprintf(stderr, "Running init...\n");
+        BenchInit(out, iterations);
+    }
+    if (BenchEnabled(args, "lazy_bind")) {
+        fprintf(stderr, "Running lazy_bind...\n");
+        BenchLazyBind(out, iterations);
+    }
+    if (BenchEnabled(args, "dispatch")) {
+        fprintf(stderr, "Running dispatch...\n");
+        BenchMount("bench", bundlePath);
+        BenchDispatch(out, calls);
+        WUHBUtils_UnmountBundle("bench", nullptr);
+    }
+
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return 0;
+}
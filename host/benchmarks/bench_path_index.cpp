@@ -0,0 +1,133 @@
+#include "bench.h"
+
+/*
+ * Path lookups with and without the client-side bundle index.
+ *
+ *   mount        time needed to mount a bundle with and without building the index, and the memory used by the index
+ *   probe        WUHBUtils_FileExists and WUHBUtils_FileOpen for existing, compressed (".gz" fallback) and missing files
+ */
+
+static const uint32_t sFileCounts[] = {256, 4096, 32768};
+
+static std::string FilePath(uint32_t i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "/content/dir_%03u/sub_%u/file_%05u.bin", i / 128, i % 4, i);
+    return buf;
+}
+
+static void Mount(BenchOutput &out, const BenchArgs &args, const std::string &bundlePath, uint32_t fileCount, bool indexed) {
+    WUHBUtils_SetBundleIndexEnabled(indexed);
+    auto start = BenchNowNs();
+    BenchMount(indexed ? "indexed" : "plain", bundlePath);
+    auto ns = BenchNowNs() - start;
+    if (!BenchEnabled(args, "mount")) {
+        return;
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "mount")
+            .Add("indexed", indexed)
+            .Add("files", fileCount)
+            .Add("mount_ns", ns);
+    WUHBBundleIndexInfo info;
+    if (indexed) {
+        BenchCheck(WUHBUtils_GetBundleIndexInfo("indexed", &info), "WUHBUtils_GetBundleIndexInfo");
+        line.Add("index_memory", info.memoryUsage).Add("slots", info.slots).Add("gz_aliases", info.gzAliases);
+    }
+    out.Write(line);
+}
+
+static void Probe(BenchOutput &out, uint32_t fileCount, bool indexed, const char *kind) {
+    const char *mount = indexed ? "indexed:" : "plain:";
+    uint32_t probes   = std::min<uint32_t>(fileCount, 4096);
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < probes; i++) {
+        // Every 2nd file is stored as "<file>.gz".
+        uint32_t file = (i * 7919) % fileCount;
+        if (strcmp(kind, "hit") == 0) {
+            file &= ~1u;
+        } else if (strcmp(kind, "gz") == 0) {
+            file |= 1;
+            if (file >= fileCount) {
+                file -= 2;
+            }
+        }
+        paths.push_back(mount + FilePath(file) + (strcmp(kind, "miss") == 0 ? ".missing" : ""));
+    }
+
+    LatencyStats existsStats, openStats;
+    for (int pass = 0; pass < 4; pass++) {
+        for (auto &path : paths) {
+            int32_t exists = -1;
+            auto start     = BenchNowNs();
+            BenchCheck(WUHBUtils_FileExists(path.c_str(), &exists), "WUHBUtils_FileExists");
+            auto mid = BenchNowNs();
+            WUHBFileHandle handle;
+            auto res = WUHBUtils_FileOpen(path.c_str(), &handle);
+            openStats.Add(BenchNowNs() - mid);
+            existsStats.Add(mid - start);
+            if (res == WUHB_UTILS_RESULT_SUCCESS) {
+                WUHBUtils_FileClose(handle);
+            }
+            if ((res == WUHB_UTILS_RESULT_SUCCESS) != (strcmp(kind, "miss") != 0) || exists != (strcmp(kind, "hit") == 0)) {
+                fprintf(stderr, "Unexpected result for %s\n", path.c_str());
+                exit(1);
+            }
+        }
+    }
+    for (auto *stats : {&existsStats, &openStats}) {
+        JsonLine line;
+        line.Add("benchmark", "probe")
+                .Add("call", stats == &existsStats ? "exists" : "open")
+                .Add("kind", kind)
+                .Add("indexed", indexed)
+                .Add("files", fileCount)
+                .Add("ops_per_s", stats->TotalNs() ? stats->Count() * 1e9 / stats->TotalNs() : 0.0);
+        stats->AddTo(line);
+        out.Write(line);
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchOutput out(args);
+    BenchWriteMeta(out, "path_index", args);
+
+    for (uint32_t fileCount : sFileCounts) {
+        if (args.quick && fileCount > 4096) {
+            continue;
+        }
+        fprintf(stderr, "Generating test bundle with %u files...\n", fileCount);
+        RomFSBuilder builder;
+        for (uint32_t i = 0; i < fileCount; i++) {
+            std::vector<uint8_t> data(16, (uint8_t) i);
+            if (i % 2) {
+                builder.AddFile(FilePath(i) + ".gz", BenchGzip(data));
+            } else {
+                builder.AddFile(FilePath(i), std::move(data));
+            }
+        }
+        auto bundlePath = args.workDir + "/wuhb_bench_path_index.wuhb";
+        BenchWriteBundle(builder, bundlePath);
+
+        for (bool indexed : {false, true}) {
+            Mount(out, args, bundlePath, fileCount, indexed);
+        }
+        if (BenchEnabled(args, "probe")) {
+            for (const char *kind : {"hit", "gz", "miss"}) {
+                for (bool indexed : {false, true}) {
+                    Probe(out, fileCount, indexed, kind);
+                }
+            }
+        }
+        WUHBUtils_UnmountBundle("plain", nullptr);
+        WUHBUtils_UnmountBundle("indexed", nullptr);
+        remove(bundlePath.c_str());
+    }
+    WUHBUtils_SetBundleIndexEnabled(true);
+    return 0;
+}
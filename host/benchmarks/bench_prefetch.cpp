@@ -0,0 +1,101 @@
+#include "bench.h"
+#include <thread>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/prefetch.h>
+
+/*
+ * Screen transitions: the files of the next screen are known while the current screen is still running.
+ *
+ *   transition   time spent loading the files of the next screen at the transition, without prefetching vs. with
+ *                WUHBUtils_Prefetch issued when the current screen starts, for different lead times (time the current
+ *                screen keeps running after the prefetch). Half of the files are stored compressed. Includes the
+ *                used/wasted counters of the staging area.
+ */
+
+static const uint32_t sLeadTimesMs[] = {0, 5, 50};
+
+static void RunTransitions(BenchOutput &out, const std::vector<std::string> &paths, uint32_t screens, bool prefetch, uint32_t leadTimeMs) {
+    std::vector<const char *> pathPtrs;
+    for (auto &path : paths) {
+        pathPtrs.push_back(path.c_str());
+    }
+    WUHBUtils_PrefetchResetStats();
+
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < screens; i++) {
+        if (prefetch) {
+            BenchCheck(WUHBUtils_Prefetch(pathPtrs.data(), pathPtrs.size(), 0), "WUHBUtils_Prefetch");
+        }
+        // The current screen keeps running.
+        std::this_thread::sleep_for(std::chrono::milliseconds(leadTimeMs));
+
+        auto start = BenchNowNs();
+        for (auto *path : pathPtrs) {
+            uint8_t *buffer;
+            uint32_t size;
+            BenchCheck(WUHBUtils_ReadWholeFile(path, &buffer, &size), "WUHBUtils_ReadWholeFile");
+            bytes += size;
+            WUHBUtils_Free(buffer);
+        }
+        stats.Add(BenchNowNs() - start);
+    }
+
+    WUHBPrefetchStats prefetchStats;
+    BenchCheck(WUHBUtils_PrefetchGetStats(&prefetchStats), "WUHBUtils_PrefetchGetStats");
+    JsonLine line;
+    line.Add("benchmark", "transition")
+            .Add("method", prefetch ? "prefetch" : "no_prefetch")
+            .Add("files", (uint32_t) paths.size())
+            .Add("lead_time_ms", leadTimeMs)
+            .Add("screens", screens)
+            .Add("used", prefetchStats.used)
+            .Add("late", prefetchStats.late)
+            .Add("wasted", prefetchStats.wasted)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = 32;
+    uint32_t screens   = args.quick ? 5 : 20;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < fileCount; i++) {
+        auto name = "/screen/file_" + std::to_string(i) + ".bin";
+        auto data = BenchGenerateData(64 * 1024 + i * 1024, i, true);
+        if (i % 2 == 0) {
+            builder.AddFile(name + ".gz", BenchGzip(data));
+        } else {
+            builder.AddFile(name, std::move(data));
+        }
+        paths.push_back("bench:" + name);
+    }
+    auto bundlePath = args.workDir + "/wuhb_bench_prefetch.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "prefetch", args);
+    if (BenchEnabled(args, "transition")) {
+        fprintf(stderr, "Running transition...\n");
+        RunTransitions(out, paths, screens, false, sLeadTimesMs[0]);
+        for (uint32_t leadTimeMs : sLeadTimesMs) {
+            RunTransitions(out, paths, screens, true, leadTimeMs);
+        }
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    WUHBUtils_DeInitLibrary();
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "bench.h"
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/prefetch.h>
+#include <wuhb_utils/trace.h>
+
+/*
+ * Cold start of an application: mount the bundle, then load the files needed until the title screen is shown.
+ *
+ *   cold_start   time from WUHBUtils_MountBundle until the last boot file has been processed, without a profile, while
+ *                recording a trace (tracing overhead) and with a profile built from 3 traces via WUHBUtils_BuildProfile.
+ *                The boot opens 150 of 300 files in an order unrelated to their position in the bundle, reads them
+ *                whole, in chunks or (for some) only their header, and processes every file before opening the next one.
+ *                Every boot additionally reads a few random files that should not end up in the profile.
+ *                On the host the bundle is served from the page cache, so this shows how much of the loading (and
+ *                inflating) is hidden behind the processing, not the seek times of the SD card. The prefetch thread needs a
+ *                core of its own for that, on a single core it competes with the boot.
+ */
+
+enum BootRead {
+    BOOT_READ_WHOLE,
+    BOOT_READ_CHUNKS,
+    BOOT_READ_HEADER,
+};
+
+struct BootStep {
+    std::string path;
+    BootRead read;
+};
+
+static uint32_t Process(const uint8_t *data, uint32_t size) {
+    // Stands in for parsing/decoding the file.
+    uint32_t crc = 0;
+    for (int i = 0; i < 4; i++) {
+        crc = crc32(crc, data, size);
+    }
+    return crc;
+}
+
+static uint32_t RunStep(const BootStep &step) {
+    if (step.read == BOOT_READ_WHOLE) {
+        uint8_t *buffer;
+        uint32_t size;
+        BenchCheck(WUHBUtils_ReadWholeFile(step.path.c_str(), &buffer, &size), "WUHBUtils_ReadWholeFile");
+        auto crc = Process(buffer, size);
+        WUHBUtils_Free(buffer);
+        return crc;
+    }
+    WUHBFileHandle handle;
+    BenchCheck(WUHBUtils_FileOpen(step.path.c_str(), &handle), "WUHBUtils_FileOpen");
+    std::vector<uint8_t> chunk(step.read == BOOT_READ_HEADER ? 4096 : 64 * 1024);
+    uint32_t crc = 0;
+    while (true) {
+        int32_t read = -1;
+        BenchCheck(WUHBUtils_FileRead(handle, chunk.data(), chunk.size(), &read), "WUHBUtils_FileRead");
+        if (read <= 0) {
+            break;
+        }
+        crc ^= Process(chunk.data(), read);
+        if (step.read == BOOT_READ_HEADER) {
+            break;
+        }
+    }
+    WUHBUtils_FileClose(handle);
+    return crc;
+}
+
+/**
+ * Mounts the bundle and runs the boot, returns the elapsed time.
+ */
+static uint64_t Boot(const std::string &bundlePath, const std::vector<BootStep> &steps, const std::vector<std::string> &paths) {
+    // A few files that differ from boot to boot, e.g. a save file or the last opened level.
+    static uint32_t sBootCount = 0;
+    uint32_t boot              = sBootCount++;
+    std::vector<BootStep> extra;
+    for (uint32_t i = 0; i < 5; i++) {
+        extra.push_back({paths[(boot * 7919u + i * 104729u) % paths.size()], BOOT_READ_WHOLE});
+    }
+    uint32_t crc = 0;
+    auto start   = BenchNowNs();
+    BenchMount("bench", bundlePath);
+    for (uint32_t i = 0; i < steps.size(); i++) {
+        crc ^= RunStep(steps[i]);
+        if (i % 30 == 0) {
+            crc ^= RunStep(extra[i / 30]);
+        }
+    }
+    auto ns = BenchNowNs() - start;
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    if (crc == 0x12345678) {
+        fprintf(stderr, "\n"); // keep the processing from being optimized away
+    }
+    return ns;
+}
+
+/**
+ * If "tracePaths" is not NULL, a trace of every boot is written to the paths in it.
+ */
+static void BenchColdStart(BenchOutput &out, const std::string &bundlePath, const char *method, const std::vector<BootStep> &steps,
+                           const std::vector<std::string> &paths, uint32_t boots, uint64_t bootBytes, const std::vector<std::string> *tracePaths) {
+    WUHBUtils_PrefetchCancel(nullptr);
+    WUHBUtils_PrefetchResetStats();
+    LatencyStats stats;
+    WUHBTraceInfo traceInfo = {};
+    for (uint32_t i = 0; i < boots; i++) {
+        if (tracePaths) {
+            BenchCheck(WUHBUtils_TraceStart(0), "WUHBUtils_TraceStart");
+        }
+        stats.Add(Boot(bundlePath, steps, paths));
+        if (tracePaths) {
+            BenchCheck(WUHBUtils_TraceGetInfo(&traceInfo), "WUHBUtils_TraceGetInfo");
+            BenchCheck(WUHBUtils_TraceStop((*tracePaths)[i].c_str()), "WUHBUtils_TraceStop");
+        }
+    }
+
+    WUHBPrefetchStats prefetchStats;
+    BenchCheck(WUHBUtils_PrefetchGetStats(&prefetchStats), "WUHBUtils_PrefetchGetStats");
+    JsonLine line;
+    line.Add("benchmark", "cold_start")
+            .Add("method", method)
+            .Add("boot_files", (uint32_t) steps.size())
+            .Add("boots", boots)
+            .Add("used", prefetchStats.used)
+            .Add("late", prefetchStats.late)
+            .Add("wasted", prefetchStats.wasted)
+            .Add("trace_events", traceInfo.events)
+            .Add("mb_per_s", BenchMBPerSec(bootBytes * boots, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = 300;
+    uint32_t bootFiles = 150;
+    uint32_t boots     = args.quick ? 3 : 10;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    std::vector<std::string> paths;
+    std::vector<uint32_t> sizes;
+    for (uint32_t i = 0; i < fileCount; i++) {
+        auto name = "/data/" + std::to_string(i / 50) + "/file_" + std::to_string(i) + ".bin";
+        auto size = 8 * 1024 + (i * 7919u) % 120 * 1024;
+        auto data = BenchGenerateData(size, i, true);
+        if (i % 3 == 0) {
+            builder.AddFile(name + ".gz", BenchGzip(data));
+        } else {
+            builder.AddFile(name, std::move(data));
+        }
+        paths.push_back("bench:" + name);
+        sizes.push_back(size);
+    }
+    auto bundlePath  = args.workDir + "/wuhb_bench_profile.wuhb";
+    auto profilePath = args.workDir + "/wuhb_bench_profile.txt";
+    BenchWriteBundle(builder, bundlePath);
+
+    // The boot order is a fixed permutation, unrelated to the order inside the bundle.
+    std::vector<BootStep> steps;
+    uint64_t bootBytes = 0;
+    for (uint32_t i = 0; i < bootFiles; i++) {
+        uint32_t file = (i * 113u + 17u) % fileCount;
+        auto read     = i % 10 == 0 ? BOOT_READ_HEADER : (i % 3 == 0 ? BOOT_READ_CHUNKS : BOOT_READ_WHOLE);
+        steps.push_back({paths[file], read});
+        bootBytes += read == BOOT_READ_HEADER ? std::min(sizes[file], 4096u) : sizes[file];
+    }
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "profile", args);
+    if (BenchEnabled(args, "cold_start")) {
+        fprintf(stderr, "Running cold_start...\n");
+        BenchColdStart(out, bundlePath, "no_profile", steps, paths, boots, bootBytes, nullptr);
+
+        std::vector<std::string> traces;
+        for (uint32_t i = 0; i < 3; i++) {
+            traces.push_back(args.workDir + "/wuhb_bench_profile_" + std::to_string(i) + ".trace");
+        }
+        BenchColdStart(out, bundlePath, "tracing", steps, paths, traces.size(), bootBytes, &traces);
+        std::vector<const char *> tracePtrs;
+        for (auto &trace : traces) {
+            tracePtrs.push_back(trace.c_str());
+        }
+        BenchCheck(WUHBUtils_BuildProfile(tracePtrs.data(), tracePtrs.size(), 0, profilePath.c_str()), "WUHBUtils_BuildProfile");
+        BenchCheck(WUHBUtils_SetMountProfile("bench", profilePath.c_str()), "WUHBUtils_SetMountProfile");
+        BenchColdStart(out, bundlePath, "with_profile", steps, paths, boots, bootBytes, nullptr);
+        BenchCheck(WUHBUtils_SetMountProfile("bench", nullptr), "WUHBUtils_SetMountProfile");
+        for (auto &trace : traces) {
+            remove(trace.c_str());
+        }
+    }
+
+    WUHBUtils_DeInitLibrary();
+    remove(profilePath.c_str());
+    remove(bundlePath.c_str());
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "bench.h"
+#include <random>
+#include <wuhb_utils/gz_index.h>
+
+/*
+ * Random access into a big file, plain and compressed.
+ *
+ *   random_read   reads of "read_size" bytes at random offsets via
+ *                   reopen_skip  WUHBUtils_FileOpen + read and discard everything before the offset
+ *                   seek_read    WUHBUtils_FileSeek + WUHBUtils_FileRead
+ *                   read_at      WUHBUtils_FileReadAt
+ *                   gz_index     WUHBUtils_GzIndexReadAt (compressed file only) for different spans
+ *                 The compressed file is read without an index and, via seek_read/read_at, while an index is
+ *                 registered for it (lines with "span").
+ *   gz_index_build   time and memory needed to build an index per span and memory budget
+ */
+
+static void RunRandomRead(BenchOutput &out, const char *path, bool compressed, uint32_t fileSize, uint32_t readSize, const char *method, uint32_t iterations, WUHBGzIndex *index = nullptr) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> buffer(readSize), skipBuffer(64 * 1024);
+    LatencyStats stats;
+    WUHBFileHandle handle;
+    BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t offset = rng() % (fileSize - readSize);
+        int32_t readRes = -1;
+        auto start      = BenchNowNs();
+        if (strcmp(method, "reopen_skip") == 0) {
+            BenchCheck(WUHBUtils_FileClose(handle), "WUHBUtils_FileClose");
+            BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+            uint32_t skipped = 0;
+            while (skipped < offset) {
+                uint32_t toSkip = std::min<uint32_t>(offset - skipped, skipBuffer.size());
+                BenchCheck(WUHBUtils_FileRead(handle, skipBuffer.data(), toSkip, &readRes), "WUHBUtils_FileRead");
+                skipped += readRes;
+            }
+            BenchCheck(WUHBUtils_FileRead(handle, buffer.data(), readSize, &readRes), "WUHBUtils_FileRead");
+        } else if (strcmp(method, "seek_read") == 0) {
+            BenchCheck(WUHBUtils_FileSeek(handle, offset, WUHB_SEEK_SET, nullptr), "WUHBUtils_FileSeek");
+            BenchCheck(WUHBUtils_FileRead(handle, buffer.data(), readSize, &readRes), "WUHBUtils_FileRead");
+        } else if (strcmp(method, "gz_index") == 0) {
+            BenchCheck(WUHBUtils_GzIndexReadAt(index, offset, buffer.data(), readSize, &readRes), "WUHBUtils_GzIndexReadAt");
+        } else {
+            BenchCheck(WUHBUtils_FileReadAt(handle, offset, buffer.data(), readSize, &readRes), "WUHBUtils_FileReadAt");
+        }
+        stats.Add(BenchNowNs() - start);
+        if (readRes != (int32_t) readSize) {
+            fprintf(stderr, "Short read at %u\n", offset);
+            exit(1);
+        }
+    }
+    WUHBUtils_FileClose(handle);
+
+    JsonLine line;
+    line.Add("benchmark", "random_read")
+            .Add("method", method)
+            .Add("compressed", compressed)
+            .Add("file_size", fileSize)
+            .Add("read_size", readSize);
+    if (index) {
+        WUHBGzIndexInfo info;
+        WUHBUtils_GzIndexGetInfo(index, &info);
+        line.Add("span", info.span).Add("index_memory", info.memoryUsage);
+    }
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+static void RunIndexed(BenchOutput &out, const BenchArgs &args, uint32_t fileSize) {
+    for (uint32_t span : {256u * 1024u, 1024u * 1024u, 4096u * 1024u}) {
+        for (uint32_t maxMemory : {0u, 512u * 1024u}) {
+            WUHBGzIndex *index;
+            auto start = BenchNowNs();
+            BenchCheck(WUHBUtils_GzIndexBuild("bench:/packed.bin", span, maxMemory, &index), "WUHBUtils_GzIndexBuild");
+            auto buildNs = BenchNowNs() - start;
+            WUHBGzIndexInfo info;
+            WUHBUtils_GzIndexGetInfo(index, &info);
+            out.Write(JsonLine()
+                              .Add("benchmark", "gz_index_build")
+                              .Add("file_size", fileSize)
+                              .Add("requested_span", span)
+                              .Add("max_memory", maxMemory)
+                              .Add("span", info.span)
+                              .Add("points", info.points)
+                              .Add("index_memory", info.memoryUsage)
+                              .Add("build_ns", buildNs));
+            if (BenchEnabled(args, "random_read") && maxMemory == 0) {
+                for (uint32_t readSize : {4096u, 64u * 1024u}) {
+                    for (const char *method : {"gz_index", "seek_read", "read_at"}) {
+                        RunRandomRead(out, "bench:/packed.bin", true, fileSize, readSize, method, args.quick ? 50 : 200, index);
+                    }
+                }
+            }
+            WUHBUtils_GzIndexFree(index);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileSize = args.quick ? 8 * 1024 * 1024 : 32 * 1024 * 1024;
+
+    RomFSBuilder builder;
+    auto data = BenchGenerateData(fileSize, 7, true);
+    builder.AddFile("/packed.bin.gz", BenchGzip(data));
+    builder.AddFile("/plain.bin", std::move(data));
+    auto bundlePath = args.workDir + "/wuhb_bench_random_access.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "random_access", args);
+    if (BenchEnabled(args, "random_read")) {
+        for (bool compressed : {false, true}) {
+            const char *path = compressed ? "bench:/packed.bin" : "bench:/plain.bin";
+            for (uint32_t readSize : {4096u, 64u * 1024u}) {
+                for (const char *method : {"reopen_skip", "seek_read", "read_at"}) {
+                    uint32_t iterations = compressed ? (args.quick ? 10 : 25) : 500;
+                    RunRandomRead(out, path, compressed, fileSize, readSize, method, iterations);
+                }
+            }
+        }
+    }
+
+    if (BenchEnabled(args, "random_read") || BenchEnabled(args, "gz_index_build")) {
+        RunIndexed(out, args, fileSize);
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "bench.h"
+#include <algorithm>
+#include <random>
+#include <wuhb_utils/allocator.h>
+
+/*
+ * Loading all files of a level that are requested in an order unrelated to their position inside the bundle.
+ *
+ *   level_load   WUHBUtils_ReadWholeFile per file vs. WUHBUtils_ReadFiles with separate buffers and with one
+ *                contiguous allocation, every 8th file is stored compressed
+ */
+
+static void LoadLevel(BenchOutput &out, const std::vector<std::string> &paths, uint32_t repeats, const char *method) {
+    std::vector<const char *> pathPtrs;
+    for (auto &path : paths) {
+        pathPtrs.push_back(path.c_str());
+    }
+    std::vector<uint8_t *> buffers(paths.size());
+    std::vector<uint32_t> sizes(paths.size());
+    std::vector<WUHBUtilsStatus> status(paths.size());
+
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    for (uint32_t i = 0; i < repeats; i++) {
+        uint8_t *block = nullptr;
+        auto start     = BenchNowNs();
+        if (strcmp(method, "read_whole_file") == 0) {
+            for (size_t j = 0; j < paths.size(); j++) {
+                BenchCheck(WUHBUtils_ReadWholeFile(pathPtrs[j], &buffers[j], &sizes[j]), "WUHBUtils_ReadWholeFile");
+            }
+        } else {
+            auto mode = strcmp(method, "read_files_contiguous") == 0 ? WUHB_READ_FILES_CONTIGUOUS : WUHB_READ_FILES_SEPARATE_BUFFERS;
+            BenchCheck(WUHBUtils_ReadFiles(pathPtrs.data(), pathPtrs.size(), mode, buffers.data(), sizes.data(), status.data(), &block), "WUHBUtils_ReadFiles");
+            for (auto res : status) {
+                BenchCheck(res, "WUHBUtils_ReadFiles entry");
+            }
+        }
+        stats.Add(BenchNowNs() - start);
+        for (size_t j = 0; j < paths.size(); j++) {
+            bytes += sizes[j];
+            if (!block) {
+                WUHBUtils_Free(buffers[j]);
+            }
+        }
+        WUHBUtils_Free(block);
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "level_load")
+            .Add("method", method)
+            .Add("files", (uint32_t) paths.size())
+            .Add("repeats", repeats)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()));
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileCount = 256;
+    uint32_t repeats   = args.quick ? 10 : 50;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    std::vector<std::string> paths;
+    std::mt19937 rng(1);
+    for (uint32_t i = 0; i < fileCount; i++) {
+        uint32_t size = 256 + rng() % (96 * 1024);
+        auto name     = "/level/file_" + std::to_string(i) + ".bin";
+        auto data     = BenchGenerateData(size, i, true);
+        if (i % 8 == 0) {
+            builder.AddFile(name + ".gz", BenchGzip(data));
+        } else {
+            builder.AddFile(name, std::move(data));
+        }
+        paths.push_back("bench:" + name);
+    }
+    // The game asks for the files in some unrelated order.
+    std::shuffle(paths.begin(), paths.end(), rng);
+    auto bundlePath = args.workDir + "/wuhb_bench_read_files.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "read_files", args);
+    if (BenchEnabled(args, "level_load")) {
+        fprintf(stderr, "Running level_load...\n");
+        for (auto *method : {"read_whole_file", "read_files_separate", "read_files_contiguous"}) {
+            LoadLevel(out, paths, repeats, method);
+        }
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "bench.h"
+#include <wuhb_utils/scan.h>
+
+/*
+ * A launcher collecting the RPX info of every bundle in the apps folder at boot.
+ *
+ *   scan_apps    WUHBUtils_GetRPXInfo per bundle vs. WUHBUtils_ScanBundles without cache (cold), with the in-memory
+ *                cache (warm) and with the cache loaded from the cache file (boot). On the host the bundles are in the page
+ *                cache, so neither the SD card latency that the concurrent scan hides nor the opens saved by the cache show up fully.
+ */
+
+static void CountEntry(const WUHBScanEntry *entry, void *context) {
+    if (entry->status != WUHB_UTILS_RESULT_SUCCESS) {
+        fprintf(stderr, "Scanning %s failed: %s\n", entry->path, WUHBUtils_GetStatusStr(entry->status));
+        exit(1);
+    }
+    ++*(uint32_t *) context;
+}
+
+static void ScanApps(BenchOutput &out, const std::string &appsDir, const std::vector<std::string> &bundles, const std::string &cachePath, uint32_t repeats, const char *method) {
+    if (strcmp(method, "scan_boot") == 0) {
+        // Fill the cache file once, every run then starts with an empty in-memory cache.
+        WUHBUtils_SetScanCachePath(cachePath.c_str());
+        uint32_t count = 0;
+        BenchCheck(WUHBUtils_ScanBundles(appsDir.c_str(), BundleSource_FileDescriptor, CountEntry, &count), "WUHBUtils_ScanBundles");
+    } else if (strcmp(method, "scan_warm") == 0) {
+        uint32_t count = 0;
+        BenchCheck(WUHBUtils_ScanBundles(appsDir.c_str(), BundleSource_FileDescriptor, CountEntry, &count), "WUHBUtils_ScanBundles");
+    }
+
+    LatencyStats stats;
+    for (uint32_t i = 0; i < repeats; i++) {
+        if (strcmp(method, "scan_cold") == 0) {
+            WUHBUtils_ScanCacheClear();
+        }
+        uint32_t count = 0;
+        auto start     = BenchNowNs();
+        if (strcmp(method, "get_rpx_info") == 0) {
+            for (auto &bundle : bundles) {
+                WUHBRPXInfo info;
+                BenchCheck(WUHBUtils_GetRPXInfo(bundle.c_str(), BundleSource_FileDescriptor, &info), "WUHBUtils_GetRPXInfo");
+                count++;
+            }
+        } else {
+            if (strcmp(method, "scan_boot") == 0) {
+                WUHBUtils_SetScanCachePath(cachePath.c_str());
+            }
+            BenchCheck(WUHBUtils_ScanBundles(appsDir.c_str(), BundleSource_FileDescriptor, CountEntry, &count), "WUHBUtils_ScanBundles");
+        }
+        stats.Add(BenchNowNs() - start);
+        if (count != bundles.size()) {
+            fprintf(stderr, "Expected %u bundles, got %u\n", (uint32_t) bundles.size(), count);
+            exit(1);
+        }
+    }
+    WUHBUtils_SetScanCachePath(nullptr);
+    WUHBUtils_ScanCacheClear();
+
+    JsonLine line;
+    line.Add("benchmark", "scan_apps")
+            .Add("method", method)
+            .Add("bundles", (uint32_t) bundles.size())
+            .Add("repeats", repeats);
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t bundleCount = args.quick ? 50 : 150;
+    uint32_t repeats     = args.quick ? 3 : 10;
+
+    fprintf(stderr, "Generating test bundles...\n");
+    auto appsDir = args.workDir + "/wuhb_bench_scan";
+    std::filesystem::remove_all(appsDir);
+    std::filesystem::create_directories(appsDir);
+    std::vector<std::string> bundles;
+    for (uint32_t i = 0; i < bundleCount; i++) {
+        RomFSBuilder builder;
+        builder.AddFile("/code/app_" + std::to_string(i) + ".rpx", BenchGenerateData(64 * 1024, i, false));
+        builder.AddFile("/meta/meta.ini", BenchGenerateData(256, i, true));
+        builder.AddFile("/meta/iconTex.tga", BenchGenerateData(64 * 1024, i, false));
+        for (uint32_t j = 0; j < 64; j++) {
+            builder.AddFile("/content/assets/file_" + std::to_string(j) + ".bin", BenchGenerateData(1024, i * 64 + j, true));
+        }
+        bundles.push_back(appsDir + "/app_" + std::to_string(i) + ".wuhb");
+        BenchWriteBundle(builder, bundles.back());
+    }
+    auto cachePath = args.workDir + "/wuhb_bench_scan_cache.bin";
+    remove(cachePath.c_str());
+
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "scan", args);
+    if (BenchEnabled(args, "scan_apps")) {
+        fprintf(stderr, "Running scan_apps...\n");
+        for (auto *method : {"get_rpx_info", "scan_cold", "scan_warm", "scan_boot"}) {
+            ScanApps(out, appsDir, bundles, cachePath, repeats, method);
+        }
+    }
+
+    std::filesystem::remove_all(appsDir);
+    remove(cachePath.c_str());
+    return 0;
+}
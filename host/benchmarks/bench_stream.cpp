@@ -0,0 +1,137 @@
+#include "bench.h"
+#include <malloc.h>
+#include <wuhb_host/host.h>
+#include <wuhb_utils/allocator.h>
+
+/*
+ * Feeding a large file to a consumer that processes it incrementally (e.g. a decoder), the consumer is emulated by a CRC-32 pass.
+ *
+ *   stream   WUHBUtils_ReadWholeFile + processing the buffer (with and without WUU_FileGetSize, without it the buffer grows
+ *            while reading) vs. WUHBUtils_FileStream with different chunk sizes, for a plain and a compressed file.
+ *            Reports the throughput and the peak memory allocated through the allocator hooks.
+ */
+
+static uint64_t sAllocated = 0;
+static uint64_t sPeak      = 0;
+
+static void *TrackingAlloc(uint32_t size, uint32_t alignment, void *) {
+    void *ptr = memalign(alignment, size);
+    if (ptr) {
+        sAllocated += malloc_usable_size(ptr);
+        sPeak = std::max(sPeak, sAllocated);
+    }
+    return ptr;
+}
+
+static void TrackingFree(void *ptr, void *) {
+    sAllocated -= malloc_usable_size(ptr);
+    free(ptr);
+}
+
+static bool Consume(const uint8_t *data, uint32_t size, uint32_t, void *userdata) {
+    auto *crc = (uint32_t *) userdata;
+    *crc      = crc32(*crc, data, size);
+    return true;
+}
+
+static void ReInitLibrary(const std::string &bundlePath, const char *hiddenExports) {
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    WUHBUtils_DeInitLibrary();
+    WUHBHost_SetHiddenExports(hiddenExports);
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+}
+
+static void BenchStream(BenchOutput &out, const std::string &bundlePath, const char *path, bool compressed, uint32_t expectedCrc, uint32_t repeats,
+                        const char *method, uint32_t chunkSize) {
+    ReInitLibrary(bundlePath, strcmp(method, "read_whole_file_growing") == 0 ? "WUU_FileGetSize" : "");
+    LatencyStats stats;
+    uint64_t bytes = 0;
+    sPeak          = sAllocated;
+    auto baseline  = sAllocated;
+    for (uint32_t i = 0; i < repeats; i++) {
+        uint32_t crc = 0;
+        auto start   = BenchNowNs();
+        if (chunkSize == 0) {
+            uint8_t *buffer = nullptr;
+            uint32_t size   = 0;
+            BenchCheck(WUHBUtils_ReadWholeFile(path, &buffer, &size), "WUHBUtils_ReadWholeFile");
+            Consume(buffer, size, 0, &crc);
+            WUHBUtils_Free(buffer);
+            bytes += size;
+        } else {
+            BenchCheck(WUHBUtils_FileStream(path, chunkSize, Consume, &crc), "WUHBUtils_FileStream");
+        }
+        stats.Add(BenchNowNs() - start);
+        if (crc != expectedCrc) {
+            fprintf(stderr, "Wrong data for %s via %s\n", path, method);
+            exit(1);
+        }
+    }
+    if (chunkSize != 0) {
+        uint32_t size = 0;
+        WUHBFileHandle handle;
+        BenchCheck(WUHBUtils_FileOpen(path, &handle), "WUHBUtils_FileOpen");
+        BenchCheck(WUHBUtils_FileGetSize(handle, &size), "WUHBUtils_FileGetSize");
+        WUHBUtils_FileClose(handle);
+        bytes = (uint64_t) size * repeats;
+    }
+
+    JsonLine line;
+    line.Add("benchmark", "stream")
+            .Add("method", method)
+            .Add("compressed", compressed)
+            .Add("chunk_size", chunkSize)
+            .Add("file_size", (uint32_t) (bytes / repeats))
+            .Add("repeats", repeats)
+            .Add("mb_per_s", BenchMBPerSec(bytes, stats.TotalNs()))
+            .Add("peak_bytes", sPeak - baseline);
+    stats.AddTo(line);
+    out.Write(line);
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    uint32_t fileSize = args.quick ? 8 * 1024 * 1024 : 32 * 1024 * 1024;
+    uint32_t repeats  = args.quick ? 3 : 10;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    auto plain      = BenchGenerateData(fileSize, 1, false);
+    auto packed     = BenchGenerateData(fileSize, 2, true);
+    auto plainCrc   = (uint32_t) crc32(0, plain.data(), plain.size());
+    auto packedCrc  = (uint32_t) crc32(0, packed.data(), packed.size());
+    builder.AddFile("/stream/plain.bin", std::move(plain));
+    builder.AddFile("/stream/packed.bin.gz", BenchGzip(packed));
+    auto bundlePath = args.workDir + "/wuhb_bench_stream.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+
+    BenchCheck(WUHBUtils_SetAllocator(TrackingAlloc, TrackingFree, nullptr), "WUHBUtils_SetAllocator");
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "stream", args);
+    if (BenchEnabled(args, "stream")) {
+        fprintf(stderr, "Running stream...\n");
+        for (bool compressed : {false, true}) {
+            auto *path = compressed ? "bench:/stream/packed.bin" : "bench:/stream/plain.bin";
+            auto crc   = compressed ? packedCrc : plainCrc;
+            BenchStream(out, bundlePath, path, compressed, crc, repeats, "read_whole_file", 0);
+            BenchStream(out, bundlePath, path, compressed, crc, repeats, "read_whole_file_growing", 0);
+            for (uint32_t chunkSize : {64 * 1024, 256 * 1024, 1024 * 1024}) {
+                BenchStream(out, bundlePath, path, compressed, crc, repeats, "file_stream", chunkSize);
+            }
+        }
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    WUHBUtils_DeInitLibrary();
+    WUHBUtils_SetAllocator(nullptr, nullptr, nullptr);
+    WUHBHost_SetHiddenExports("");
+    remove(bundlePath.c_str());
+    return 0;
+}
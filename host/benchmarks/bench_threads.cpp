@@ -0,0 +1,110 @@
+#include "bench.h"
+#include <atomic>
+#include <thread>
+
+/*
+ * Using the library from several cores at the same time. The correctness of concurrent calls is checked by the
+ * test_threads test.
+ *
+ *   scaling   WUHBUtils_FileRead throughput with 1-3 threads reading their own file each via their own handle,
+ *             reports the aggregate MB/s and the speedup over one thread. On the host the reads are served from the page
+ *             cache, so this shows the overhead of the library and the stand-in module, not the SD card.
+ */
+
+static constexpr uint32_t THREAD_FILE_SIZE = 4 * 1024 * 1024;
+
+static std::string ThreadFilePath(uint32_t i) {
+    return "bench:/thread_" + std::to_string(i) + ".bin";
+}
+
+/**
+ * Starts "threadCount" threads that all run "fn(index)" once all of them are running.
+ */
+template<typename Fn>
+static void RunThreads(uint32_t threadCount, Fn &&fn) {
+    std::atomic<uint32_t> ready(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads.emplace_back([&, i] {
+            ready.fetch_add(1);
+            while (ready.load() < threadCount) {
+                std::this_thread::yield();
+            }
+            fn(i);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+static void BenchScaling(BenchOutput &out, uint32_t fileCount, uint64_t bytesPerThread) {
+    double singleMBPerSec = 0;
+    for (uint32_t chunkSize : {4096u, 65536u}) {
+        for (uint32_t threadCount = 1; threadCount <= fileCount; threadCount++) {
+            auto start = BenchNowNs();
+            RunThreads(threadCount, [&](uint32_t index) {
+                auto path = ThreadFilePath(index);
+                std::vector<uint8_t> buffer(chunkSize);
+                uint64_t done = 0;
+                while (done < bytesPerThread) {
+                    WUHBFileHandle handle;
+                    BenchCheck(WUHBUtils_FileOpen(path.c_str(), &handle), "WUHBUtils_FileOpen");
+                    int32_t read = -1;
+                    while (done < bytesPerThread) {
+                        BenchCheck(WUHBUtils_FileRead(handle, buffer.data(), chunkSize, &read), "WUHBUtils_FileRead");
+                        if (read <= 0) {
+                            break;
+                        }
+                        done += read;
+                    }
+                    WUHBUtils_FileClose(handle);
+                }
+            });
+            auto ns         = BenchNowNs() - start;
+            double mbPerSec = BenchMBPerSec(bytesPerThread * threadCount, ns);
+            if (threadCount == 1) {
+                singleMBPerSec = mbPerSec;
+            }
+            out.Write(JsonLine()
+                              .Add("benchmark", "scaling")
+                              .Add("chunk_size", chunkSize)
+                              .Add("threads", threadCount)
+                              .Add("bytes", bytesPerThread * threadCount)
+                              .Add("total_ns", ns)
+                              .Add("mb_per_s", mbPerSec)
+                              .Add("speedup", mbPerSec / singleMBPerSec));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args;
+    if (!BenchParseArgs(argc, argv, args)) {
+        return 1;
+    }
+    // One thread per core of the Wii U.
+    uint32_t threadCount    = 3;
+    uint64_t bytesPerThread = args.quick ? 256 * 1024 * 1024 : 1024ull * 1024 * 1024;
+
+    fprintf(stderr, "Generating test bundle...\n");
+    RomFSBuilder builder;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        builder.AddFile("/thread_" + std::to_string(i) + ".bin", BenchGenerateData(THREAD_FILE_SIZE, i, false));
+    }
+    auto bundlePath = args.workDir + "/wuhb_bench_threads.wuhb";
+    BenchWriteBundle(builder, bundlePath);
+    BenchCheck(WUHBUtils_InitLibrary(), "WUHBUtils_InitLibrary");
+    BenchMount("bench", bundlePath);
+
+    BenchOutput out(args);
+    BenchWriteMeta(out, "threads", args);
+    if (BenchEnabled(args, "scaling")) {
+        fprintf(stderr, "Running scaling...\n");
+        BenchScaling(out, threadCount, bytesPerThread);
+    }
+
+    WUHBUtils_UnmountBundle("bench", nullptr);
+    remove(bundlePath.c_str());
+    return 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *OSDynLoad_Module;
+
+typedef enum OSDynLoad_Error {
+    OS_DYNLOAD_OK               = 0,
+    OS_DYNLOAD_INVALID_NOTIFY   = 0xBAD10019,
+    OS_DYNLOAD_INVALID_ARGUMENT = 0xBAD10017,
+    OS_DYNLOAD_MODULE_NOT_FOUND = 0xBAD1002E,
+    OS_DYNLOAD_EXPORT_NOT_FOUND = 0xBAD10030,
+} OSDynLoad_Error;
+
+typedef enum OSDynLoad_ExportType {
+    OS_DYNLOAD_EXPORT_FUNC = 0,
+    OS_DYNLOAD_EXPORT_DATA = 1,
+} OSDynLoad_ExportType;
+
+/**
+ * Host replacement. Only "homebrew_wuhb_utils" (the stand-in module) can be acquired.
+ */
+OSDynLoad_Error OSDynLoad_Acquire(const char *name, OSDynLoad_Module *outModule);
+
+/**
+ * Host replacement. Looks up the export in the stand-in module, exports hidden via
+ * WUHBHost_SetHiddenExports or the WUHB_HOST_HIDE_EXPORTS environment variable are not found.
+ */
+OSDynLoad_Error OSDynLoad_FindExport(OSDynLoad_Module module, OSDynLoad_ExportType exportType, const char *name, void **outAddr);
+
+void OSDynLoad_Release(OSDynLoad_Module module);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Returns the address of an export of the stand-in WUHBUtilsModule or NULL if it doesn't exist.
+ */
+void *WUHBHost_FindModuleExport(const char *name);
+
+/**
+ * Hides exports of the stand-in module from OSDynLoad_FindExport to emulate older module versions.
+ * Has to be called before WUHBUtils_InitLibrary.
+ *
+ * @param exports   comma separated list of export names (e.g. "WUU_FileGetSize,WUU_GetRPXInfo"),
+ *                  NULL or "" to make all exports visible again.
+ *                  Defaults to the value of the WUHB_HOST_HIDE_EXPORTS environment variable.
+ */
+void WUHBHost_SetHiddenExports(const char *exports);
+
+/**
+ * Number of OSDynLoad_FindExport calls so far, e.g. to count the exports looked up by WUHBUtils_InitLibrary.
+ */
+unsigned int WUHBHost_GetFindExportCount();
+
+/**
+ * Makes OSDynLoad_Acquire fail for the stand-in module to emulate a missing module.
+ */
+void WUHBHost_SetModuleLoaded(int loaded);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
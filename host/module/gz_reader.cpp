@@ -0,0 +1,95 @@
+#include "gz_reader.h"
+
+#define GZ_INPUT_BUFFER_SIZE (64 * 1024)
+#define GZ_SKIP_BUFFER_SIZE  (32 * 1024)
+
+GzReader::GzReader(std::shared_ptr<RomFS> romfs, const RomFS::FileEntry &entry) : mRomfs(std::move(romfs)), mEntry(entry) {
+}
+
+GzReader::~GzReader() {
+    if (mInitialized) {
+        inflateEnd(&mStream);
+    }
+}
+
+bool GzReader::Init() {
+    mInput.reset(new (std::nothrow) uint8_t[GZ_INPUT_BUFFER_SIZE]);
+    if (!mInput || inflateInit2(&mStream, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    mInitialized = true;
+    return true;
+}
+
+bool GzReader::Reset() {
+    if (inflateReset(&mStream) != Z_OK) {
+        return false;
+    }
+    mStream.avail_in = 0;
+    mStreamEnd       = false;
+    mRawPos          = 0;
+    mPos             = 0;
+    return true;
+}
+
+int64_t GzReader::Read(uint8_t *buffer, uint64_t size) {
+    uint64_t total = 0;
+    while (total < size && !mStreamEnd) {
+        if (mStream.avail_in == 0) {
+            uint64_t toRead = mEntry.size - mRawPos;
+            if (toRead > GZ_INPUT_BUFFER_SIZE) {
+                toRead = GZ_INPUT_BUFFER_SIZE;
+            }
+            if (toRead == 0) {
+                break;
+            }
+            auto res = mRomfs->ReadAt(mEntry.offset + mRawPos, mInput.get(), toRead);
+            if (res <= 0) {
+                return -1;
+            }
+            mRawPos += res;
+            mStream.next_in  = mInput.get();
+            mStream.avail_in = res;
+        }
+        uint64_t chunk    = size - total > UINT32_MAX ? UINT32_MAX : size - total;
+        mStream.next_out  = buffer + total;
+        mStream.avail_out = chunk;
+        auto res          = inflate(&mStream, Z_NO_FLUSH);
+        total += chunk - mStream.avail_out;
+        if (res == Z_STREAM_END) {
+            mStreamEnd = true;
+        } else if (res != Z_OK) {
+            return -1;
+        }
+    }
+    mPos += total;
+    return total;
+}
+
+bool GzReader::Seek(uint64_t pos) {
+    if (pos < mPos && !Reset()) {
+        return false;
+    }
+    uint8_t skipBuffer[GZ_SKIP_BUFFER_SIZE];
+    while (mPos < pos) {
+        uint64_t toSkip = pos - mPos < sizeof(skipBuffer) ? pos - mPos : sizeof(skipBuffer);
+        auto res        = Read(skipBuffer, toSkip);
+        if (res < 0) {
+            return false;
+        }
+        if (res == 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool GzReader::GetSize(uint32_t *outSize) const {
+    // The gzip trailer ends with the uncompressed size (mod 2^32, little endian).
+    uint8_t isize[4];
+    if (mEntry.size < 18 || mRomfs->ReadAt(mEntry.offset + mEntry.size - 4, isize, 4) != 4) {
+        return false;
+    }
+    *outSize = (uint32_t) isize[0] | ((uint32_t) isize[1] << 8) | ((uint32_t) isize[2] << 16) | ((uint32_t) isize[3] << 24);
+    return true;
+}
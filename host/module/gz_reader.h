@@ -0,0 +1,47 @@
+#pragma once
+#include "romfs.h"
+#include <memory>
+#include <zlib.h>
+
+/**
+ * Inflates a gzip compressed file inside a RomFS image.
+ */
+class GzReader {
+public:
+    GzReader(std::shared_ptr<RomFS> romfs, const RomFS::FileEntry &entry);
+    ~GzReader();
+
+    GzReader(const GzReader &)            = delete;
+    GzReader &operator=(const GzReader &) = delete;
+
+    bool Init();
+
+    /**
+     * Reads up to "size" uncompressed bytes, returns the number of bytes read or -1 on error.
+     */
+    int64_t Read(uint8_t *buffer, uint64_t size);
+
+    /**
+     * Moves to the given position of the uncompressed data. Going backwards restarts at the beginning of the stream.
+     */
+    bool Seek(uint64_t pos);
+
+    [[nodiscard]] uint64_t Tell() const { return mPos; }
+
+    /**
+     * Returns the uncompressed size stored in the gzip trailer (mod 2^32).
+     */
+    bool GetSize(uint32_t *outSize) const;
+
+private:
+    bool Reset();
+
+    std::shared_ptr<RomFS> mRomfs;
+    RomFS::FileEntry mEntry;
+    z_stream mStream{};
+    bool mInitialized = false;
+    bool mStreamEnd   = false;
+    uint64_t mRawPos  = 0;
+    uint64_t mPos     = 0;
+    std::unique_ptr<uint8_t[]> mInput;
+};
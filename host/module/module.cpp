@@ -0,0 +1,572 @@
+#include "gz_reader.h"
+#include "romfs.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
+#include <wuhb_host/host.h>
+#include <wuhb_utils/utils.h>
+
+/*
+ * Stand-in for the WUHBUtilsModule. Implements the WUU_* exports on top of WUHB RomFS images on the host file system.
+ */
+
+#define WUHB_HOST_MODULE_VERSION 1
+
+class OpenFile {
+public:
+    int64_t Read(uint8_t *buffer, uint32_t size);
+    int64_t ReadAt(uint64_t offset, uint8_t *buffer, uint32_t size) const;
+    int64_t ReadV(const WUHBIoVec *vecs, uint32_t count);
+    int64_t ReadVAt(uint64_t offset, const WUHBIoVec *vecs, uint32_t count) const;
+    bool GetSize(uint32_t *outSize) const;
+
+    std::mutex mutex;
+    std::shared_ptr<RomFS> romfs;
+    RomFS::FileEntry entry{};
+    uint64_t pos = 0; // position inside the (uncompressed) file.
+    std::unique_ptr<GzReader> gz;
+};
+
+struct OpenDirectory {
+    std::mutex mutex;
+    std::shared_ptr<RomFS> romfs; // keeps the names in "entries" alive
+    std::vector<RomFS::DirEntry> entries;
+    std::unordered_set<std::string_view> files; // names of all files, to detect "<file>.gz" next to "<file>"
+    size_t pos = 0;
+};
+
+static std::mutex sMountMutex;
+static std::map<std::string, std::shared_ptr<RomFS>, std::less<>> sMounts;
+
+static std::shared_mutex sFilesMutex;
+static std::map<WUHBFileHandle, std::shared_ptr<OpenFile>> sFiles;
+static WUHBFileHandle sNextHandle = 1;
+
+static std::mutex sDirsMutex;
+static std::map<WUHBDirHandle, std::shared_ptr<OpenDirectory>> sDirs;
+static WUHBDirHandle sNextDirHandle = 1;
+
+int64_t OpenFile::Read(uint8_t *buffer, uint32_t size) {
+    if (!gz) {
+        auto res = ReadAt(pos, buffer, size);
+        if (res > 0) {
+            pos += res;
+        }
+        return res;
+    }
+    // Seeks only update "pos", the stream is moved on the next read.
+    if (gz->Tell() != pos && !gz->Seek(pos)) {
+        return -1;
+    }
+    auto res = gz->Read(buffer, size);
+    pos      = gz->Tell();
+    return res;
+}
+
+int64_t OpenFile::ReadAt(uint64_t offset, uint8_t *buffer, uint32_t size) const {
+    if (!gz) {
+        if (offset >= entry.size) {
+            return 0;
+        }
+        uint64_t toRead = entry.size - offset;
+        if (toRead > size) {
+            toRead = size;
+        }
+        return romfs->ReadAt(entry.offset + offset, buffer, toRead);
+    }
+    // Don't touch the state of the handle, inflate into a separate stream.
+    GzReader reader(romfs, entry);
+    if (!reader.Init() || !reader.Seek(offset)) {
+        return -1;
+    }
+    return reader.Read(buffer, size);
+}
+
+int64_t OpenFile::ReadV(const WUHBIoVec *vecs, uint32_t count) {
+    int64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t done = 0;
+        while (done < vecs[i].size) {
+            auto res = Read(vecs[i].buffer + done, vecs[i].size - done);
+            if (res < 0) {
+                return -1;
+            }
+            if (res == 0) {
+                return total;
+            }
+            done += res;
+            total += res;
+        }
+    }
+    return total;
+}
+
+int64_t OpenFile::ReadVAt(uint64_t offset, const WUHBIoVec *vecs, uint32_t count) const {
+    // A single inflate stream serves all buffers of a compressed file.
+    std::unique_ptr<GzReader> reader;
+    if (gz) {
+        reader = std::make_unique<GzReader>(romfs, entry);
+        if (!reader->Init() || !reader->Seek(offset)) {
+            return -1;
+        }
+    }
+    int64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t done = 0;
+        while (done < vecs[i].size) {
+            auto res = reader ? reader->Read(vecs[i].buffer + done, vecs[i].size - done)
+                              : ReadAt(offset + total, vecs[i].buffer + done, vecs[i].size - done);
+            if (res < 0) {
+                return -1;
+            }
+            if (res == 0) {
+                return total;
+            }
+            done += res;
+            total += res;
+        }
+    }
+    return total;
+}
+
+bool OpenFile::GetSize(uint32_t *outSize) const {
+    if (gz) {
+        return gz->GetSize(outSize);
+    }
+    *outSize = (uint32_t) entry.size;
+    return true;
+}
+
+static bool SplitPath(std::string_view name, std::string_view *outMount, std::string_view *outPath) {
+    auto colon = name.find(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return false;
+    }
+    *outMount = name.substr(0, colon);
+    *outPath  = name.substr(colon + 1);
+    return true;
+}
+
+static std::shared_ptr<RomFS> GetMountedBundle(std::string_view mount) {
+    std::lock_guard<std::mutex> lock(sMountMutex);
+    auto it = sMounts.find(mount);
+    return it != sMounts.end() ? it->second : nullptr;
+}
+
+static std::shared_ptr<OpenFile> GetOpenFile(WUHBFileHandle handle) {
+    std::shared_lock<std::shared_mutex> lock(sFilesMutex);
+    auto it = sFiles.find(handle);
+    return it != sFiles.end() ? it->second : nullptr;
+}
+
+/**
+ * Maps a bundle path as it would be used on the console to a path on the host.
+ * "fs:" prefixes are stripped, "/vol/external01" is replaced by $WUHB_HOST_SD_ROOT if set.
+ */
+static std::string GetHostBundlePath(const char *path, BundleSource source) {
+    std::string result = path;
+    if (source == BundleSource_FileDescriptor && result.rfind("fs:", 0) == 0) {
+        result = result.substr(3);
+    }
+    const char *sdRoot = getenv("WUHB_HOST_SD_ROOT");
+    if (sdRoot && result.rfind("/vol/external01", 0) == 0) {
+        result = sdRoot + result.substr(strlen("/vol/external01"));
+    }
+    return result;
+}
+
+static WUHBUtilsApiErrorType WUU_GetVersion(WUHBUtilsVersion *outVersion) {
+    if (!outVersion) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    *outVersion = WUHB_HOST_MODULE_VERSION;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_MountBundle(const char *name, const char *path, BundleSource source, int32_t *outRes) {
+    if (!name || !path || !outRes || strchr(name, ':')) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(sMountMutex);
+    if (sMounts.count(name) > 0) {
+        return WUHB_UTILS_API_ERROR_MOUNT_NAME_TAKEN;
+    }
+    std::shared_ptr<RomFS> romfs = RomFS::Open(GetHostBundlePath(path, source));
+    if (!romfs) {
+        *outRes = -1;
+        return WUHB_UTILS_API_ERROR_NONE;
+    }
+    sMounts[name] = std::move(romfs);
+    *outRes       = 0;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_UnmountBundle(const char *name, int32_t *outRes) {
+    if (!name) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::lock_guard<std::mutex> lock(sMountMutex);
+    auto it = sMounts.find(name);
+    if (it == sMounts.end()) {
+        return WUHB_UTILS_API_ERROR_MOUNT_NOT_FOUND;
+    }
+    // Files that are still open keep a reference to the image.
+    sMounts.erase(it);
+    if (outRes) {
+        *outRes = 0;
+    }
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileOpen(const char *name, WUHBFileHandle *outHandle) {
+    if (!name || !outHandle) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::string_view mount, path;
+    if (!SplitPath(name, &mount, &path)) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+    auto romfs = GetMountedBundle(mount);
+    if (!romfs) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+
+    auto file   = std::make_shared<OpenFile>();
+    file->romfs = romfs;
+    if (!romfs->FindFile(path, &file->entry)) {
+        if (!romfs->FindFile(std::string(path) + ".gz", &file->entry)) {
+            return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+        }
+        file->gz = std::make_unique<GzReader>(romfs, file->entry);
+        if (!file->gz->Init()) {
+            return WUHB_UTILS_API_ERROR_NO_MEMORY;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(sFilesMutex);
+    WUHBFileHandle handle = sNextHandle++;
+    sFiles[handle]        = std::move(file);
+    *outHandle            = handle;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (!buffer || !outRes) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    auto res = file->Read(buffer, size > INT32_MAX ? INT32_MAX : size);
+    *outRes  = res < 0 ? -1 : (int32_t) res;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileClose(WUHBFileHandle handle) {
+    std::unique_lock<std::shared_mutex> lock(sFilesMutex);
+    if (sFiles.erase(handle) == 0) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileExists(const char *name, int32_t *outRes) {
+    if (!name || !outRes) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::string_view mount, path;
+    std::shared_ptr<RomFS> romfs;
+    RomFS::FileEntry entry{};
+    *outRes = SplitPath(name, &mount, &path) && (romfs = GetMountedBundle(mount)) && romfs->FindFile(path, &entry);
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_GetRPXInfo(const char *path, BundleSource source, WUHBRPXInfo *outFileInfo) {
+    if (!path || !outFileInfo) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto romfs = RomFS::Open(GetHostBundlePath(path, source));
+    if (!romfs) {
+        return WUHB_UTILS_API_ERROR_MOUNT_FAILED;
+    }
+    uint32_t codeDir;
+    if (!romfs->FindDir("/code", &codeDir)) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+    std::vector<RomFS::DirEntry> entries;
+    romfs->ListDir(codeDir, entries);
+    for (auto &entry : entries) {
+        if (!entry.isDir && entry.name.size() > 4 && entry.name.substr(entry.name.size() - 4) == ".rpx") {
+            outFileInfo->offset = entry.offset;
+            outFileInfo->length = entry.size;
+            return WUHB_UTILS_API_ERROR_NONE;
+        }
+    }
+    return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+}
+
+static WUHBUtilsApiErrorType WUU_FileGetSize(WUHBFileHandle handle, uint32_t *outSize) {
+    if (!outSize) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    if (!file->GetSize(outSize)) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos) {
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    int64_t base;
+    uint32_t size;
+    switch (origin) {
+        case WUHB_SEEK_SET:
+            base = 0;
+            break;
+        case WUHB_SEEK_CUR:
+            base = (int64_t) file->pos;
+            break;
+        case WUHB_SEEK_END:
+            if (!file->GetSize(&size)) {
+                return WUHB_UTILS_API_ERROR_INVALID_ARG;
+            }
+            base = size;
+            break;
+        default:
+            return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    if (base + offset < 0 || base + offset > UINT32_MAX) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    file->pos = base + offset;
+    if (outPos) {
+        *outPos = file->pos;
+    }
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileTell(WUHBFileHandle handle, uint32_t *outPos) {
+    if (!outPos) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    *outPos = file->pos;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (!buffer || !outRes) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    auto res = file->ReadAt(offset, buffer, size > INT32_MAX ? INT32_MAX : size);
+    *outRes  = res < 0 ? -1 : (int32_t) res;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static bool IsValidIoVec(const WUHBIoVec *vecs, uint32_t count) {
+    if (!vecs && count > 0) {
+        return false;
+    }
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!vecs[i].buffer && vecs[i].size > 0) {
+            return false;
+        }
+        total += vecs[i].size;
+    }
+    return total <= UINT32_MAX;
+}
+
+static WUHBUtilsApiErrorType WUU_FileReadV(WUHBFileHandle handle, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal) {
+    if (!IsValidIoVec(vecs, count) || !outTotal) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    auto res = file->ReadV(vecs, count);
+    if (res < 0) {
+        return WUHB_UTILS_API_ERROR_READ_FAILED;
+    }
+    *outTotal = (uint32_t) res;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_FileReadVAt(WUHBFileHandle handle, uint32_t offset, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal) {
+    if (!IsValidIoVec(vecs, count) || !outTotal) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    auto file = GetOpenFile(handle);
+    if (!file) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    auto res = file->ReadVAt(offset, vecs, count);
+    if (res < 0) {
+        return WUHB_UTILS_API_ERROR_READ_FAILED;
+    }
+    *outTotal = (uint32_t) res;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_GetFileInfo(const char *name, uint64_t *outOffset, uint64_t *outLength, bool *outIsCompressed) {
+    if (!name || !outOffset || !outLength || !outIsCompressed) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::string_view mount, path;
+    if (!SplitPath(name, &mount, &path)) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+    auto romfs = GetMountedBundle(mount);
+    if (!romfs) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+    RomFS::FileEntry entry{};
+    bool compressed = false;
+    if (!romfs->FindFile(path, &entry)) {
+        if (!romfs->FindFile(std::string(path) + ".gz", &entry)) {
+            return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+        }
+        compressed = true;
+    }
+    *outOffset       = entry.offset;
+    *outLength       = entry.size;
+    *outIsCompressed = compressed;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_OpenDir(const char *name, WUHBDirHandle *outHandle) {
+    if (!name || !outHandle) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::string_view mount, path;
+    if (!SplitPath(name, &mount, &path)) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+    auto romfs = GetMountedBundle(mount);
+    uint32_t dirIndex;
+    if (!romfs || !romfs->FindDir(path, &dirIndex)) {
+        return WUHB_UTILS_API_ERROR_FILE_NOT_FOUND;
+    }
+
+    auto dir   = std::make_shared<OpenDirectory>();
+    dir->romfs = romfs;
+    romfs->ListDir(dirIndex, dir->entries);
+    for (auto &entry : dir->entries) {
+        if (!entry.isDir) {
+            dir->files.insert(entry.name);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(sDirsMutex);
+    WUHBDirHandle handle = sNextDirHandle++;
+    sDirs[handle]        = std::move(dir);
+    *outHandle           = handle;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static void FillDirEntry(const OpenDirectory &dir, const RomFS::DirEntry &entry, WUHBDirEntry *outEntry) {
+    std::string_view name  = entry.name;
+    outEntry->type         = entry.isDir ? WUHB_DIR_ENTRY_TYPE_DIRECTORY : WUHB_DIR_ENTRY_TYPE_FILE;
+    outEntry->size         = entry.isDir ? 0 : (uint32_t) entry.size;
+    outEntry->isCompressed = false;
+    if (!entry.isDir && name.size() > 3 && name.substr(name.size() - 3) == ".gz" && dir.files.count(name.substr(0, name.size() - 3)) == 0) {
+        // Report the file the way WUU_FileOpen resolves it.
+        GzReader reader(dir.romfs, {entry.offset, entry.size});
+        uint32_t size;
+        if (reader.GetSize(&size)) {
+            name                   = name.substr(0, name.size() - 3);
+            outEntry->size         = size;
+            outEntry->isCompressed = true;
+        }
+    }
+    size_t length = std::min(name.size(), (size_t) WUHB_DIR_ENTRY_NAME_LENGTH - 1);
+    memcpy(outEntry->name, name.data(), length);
+    outEntry->name[length] = '\0';
+}
+
+static WUHBUtilsApiErrorType WUU_ReadDirBatch(WUHBDirHandle handle, WUHBDirEntry *entries, uint32_t maxEntries, uint32_t *outCount) {
+    if (!entries || maxEntries == 0 || !outCount) {
+        return WUHB_UTILS_API_ERROR_INVALID_ARG;
+    }
+    std::shared_ptr<OpenDirectory> dir;
+    {
+        std::lock_guard<std::mutex> lock(sDirsMutex);
+        auto it = sDirs.find(handle);
+        if (it == sDirs.end()) {
+            return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+        }
+        dir = it->second;
+    }
+    std::lock_guard<std::mutex> lock(dir->mutex);
+    uint32_t count = 0;
+    while (count < maxEntries && dir->pos < dir->entries.size()) {
+        FillDirEntry(*dir, dir->entries[dir->pos++], &entries[count++]);
+    }
+    *outCount = count;
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+static WUHBUtilsApiErrorType WUU_CloseDir(WUHBDirHandle handle) {
+    std::lock_guard<std::mutex> lock(sDirsMutex);
+    if (sDirs.erase(handle) == 0) {
+        return WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND;
+    }
+    return WUHB_UTILS_API_ERROR_NONE;
+}
+
+void *WUHBHost_FindModuleExport(const char *name) {
+    static const struct {
+        const char *name;
+        void *addr;
+    } sExports[] = {
+            {"WUU_GetVersion", (void *) &WUU_GetVersion},
+            {"WUU_MountBundle", (void *) &WUU_MountBundle},
+            {"WUU_UnmountBundle", (void *) &WUU_UnmountBundle},
+            {"WUU_FileOpen", (void *) &WUU_FileOpen},
+            {"WUU_FileRead", (void *) &WUU_FileRead},
+            {"WUU_FileClose", (void *) &WUU_FileClose},
+            {"WUU_FileExists", (void *) &WUU_FileExists},
+            {"WUU_GetRPXInfo", (void *) &WUU_GetRPXInfo},
+            {"WUU_FileGetSize", (void *) &WUU_FileGetSize},
+            {"WUU_FileSeek", (void *) &WUU_FileSeek},
+            {"WUU_FileTell", (void *) &WUU_FileTell},
+            {"WUU_FileReadAt", (void *) &WUU_FileReadAt},
+            {"WUU_FileReadV", (void *) &WUU_FileReadV},
+            {"WUU_FileReadVAt", (void *) &WUU_FileReadVAt},
+            {"WUU_OpenDir", (void *) &WUU_OpenDir},
+            {"WUU_ReadDirBatch", (void *) &WUU_ReadDirBatch},
+            {"WUU_CloseDir", (void *) &WUU_CloseDir},
+            {"WUU_GetFileInfo", (void *) &WUU_GetFileInfo},
+    };
+    for (auto &cur : sExports) {
+        if (strcmp(cur.name, name) == 0) {
+            return cur.addr;
+        }
+    }
+    return nullptr;
+}
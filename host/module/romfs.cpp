@@ -0,0 +1,406 @@
+#include "romfs.h"
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ROMFS_DIR_ENTRY_SIZE  0x18
+#define ROMFS_FILE_ENTRY_SIZE 0x20
+#define ROMFS_FILE_DATA_START 0x200
+#define ROMFS_FILE_ALIGNMENT  0x10
+
+static uint32_t ReadBE32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static uint64_t ReadBE64(const uint8_t *p) {
+    return ((uint64_t) ReadBE32(p) << 32) | ReadBE32(p + 4);
+}
+
+static void WriteBE32(uint8_t *p, uint32_t val) {
+    p[0] = val >> 24;
+    p[1] = val >> 16;
+    p[2] = val >> 8;
+    p[3] = val;
+}
+
+static void WriteBE64(uint8_t *p, uint64_t val) {
+    WriteBE32(p, val >> 32);
+    WriteBE32(p + 4, (uint32_t) val);
+}
+
+static uint64_t Align(uint64_t val, uint64_t alignment) {
+    return (val + alignment - 1) & ~(alignment - 1);
+}
+
+uint32_t RomFSCalcHash(uint32_t parent, std::string_view name, uint32_t tableSize) {
+    uint32_t hash = parent ^ 123456789;
+    for (unsigned char c : name) {
+        hash = (hash >> 5) | (hash << 27);
+        hash ^= c;
+    }
+    return hash % tableSize;
+}
+
+RomFS::~RomFS() {
+    if (mFd >= 0) {
+        close(mFd);
+    }
+}
+
+int64_t RomFS::ReadAt(uint64_t offset, void *buffer, uint64_t size) const {
+    uint64_t total = 0;
+    while (total < size) {
+        auto res = pread(mFd, (uint8_t *) buffer + total, size - total, (off_t) (offset + total));
+        if (res < 0) {
+            return -1;
+        }
+        if (res == 0) {
+            break;
+        }
+        total += res;
+    }
+    return (int64_t) total;
+}
+
+std::unique_ptr<RomFS> RomFS::Open(const std::string &path) {
+    std::unique_ptr<RomFS> romfs(new RomFS());
+    romfs->mFd = open(path.c_str(), O_RDONLY);
+    if (romfs->mFd < 0) {
+        return nullptr;
+    }
+    struct stat st {};
+    if (fstat(romfs->mFd, &st) < 0) {
+        return nullptr;
+    }
+    romfs->mImageSize = st.st_size;
+
+    uint8_t header[ROMFS_HEADER_SIZE];
+    if (romfs->ReadAt(0, header, sizeof(header)) != sizeof(header)) {
+        return nullptr;
+    }
+    if (ReadBE32(header) != ROMFS_HEADER_MAGIC || ReadBE32(header + 4) != ROMFS_HEADER_SIZE) {
+        return nullptr;
+    }
+    uint64_t dirHashTableOff   = ReadBE64(header + 0x08);
+    uint64_t dirHashTableSize  = ReadBE64(header + 0x10);
+    uint64_t dirTableOff       = ReadBE64(header + 0x18);
+    uint64_t dirTableSize      = ReadBE64(header + 0x20);
+    uint64_t fileHashTableOff  = ReadBE64(header + 0x28);
+    uint64_t fileHashTableSize = ReadBE64(header + 0x30);
+    uint64_t fileTableOff      = ReadBE64(header + 0x38);
+    uint64_t fileTableSize     = ReadBE64(header + 0x40);
+    romfs->mDataOff            = ReadBE64(header + 0x48);
+
+    auto loadTable = [&romfs](uint64_t off, uint64_t size, std::vector<uint8_t> &out) {
+        if (off > romfs->mImageSize || size > romfs->mImageSize - off) {
+            return false;
+        }
+        out.resize(size);
+        return romfs->ReadAt(off, out.data(), size) == (int64_t) size;
+    };
+    auto loadHashTable = [&loadTable](uint64_t off, uint64_t size, std::vector<uint32_t> &out) {
+        std::vector<uint8_t> raw;
+        if (!loadTable(off, size, raw)) {
+            return false;
+        }
+        out.resize(size / 4);
+        for (size_t i = 0; i < out.size(); i++) {
+            out[i] = ReadBE32(raw.data() + i * 4);
+        }
+        return true;
+    };
+
+    if (!loadHashTable(dirHashTableOff, dirHashTableSize, romfs->mDirHashTable) ||
+        !loadHashTable(fileHashTableOff, fileHashTableSize, romfs->mFileHashTable) ||
+        !loadTable(dirTableOff, dirTableSize, romfs->mDirTable) ||
+        !loadTable(fileTableOff, fileTableSize, romfs->mFileTable)) {
+        return nullptr;
+    }
+    if (romfs->mDirTable.size() < ROMFS_DIR_ENTRY_SIZE || romfs->mDataOff > romfs->mImageSize) {
+        return nullptr;
+    }
+    return romfs;
+}
+
+static bool GetEntry(const std::vector<uint8_t> &table, uint32_t off, uint32_t entrySize, std::string_view *outName) {
+    if (off == ROMFS_NONE || (uint64_t) off + entrySize > table.size()) {
+        return false;
+    }
+    uint32_t nameLen = ReadBE32(table.data() + off + entrySize - 4);
+    if ((uint64_t) off + entrySize + nameLen > table.size()) {
+        return false;
+    }
+    *outName = std::string_view((const char *) table.data() + off + entrySize, nameLen);
+    return true;
+}
+
+uint32_t RomFS::LookupDir(uint32_t parent, std::string_view name) const {
+    if (mDirHashTable.empty()) {
+        return ROMFS_NONE;
+    }
+    uint32_t cur = mDirHashTable[RomFSCalcHash(parent, name, mDirHashTable.size())];
+    std::string_view curName;
+    while (GetEntry(mDirTable, cur, ROMFS_DIR_ENTRY_SIZE, &curName)) {
+        const uint8_t *entry = mDirTable.data() + cur;
+        if (ReadBE32(entry) == parent && curName == name) {
+            return cur;
+        }
+        cur = ReadBE32(entry + 0x10);
+    }
+    return ROMFS_NONE;
+}
+
+uint32_t RomFS::LookupFile(uint32_t parent, std::string_view name) const {
+    if (mFileHashTable.empty()) {
+        return ROMFS_NONE;
+    }
+    uint32_t cur = mFileHashTable[RomFSCalcHash(parent, name, mFileHashTable.size())];
+    std::string_view curName;
+    while (GetEntry(mFileTable, cur, ROMFS_FILE_ENTRY_SIZE, &curName)) {
+        const uint8_t *entry = mFileTable.data() + cur;
+        if (ReadBE32(entry) == parent && curName == name) {
+            return cur;
+        }
+        cur = ReadBE32(entry + 0x18);
+    }
+    return ROMFS_NONE;
+}
+
+bool RomFS::FindDir(std::string_view path, uint32_t *outDir) const {
+    uint32_t cur = 0;
+    while (!path.empty()) {
+        auto slash          = path.find('/');
+        std::string_view cp = path.substr(0, slash);
+        path                = slash == std::string_view::npos ? std::string_view() : path.substr(slash + 1);
+        if (cp.empty() || cp == ".") {
+            continue;
+        }
+        if ((cur = LookupDir(cur, cp)) == ROMFS_NONE) {
+            return false;
+        }
+    }
+    *outDir = cur;
+    return true;
+}
+
+bool RomFS::FindFile(std::string_view path, FileEntry *outEntry) const {
+    auto slash = path.rfind('/');
+    uint32_t dir;
+    if (!FindDir(slash == std::string_view::npos ? std::string_view() : path.substr(0, slash), &dir)) {
+        return false;
+    }
+    auto name = slash == std::string_view::npos ? path : path.substr(slash + 1);
+    if (name.empty()) {
+        return false;
+    }
+    uint32_t file = LookupFile(dir, name);
+    if (file == ROMFS_NONE) {
+        return false;
+    }
+    const uint8_t *entry = mFileTable.data() + file;
+    outEntry->offset     = mDataOff + ReadBE64(entry + 0x08);
+    outEntry->size       = ReadBE64(entry + 0x10);
+    return outEntry->offset <= mImageSize && outEntry->size <= mImageSize - outEntry->offset;
+}
+
+void RomFS::ListDir(uint32_t dir, std::vector<DirEntry> &outEntries) const {
+    std::string_view name;
+    if (!GetEntry(mDirTable, dir, ROMFS_DIR_ENTRY_SIZE, &name)) {
+        return;
+    }
+    // Guard against loops in broken images.
+    size_t maxEntries = mDirTable.size() / ROMFS_DIR_ENTRY_SIZE + mFileTable.size() / ROMFS_FILE_ENTRY_SIZE;
+
+    uint32_t cur = ReadBE32(mDirTable.data() + dir + 0x08);
+    while (GetEntry(mDirTable, cur, ROMFS_DIR_ENTRY_SIZE, &name) && maxEntries-- > 0) {
+        outEntries.push_back({name, true, 0, 0});
+        cur = ReadBE32(mDirTable.data() + cur + 0x04);
+    }
+    cur = ReadBE32(mDirTable.data() + dir + 0x0C);
+    while (GetEntry(mFileTable, cur, ROMFS_FILE_ENTRY_SIZE, &name) && maxEntries-- > 0) {
+        const uint8_t *entry = mFileTable.data() + cur;
+        outEntries.push_back({name, false, mDataOff + ReadBE64(entry + 0x08), ReadBE64(entry + 0x10)});
+        cur = ReadBE32(entry + 0x04);
+    }
+}
+
+void RomFSBuilder::AddFile(const std::string &path, std::vector<uint8_t> data) {
+    Dir *cur   = &mRoot;
+    size_t pos = 0;
+    while (true) {
+        auto slash = path.find('/', pos);
+        auto cp    = path.substr(pos, slash == std::string::npos ? std::string::npos : slash - pos);
+        if (slash == std::string::npos) {
+            cur->files[cp] = std::move(data);
+            return;
+        }
+        if (!cp.empty()) {
+            cur = &cur->dirs[cp];
+        }
+        pos = slash + 1;
+    }
+}
+
+static uint32_t GetHashTableCount(uint32_t numEntries) {
+    if (numEntries < 3) {
+        return 3;
+    } else if (numEntries < 19) {
+        return numEntries | 1;
+    }
+    uint32_t count = numEntries;
+    while (count % 2 == 0 || count % 3 == 0 || count % 5 == 0 || count % 7 == 0 ||
+           count % 11 == 0 || count % 13 == 0 || count % 17 == 0) {
+        count++;
+    }
+    return count;
+}
+
+bool RomFSBuilder::Write(const std::string &outPath) const {
+    struct FlatDir {
+        std::string name;
+        uint32_t parent;
+        uint32_t offset;
+        uint32_t sibling   = ROMFS_NONE;
+        uint32_t childDir  = ROMFS_NONE;
+        uint32_t childFile = ROMFS_NONE;
+        uint32_t nextHash  = ROMFS_NONE;
+    };
+    struct FlatFile {
+        std::string name;
+        uint32_t parent;
+        uint32_t offset;
+        const std::vector<uint8_t> *data;
+        uint64_t dataOff  = 0;
+        uint32_t sibling  = ROMFS_NONE;
+        uint32_t nextHash = ROMFS_NONE;
+    };
+
+    std::vector<FlatDir> dirs;
+    std::vector<FlatFile> files;
+    uint32_t dirTableSize  = 0;
+    uint32_t fileTableSize = 0;
+
+    // Flatten the tree, every directory lists its sub directories and then its files.
+    std::vector<std::pair<const Dir *, size_t>> stack;
+    dirs.push_back({"", 0, 0});
+    dirTableSize += ROMFS_DIR_ENTRY_SIZE;
+    stack.emplace_back(&mRoot, 0);
+    while (!stack.empty()) {
+        auto [dir, idx] = stack.back();
+        stack.pop_back();
+        size_t prev = SIZE_MAX;
+        std::vector<std::pair<const Dir *, size_t>> children;
+        for (auto &[name, child] : dir->dirs) {
+            dirs.push_back({name, dirs[idx].offset, dirTableSize});
+            if (prev == SIZE_MAX) {
+                dirs[idx].childDir = dirTableSize;
+            } else {
+                dirs[prev].sibling = dirTableSize;
+            }
+            prev = dirs.size() - 1;
+            dirTableSize += ROMFS_DIR_ENTRY_SIZE + Align(name.size(), 4);
+            children.emplace_back(&child, prev);
+        }
+        prev = SIZE_MAX;
+        for (auto &[name, data] : dir->files) {
+            files.push_back({name, dirs[idx].offset, fileTableSize, &data});
+            if (prev == SIZE_MAX) {
+                dirs[idx].childFile = fileTableSize;
+            } else {
+                files[prev].sibling = fileTableSize;
+            }
+            prev = files.size() - 1;
+            fileTableSize += ROMFS_FILE_ENTRY_SIZE + Align(name.size(), 4);
+        }
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            stack.push_back(*it);
+        }
+    }
+
+    uint64_t dataSize = 0;
+    for (auto &file : files) {
+        file.dataOff = dataSize;
+        dataSize     = Align(dataSize + file.data->size(), ROMFS_FILE_ALIGNMENT);
+    }
+
+    std::vector<uint32_t> dirHashTable(GetHashTableCount(dirs.size()), ROMFS_NONE);
+    for (auto &dir : dirs) {
+        auto hash    = RomFSCalcHash(dir.parent, dir.name, dirHashTable.size());
+        dir.nextHash = dirHashTable[hash];
+        dirHashTable[hash] = dir.offset;
+    }
+    std::vector<uint32_t> fileHashTable(GetHashTableCount(files.size()), ROMFS_NONE);
+    for (auto &file : files) {
+        auto hash     = RomFSCalcHash(file.parent, file.name, fileHashTable.size());
+        file.nextHash = fileHashTable[hash];
+        fileHashTable[hash] = file.offset;
+    }
+
+    uint64_t dirHashTableOff  = Align(ROMFS_FILE_DATA_START + dataSize, 4);
+    uint64_t dirTableOff      = dirHashTableOff + dirHashTable.size() * 4;
+    uint64_t fileHashTableOff = dirTableOff + dirTableSize;
+    uint64_t fileTableOff     = fileHashTableOff + fileHashTable.size() * 4;
+
+    std::vector<uint8_t> meta(fileTableOff + fileTableSize - dirHashTableOff);
+    uint8_t *p = meta.data();
+    for (auto val : dirHashTable) {
+        WriteBE32(p, val);
+        p += 4;
+    }
+    for (auto &dir : dirs) {
+        WriteBE32(p + 0x00, dir.parent);
+        WriteBE32(p + 0x04, dir.sibling);
+        WriteBE32(p + 0x08, dir.childDir);
+        WriteBE32(p + 0x0C, dir.childFile);
+        WriteBE32(p + 0x10, dir.nextHash);
+        WriteBE32(p + 0x14, dir.name.size());
+        memcpy(p + ROMFS_DIR_ENTRY_SIZE, dir.name.data(), dir.name.size());
+        p += ROMFS_DIR_ENTRY_SIZE + Align(dir.name.size(), 4);
+    }
+    for (auto val : fileHashTable) {
+        WriteBE32(p, val);
+        p += 4;
+    }
+    for (auto &file : files) {
+        WriteBE32(p + 0x00, file.parent);
+        WriteBE32(p + 0x04, file.sibling);
+        WriteBE64(p + 0x08, file.dataOff);
+        WriteBE64(p + 0x10, file.data->size());
+        WriteBE32(p + 0x18, file.nextHash);
+        WriteBE32(p + 0x1C, file.name.size());
+        memcpy(p + ROMFS_FILE_ENTRY_SIZE, file.name.data(), file.name.size());
+        p += ROMFS_FILE_ENTRY_SIZE + Align(file.name.size(), 4);
+    }
+
+    uint8_t header[ROMFS_FILE_DATA_START] = {};
+    WriteBE32(header + 0x00, ROMFS_HEADER_MAGIC);
+    WriteBE32(header + 0x04, ROMFS_HEADER_SIZE);
+    WriteBE64(header + 0x08, dirHashTableOff);
+    WriteBE64(header + 0x10, dirHashTable.size() * 4);
+    WriteBE64(header + 0x18, dirTableOff);
+    WriteBE64(header + 0x20, dirTableSize);
+    WriteBE64(header + 0x28, fileHashTableOff);
+    WriteBE64(header + 0x30, fileHashTable.size() * 4);
+    WriteBE64(header + 0x38, fileTableOff);
+    WriteBE64(header + 0x40, fileTableSize);
+    WriteBE64(header + 0x48, ROMFS_FILE_DATA_START);
+
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    out.write((const char *) header, sizeof(header));
+    static const char padding[ROMFS_FILE_ALIGNMENT] = {};
+    uint64_t written                                 = 0;
+    for (auto &file : files) {
+        out.write(padding, file.dataOff - written);
+        out.write((const char *) file.data->data(), file.data->size());
+        written = file.dataOff + file.data->size();
+    }
+    out.write(padding, dirHashTableOff - ROMFS_FILE_DATA_START - written);
+    out.write((const char *) meta.data(), meta.size());
+    return out.good();
+}
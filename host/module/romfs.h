@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define ROMFS_HEADER_MAGIC 0x57554842 // "WUHB"
+#define ROMFS_HEADER_SIZE  0x50
+#define ROMFS_NONE         0xFFFFFFFF
+
+/**
+ * Read-only view of a WUHB RomFS image on disk.
+ *
+ * Layout (all values big-endian):
+ *   header      magic, header size and the offset/size of the tables below (u64)
+ *   dir table   parent, sibling, child dir, child file, next hash, name length (u32) + name
+ *   file table  parent, sibling (u32), data offset, data size (u64), next hash, name length (u32) + name
+ * Names are padded to 4 bytes, data offsets are relative to the start of the file data.
+ */
+class RomFS {
+public:
+    struct FileEntry {
+        uint64_t offset; // absolute offset of the data inside the bundle file
+        uint64_t size;
+    };
+
+    struct DirEntry {
+        std::string_view name;
+        bool isDir;
+        uint64_t offset; // absolute data offset for files
+        uint64_t size;   // data size for files
+    };
+
+    ~RomFS();
+
+    /**
+     * Opens and validates the image at "path", returns nullptr on error.
+     */
+    static std::unique_ptr<RomFS> Open(const std::string &path);
+
+    /**
+     * Looks up a file by its path inside the image (e.g. "/meta/meta.ini")
+     */
+    bool FindFile(std::string_view path, FileEntry *outEntry) const;
+
+    /**
+     * Looks up a directory by its path inside the image, "/" is the root directory.
+     */
+    bool FindDir(std::string_view path, uint32_t *outDir) const;
+
+    /**
+     * Lists the sub directories and files of a directory returned by FindDir.
+     */
+    void ListDir(uint32_t dir, std::vector<DirEntry> &outEntries) const;
+
+    /**
+     * pread on the underlying image, returns the number of bytes read or -1.
+     */
+    int64_t ReadAt(uint64_t offset, void *buffer, uint64_t size) const;
+
+    [[nodiscard]] uint64_t GetImageSize() const { return mImageSize; }
+
+private:
+    RomFS() = default;
+
+    uint32_t LookupDir(uint32_t parent, std::string_view name) const;
+    uint32_t LookupFile(uint32_t parent, std::string_view name) const;
+
+    int mFd             = -1;
+    uint64_t mImageSize = 0;
+    uint64_t mDataOff   = 0;
+    std::vector<uint32_t> mDirHashTable;
+    std::vector<uint32_t> mFileHashTable;
+    std::vector<uint8_t> mDirTable;
+    std::vector<uint8_t> mFileTable;
+};
+
+/**
+ * Creates WUHB RomFS images, used by mkwuhb and to generate test data.
+ */
+class RomFSBuilder {
+public:
+    /**
+     * Adds a file, "path" is the path inside the image (e.g. "/meta/meta.ini").
+     */
+    void AddFile(const std::string &path, std::vector<uint8_t> data);
+
+    bool Write(const std::string &outPath) const;
+
+private:
+    struct Dir {
+        std::map<std::string, Dir> dirs;
+        std::map<std::string, std::vector<uint8_t>> files;
+    };
+
+    Dir mRoot;
+};
+
+uint32_t RomFSCalcHash(uint32_t parent, std::string_view name, uint32_t tableSize);
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <coreinit/debug.h>
+#include <coreinit/dynload.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <wuhb_host/host.h>
+
+static std::mutex sExportsMutex;
+static std::string sHiddenExports;
+static bool sHiddenExportsSet = false;
+static bool sModuleLoaded     = true;
+static std::atomic<unsigned int> sFindExportCount(0);
+
+// The address of this is used as module handle.
+static int sModuleHandleDummy = 0;
+
+void OSReport(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+void WUHBHost_SetHiddenExports(const char *exports) {
+    std::lock_guard<std::mutex> lock(sExportsMutex);
+    sHiddenExports    = exports ? exports : "";
+    sHiddenExportsSet = true;
+}
+
+unsigned int WUHBHost_GetFindExportCount() {
+    return sFindExportCount.load();
+}
+
+void WUHBHost_SetModuleLoaded(int loaded) {
+    std::lock_guard<std::mutex> lock(sExportsMutex);
+    sModuleLoaded = loaded != 0;
+}
+
+static bool IsExportHidden(const char *name) {
+    std::lock_guard<std::mutex> lock(sExportsMutex);
+    if (!sHiddenExportsSet) {
+        const char *env   = getenv("WUHB_HOST_HIDE_EXPORTS");
+        sHiddenExports    = env ? env : "";
+        sHiddenExportsSet = true;
+    }
+    size_t len   = strlen(name);
+    size_t start = 0;
+    while (start <= sHiddenExports.size()) {
+        auto end = sHiddenExports.find(',', start);
+        if (end == std::string::npos) {
+            end = sHiddenExports.size();
+        }
+        if (end - start == len && sHiddenExports.compare(start, len, name) == 0) {
+            return true;
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+OSDynLoad_Error OSDynLoad_Acquire(const char *name, OSDynLoad_Module *outModule) {
+    if (!name || !outModule) {
+        return OS_DYNLOAD_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sExportsMutex);
+    if (!sModuleLoaded || strcmp(name, "homebrew_wuhb_utils") != 0) {
+        return OS_DYNLOAD_MODULE_NOT_FOUND;
+    }
+    *outModule = &sModuleHandleDummy;
+    return OS_DYNLOAD_OK;
+}
+
+OSDynLoad_Error OSDynLoad_FindExport(OSDynLoad_Module module, OSDynLoad_ExportType exportType, const char *name, void **outAddr) {
+    sFindExportCount++;
+    if (module != &sModuleHandleDummy || !name || !outAddr) {
+        return OS_DYNLOAD_INVALID_ARGUMENT;
+    }
+    if (exportType != OS_DYNLOAD_EXPORT_FUNC || IsExportHidden(name)) {
+        return OS_DYNLOAD_EXPORT_NOT_FOUND;
+    }
+    auto *addr = WUHBHost_FindModuleExport(name);
+    if (!addr) {
+        return OS_DYNLOAD_EXPORT_NOT_FOUND;
+    }
+    *outAddr = addr;
+    return OS_DYNLOAD_OK;
+}
+
+void OSDynLoad_Release(OSDynLoad_Module) {
+}
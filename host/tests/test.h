@@ -0,0 +1,108 @@
+#pragma once
+#include "romfs.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <wuhb_utils/utils.h>
+#include <zlib.h>
+
+/*
+ * Shared helpers for the host tests.
+ * A failed CHECK is reported and counted, the test keeps running so one run shows every failed check. CHECK may be
+ * used from several threads.
+ */
+
+static std::atomic<uint32_t> sTestFailed(0);
+
+#define CHECK(cond)                                                                  \
+    do {                                                                             \
+        if (!(cond)) {                                                               \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            sTestFailed++;                                                           \
+        }                                                                            \
+    } while (0)
+
+/**
+ * Deterministic, incompressible data.
+ */
+static inline std::vector<uint8_t> TestGenerateData(uint32_t size, uint32_t seed) {
+    std::vector<uint8_t> data(size);
+    uint32_t state = seed * 2654435761u + 1;
+    for (auto &byte : data) {
+        state = state * 1103515245u + 12345u;
+        byte  = (uint8_t) (state >> 16);
+    }
+    return data;
+}
+
+/**
+ * Deterministic text that compresses well, so gzip produces compressed instead of stored blocks.
+ */
+static inline std::vector<uint8_t> TestGenerateText(uint32_t size, uint32_t seed) {
+    static const char *words[] = {"wuhb ", "bundle ", "texture ", "sound ", "model ", "level ", "shader ", "font ", "\n"};
+    std::vector<uint8_t> data(size);
+    uint32_t state = seed * 2654435761u + 1;
+    uint32_t i     = 0;
+    while (i < size) {
+        state            = state * 1664525u + 1013904223u;
+        const char *word = words[(state >> 16) % (sizeof(words) / sizeof(words[0]))];
+        while (*word && i < size) {
+            data[i++] = *word++;
+        }
+    }
+    return data;
+}
+
+/**
+ * Compresses "data" into a gzip file.
+ */
+static inline std::vector<uint8_t> TestGzip(const std::vector<uint8_t> &data) {
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "deflateInit2 failed\n");
+        exit(1);
+    }
+    std::vector<uint8_t> out(deflateBound(&zs, data.size()));
+    zs.next_in   = (Bytef *) data.data();
+    zs.avail_in  = data.size();
+    zs.next_out  = out.data();
+    zs.avail_out = out.size();
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+/**
+ * Writes "builder" to "<temp dir>/<name>" and returns the path, exits on failure.
+ */
+static inline std::string TestWriteBundle(const RomFSBuilder &builder, const char *name) {
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    if (!builder.Write(path)) {
+        fprintf(stderr, "Failed to write %s\n", path.c_str());
+        exit(1);
+    }
+    return path;
+}
+
+static inline void TestInitLibrary() {
+    if (WUHBUtils_InitLibrary() != WUHB_UTILS_RESULT_SUCCESS) {
+        fprintf(stderr, "WUHBUtils_InitLibrary failed\n");
+        exit(1);
+    }
+}
+
+/**
+ * Prints the result, returns the exit code of the test.
+ */
+static inline int TestFinish(const char *name) {
+    if (sTestFailed > 0) {
+        fprintf(stderr, "%s: %u check(s) failed\n", name, sTestFailed.load());
+        return 1;
+    }
+    printf("%s: OK\n", name);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "test.h"
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/hash.h>
+#include <wuhb_utils/trace.h>
+
+/*
+ * The storage of bundle indices, hash manifests and traces comes from the allocator hooks and is returned to them
+ * once the bundle is unmounted or the trace stops.
+ */
+
+static constexpr uint32_t FILE_COUNT = 2000;
+
+struct TrackingAllocator {
+    std::mutex mutex;
+    std::unordered_map<void *, uint32_t> live; // pointer -> size
+    uint64_t liveBytes = 0;
+    uint32_t allocs    = 0;
+};
+
+static void *TrackingAlloc(uint32_t size, uint32_t alignment, void *userdata) {
+    auto *allocator = (TrackingAllocator *) userdata;
+    void *ptr       = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+    if (ptr) {
+        std::lock_guard<std::mutex> lock(allocator->mutex);
+        allocator->live[ptr] = size;
+        allocator->liveBytes += size;
+        allocator->allocs++;
+    }
+    return ptr;
+}
+
+static void TrackingFree(void *ptr, void *userdata) {
+    auto *allocator = (TrackingAllocator *) userdata;
+    {
+        std::lock_guard<std::mutex> lock(allocator->mutex);
+        auto it = allocator->live.find(ptr);
+        CHECK(it != allocator->live.end());
+        if (it != allocator->live.end()) {
+            allocator->liveBytes -= it->second;
+            allocator->live.erase(it);
+        }
+    }
+    free(ptr);
+}
+
+static uint64_t LiveBytes(TrackingAllocator &allocator) {
+    std::lock_guard<std::mutex> lock(allocator.mutex);
+    return allocator.liveBytes;
+}
+
+int main() {
+    RomFSBuilder builder;
+    std::string manifest = "crc32\n";
+    for (uint32_t i = 0; i < FILE_COUNT; i++) {
+        auto name = "dir_" + std::to_string(i % 20) + "/file_" + std::to_string(i) + ".bin";
+        auto data = TestGenerateData(16, i);
+        char line[16];
+        snprintf(line, sizeof(line), "%08X ", (uint32_t) crc32(0, data.data(), data.size()));
+        manifest += line + name + "\n";
+        builder.AddFile("/" + name, data);
+    }
+    builder.AddFile("/meta/hashes.txt", std::vector<uint8_t>(manifest.begin(), manifest.end()));
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_allocator.wuhb");
+
+    TrackingAllocator allocator;
+    CHECK(WUHBUtils_SetAllocator(TrackingAlloc, TrackingFree, &allocator) == WUHB_UTILS_RESULT_SUCCESS);
+    TestInitLibrary();
+    uint64_t base = LiveBytes(allocator);
+
+    // The index holds a slot, an extent and the path of every file.
+    int32_t outRes = -1;
+    CHECK(WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes) == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0);
+    WUHBBundleIndexInfo info;
+    CHECK(WUHBUtils_GetBundleIndexInfo("test", &info) == WUHB_UTILS_RESULT_SUCCESS);
+    uint64_t mounted = LiveBytes(allocator);
+    CHECK(mounted >= base + FILE_COUNT * 20);
+
+    CHECK(WUHBUtils_LoadHashManifest("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    uint64_t loaded = LiveBytes(allocator);
+    CHECK(loaded >= mounted + FILE_COUNT * 8);
+
+    CHECK(WUHBUtils_TraceStart(0) == WUHB_UTILS_RESULT_SUCCESS);
+    for (uint32_t i = 0; i < 100; i++) {
+        auto path = "test:/dir_" + std::to_string(i % 20) + "/file_" + std::to_string(i) + "_with_a_long_name.bin";
+        WUHBFileHandle handle;
+        CHECK(WUHBUtils_FileOpen(path.c_str(), &handle) != WUHB_UTILS_RESULT_SUCCESS);
+        path = "test:/dir_" + std::to_string(i % 20) + "/file_" + std::to_string(i) + ".bin";
+        CHECK(WUHBUtils_FileOpen(path.c_str(), &handle) == WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+    }
+    WUHBTraceInfo traceInfo;
+    CHECK(WUHBUtils_TraceGetInfo(&traceInfo) == WUHB_UTILS_RESULT_SUCCESS && traceInfo.events == 200 && traceInfo.paths == 100);
+    CHECK(LiveBytes(allocator) >= loaded + traceInfo.events * 16);
+    CHECK(WUHBUtils_TraceStop(nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(LiveBytes(allocator) == loaded);
+
+    CHECK(WUHBUtils_UnmountBundle("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(LiveBytes(allocator) == base);
+    WUHBUtils_DeInitLibrary();
+    CHECK(WUHBUtils_SetAllocator(nullptr, nullptr, nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(allocator.live.empty());
+    remove(bundlePath.c_str());
+    return TestFinish("test_allocator");
+}
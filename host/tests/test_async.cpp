@@ -0,0 +1,164 @@
+#include "test.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <wuhb_host/host.h>
+#include <wuhb_utils/async.h>
+
+/*
+ * Several WUHBUtils_FileReadAsync requests for the same handle on a pool with several worker threads. Without
+ * WUU_FileReadAt every read seeks the shared position of the handle, so requests that ran at the same time would read
+ * the wrong data. WUHBUtils_FileStream inside a completion callback on a pool with a single worker thread. The
+ * throughput of the pool is measured by bench_async.
+ */
+
+static constexpr uint32_t FILE_SIZE     = 1024 * 1024;
+static constexpr uint32_t READ_SIZE     = 64 * 1024;
+static constexpr uint32_t REQUEST_COUNT = 256;
+
+struct Read {
+    WUHBAsyncRequest *request = nullptr;
+    const std::vector<uint8_t> *expected;
+    uint32_t offset;
+    std::vector<uint8_t> buffer;
+};
+
+/**
+ * Submits REQUEST_COUNT reads at different offsets, alternating between the handles.
+ */
+static std::vector<Read> SubmitReads(const WUHBFileHandle *handles, const std::vector<uint8_t> *files, uint32_t fileCount) {
+    std::vector<Read> reads(REQUEST_COUNT);
+    for (uint32_t i = 0; i < REQUEST_COUNT; i++) {
+        auto &read    = reads[i];
+        uint32_t file = i % fileCount;
+        read.expected = &files[file];
+        read.offset   = (i * 7919u * 64u) % (FILE_SIZE - READ_SIZE);
+        read.buffer.resize(READ_SIZE);
+        CHECK(WUHBUtils_FileReadAsync(handles[file], read.offset, read.buffer.data(), READ_SIZE, WUHB_ASYNC_PRIORITY_NORMAL, nullptr, nullptr, &read.request) == WUHB_UTILS_RESULT_SUCCESS);
+    }
+    return reads;
+}
+
+/**
+ * Waits for and frees all requests, returns the number of cancelled ones. The data of all other requests is checked.
+ */
+static uint32_t FinishReads(std::vector<Read> &reads) {
+    uint32_t cancelled = 0;
+    for (auto &read : reads) {
+        if (!read.request) {
+            continue;
+        }
+        CHECK(WUHBUtils_AsyncWait(read.request) == WUHB_UTILS_RESULT_SUCCESS);
+        WUHBUtilsStatus status = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        uint32_t size          = 0;
+        CHECK(WUHBUtils_AsyncGetResult(read.request, &status, nullptr, &size) == WUHB_UTILS_RESULT_SUCCESS);
+        if (status == WUHB_UTILS_RESULT_REQUEST_CANCELLED) {
+            cancelled++;
+        } else {
+            CHECK(status == WUHB_UTILS_RESULT_SUCCESS && size == READ_SIZE);
+            CHECK(memcmp(read.buffer.data(), read.expected->data() + read.offset, READ_SIZE) == 0);
+        }
+        WUHBUtils_AsyncFree(read.request);
+    }
+    return cancelled;
+}
+
+static void TestSameHandle(const std::vector<uint8_t> *files) {
+    WUHBFileHandle handles[2];
+    CHECK(WUHBUtils_FileOpen("test:/a.bin", &handles[0]) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(WUHBUtils_FileOpen("test:/b.bin", &handles[1]) == WUHB_UTILS_RESULT_SUCCESS);
+    // The reads are emulated via seeking, they have to restore the position.
+    CHECK(WUHBUtils_FileSeek(handles[0], 100, WUHB_SEEK_SET, nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+
+    for (uint32_t fileCount = 1; fileCount <= 2; fileCount++) {
+        auto reads = SubmitReads(handles, files, fileCount);
+        CHECK(FinishReads(reads) == 0);
+    }
+    uint32_t pos = 0;
+    CHECK(WUHBUtils_FileTell(handles[0], &pos) == WUHB_UTILS_RESULT_SUCCESS && pos == 100);
+
+    // Requests waiting for their handle can be cancelled, requests that have finished already keep their data.
+    auto reads = SubmitReads(handles, files, 1);
+    for (uint32_t i = REQUEST_COUNT / 2; i < REQUEST_COUNT; i++) {
+        CHECK(WUHBUtils_AsyncCancel(reads[i].request) == WUHB_UTILS_RESULT_SUCCESS);
+    }
+    FinishReads(reads);
+
+    // Requests still waiting for their handle are cancelled by WUHBUtils_AsyncDeInit.
+    reads = SubmitReads(handles, files, 1);
+    CHECK(WUHBUtils_AsyncDeInit() == WUHB_UTILS_RESULT_SUCCESS);
+    FinishReads(reads);
+
+    CHECK(WUHBUtils_FileClose(handles[0]) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(WUHBUtils_FileClose(handles[1]) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+struct StreamContext {
+    std::vector<uint8_t> data;
+    WUHBUtilsStatus status = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    std::atomic<bool> done{false};
+};
+
+static bool AppendChunk(const uint8_t *data, uint32_t size, uint32_t offset, void *userdata) {
+    auto *out = (std::vector<uint8_t> *) userdata;
+    out->insert(out->end(), data, data + size);
+    return true;
+}
+
+static void StreamInCallback(WUHBAsyncRequest *request, void *context) {
+    auto *stream   = (StreamContext *) context;
+    stream->status = WUHBUtils_FileStream("test:/a.bin", 64 * 1024, AppendChunk, &stream->data);
+    stream->done   = true;
+}
+
+static void TestStreamInCallback(const std::vector<uint8_t> *files) {
+    // The only worker thread runs the callback, a read-ahead queued on the pool would never run.
+    CHECK(WUHBUtils_AsyncInit(1) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBFileHandle handle;
+    CHECK(WUHBUtils_FileOpen("test:/b.bin", &handle) == WUHB_UTILS_RESULT_SUCCESS);
+    uint8_t buffer[16];
+    StreamContext stream;
+    WUHBAsyncRequest *request = nullptr;
+    CHECK(WUHBUtils_FileReadAsync(handle, 0, buffer, sizeof(buffer), WUHB_ASYNC_PRIORITY_NORMAL, StreamInCallback, &stream, &request) == WUHB_UTILS_RESULT_SUCCESS);
+    for (uint32_t i = 0; i < 10000 && !stream.done; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!stream.done) {
+        // The worker is stuck and can't be joined.
+        fprintf(stderr, "WUHBUtils_FileStream in a completion callback didn't finish\n");
+        _Exit(1);
+    }
+    CHECK(stream.status == WUHB_UTILS_RESULT_SUCCESS && stream.data == files[0]);
+    CHECK(WUHBUtils_AsyncWait(request) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_AsyncFree(request);
+
+    // Streaming on other threads still reads ahead on the pool.
+    stream.data.clear();
+    CHECK(WUHBUtils_FileStream("test:/b.bin", 64 * 1024, AppendChunk, &stream.data) == WUHB_UTILS_RESULT_SUCCESS && stream.data == files[1]);
+    CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+int main() {
+    std::vector<uint8_t> files[2] = {TestGenerateData(FILE_SIZE, 1), TestGenerateData(FILE_SIZE, 2)};
+    RomFSBuilder builder;
+    builder.AddFile("/a.bin", files[0]);
+    builder.AddFile("/b.bin", files[1]);
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_async.wuhb");
+
+    WUHBHost_SetHiddenExports("WUU_FileReadAt");
+    TestInitLibrary();
+    int32_t outRes = -1;
+    CHECK(WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes) == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0);
+    CHECK(WUHBUtils_AsyncInit(WUHB_ASYNC_MAX_THREADS) == WUHB_UTILS_RESULT_SUCCESS);
+
+    TestSameHandle(files);
+    TestStreamInCallback(files);
+
+    CHECK(WUHBUtils_UnmountBundle("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_DeInitLibrary();
+    WUHBHost_SetHiddenExports(nullptr);
+    remove(bundlePath.c_str());
+    return TestFinish("test_async");
+}
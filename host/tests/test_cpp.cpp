@@ -0,0 +1,240 @@
+#include "test.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <wuhb_host/host.h>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/utils.hpp>
+
+/*
+ * Behaviour of the C++ layer in <wuhb_utils/utils.hpp>: ownership of files and mounts when they are moved, released
+ * and destroyed, wuhb::readAll with and without a known file size, and wuhb::Buffer freeing via the current allocator.
+ * The timing of the same calls is measured by bench_cpp.
+ */
+
+// Multiple of the chunk size readAll grows the container by if the size of the file is unknown.
+static constexpr uint32_t CHUNK_FILE_SIZE = 256 * 1024;
+static constexpr uint32_t ODD_FILE_SIZE   = 300 * 1024 + 17;
+
+/**
+ * Returns true if "handle" is still open.
+ */
+static bool IsOpen(WUHBFileHandle handle) {
+    uint32_t pos;
+    return WUHBUtils_FileTell(handle, &pos) == WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Returns true if "name" is still mounted.
+ */
+static bool IsMounted(const char *name) {
+    int32_t exists = 0;
+    return WUHBUtils_FileExists((std::string(name) + ":/odd.bin").c_str(), &exists) == WUHB_UTILS_RESULT_SUCCESS && exists;
+}
+
+static void TestFileMove(const std::string &bundlePath) {
+    wuhb::Mount mount;
+    CHECK(wuhb::Mount::mount("test", bundlePath.c_str(), BundleSource_FileDescriptor, mount) == WUHB_UTILS_RESULT_SUCCESS);
+
+    wuhb::File file;
+    CHECK(!file && !file.isOpen());
+    CHECK(wuhb::File::open("test:/odd.bin", file) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(file);
+    WUHBFileHandle handle = file.handle();
+
+    // Moving hands over the handle, the moved-from file doesn't close it.
+    wuhb::File moved(std::move(file));
+    CHECK(!file && moved && moved.handle() == handle);
+    CHECK(file.close() == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(IsOpen(handle));
+
+    // Assigning closes the file held before.
+    wuhb::File other;
+    CHECK(wuhb::File::open("test:/chunk.bin", other) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBFileHandle otherHandle = other.handle();
+    other                      = std::move(moved);
+    CHECK(!moved && other.handle() == handle);
+    CHECK(!IsOpen(otherHandle) && IsOpen(handle));
+
+    auto &self = other;
+    other      = std::move(self);
+    CHECK(other && IsOpen(handle));
+
+    // Opening into an open file closes the old one.
+    CHECK(wuhb::File::open("test:/chunk.bin", other) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(!IsOpen(handle));
+    handle = other.handle();
+
+    // A failed open leaves the file untouched.
+    CHECK(wuhb::File::open("test:/missing.bin", other) != WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(other && other.handle() == handle && IsOpen(handle));
+
+    CHECK(other.release() == handle);
+    CHECK(!other);
+    {
+        wuhb::File owner(handle);
+        CHECK(IsOpen(handle));
+    }
+    CHECK(!IsOpen(handle));
+}
+
+static void TestMountMove(const std::string &bundlePath) {
+    wuhb::Mount first;
+    CHECK(!first);
+    CHECK(wuhb::Mount::mount("first", bundlePath.c_str(), BundleSource_FileDescriptor, first) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(first && first.name() == "first" && IsMounted("first"));
+
+    wuhb::Mount moved(std::move(first));
+    CHECK(!first && moved && moved.name() == "first");
+    CHECK(first.unmount() == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(IsMounted("first"));
+
+    {
+        // Assigning unmounts the bundle held before.
+        wuhb::Mount second;
+        CHECK(wuhb::Mount::mount("second", bundlePath.c_str(), BundleSource_FileDescriptor, second) == WUHB_UTILS_RESULT_SUCCESS);
+        second = std::move(moved);
+        CHECK(!moved && second.name() == "first");
+        CHECK(!IsMounted("second") && IsMounted("first"));
+
+        // A failed mount leaves the mount untouched.
+        CHECK(wuhb::Mount::mount("third", (bundlePath + ".missing").c_str(), BundleSource_FileDescriptor, second) != WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(second && second.name() == "first" && IsMounted("first"));
+    }
+    // Destroying unmounts.
+    CHECK(!IsMounted("first"));
+    CHECK(WUHBUtils_UnmountBundle("first", nullptr) == WUHB_UTILS_RESULT_MOUNT_NOT_FOUND);
+}
+
+/**
+ * readAll of every test file, of the rest of a file after seeking and of a missing file.
+ */
+static void CheckReadAll(const std::vector<uint8_t> &odd, const std::vector<uint8_t> &chunk) {
+    std::vector<uint8_t> data = {1, 2, 3};
+    CHECK(wuhb::readAll("test:/odd.bin", data) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(data == odd);
+    CHECK(wuhb::readAll("test:/chunk.bin", data) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(data == chunk);
+    CHECK(wuhb::readAll("test:/empty.bin", data) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(data.empty());
+
+    std::string text;
+    CHECK(wuhb::readAll("test:/odd.bin", text) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(text.size() == odd.size() && std::equal(odd.begin(), odd.end(), (const uint8_t *) text.data()));
+
+    wuhb::File file;
+    CHECK(wuhb::File::open("test:/odd.bin", file) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(file.seek(1000) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(file.readAll(data) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(data.size() == odd.size() - 1000 && std::equal(data.begin(), data.end(), odd.begin() + 1000));
+    CHECK(file.readAll(data) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(data.empty());
+
+    data = {1, 2, 3};
+    CHECK(wuhb::readAll("test:/missing.bin", data) != WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(data.size() == 3);
+}
+
+static void TestReadAll(const std::string &bundlePath, const std::vector<uint8_t> &odd, const std::vector<uint8_t> &chunk) {
+    wuhb::Mount mount;
+    CHECK(wuhb::Mount::mount("test", bundlePath.c_str(), BundleSource_FileDescriptor, mount) == WUHB_UTILS_RESULT_SUCCESS);
+    CheckReadAll(odd, chunk);
+}
+
+static void TestReadAllUnknownSize(const std::string &bundlePath, const std::vector<uint8_t> &odd, const std::vector<uint8_t> &chunk) {
+    // Without WUU_FileGetSize readAll grows the container while reading.
+    WUHBUtils_DeInitLibrary();
+    WUHBHost_SetHiddenExports("WUU_FileGetSize");
+    CHECK(WUHBUtils_InitLibrary() == WUHB_UTILS_RESULT_SUCCESS);
+    {
+        wuhb::Mount mount;
+        CHECK(wuhb::Mount::mount("test", bundlePath.c_str(), BundleSource_FileDescriptor, mount) == WUHB_UTILS_RESULT_SUCCESS);
+        wuhb::File file;
+        uint32_t size;
+        CHECK(wuhb::File::open("test:/odd.bin", file) == WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(file.size(size) != WUHB_UTILS_RESULT_SUCCESS);
+        CheckReadAll(odd, chunk);
+    }
+    WUHBUtils_DeInitLibrary();
+    WUHBHost_SetHiddenExports(nullptr);
+    CHECK(WUHBUtils_InitLibrary() == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+struct CountingAllocator {
+    uint32_t allocs = 0;
+    uint32_t frees  = 0;
+    void *lastFreed = nullptr;
+};
+
+static void *CountingAlloc(uint32_t size, uint32_t alignment, void *userdata) {
+    ((CountingAllocator *) userdata)->allocs++;
+    return aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+}
+
+static void CountingFree(void *ptr, void *userdata) {
+    auto *allocator = (CountingAllocator *) userdata;
+    allocator->frees++;
+    allocator->lastFreed = ptr;
+    free(ptr);
+}
+
+static void TestBufferDeleter(const std::string &bundlePath, const std::vector<uint8_t> &odd, const std::vector<uint8_t> &chunk) {
+    wuhb::Mount mount;
+    CHECK(wuhb::Mount::mount("test", bundlePath.c_str(), BundleSource_FileDescriptor, mount) == WUHB_UTILS_RESULT_SUCCESS);
+
+    CountingAllocator allocator;
+    CHECK(WUHBUtils_SetAllocator(CountingAlloc, CountingFree, &allocator) == WUHB_UTILS_RESULT_SUCCESS);
+    {
+        wuhb::Buffer buffer;
+        uint32_t size = 0;
+        CHECK(wuhb::readWholeFile("test:/odd.bin", buffer, size) == WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(buffer && size == odd.size() && std::equal(odd.begin(), odd.end(), buffer.get()));
+        uint8_t *first = buffer.get();
+        CHECK(allocator.frees == 0);
+
+        // Reading into a buffer that owns memory frees the old memory.
+        CHECK(wuhb::readWholeFile("test:/chunk.bin", buffer, size) == WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(size == chunk.size() && std::equal(chunk.begin(), chunk.end(), buffer.get()));
+        CHECK(allocator.frees == 1 && allocator.lastFreed == first);
+
+        // A failed read leaves the buffer untouched.
+        uint8_t *second = buffer.get();
+        CHECK(wuhb::readWholeFile("test:/missing.bin", buffer, size) != WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(buffer.get() == second && allocator.frees == 1);
+
+        // Released memory is freed via WUHBUtils_Free.
+        uint8_t *released = buffer.release();
+        CHECK(!buffer);
+        WUHBUtils_Free(released);
+        CHECK(allocator.frees == 2 && allocator.lastFreed == released);
+
+        CHECK(wuhb::readWholeFile("test:/odd.bin", buffer, size) == WUHB_UTILS_RESULT_SUCCESS);
+        second = buffer.get();
+        wuhb::Buffer moved(std::move(buffer));
+        CHECK(!buffer && moved.get() == second);
+    }
+    // Destroying the moved-to buffer frees the memory once.
+    CHECK(allocator.frees == 3 && allocator.allocs == allocator.frees);
+    CHECK(WUHBUtils_SetAllocator(nullptr, nullptr, nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+int main() {
+    auto odd   = TestGenerateData(ODD_FILE_SIZE, 1);
+    auto chunk = TestGenerateData(CHUNK_FILE_SIZE, 2);
+    RomFSBuilder builder;
+    builder.AddFile("/odd.bin", odd);
+    builder.AddFile("/chunk.bin", chunk);
+    builder.AddFile("/empty.bin", {});
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_cpp.wuhb");
+
+    TestInitLibrary();
+    TestFileMove(bundlePath);
+    TestMountMove(bundlePath);
+    TestReadAll(bundlePath, odd, chunk);
+    TestReadAllUnknownSize(bundlePath, odd, chunk);
+    TestBufferDeleter(bundlePath, odd, chunk);
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return TestFinish("test_cpp");
+}
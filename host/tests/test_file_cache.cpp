@@ -0,0 +1,142 @@
+#include "test.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <wuhb_utils/file_cache.h>
+
+/*
+ * Reference counting of <wuhb_utils/file_cache.h>: buffers stay valid after they have been evicted or invalidated,
+ * releasing a buffer too often is rejected instead of dropping a reference somebody else holds.
+ * Build with HOST_CXXFLAGS=-fsanitize=address to catch accesses to freed buffers.
+ */
+
+static constexpr uint32_t FILE_SIZE = 64 * 1024;
+
+static std::vector<uint8_t> sFiles[3];
+
+static bool Matches(const uint8_t *buffer, uint32_t size, uint32_t file) {
+    return buffer && size == sFiles[file].size() && std::equal(sFiles[file].begin(), sFiles[file].end(), buffer);
+}
+
+static std::string FilePath(uint32_t file) {
+    return "test:/file" + std::to_string(file) + ".bin";
+}
+
+static WUHBCacheStats GetStats() {
+    WUHBCacheStats stats = {};
+    CHECK(WUHBUtils_CacheGetStats(&stats) == WUHB_UTILS_RESULT_SUCCESS);
+    return stats;
+}
+
+static void TestReleaseAfterEviction() {
+    // Room for one file only.
+    CHECK(WUHBUtils_CacheSetBudget(FILE_SIZE) == WUHB_UTILS_RESULT_SUCCESS);
+    const uint8_t *first, *second;
+    uint32_t firstSize, secondSize;
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(0).c_str(), &first, &firstSize) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(1).c_str(), &second, &secondSize) == WUHB_UTILS_RESULT_SUCCESS);
+    auto stats = GetStats();
+    CHECK(stats.evictions == 1 && stats.entries == 1 && stats.activeBuffers == 2);
+
+    // The evicted file is still valid until it's released.
+    CHECK(Matches(first, firstSize, 0));
+    WUHBUtils_CacheRelease(first);
+    WUHBUtils_CacheRelease(second);
+    stats = GetStats();
+    CHECK(stats.activeBuffers == 0 && stats.entries == 1);
+    CHECK(WUHBUtils_CacheInvalidate(nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+static void TestDoubleRelease() {
+    CHECK(WUHBUtils_CacheSetBudget(FILE_SIZE * 4) == WUHB_UTILS_RESULT_SUCCESS);
+    const uint8_t *buffer;
+    uint32_t size;
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(0).c_str(), &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_CacheRelease(buffer);
+    // Would drop the reference of the cache itself.
+    WUHBUtils_CacheRelease(buffer);
+    auto stats = GetStats();
+    CHECK(stats.activeBuffers == 0 && stats.entries == 1);
+
+    // The cached file is still intact.
+    const uint8_t *again;
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(0).c_str(), &again, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(again == buffer && Matches(again, size, 0));
+    CHECK(GetStats().hits == 1);
+
+    // Two references of the same buffer need two releases.
+    const uint8_t *shared;
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(0).c_str(), &shared, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(shared == again && GetStats().activeBuffers == 2);
+    WUHBUtils_CacheRelease(again);
+    CHECK(Matches(shared, size, 0));
+    WUHBUtils_CacheRelease(shared);
+    CHECK(GetStats().activeBuffers == 0);
+
+    // An uncached buffer (bigger than the budget) is freed by its release, releasing it again must not touch it.
+    CHECK(WUHBUtils_CacheSetBudget(FILE_SIZE / 2) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(1).c_str(), &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(Matches(buffer, size, 1) && GetStats().entries == 0);
+    WUHBUtils_CacheRelease(buffer);
+    WUHBUtils_CacheRelease(buffer);
+    CHECK(GetStats().activeBuffers == 0);
+
+    // Neither is a pointer that has never been handed out.
+    uint8_t other[16];
+    WUHBUtils_CacheRelease(other);
+    CHECK(GetStats().activeBuffers == 0);
+    CHECK(WUHBUtils_CacheInvalidate(nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+static void TestInvalidateWhileHeld() {
+    CHECK(WUHBUtils_CacheSetBudget(FILE_SIZE * 4) == WUHB_UTILS_RESULT_SUCCESS);
+    const uint8_t *buffers[3];
+    uint32_t sizes[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK(WUHBUtils_CacheReadWholeFile(FilePath(i).c_str(), &buffers[i], &sizes[i]) == WUHB_UTILS_RESULT_SUCCESS);
+    }
+    auto before = GetStats();
+    CHECK(before.entries == 3);
+    CHECK(WUHBUtils_CacheInvalidate("test:/file1") == WUHB_UTILS_RESULT_SUCCESS);
+    auto stats = GetStats();
+    CHECK(stats.entries == 2 && stats.invalidations == before.invalidations + 1 && stats.cachedBytes == 2 * FILE_SIZE);
+    CHECK(WUHBUtils_CacheInvalidate(nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(GetStats().entries == 0 && GetStats().cachedBytes == 0);
+
+    // All buffers stay valid, and are freed by their release.
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK(Matches(buffers[i], sizes[i], i));
+        WUHBUtils_CacheRelease(buffers[i]);
+    }
+    CHECK(GetStats().activeBuffers == 0);
+
+    // Reading again loads the files again.
+    const uint8_t *buffer;
+    uint32_t size;
+    auto misses = GetStats().misses;
+    CHECK(WUHBUtils_CacheReadWholeFile(FilePath(1).c_str(), &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(Matches(buffer, size, 1) && GetStats().misses == misses + 1);
+    WUHBUtils_CacheRelease(buffer);
+    CHECK(WUHBUtils_CacheInvalidate(nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+int main() {
+    RomFSBuilder builder;
+    for (uint32_t i = 0; i < 3; i++) {
+        sFiles[i] = TestGenerateData(FILE_SIZE, i + 1);
+        builder.AddFile("/file" + std::to_string(i) + ".bin", sFiles[i]);
+    }
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_file_cache.wuhb");
+
+    TestInitLibrary();
+    int32_t outRes = -1;
+    CHECK(WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes) == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0);
+    TestReleaseAfterEviction();
+    TestDoubleRelease();
+    TestInvalidateWhileHeld();
+    WUHBUtils_UnmountBundle("test", nullptr);
+    WUHBUtils_CacheSetBudget(0);
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return TestFinish("test_file_cache");
+}
@@ -0,0 +1,145 @@
+#include "test.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <wuhb_utils/gz_index.h>
+
+/*
+ * Reads through a <wuhb_utils/gz_index.h> index against the uncompressed source: random offsets, offsets around the
+ * spans and the end of the file, via WUHBUtils_GzIndexReadAt and via WUHBUtils_FileReadAt and WUHBUtils_FileSeek +
+ * WUHBUtils_FileRead on a handle served by the index. The same reads are repeated with an index that went through
+ * WUHBUtils_GzIndexSave/WUHBUtils_GzIndexLoad. The speed of the reads is measured by bench_random_access.
+ */
+
+static constexpr uint32_t SPAN         = 64 * 1024;
+static constexpr uint32_t MAX_READ     = 3 * SPAN;
+static constexpr uint32_t RANDOM_READS = 200;
+
+struct Read {
+    uint32_t offset;
+    uint32_t size;
+};
+
+/**
+ * Reads at and around every multiple of the span, reads crossing them, reads at and after the end of the file and
+ * reads at random offsets, which also go backwards.
+ */
+static std::vector<Read> GetReads(uint32_t fileSize) {
+    std::vector<Read> reads;
+    for (uint32_t boundary = 0; boundary <= fileSize + SPAN; boundary += SPAN) {
+        for (uint32_t offset : {boundary - 1, boundary, boundary + 1}) {
+            if (offset != UINT32_MAX) {
+                reads.push_back({offset, 1});
+                reads.push_back({offset, 4096});
+            }
+        }
+        if (boundary >= 100) {
+            reads.push_back({boundary - 100, 200});
+            reads.push_back({boundary - 100, SPAN + 200});
+        }
+    }
+    for (uint32_t offset : {fileSize - 1, fileSize, fileSize + 1}) {
+        reads.push_back({offset, 1});
+        reads.push_back({offset, 1000});
+    }
+    reads.push_back({0, fileSize});
+    reads.push_back({fileSize - 100, 100});
+    std::mt19937 rng(1);
+    for (uint32_t i = 0; i < RANDOM_READS; i++) {
+        reads.push_back({(uint32_t) (rng() % fileSize), (uint32_t) (1 + rng() % MAX_READ)});
+    }
+    return reads;
+}
+
+static void CheckRead(const char *method, const Read &read, const uint8_t *buffer, int32_t readRes, const std::vector<uint8_t> &source) {
+    uint32_t expected = read.offset < source.size() ? std::min<uint32_t>(read.size, source.size() - read.offset) : 0;
+    if (readRes != (int32_t) expected || (expected > 0 && memcmp(buffer, source.data() + read.offset, expected) != 0)) {
+        fprintf(stderr, "%s: %u bytes at %u: got %d bytes, expected %u\n", method, read.size, read.offset, readRes, expected);
+        sTestFailed++;
+    }
+}
+
+static void TestReads(WUHBGzIndex *index, const std::vector<uint8_t> &source) {
+    auto reads = GetReads(source.size());
+    std::vector<uint8_t> buffer(source.size() + 1000);
+
+    for (auto &read : reads) {
+        int32_t readRes = -1;
+        CHECK(WUHBUtils_GzIndexReadAt(index, read.offset, buffer.data(), read.size, &readRes) == WUHB_UTILS_RESULT_SUCCESS);
+        CheckRead("WUHBUtils_GzIndexReadAt", read, buffer.data(), readRes, source);
+    }
+
+    WUHBFileHandle handle;
+    CHECK(WUHBUtils_FileOpen("test:/packed.bin", &handle) == WUHB_UTILS_RESULT_SUCCESS);
+    uint32_t size = 0;
+    CHECK(WUHBUtils_FileGetSize(handle, &size) == WUHB_UTILS_RESULT_SUCCESS && size == source.size());
+    for (auto &read : reads) {
+        int32_t readRes = -1;
+        CHECK(WUHBUtils_FileReadAt(handle, read.offset, buffer.data(), read.size, &readRes) == WUHB_UTILS_RESULT_SUCCESS);
+        CheckRead("WUHBUtils_FileReadAt", read, buffer.data(), readRes, source);
+    }
+    for (auto &read : reads) {
+        int32_t readRes = -1;
+        uint32_t pos    = 0;
+        CHECK(WUHBUtils_FileSeek(handle, read.offset, WUHB_SEEK_SET, &pos) == WUHB_UTILS_RESULT_SUCCESS && pos == read.offset);
+        CHECK(WUHBUtils_FileRead(handle, buffer.data(), read.size, &readRes) == WUHB_UTILS_RESULT_SUCCESS);
+        CheckRead("WUHBUtils_FileSeek + WUHBUtils_FileRead", read, buffer.data(), readRes, source);
+        if (readRes >= 0) {
+            CHECK(WUHBUtils_FileTell(handle, &pos) == WUHB_UTILS_RESULT_SUCCESS && pos == read.offset + readRes);
+        }
+    }
+
+    // Sequential reads continue the inflate stream across the spans.
+    CHECK(WUHBUtils_FileSeek(handle, 0, WUHB_SEEK_SET, nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    uint32_t offset = 0;
+    int32_t readRes = -1;
+    while (WUHBUtils_FileRead(handle, buffer.data() + offset, 12345, &readRes) == WUHB_UTILS_RESULT_SUCCESS && readRes > 0) {
+        offset += readRes;
+    }
+    CHECK(readRes == 0 && offset == source.size() && memcmp(buffer.data(), source.data(), source.size()) == 0);
+    CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+int main() {
+    // Text compresses into Huffman coded blocks, random data into stored blocks.
+    auto source = TestGenerateText(1024 * 1024 + 17, 1);
+    auto random = TestGenerateData(300 * 1024, 2);
+    source.insert(source.begin() + 400 * 1024, random.begin(), random.end());
+
+    RomFSBuilder builder;
+    builder.AddFile("/packed.bin.gz", TestGzip(source));
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_gz_index.wuhb");
+    auto indexPath  = (std::filesystem::temp_directory_path() / "wuhb_test_gz_index.idx").string();
+
+    TestInitLibrary();
+    int32_t outRes = -1;
+    CHECK(WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes) == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0);
+
+    WUHBGzIndex *index = nullptr;
+    CHECK(WUHBUtils_GzIndexBuild("test:/packed.bin", SPAN, 0, &index) == WUHB_UTILS_RESULT_SUCCESS);
+    if (index) {
+        WUHBGzIndexInfo info{};
+        CHECK(WUHBUtils_GzIndexGetInfo(index, &info) == WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(info.uncompressedSize == source.size() && info.span == SPAN && info.points > 1);
+        TestReads(index, source);
+
+        CHECK(WUHBUtils_GzIndexSave(index, indexPath.c_str()) == WUHB_UTILS_RESULT_SUCCESS);
+        CHECK(WUHBUtils_GzIndexFree(index) == WUHB_UTILS_RESULT_SUCCESS);
+        index = nullptr;
+        CHECK(WUHBUtils_GzIndexLoad("test:/packed.bin", indexPath.c_str(), &index) == WUHB_UTILS_RESULT_SUCCESS);
+        if (index) {
+            WUHBGzIndexInfo loaded{};
+            CHECK(WUHBUtils_GzIndexGetInfo(index, &loaded) == WUHB_UTILS_RESULT_SUCCESS);
+            CHECK(memcmp(&loaded, &info, sizeof(info)) == 0);
+            TestReads(index, source);
+            CHECK(WUHBUtils_GzIndexFree(index) == WUHB_UTILS_RESULT_SUCCESS);
+        }
+    }
+
+    CHECK(WUHBUtils_UnmountBundle("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_DeInitLibrary();
+    remove(indexPath.c_str());
+    remove(bundlePath.c_str());
+    return TestFinish("test_gz_index");
+}
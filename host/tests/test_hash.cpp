@@ -0,0 +1,196 @@
+#include "test.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/async.h>
+#include <wuhb_utils/hash.h>
+
+/*
+ * The hash kernels against independent references: CRC-32 against zlib's crc32 and xxHash32 against the published
+ * test vectors. Manifest verification of WUHBUtils_ReadWholeFile, WUHBUtils_ReadWholeFileAsync and WUHBUtils_FileStream
+ * with a manifest built via zlib's crc32. The throughput of the kernels is measured by bench_hash.
+ */
+
+static constexpr uint32_t BIG_FILE_SIZE = 2 * 1024 * 1024 + 512 * 1024 + 3; // more than one chunk of the async reads
+
+static uint32_t Hash(WUHBHashType type, const void *data, uint32_t size) {
+    uint32_t hash = 0;
+    CHECK(WUHBUtils_HashBuffer(type, data, size, &hash) == WUHB_UTILS_RESULT_SUCCESS);
+    return hash;
+}
+
+/**
+ * Hashes "data" incrementally in pieces of 1, 2, 3, ... bytes, so every alignment of the pending bytes is used.
+ */
+static uint32_t HashIncremental(WUHBHashType type, const std::vector<uint8_t> &data) {
+    WUHBHashState state;
+    CHECK(WUHBUtils_HashInit(&state, type) == WUHB_UTILS_RESULT_SUCCESS);
+    uint32_t offset = 0;
+    for (uint32_t piece = 1; offset < data.size(); piece = piece % 67 + 1) {
+        uint32_t size = std::min<uint32_t>(piece, data.size() - offset);
+        WUHBUtils_HashUpdate(&state, data.data() + offset, size);
+        offset += size;
+    }
+    return WUHBUtils_HashFinal(&state);
+}
+
+static void TestCrc32() {
+    auto data = TestGenerateData(1024 * 1024 + 7, 1);
+    for (uint32_t size : {0u, 1u, 3u, 4u, 7u, 8u, 15u, 16u, 31u, 64u, 255u, 1000u, 4096u, 65537u, (uint32_t) data.size()}) {
+        // Unaligned start addresses as well.
+        for (uint32_t offset = 0; offset < 4; offset++) {
+            uint32_t expected = crc32(0, data.data() + offset, std::min<uint32_t>(size, data.size() - offset));
+            CHECK(Hash(WUHB_HASH_CRC32, data.data() + offset, std::min<uint32_t>(size, data.size() - offset)) == expected);
+        }
+    }
+    CHECK(HashIncremental(WUHB_HASH_CRC32, data) == crc32(0, data.data(), data.size()));
+}
+
+static void TestXxh32() {
+    struct Vector {
+        const char *input;
+        uint32_t hash;
+    };
+    // Published xxHash32 values for seed 0.
+    static const Vector vectors[] = {
+            {"", 0x02CC5D05},
+            {"a", 0x550D7456},
+            {"abc", 0x32D153FF},
+            {"Nobody inspects the spammish repetition", 0xE2293B2F},
+    };
+    for (auto &vector : vectors) {
+        std::vector<uint8_t> input(vector.input, vector.input + strlen(vector.input));
+        CHECK(Hash(WUHB_HASH_XXH32, input.data(), input.size()) == vector.hash);
+        CHECK(HashIncremental(WUHB_HASH_XXH32, input) == vector.hash);
+    }
+
+    auto data = TestGenerateData(1024 * 1024 + 7, 2);
+    CHECK(HashIncremental(WUHB_HASH_XXH32, data) == Hash(WUHB_HASH_XXH32, data.data(), data.size()));
+    CHECK(Hash(WUHB_HASH_XXH32, data.data() + 1, data.size() - 1) != Hash(WUHB_HASH_XXH32, data.data(), data.size() - 1));
+}
+
+static void TestReadWholeFile(const std::vector<uint8_t> &good) {
+    uint8_t *buffer = nullptr;
+    uint32_t size   = 0;
+    CHECK(WUHBUtils_ReadWholeFile("test:/good.bin", &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(buffer && size == good.size() && memcmp(buffer, good.data(), size) == 0);
+    WUHBUtils_Free(buffer);
+
+    buffer = nullptr;
+    CHECK(WUHBUtils_ReadWholeFile("test:/bad.bin", &buffer, &size) == WUHB_UTILS_RESULT_HASH_MISMATCH);
+    CHECK(buffer == nullptr);
+    CHECK(WUHBUtils_ReadWholeFile("test:/packed.bin", &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_Free(buffer);
+    CHECK(WUHBUtils_ReadWholeFile("test:/unlisted.bin", &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_Free(buffer);
+}
+
+/**
+ * Reads "path" via WUHBUtils_ReadWholeFileAsync, returns the status of the request.
+ */
+static WUHBUtilsStatus ReadAsync(const char *path, std::vector<uint8_t> *outData) {
+    WUHBAsyncRequest *request = nullptr;
+    auto res                  = WUHBUtils_ReadWholeFileAsync(path, WUHB_ASYNC_PRIORITY_NORMAL, nullptr, nullptr, &request);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    CHECK(WUHBUtils_AsyncWait(request) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtilsStatus status = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    uint8_t *buffer        = nullptr;
+    uint32_t size          = 0;
+    CHECK(WUHBUtils_AsyncGetResult(request, &status, &buffer, &size) == WUHB_UTILS_RESULT_SUCCESS);
+    if (status == WUHB_UTILS_RESULT_SUCCESS) {
+        CHECK(buffer != nullptr);
+        outData->assign(buffer, buffer + size);
+    } else {
+        CHECK(buffer == nullptr);
+    }
+    WUHBUtils_Free(buffer);
+    WUHBUtils_AsyncFree(request);
+    return status;
+}
+
+static void TestReadWholeFileAsync(const std::vector<uint8_t> &good, const std::vector<uint8_t> &big) {
+    std::vector<uint8_t> data;
+    CHECK(ReadAsync("test:/good.bin", &data) == WUHB_UTILS_RESULT_SUCCESS && data == good);
+    CHECK(ReadAsync("test:/big.bin", &data) == WUHB_UTILS_RESULT_SUCCESS && data == big);
+    CHECK(ReadAsync("test:/bad.bin", &data) == WUHB_UTILS_RESULT_HASH_MISMATCH);
+    CHECK(ReadAsync("test:/big_bad.bin", &data) == WUHB_UTILS_RESULT_HASH_MISMATCH);
+    CHECK(ReadAsync("test:/packed.bin", &data) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(ReadAsync("test:/unlisted.bin", &data) == WUHB_UTILS_RESULT_SUCCESS);
+
+    // Disabled verification returns the data as it is.
+    CHECK(WUHBUtils_SetHashVerification(false) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(ReadAsync("test:/big_bad.bin", &data) == WUHB_UTILS_RESULT_SUCCESS && data.size() == BIG_FILE_SIZE);
+    CHECK(WUHBUtils_SetHashVerification(true) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+static bool AppendChunk(const uint8_t *data, uint32_t size, uint32_t offset, void *userdata) {
+    auto *out = (std::vector<uint8_t> *) userdata;
+    out->insert(out->end(), data, data + size);
+    return true;
+}
+
+static void TestFileStream(const std::vector<uint8_t> &big) {
+    std::vector<uint8_t> data;
+    CHECK(WUHBUtils_FileStream("test:/big.bin", 256 * 1024, AppendChunk, &data) == WUHB_UTILS_RESULT_SUCCESS && data == big);
+    data.clear();
+    CHECK(WUHBUtils_FileStream("test:/big_bad.bin", 256 * 1024, AppendChunk, &data) == WUHB_UTILS_RESULT_HASH_MISMATCH);
+}
+
+/**
+ * Manifest line with the CRC-32 of "data" as computed by zlib.
+ */
+static std::string ManifestLine(const std::vector<uint8_t> &data, const char *path) {
+    char line[16];
+    snprintf(line, sizeof(line), "%08X ", (uint32_t) crc32(0, data.data(), data.size()));
+    return std::string(line) + path + "\n";
+}
+
+int main() {
+    TestCrc32();
+    TestXxh32();
+
+    auto good = TestGenerateData(100 * 1024 + 1, 3);
+    auto big  = TestGenerateData(BIG_FILE_SIZE, 4);
+    auto text = TestGenerateText(300 * 1024, 5);
+    auto bad  = good;
+    bad[bad.size() / 2] ^= 0x01;
+    auto bigBad = big;
+    bigBad[BIG_FILE_SIZE - 1] ^= 0x80;
+
+    // The manifest lists the hashes of the original files, "bad" and "big_bad" are stored with a flipped bit.
+    std::string manifest = "crc32\n";
+    manifest += ManifestLine(good, "good.bin");
+    manifest += ManifestLine(good, "bad.bin");
+    manifest += ManifestLine(big, "big.bin");
+    manifest += ManifestLine(big, "big_bad.bin");
+    manifest += ManifestLine(text, "packed.bin");
+
+    RomFSBuilder builder;
+    builder.AddFile("/good.bin", good);
+    builder.AddFile("/bad.bin", bad);
+    builder.AddFile("/big.bin", big);
+    builder.AddFile("/big_bad.bin", bigBad);
+    builder.AddFile("/packed.bin.gz", TestGzip(text));
+    builder.AddFile("/unlisted.bin", TestGenerateData(1000, 6));
+    builder.AddFile("/meta/hashes.txt", std::vector<uint8_t>(manifest.begin(), manifest.end()));
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_hash.wuhb");
+
+    TestInitLibrary();
+    int32_t outRes = -1;
+    CHECK(WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes) == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0);
+    CHECK(WUHBUtils_LoadHashManifest("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(WUHBUtils_SetHashVerification(true) == WUHB_UTILS_RESULT_SUCCESS);
+
+    TestReadWholeFile(good);
+    TestReadWholeFileAsync(good, big);
+    TestFileStream(big);
+
+    CHECK(WUHBUtils_SetHashVerification(false) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(WUHBUtils_UnmountBundle("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return TestFinish("test_hash");
+}
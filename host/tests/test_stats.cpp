@@ -0,0 +1,122 @@
+#include "test.h"
+#include <chrono>
+#include <thread>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/gz_index.h>
+#include <wuhb_utils/prefetch.h>
+#include <wuhb_utils/stats.h>
+
+/*
+ * Every read of the application is counted once: reads via a ".gz" index count the uncompressed bytes only, files
+ * loaded by the prefetch thread count when the application reads them. Needs a build with WUHB_UTILS_STATS
+ * ("make -C host test WUHB_UTILS_STATS=1 BUILD=build_stats"), otherwise the test only checks that the statistics
+ * are unsupported.
+ */
+
+static constexpr uint32_t PACKED_FILE_SIZE = 512 * 1024;
+static constexpr uint32_t STAGED_FILE_SIZE = 100 * 1024 + 3;
+
+static WUHBStats GetStats() {
+    WUHBStats stats{};
+    CHECK(WUHBUtils_GetStats(&stats) == WUHB_UTILS_RESULT_SUCCESS);
+    return stats;
+}
+
+static void TestGzIndex() {
+    WUHBGzIndex *index = nullptr;
+    CHECK(WUHBUtils_GzIndexBuild("test:/packed.bin", 64 * 1024, 0, &index) == WUHB_UTILS_RESULT_SUCCESS);
+    if (!index) {
+        return;
+    }
+    // Building the index reads the compressed data, that isn't a read of the application.
+    auto stats = GetStats();
+    CHECK(stats.bytesReadPlain == 0 && stats.bytesReadCompressed == 0);
+    CHECK(stats.calls[WUHB_STATS_CALL_FILE_OPEN] == 0 && stats.calls[WUHB_STATS_CALL_FILE_READ] == 0);
+    CHECK(stats.openFileHandles == 0);
+
+    WUHBFileHandle handle;
+    CHECK(WUHBUtils_FileOpen("test:/packed.bin", &handle) == WUHB_UTILS_RESULT_SUCCESS);
+    uint8_t buffer[4096];
+    int32_t read = -1;
+    CHECK(WUHBUtils_FileReadAt(handle, 200 * 1024, buffer, sizeof(buffer), &read) == WUHB_UTILS_RESULT_SUCCESS && read == sizeof(buffer));
+    CHECK(WUHBUtils_FileRead(handle, buffer, 1000, &read) == WUHB_UTILS_RESULT_SUCCESS && read == 1000);
+    stats = GetStats();
+    CHECK(stats.openFileHandles == 1);
+    CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+
+    stats = GetStats();
+    CHECK(stats.bytesReadCompressed == sizeof(buffer) + 1000 && stats.bytesReadPlain == 0);
+    CHECK(stats.calls[WUHB_STATS_CALL_FILE_OPEN] == 1 && stats.calls[WUHB_STATS_CALL_FILE_CLOSE] == 1);
+    CHECK(stats.calls[WUHB_STATS_CALL_FILE_READ_AT] == 1 && stats.calls[WUHB_STATS_CALL_FILE_READ] == 1);
+    CHECK(stats.readLatency.count == 2);
+    CHECK(stats.openFileHandles == 0);
+    CHECK(WUHBUtils_GzIndexFree(index) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+/**
+ * Stages "path", returns false after 10 seconds.
+ */
+static bool Stage(const char *path) {
+    CHECK(WUHBUtils_Prefetch(&path, 1, 0) == WUHB_UTILS_RESULT_SUCCESS);
+    for (uint32_t i = 0; i < 10000; i++) {
+        WUHBPrefetchStats stats;
+        if (WUHBUtils_PrefetchGetStats(&stats) == WUHB_UTILS_RESULT_SUCCESS && stats.queued == 0 && stats.stagedFiles == 1) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static void TestPrefetch() {
+    // Loading the file isn't a read of the application.
+    CHECK(Stage("test:/staged.bin"));
+    auto stats = GetStats();
+    CHECK(stats.bytesReadPlain == 0 && stats.calls[WUHB_STATS_CALL_FILE_OPEN] == 0 && stats.calls[WUHB_STATS_CALL_FILE_READ] == 0);
+
+    WUHBFileHandle handle;
+    CHECK(WUHBUtils_FileOpen("test:/staged.bin", &handle) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(GetStats().openFileHandles == 1);
+    std::vector<uint8_t> buffer(STAGED_FILE_SIZE);
+    int32_t read = -1;
+    CHECK(WUHBUtils_FileRead(handle, buffer.data(), buffer.size(), &read) == WUHB_UTILS_RESULT_SUCCESS && read == (int32_t) STAGED_FILE_SIZE);
+    CHECK(WUHBUtils_FileReadAt(handle, 10, buffer.data(), 100, &read) == WUHB_UTILS_RESULT_SUCCESS && read == 100);
+    CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+    stats = GetStats();
+    CHECK(stats.bytesReadPlain == STAGED_FILE_SIZE + 100 && stats.bytesReadCompressed == 0);
+    CHECK(stats.openFileHandles == 0);
+
+    CHECK(WUHBUtils_ResetStats() == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(Stage("test:/staged.bin"));
+    uint8_t *data = nullptr;
+    uint32_t size = 0;
+    CHECK(WUHBUtils_ReadWholeFile("test:/staged.bin", &data, &size) == WUHB_UTILS_RESULT_SUCCESS && size == STAGED_FILE_SIZE);
+    WUHBUtils_Free(data);
+    stats = GetStats();
+    CHECK(stats.bytesReadPlain == STAGED_FILE_SIZE && stats.calls[WUHB_STATS_CALL_FILE_OPEN] == 0);
+}
+
+int main() {
+    RomFSBuilder builder;
+    builder.AddFile("/packed.bin.gz", TestGzip(TestGenerateText(PACKED_FILE_SIZE, 1)));
+    builder.AddFile("/staged.bin", TestGenerateData(STAGED_FILE_SIZE, 2));
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_stats.wuhb");
+
+    TestInitLibrary();
+    int32_t outRes = -1;
+    CHECK(WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes) == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0);
+    WUHBStats stats;
+    if (WUHBUtils_GetStats(&stats) == WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND) {
+        CHECK(WUHBUtils_ResetStats() == WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND);
+    } else {
+        CHECK(WUHBUtils_ResetStats() == WUHB_UTILS_RESULT_SUCCESS);
+        TestGzIndex();
+        CHECK(WUHBUtils_ResetStats() == WUHB_UTILS_RESULT_SUCCESS);
+        TestPrefetch();
+    }
+
+    CHECK(WUHBUtils_UnmountBundle("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return TestFinish("test_stats");
+}
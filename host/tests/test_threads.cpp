@@ -0,0 +1,265 @@
+#include "test.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <wuhb_utils/allocator.h>
+#include <wuhb_utils/gz_index.h>
+#include <wuhb_utils/prefetch.h>
+#include <wuhb_utils/utils.h>
+
+/*
+ * Using the library from several threads at the same time, every thread uses its own handles:
+ *
+ *   init       threads call WUHBUtils_InitLibrary and mount the same bundle at the same time, exactly one mount wins
+ *   plain      open, read (FileRead with varying chunk sizes/FileReadAt/ReadWholeFile) and close files of the bundle
+ *   gz_index   handles of a ".gz" file served by one WUHBGzIndex, read via FileRead/FileReadAt/Seek, next to
+ *              WUHBUtils_GzIndexReadAt calls on the index itself
+ *   prefetch   handles of files opened from the prefetch staging area
+ *
+ * All data is compared with the source files. The throughput of the same calls is measured by bench_threads.
+ */
+
+static constexpr uint32_t THREAD_COUNT     = 4;
+static constexpr uint32_t ROUNDS           = 20;
+static constexpr uint32_t PLAIN_FILE_SIZE  = 1024 * 1024;
+static constexpr uint32_t PACKED_FILE_SIZE = 1024 * 1024 + 123;
+static constexpr uint32_t STAGED_FILE_SIZE = 128 * 1024 + 45;
+static constexpr uint32_t READ_SIZE        = 4096;
+
+static std::string PlainFilePath(uint32_t i) {
+    return "test:/plain_" + std::to_string(i) + ".bin";
+}
+
+static std::string StagedFilePath(uint32_t i) {
+    return "test:/staged_" + std::to_string(i) + ".bin";
+}
+
+/**
+ * Starts "threadCount" threads that all run "fn(index)" once all of them are running.
+ */
+template<typename Fn>
+static void RunThreads(uint32_t threadCount, Fn &&fn) {
+    std::atomic<uint32_t> ready(0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads.emplace_back([&, i] {
+            ready.fetch_add(1);
+            while (ready.load() < threadCount) {
+                std::this_thread::yield();
+            }
+            fn(i);
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+/**
+ * Returns true if "size" bytes at "buffer" equal "expected" at "offset".
+ */
+static bool Matches(const std::vector<uint8_t> &expected, uint32_t offset, const uint8_t *buffer, uint32_t size) {
+    return offset + size <= expected.size() && std::equal(buffer, buffer + size, expected.begin() + offset);
+}
+
+/**
+ * Reads "handle" from its current position to the end in chunks of "chunk" bytes and compares it with "expected".
+ */
+static void CheckReadToEnd(WUHBFileHandle handle, const std::vector<uint8_t> &expected, uint32_t offset, uint32_t chunk) {
+    std::vector<uint8_t> buffer(chunk);
+    while (true) {
+        int32_t read = -1;
+        if (WUHBUtils_FileRead(handle, buffer.data(), chunk, &read) != WUHB_UTILS_RESULT_SUCCESS || read < 0) {
+            CHECK(false);
+            return;
+        }
+        if (read == 0) {
+            break;
+        }
+        CHECK(Matches(expected, offset, buffer.data(), read));
+        offset += read;
+    }
+    CHECK(offset == expected.size());
+}
+
+/**
+ * FileReadAt of "READ_SIZE" bytes at "offset", the read is cut at the end of the file.
+ */
+static void CheckReadAt(WUHBFileHandle handle, const std::vector<uint8_t> &expected, uint32_t offset) {
+    uint8_t buffer[READ_SIZE];
+    int32_t read = -1;
+    CHECK(WUHBUtils_FileReadAt(handle, offset, buffer, READ_SIZE, &read) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(read == (int32_t) std::min<uint32_t>(READ_SIZE, expected.size() - offset));
+    CHECK(read < 0 || Matches(expected, offset, buffer, read));
+}
+
+static void TestInit(const std::string &bundlePath) {
+    std::vector<uint8_t> mounted(THREAD_COUNT);
+    RunThreads(THREAD_COUNT, [&](uint32_t index) {
+        CHECK(WUHBUtils_InitLibrary() == WUHB_UTILS_RESULT_SUCCESS);
+        WUHBUtilsVersion version = WUHB_UTILS_MODULE_VERSION_ERROR;
+        CHECK(WUHBUtils_GetVersion(&version) == WUHB_UTILS_RESULT_SUCCESS && version != WUHB_UTILS_MODULE_VERSION_ERROR);
+
+        // Exactly one thread wins the mount, the others see the name taken.
+        int32_t outRes = -1;
+        auto res       = WUHBUtils_MountBundle("test", bundlePath.c_str(), BundleSource_FileDescriptor, &outRes);
+        mounted[index] = res == WUHB_UTILS_RESULT_SUCCESS && outRes >= 0;
+        CHECK(mounted[index] || res == WUHB_UTILS_RESULT_MOUNT_NAME_TAKEN || (res == WUHB_UTILS_RESULT_SUCCESS && outRes < 0));
+    });
+    CHECK(std::count(mounted.begin(), mounted.end(), 1) == 1);
+}
+
+static void TestPlain(const std::vector<std::vector<uint8_t>> &files) {
+    RunThreads(THREAD_COUNT, [&](uint32_t index) {
+        for (uint32_t round = 0; round < ROUNDS; round++) {
+            // Every thread reads every file, so handles of the same file are used concurrently on different threads.
+            uint32_t file  = (index + round) % files.size();
+            auto &expected = files[file];
+            auto path      = PlainFilePath(file);
+            WUHBFileHandle handle;
+            CHECK(WUHBUtils_FileOpen(path.c_str(), &handle) == WUHB_UTILS_RESULT_SUCCESS);
+            CheckReadToEnd(handle, expected, 0, 4096 << (round % 6));
+            CheckReadAt(handle, expected, (round * 7919u * 4096u) % (PLAIN_FILE_SIZE - READ_SIZE));
+            CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+
+            uint8_t *data = nullptr;
+            uint32_t size = 0;
+            CHECK(WUHBUtils_ReadWholeFile(path.c_str(), &data, &size) == WUHB_UTILS_RESULT_SUCCESS);
+            CHECK(data && size == expected.size() && Matches(expected, 0, data, size));
+            WUHBUtils_Free(data);
+
+            int32_t exists = 0;
+            CHECK(WUHBUtils_FileExists("test:/missing.bin", &exists) == WUHB_UTILS_RESULT_SUCCESS && !exists);
+        }
+    });
+}
+
+static void TestGzIndex(const std::vector<uint8_t> &packed) {
+    WUHBGzIndex *index = nullptr;
+    CHECK(WUHBUtils_GzIndexBuild("test:/packed.bin", 64 * 1024, 0, &index) == WUHB_UTILS_RESULT_SUCCESS);
+    if (!index) {
+        return;
+    }
+    RunThreads(THREAD_COUNT, [&](uint32_t thread) {
+        uint32_t state = thread * 2654435761u + 1;
+        for (uint32_t round = 0; round < ROUNDS; round++) {
+            state           = state * 1664525u + 1013904223u;
+            uint32_t offset = state % (PACKED_FILE_SIZE - 1);
+            if (thread == 0) {
+                // One thread uses the index directly while the others read via their handles.
+                uint8_t buffer[READ_SIZE];
+                int32_t read = -1;
+                CHECK(WUHBUtils_GzIndexReadAt(index, offset, buffer, READ_SIZE, &read) == WUHB_UTILS_RESULT_SUCCESS);
+                CHECK(read == (int32_t) std::min<uint32_t>(READ_SIZE, PACKED_FILE_SIZE - offset));
+                CHECK(read < 0 || Matches(packed, offset, buffer, read));
+                continue;
+            }
+            WUHBFileHandle handle;
+            CHECK(WUHBUtils_FileOpen("test:/packed.bin", &handle) == WUHB_UTILS_RESULT_SUCCESS);
+            uint32_t size = 0;
+            CHECK(WUHBUtils_FileGetSize(handle, &size) == WUHB_UTILS_RESULT_SUCCESS && size == PACKED_FILE_SIZE);
+            CheckReadAt(handle, packed, offset);
+            CheckReadAt(handle, packed, PACKED_FILE_SIZE - READ_SIZE / 2);
+
+            // Seek to a random position and read to the end of the file.
+            offset       = (state >> 8) % PACKED_FILE_SIZE;
+            uint32_t pos = 0;
+            CHECK(WUHBUtils_FileSeek(handle, offset, WUHB_SEEK_SET, &pos) == WUHB_UTILS_RESULT_SUCCESS && pos == offset);
+            CheckReadToEnd(handle, packed, offset, 16 * 1024);
+            CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+        }
+    });
+    CHECK(WUHBUtils_GzIndexFree(index) == WUHB_UTILS_RESULT_SUCCESS);
+}
+
+/**
+ * Waits until "count" files are staged, returns false after 10 seconds.
+ */
+static bool WaitStaged(uint32_t count) {
+    for (uint32_t i = 0; i < 10000; i++) {
+        WUHBPrefetchStats stats;
+        if (WUHBUtils_PrefetchGetStats(&stats) == WUHB_UTILS_RESULT_SUCCESS && stats.queued == 0 && stats.stagedFiles == count) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static void TestPrefetch(const std::vector<std::vector<uint8_t>> &files) {
+    std::vector<std::string> paths;
+    for (uint32_t i = 0; i < files.size(); i++) {
+        paths.push_back(StagedFilePath(i));
+    }
+    std::vector<const char *> pathPtrs;
+    for (auto &path : paths) {
+        pathPtrs.push_back(path.c_str());
+    }
+    uint32_t filesPerThread = files.size() / THREAD_COUNT;
+
+    WUHBPrefetchStats before;
+    CHECK(WUHBUtils_PrefetchGetStats(&before) == WUHB_UTILS_RESULT_SUCCESS);
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        CHECK(WUHBUtils_Prefetch(pathPtrs.data(), pathPtrs.size(), 0) == WUHB_UTILS_RESULT_SUCCESS);
+        if (!WaitStaged(files.size())) {
+            CHECK(false);
+            break;
+        }
+        RunThreads(THREAD_COUNT, [&](uint32_t index) {
+            // Every thread keeps its files open at the same time and reads them in turns.
+            std::vector<WUHBFileHandle> handles(filesPerThread);
+            for (uint32_t i = 0; i < filesPerThread; i++) {
+                CHECK(WUHBUtils_FileOpen(paths[index * filesPerThread + i].c_str(), &handles[i]) == WUHB_UTILS_RESULT_SUCCESS);
+            }
+            for (uint32_t i = 0; i < filesPerThread; i++) {
+                auto &expected = files[index * filesPerThread + i];
+                uint32_t size  = 0;
+                CHECK(WUHBUtils_FileGetSize(handles[i], &size) == WUHB_UTILS_RESULT_SUCCESS && size == expected.size());
+                CheckReadToEnd(handles[i], expected, 0, 4096 << ((round + i) % 6));
+                CheckReadAt(handles[i], expected, (round * 7919u) % expected.size());
+
+                uint32_t pos = 0;
+                CHECK(WUHBUtils_FileSeek(handles[i], 100, WUHB_SEEK_SET, nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+                CHECK(WUHBUtils_FileTell(handles[i], &pos) == WUHB_UTILS_RESULT_SUCCESS && pos == 100);
+                CheckReadToEnd(handles[i], expected, 100, 65536);
+            }
+            for (auto handle : handles) {
+                CHECK(WUHBUtils_FileClose(handle) == WUHB_UTILS_RESULT_SUCCESS);
+            }
+        });
+    }
+    // Every open has been served from the staging area.
+    WUHBPrefetchStats after;
+    CHECK(WUHBUtils_PrefetchGetStats(&after) == WUHB_UTILS_RESULT_SUCCESS);
+    CHECK(after.used - before.used == (uint64_t) ROUNDS * files.size());
+    CHECK(after.stagedFiles == 0);
+}
+
+int main() {
+    RomFSBuilder builder;
+    std::vector<std::vector<uint8_t>> plainFiles;
+    for (uint32_t i = 0; i < THREAD_COUNT; i++) {
+        plainFiles.push_back(TestGenerateData(PLAIN_FILE_SIZE, i));
+        builder.AddFile("/plain_" + std::to_string(i) + ".bin", plainFiles.back());
+    }
+    auto packed = TestGenerateText(PACKED_FILE_SIZE, 100);
+    builder.AddFile("/packed.bin.gz", TestGzip(packed));
+    std::vector<std::vector<uint8_t>> stagedFiles;
+    for (uint32_t i = 0; i < THREAD_COUNT * 2; i++) {
+        stagedFiles.push_back(TestGenerateData(STAGED_FILE_SIZE + i, 200 + i));
+        builder.AddFile("/staged_" + std::to_string(i) + ".bin", stagedFiles.back());
+    }
+    auto bundlePath = TestWriteBundle(builder, "wuhb_test_threads.wuhb");
+
+    TestInit(bundlePath);
+    TestPlain(plainFiles);
+    TestGzIndex(packed);
+    TestPrefetch(stagedFiles);
+
+    CHECK(WUHBUtils_UnmountBundle("test", nullptr) == WUHB_UTILS_RESULT_SUCCESS);
+    WUHBUtils_DeInitLibrary();
+    remove(bundlePath.c_str());
+    return TestFinish("test_threads");
+}
@@ -0,0 +1,113 @@
+#include "romfs.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <wuhb_utils/hash.h>
+#include <zlib.h>
+
+/*
+ * Packs a directory into a WUHB RomFS image that can be mounted by the host build.
+ * Files are stored as they are, compress them with gzip beforehand to get name + ".gz" entries.
+ * With "--hash-manifest <crc32|xxh32>" a hash manifest (see <wuhb_utils/hash.h>) is added as /meta/hashes.txt.
+ */
+
+/**
+ * Inflates a gzip file, returns false if the data is not valid gzip.
+ */
+static bool Gunzip(const std::vector<uint8_t> &in, std::vector<uint8_t> *out) {
+    z_stream stream{};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in  = (Bytef *) in.data();
+    stream.avail_in = in.size();
+    uint8_t chunk[64 * 1024];
+    int res;
+    do {
+        stream.next_out  = chunk;
+        stream.avail_out = sizeof(chunk);
+        res              = inflate(&stream, Z_NO_FLUSH);
+        out->insert(out->end(), chunk, chunk + (sizeof(chunk) - stream.avail_out));
+    } while (res == Z_OK);
+    inflateEnd(&stream);
+    return res == Z_STREAM_END;
+}
+
+int main(int argc, char **argv) {
+    bool writeManifest    = false;
+    WUHBHashType hashType = WUHB_HASH_CRC32;
+    if (argc == 5 && strcmp(argv[1], "--hash-manifest") == 0) {
+        if (strcmp(argv[2], "crc32") != 0 && strcmp(argv[2], "xxh32") != 0) {
+            fprintf(stderr, "Unknown hash type %s\n", argv[2]);
+            return 1;
+        }
+        writeManifest = true;
+        hashType      = strcmp(argv[2], "crc32") == 0 ? WUHB_HASH_CRC32 : WUHB_HASH_XXH32;
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s [--hash-manifest <crc32|xxh32>] <input dir> <output.wuhb>\n", argv[0]);
+        return 1;
+    }
+    namespace fs = std::filesystem;
+    fs::path root(argv[1]);
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        fprintf(stderr, "%s is not a directory\n", argv[1]);
+        return 1;
+    }
+
+    RomFSBuilder builder;
+    size_t fileCount     = 0;
+    std::string manifest = writeManifest ? std::string(hashType == WUHB_HASH_CRC32 ? "crc32" : "xxh32") + "\n" : "";
+    for (auto &entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (!in.good() && !in.eof()) {
+            fprintf(stderr, "Failed to read %s\n", entry.path().c_str());
+            return 1;
+        }
+        auto path = "/" + fs::relative(entry.path(), root).generic_string();
+        if (writeManifest && path == WUHB_HASH_MANIFEST_DEFAULT_PATH) {
+            continue; // replaced by the generated manifest
+        }
+        if (writeManifest) {
+            // .gz files are listed with the hash of their uncompressed data under the name without ".gz".
+            auto listedPath = path;
+            std::vector<uint8_t> inflated;
+            const auto *hashed = &data;
+            if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0) {
+                if (!Gunzip(data, &inflated)) {
+                    fprintf(stderr, "Failed to inflate %s\n", entry.path().c_str());
+                    return 1;
+                }
+                listedPath.resize(listedPath.size() - 3);
+                hashed = &inflated;
+            }
+            uint32_t hash = 0;
+            WUHBUtils_HashBuffer(hashType, hashed->data(), hashed->size(), &hash);
+            char line[16];
+            snprintf(line, sizeof(line), "%08X ", hash);
+            manifest += line + listedPath.substr(1) + "\n";
+        }
+        builder.AddFile(path, std::move(data));
+        fileCount++;
+    }
+    if (writeManifest) {
+        builder.AddFile(WUHB_HASH_MANIFEST_DEFAULT_PATH, std::vector<uint8_t>(manifest.begin(), manifest.end()));
+    }
+
+    if (!builder.Write(argv[2])) {
+        fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+    printf("Packed %zu files into %s\n", fileCount, argv[2]);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <wuhb_utils/trace.h>
+
+/*
+ * Turns traces recorded via WUHBUtils_TraceStart/WUHBUtils_TraceStop (e.g. on the console) into a prefetch profile
+ * that can be registered via WUHBUtils_SetMountProfile, see <wuhb_utils/trace.h>.
+ */
+
+int main(int argc, char **argv) {
+    uint32_t budget = 0;
+    if (argc >= 3 && strcmp(argv[1], "--budget") == 0) {
+        char *end;
+        budget = strtoul(argv[2], &end, 0);
+        if (*end != '\0' || budget == 0) {
+            fprintf(stderr, "Invalid budget %s\n", argv[2]);
+            return 1;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s [--budget <bytes>] <output profile> <trace>...\n", argv[0]);
+        return 1;
+    }
+    std::vector<const char *> traces(argv + 2, argv + argc);
+    auto res = WUHBUtils_BuildProfile(traces.data(), traces.size(), budget, argv[1]);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        fprintf(stderr, "Failed to build profile: %s\n", WUHBUtils_GetStatusStr(res));
+        return 1;
+    }
+
+    FILE *f = fopen(argv[1], "r");
+    if (!f) {
+        return 1;
+    }
+    char line[1024];
+    uint32_t files = 0;
+    uint64_t bytes = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] != '#') {
+            files++;
+            bytes += strtoul(line, nullptr, 10);
+        }
+    }
+    fclose(f);
+    printf("%s: %u files, %llu bytes\n", argv[1], files, (unsigned long long) bytes);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Allocator hooks for the memory the library allocates: the buffers returned by WUHBUtils_ReadWholeFile and
+ * WUHBUtils_ReadWholeFileAsync, the cache, the staging area, the buffered reader, gz indices, the path indices of mounted
+ * bundles, hash manifests and traces.<br>
+ * Bookkeeping data (async requests and their queues, the entries and paths of the cache and the staging area, records of
+ * open gz files, the cache of WUHBUtils_ScanBundles and one object per mounted bundle or manifest) still uses the
+ * global operator new.<br>
+ * By default memalign/free are used.<br>
+ * <br>
+ * Example for allocating from an expanded heap:<br>
+ * static void *Alloc(uint32_t size, uint32_t alignment, void *heap) { return MEMAllocFromExpHeapEx((MEMHeapHandle) heap, size, alignment); }<br>
+ * static void Free(void *ptr, void *heap) { MEMFreeToExpHeap((MEMHeapHandle) heap, ptr); }<br>
+ * WUHBUtils_SetAllocator(Alloc, Free, heap);
+ */
+
+/**
+ * Allocates "size" bytes aligned to "alignment" (a power of two), returns NULL if there is not enough memory.
+ */
+typedef void *(*WUHBAllocFn)(uint32_t size, uint32_t alignment, void *userdata);
+
+/**
+ * Frees memory returned by the matching WUHBAllocFn. Is never called with NULL.
+ */
+typedef void (*WUHBFreeFn)(void *ptr, void *userdata);
+
+/**
+ * Memory provided by the caller, files are loaded into it back-to-back.<br>
+ * Loading into an arena doesn't allocate any memory, all files are released at once via WUHBUtils_ArenaReset
+ * (e.g. when a level is unloaded).<br>
+ * An arena must not be used by multiple threads at the same time.
+ */
+typedef struct WUHBArena {
+    uint8_t *base;     // start of the memory
+    uint32_t capacity; // size of the memory in bytes
+    uint32_t used;     // bytes used by loaded files including alignment padding
+} WUHBArena;
+
+/**
+ * Sets the functions that are used for the allocations of the library, see above for what they cover.<br>
+ * Must not be called while other threads use the library. Memory is freed via the functions that are set at that time,
+ * so everything allocated via the previous functions (returned buffers, the cache, indices of mounted bundles, loaded
+ * hash manifests, a running trace) has to be released before, or the previous functions have to be restored before it's
+ * released.
+ *
+ * @param allocFn   function used for allocations, NULL to restore the default (memalign).
+ * @param freeFn    function used to free allocations, NULL to restore the default (free).
+ * @param userdata  passed to "allocFn" and "freeFn"
+ * @return WUHB_UTILS_RESULT_SUCCESS:           The allocator has been set.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:  Only one of "allocFn" and "freeFn" is NULL.
+ */
+WUHBUtilsStatus WUHBUtils_SetAllocator(WUHBAllocFn allocFn, WUHBFreeFn freeFn, void *userdata);
+
+/**
+ * Frees a buffer that has been returned by the library (e.g. by WUHBUtils_ReadWholeFile) via the current allocator.<br>
+ * With the default allocator this is the same as "free()".
+ *
+ * @param ptr   buffer to free, may be NULL.
+ */
+void WUHBUtils_Free(void *ptr);
+
+/**
+ * Initializes an arena on top of caller provided memory.
+ *
+ * @param arena     arena to initialize
+ * @param memory    memory used by the arena, it's not freed by the library.
+ * @param size      size of "memory" in bytes
+ * @return WUHB_UTILS_RESULT_SUCCESS:           The arena has been initialized.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:  "arena" or "memory" is NULL.
+ */
+WUHBUtilsStatus WUHBUtils_ArenaInit(WUHBArena *arena, void *memory, uint32_t size);
+
+/**
+ * Releases all files loaded into an arena at once.
+ *
+ * @param arena     arena to reset
+ */
+void WUHBUtils_ArenaReset(WUHBArena *arena);
+
+/**
+ * Reads a file completely into the next free part of an arena.<br>
+ * The data starts at the next address that is a multiple of "alignment", nothing is allocated.
+ *
+ * @param arena     arena to load the file into
+ * @param path      path to the file.
+ * @param alignment alignment of the data, a power of two. 0x40 is recommended.
+ * @param outBuf    address where the pointer to the data will be stored.
+ * @param outSize   address where the size of the file will be stored.
+ * @return WUHB_UTILS_RESULT_SUCCESS                The file has been loaded, the arena has been advanced.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:   Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "arena", "outBuf" or "outSize" is NULL or "alignment" is not a power of two.<br>
+ *         WUHB_UTILS_RESULT_FILE_NOT_FOUND:        file at "path" was not found.<br>
+ *         WUHB_UTILS_RESULT_BUFFER_TOO_SMALL:      The file doesn't fit into the arena, the arena is unchanged.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_ArenaReadWholeFile(WUHBArena *arena, const char *path, uint32_t alignment, uint8_t **outBuf, uint32_t *outSize);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
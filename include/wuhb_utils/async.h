@@ -0,0 +1,155 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define WUHB_ASYNC_DEFAULT_THREADS 2
+#define WUHB_ASYNC_MAX_THREADS     8
+#define WUHB_ASYNC_PRIORITY_LOW    -100
+#define WUHB_ASYNC_PRIORITY_NORMAL 0
+#define WUHB_ASYNC_PRIORITY_HIGH   100
+
+/**
+ * A request submitted via WUHBUtils_FileReadAsync or WUHBUtils_ReadWholeFileAsync.<br>
+ * Requests are executed by a pool of worker threads, requests with a higher priority are executed first,
+ * requests with the same priority in the order they have been submitted. Requests for the same handle never run at
+ * the same time.<br>
+ * <br>
+ * Every request must be released via WUHBUtils_AsyncFree, no matter if it has finished or not.
+ */
+typedef struct WUHBAsyncRequest WUHBAsyncRequest;
+
+typedef enum WUHBAsyncState {
+    WUHB_ASYNC_STATE_PENDING   = 0, // waiting for a worker thread
+    WUHB_ASYNC_STATE_RUNNING   = 1, // currently executed by a worker thread
+    WUHB_ASYNC_STATE_DONE      = 2, // finished, see WUHBUtils_AsyncGetResult for the result
+    WUHB_ASYNC_STATE_CANCELLED = 3, // cancelled before it has finished
+} WUHBAsyncState;
+
+/**
+ * Called once a request has finished or has been cancelled.<br>
+ * The callback is called from a worker thread (or from the thread calling WUHBUtils_AsyncCancel/WUHBUtils_AsyncFree/WUHBUtils_AsyncDeInit
+ * for requests that were still pending), it should return quickly. The request is valid until WUHBUtils_AsyncFree has been called,
+ * it's safe to call WUHBUtils_AsyncGetResult and WUHBUtils_AsyncFree inside the callback.
+ */
+typedef void (*WUHBAsyncCallback)(WUHBAsyncRequest *request, void *context);
+
+/**
+ * Starts the worker threads. Calling this function is optional, the first async request starts
+ * WUHB_ASYNC_DEFAULT_THREADS worker threads if the pool is not running yet.
+ *
+ * @param numThreads    number of worker threads (1 - WUHB_ASYNC_MAX_THREADS). Pass 0 to use WUHB_ASYNC_DEFAULT_THREADS.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              worker threads are running.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "numThreads" is bigger than WUHB_ASYNC_MAX_THREADS or
+ *                                                  the pool is already running with a different number of threads.<br>
+ *          WUHB_UTILS_RESULT_NO_MEMORY:            creating the threads failed.
+ */
+WUHBUtilsStatus WUHBUtils_AsyncInit(uint32_t numThreads);
+
+/**
+ * Cancels all pending requests, waits for the running requests and stops the worker threads.<br>
+ * Called by WUHBUtils_DeInitLibrary.
+ *
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_AsyncDeInit();
+
+/**
+ * Reads up to "size" bytes at position "offset" of an opened file (see WUHBUtils_FileReadAt) without blocking.<br>
+ * The read doesn't use or change the read position of the handle. Multiple requests for the same handle can be submitted
+ * at the same time, the worker threads execute them one after another. Calls on one handle must be serialized (see
+ * WUHBUtils_InitLibrary), so don't use the handle from other threads until its requests have finished.<br>
+ * "handle" and "buffer" must stay valid until the request has finished.
+ *
+ * @param handle        File handle to be read from.
+ * @param offset        position inside the file to read from.
+ * @param buffer        buffer where data will be written to. Align to 0x40 for best performance
+ * @param size          maximum bytes that should be read into buffer
+ * @param priority      requests with a higher priority are executed first, see WUHB_ASYNC_PRIORITY_*
+ * @param callback      called once the request has finished, may be NULL
+ * @param context       passed to the callback
+ * @param outRequest    the request will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              request has been submitted.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "buffer" or "outRequest" is NULL<br>
+ *          WUHB_UTILS_RESULT_NO_MEMORY:            not enough memory.
+ */
+WUHBUtilsStatus WUHBUtils_FileReadAsync(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t priority, WUHBAsyncCallback callback, void *context, WUHBAsyncRequest **outRequest);
+
+/**
+ * Reads a whole file (see WUHBUtils_ReadWholeFile) without blocking.<br>
+ * Files listed in a hash manifest are verified while they are read (see <wuhb_utils/hash.h>), on a mismatch the request
+ * finishes with WUHB_UTILS_RESULT_HASH_MISMATCH and without a buffer.
+ *
+ * @param path          path to the file that should be read.
+ * @param priority      requests with a higher priority are executed first, see WUHB_ASYNC_PRIORITY_*
+ * @param callback      called once the request has finished, may be NULL
+ * @param context       passed to the callback
+ * @param outRequest    the request will be stored here.
+ * @return see WUHBUtils_FileReadAsync
+ */
+WUHBUtilsStatus WUHBUtils_ReadWholeFileAsync(const char *path, int32_t priority, WUHBAsyncCallback callback, void *context, WUHBAsyncRequest **outRequest);
+
+/**
+ * Returns the current state of a request.
+ *
+ * @param request   request to check
+ * @param outState  the state will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outState has been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "request" or "outState" is NULL
+ */
+WUHBUtilsStatus WUHBUtils_AsyncPoll(WUHBAsyncRequest *request, WUHBAsyncState *outState);
+
+/**
+ * Blocks until a request has finished or has been cancelled. The callback of the request may still be running when this function returns.
+ *
+ * @param request   request to wait for
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the request has finished.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "request" is NULL
+ */
+WUHBUtilsStatus WUHBUtils_AsyncWait(WUHBAsyncRequest *request);
+
+/**
+ * Cancels a request. A pending request is never executed, a running request stops at the next chunk boundary (1 MiB).<br>
+ * A request that is already about to finish may still end up in WUHB_ASYNC_STATE_DONE, use WUHBUtils_AsyncPoll
+ * or WUHBUtils_AsyncWait to get the final state.<br>
+ * The callback is called in both cases.
+ *
+ * @param request   request to cancel
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the request has been marked as cancelled.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "request" is NULL
+ */
+WUHBUtilsStatus WUHBUtils_AsyncCancel(WUHBAsyncRequest *request);
+
+/**
+ * Returns the result of a finished request.<br>
+ * For WUHBUtils_ReadWholeFileAsync the ownership of the buffer is transferred to the caller, it has to be freed via "WUHBUtils_Free()"
+ * (see <wuhb_utils/allocator.h>, same as "free()" with the default allocator).
+ * Further calls return NULL as buffer.
+ *
+ * @param request       finished request
+ * @param outStatus     the status of the operation (see WUHBUtils_FileReadAt/WUHBUtils_ReadWholeFile) will be stored here,
+ *                      WUHB_UTILS_RESULT_REQUEST_CANCELLED for cancelled requests.
+ * @param outBuffer     WUHBUtils_ReadWholeFileAsync only: the buffer containing the file will be stored here, may be NULL.
+ * @param outSize       the number of bytes read will be stored here, may be NULL
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the result has been returned.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "request" or "outStatus" is NULL<br>
+ *          WUHB_UTILS_RESULT_REQUEST_PENDING:      the request has not finished yet.
+ */
+WUHBUtilsStatus WUHBUtils_AsyncGetResult(WUHBAsyncRequest *request, WUHBUtilsStatus *outStatus, uint8_t **outBuffer, uint32_t *outSize);
+
+/**
+ * Releases a request. A request that has not finished yet is cancelled.<br>
+ * A file buffer of WUHBUtils_ReadWholeFileAsync that has not been taken via WUHBUtils_AsyncGetResult is freed.
+ *
+ * @param request   request to release, may be NULL
+ */
+void WUHBUtils_AsyncFree(WUHBAsyncRequest *request);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define WUHB_BUFFERED_DEFAULT_WINDOW_SIZE (64 * 1024)
+#define WUHB_BUFFERED_MIN_WINDOW_SIZE     (4 * 1024)
+
+/**
+ * A file opened via WUHBUtils_BufferedOpen.<br>
+ * Small reads are served from a read-ahead window, which avoids a call into the WUHBUtilsModule for every read.<br>
+ * <br>
+ * The window starts small and is doubled (up to the configured size) whenever it has been consumed completely,
+ * reads that are larger than the window go directly to the destination buffer.<br>
+ * A buffered file must not be used by multiple threads at the same time.
+ */
+typedef struct WUHBBufferedFile WUHBBufferedFile;
+
+/**
+ * Opens a file inside a mounted bundle for buffered reading.
+ *
+ * @param name          path to the file that should be opened.
+ * @param windowSize    maximum size of the read-ahead window, will be rounded up to a multiple of 0x40.<br>
+ *                      Pass 0 to use WUHB_BUFFERED_DEFAULT_WINDOW_SIZE.<br>
+ *                      If the size of the file is known, the window is never bigger than the file.
+ * @param outFile       on success the buffered file will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              file has been opened successfully.<br>
+ *          WUHB_UTILS_RESULT_LIB_UNINITIALIZED:    "WUHBUtils_Init()" was not called before.<br>
+ *          WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:  Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "name" or "outFile" was NULL<br>
+ *          WUHB_UTILS_RESULT_FILE_NOT_FOUND:       file at path "name" was not found.<br>
+ *          WUHB_UTILS_RESULT_NO_MEMORY:            not enough memory.<br>
+ *          WUHB_UTILS_RESULT_UNKNOWN_ERROR:        Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_BufferedOpen(const char *name, uint32_t windowSize, WUHBBufferedFile **outFile);
+
+/**
+ * Reads from a buffered file.
+ *
+ * @param file      file to be read from.
+ * @param buffer    buffer where data will be written to.
+ * @param size      maximum bytes this function should read into buffer
+ * @param outRead   number of bytes that have been read. Less than "size" only if the end of the file has been reached.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    *outRead bytes have been read.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "file", "buffer" or "outRead" is NULL<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             Unknown error.<br>
+ *         Any error of WUHBUtils_FileRead.
+ */
+WUHBUtilsStatus WUHBUtils_BufferedRead(WUHBBufferedFile *file, uint8_t *buffer, uint32_t size, uint32_t *outRead);
+
+/**
+ * Returns the next bytes of a buffered file without consuming them.<br>
+ * The returned pointer points into the read-ahead window and is valid until the next call on this file.
+ *
+ * @param file          file to peek into.
+ * @param size          number of bytes that should be available, at most the size of the window.
+ * @param outData       pointer to the next bytes of the file.
+ * @param outAvailable  number of bytes available at *outData. Less than "size" only if the end of the file
+ *                      has been reached or "size" is bigger than the window.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    *outAvailable bytes are available at *outData.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "file", "outData" or "outAvailable" is NULL<br>
+ *         Any error of WUHBUtils_FileRead.
+ */
+WUHBUtilsStatus WUHBUtils_BufferedPeek(WUHBBufferedFile *file, uint32_t size, const uint8_t **outData, uint32_t *outAvailable);
+
+/**
+ * Reads a line from a buffered file, like fgets.<br>
+ * Reading stops after a '\n' (which is stored in the buffer) or after "size" - 1 bytes. The string is always null-terminated.<br>
+ *
+ * @param file          file to be read from.
+ * @param buffer        buffer where the line will be written to.
+ * @param size          size of buffer, at least 2.
+ * @param outLength     length of the string written to "buffer", 0 indicates end of file.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    a line has been read.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "file", "buffer" or "outLength" is NULL or "size" is < 2<br>
+ *         Any error of WUHBUtils_FileRead.
+ */
+WUHBUtilsStatus WUHBUtils_BufferedReadLine(WUHBBufferedFile *file, char *buffer, uint32_t size, uint32_t *outLength);
+
+/**
+ * Closes a buffered file and frees the read-ahead window.
+ *
+ * @param file  file to be closed.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    file has been closed successfully.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "file" is NULL<br>
+ *         Any error of WUHBUtils_FileClose.
+ */
+WUHBUtilsStatus WUHBUtils_BufferedClose(WUHBBufferedFile *file);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
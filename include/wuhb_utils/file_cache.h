@@ -0,0 +1,93 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Opt-in cache for whole files, keyed by the full path (e.g. "mount:/content/font.bin").<br>
+ * Cached files are handed out as read-only, reference-counted buffers, the least recently used files are
+ * evicted once the cached files exceed the budget.<br>
+ * Buffers that are still referenced stay valid after they have been evicted or invalidated, but don't count towards the budget anymore.<br>
+ * <br>
+ * WUHBUtils_UnmountBundle invalidates all cached files of the unmounted bundle, WUHBUtils_DeInitLibrary all cached files.<br>
+ * All functions are thread-safe.
+ */
+
+typedef struct WUHBCacheStats {
+    uint64_t hits;          // WUHBUtils_CacheReadWholeFile calls served from the cache
+    uint64_t misses;        // WUHBUtils_CacheReadWholeFile calls that had to read the file
+    uint64_t evictions;     // files evicted to stay within the budget
+    uint64_t invalidations; // files removed via WUHBUtils_CacheInvalidate or WUHBUtils_UnmountBundle
+    uint32_t entries;       // number of cached files
+    uint32_t cachedBytes;   // size of all cached files
+    uint32_t budget;        // see WUHBUtils_CacheSetBudget
+    uint32_t activeBuffers; // buffers that have not been released yet
+} WUHBCacheStats;
+
+/**
+ * Sets the maximum size of all cached files. The budget is 0 (caching disabled) by default.<br>
+ * Shrinking the budget evicts files right away.
+ *
+ * @param budget    maximum size of all cached files in bytes, 0 disables caching
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_CacheSetBudget(uint32_t budget);
+
+/**
+ * Like WUHBUtils_ReadWholeFile, but returns a cached buffer if possible.<br>
+ * The returned buffer is shared with other callers and must not be modified, release it via WUHBUtils_CacheRelease
+ * (not "free()"). Files bigger than the budget are read into a buffer that isn't cached.
+ *
+ * @param path      path to the file.
+ * @param outBuf    address where the buffer address will be stored, the buffer is aligned to 0x40.
+ * @param outSize   address where the size will be stored
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outBuf and *outSize have been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "path", "outBuf" or "outSize" is NULL.<br>
+ *          WUHB_UTILS_RESULT_NO_MEMORY:            Not enough memory.<br>
+ *          WUHB_UTILS_RESULT_HASH_MISMATCH:        the file doesn't match the hash manifest (see <wuhb_utils/hash.h>), it isn't cached.<br>
+ *          Any error of WUHBUtils_FileOpen/WUHBUtils_FileRead.
+ */
+WUHBUtilsStatus WUHBUtils_CacheReadWholeFile(const char *path, const uint8_t **outBuf, uint32_t *outSize);
+
+/**
+ * Releases a buffer returned by WUHBUtils_CacheReadWholeFile, once per time it has been returned.<br>
+ * Releasing a buffer that isn't handed out anymore is detected and logged, unless the same address has been handed
+ * out again in the meantime.
+ *
+ * @param buffer    buffer to release, may be NULL
+ */
+void WUHBUtils_CacheRelease(const uint8_t *buffer);
+
+/**
+ * Removes files from the cache, buffers that are still referenced stay valid.<br>
+ * Files that are being loaded by WUHBUtils_CacheReadWholeFile at the same time are handed out without being cached.
+ *
+ * @param pathPrefix    only files whose path starts with this prefix are removed (e.g. "mount:/"), pass NULL to remove all files.
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_CacheInvalidate(const char *pathPrefix);
+
+/**
+ * Returns the counters and the current size of the cache.
+ *
+ * @param outStats  the stats will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outStats has been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "outStats" is NULL.
+ */
+WUHBUtilsStatus WUHBUtils_CacheGetStats(WUHBCacheStats *outStats);
+
+/**
+ * Resets the hits, misses, evictions and invalidations counters.
+ *
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_CacheResetStats();
+
+#ifdef __cplusplus
+}
+#endif
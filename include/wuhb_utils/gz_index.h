@@ -0,0 +1,125 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define WUHB_GZ_INDEX_DEFAULT_SPAN (1024 * 1024)
+
+/**
+ * Random access index for a compressed (name + ".gz") file inside a mounted bundle.<br>
+ * <br>
+ * WUHBUtils_FileSeek/FileReadAt on a compressed file have to inflate everything before the requested position.
+ * The index stores a snapshot of the inflate state (the last 32 KiB of output) roughly every "span" bytes of
+ * uncompressed data, so a read only has to inflate from the nearest snapshot.<br>
+ * <br>
+ * While an index exists, files opened via WUHBUtils_FileOpen with the same name use it: WUHBUtils_FileSeek,
+ * WUHBUtils_FileRead, WUHBUtils_FileReadAt and the vectored reads only inflate from the nearest snapshot (or continue
+ * the previous read). The name has to match the "name" the index was built or loaded for exactly.<br>
+ * <br>
+ * Each snapshot needs ~32 KiB of memory. Reads of different threads on the same index are allowed.<br>
+ * Using the index requires zlib (-lz). The compressed data is read via WUHBUtils_FileReadAt, with a WUHBUtilsModule that
+ * can neither read at a position nor seek it is read forward via WUHBUtils_FileRead (reopening the file to go back).<br>
+ * <br>
+ * Every file served by an index opens its own handle of the compressed data on its first read, so reads on different
+ * handles don't wait for each other. Up to 64 files can be served by indices at the same time, further files
+ * are served by the module. Opening a file takes a short lock while any index is registered.<br>
+ * WUHBUtils_GzIndexReadAt calls on the same index share one handle of the compressed data and are serialized.
+ */
+typedef struct WUHBGzIndex WUHBGzIndex;
+
+typedef struct WUHBGzIndexInfo {
+    uint32_t uncompressedSize; // size of the uncompressed data
+    uint32_t compressedSize;   // size of the .gz file
+    uint32_t span;             // distance of the snapshots in the uncompressed data
+    uint32_t points;           // number of snapshots
+    uint32_t memoryUsage;      // memory used by the index in bytes
+} WUHBGzIndexInfo;
+
+/**
+ * Inflates a compressed file once and builds an index for it.
+ *
+ * @param name          path of the file as it would be passed to WUHBUtils_FileOpen, e.g. "bundle:/data.bin" for "bundle:/data.bin.gz"
+ * @param span          distance of the snapshots in bytes of uncompressed data, 0 for WUHB_GZ_INDEX_DEFAULT_SPAN.
+ * @param maxMemory     memory budget for the snapshots in bytes, 0 for no limit.<br>
+ *                      If the budget would be exceeded the span is doubled (and every second snapshot dropped).
+ * @param outIndex      on success the index will be stored here, free it with WUHBUtils_GzIndexFree.
+ * @return WUHB_UTILS_RESULT_SUCCESS                the index has been created.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "name" or "outIndex" is NULL or "maxMemory" is too small for a single snapshot.<br>
+ *         WUHB_UTILS_RESULT_FILE_NOT_FOUND:        the compressed file doesn't exist.<br>
+ *         WUHB_UTILS_RESULT_NO_MEMORY:             Not enough memory.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         The file is not a valid gzip file.<br>
+ *         Any error of WUHBUtils_FileOpen/WUHBUtils_FileRead.
+ */
+WUHBUtilsStatus WUHBUtils_GzIndexBuild(const char *name, uint32_t span, uint32_t maxMemory, WUHBGzIndex **outIndex);
+
+/**
+ * Loads an index that has been saved via WUHBUtils_GzIndexSave.
+ *
+ * @param name          path of the file as it would be passed to WUHBUtils_FileOpen.
+ * @param indexPath     path of the index file, e.g. "fs:/vol/external01/wiiu/apps/myapp/data.bin.idx"
+ * @param outIndex      on success the index will be stored here, free it with WUHBUtils_GzIndexFree.
+ * @return WUHB_UTILS_RESULT_SUCCESS                the index has been loaded.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "name", "indexPath" or "outIndex" is NULL.<br>
+ *         WUHB_UTILS_RESULT_FILE_NOT_FOUND:        the compressed file or the index file doesn't exist.<br>
+ *         WUHB_UTILS_RESULT_NO_MEMORY:             Not enough memory.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         The index file is invalid or doesn't belong to this file.
+ */
+WUHBUtilsStatus WUHBUtils_GzIndexLoad(const char *name, const char *indexPath, WUHBGzIndex **outIndex);
+
+/**
+ * Saves an index, so it can be loaded via WUHBUtils_GzIndexLoad instead of being rebuilt.<br>
+ * The index file is stored in big-endian byte order, so files created on another machine (e.g. by a host tool) can be loaded.
+ *
+ * @param index         index to save.
+ * @param indexPath     path of the index file.
+ * @return WUHB_UTILS_RESULT_SUCCESS                the index has been saved.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "index" or "indexPath" is NULL.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         Failed to write the index file.
+ */
+WUHBUtilsStatus WUHBUtils_GzIndexSave(const WUHBGzIndex *index, const char *indexPath);
+
+/**
+ * Reads uncompressed data at the given position, starting to inflate at the nearest snapshot.<br>
+ * Calls on the same index are serialized, open the file via WUHBUtils_FileOpen to read it from multiple threads at once.
+ *
+ * @param index     index of the file to read from.
+ * @param offset    position inside the uncompressed data.
+ * @param buffer    buffer where data will be written to.
+ * @param size      maximum bytes this function should read into buffer
+ * @param outRes    the number of bytes read will be stored here (zero indicates end of file)
+ * @return WUHB_UTILS_RESULT_SUCCESS                    *outRes bytes have been read.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "index", "buffer" or "outRes" is NULL<br>
+ *         WUHB_UTILS_RESULT_NO_MEMORY:                 Not enough memory.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             The compressed data is invalid.<br>
+ *         Any error of WUHBUtils_FileOpen/WUHBUtils_FileReadAt/WUHBUtils_FileRead.
+ */
+WUHBUtilsStatus WUHBUtils_GzIndexReadAt(WUHBGzIndex *index, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes);
+
+/**
+ * Gets information about an index, e.g. to tune "span" and "maxMemory".
+ *
+ * @param index     index to query.
+ * @param outInfo   the information will be stored here.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    The information has been stored in *outInfo.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "index" or "outInfo" is NULL
+ */
+WUHBUtilsStatus WUHBUtils_GzIndexGetInfo(const WUHBGzIndex *index, WUHBGzIndexInfo *outInfo);
+
+/**
+ * Frees an index and closes the underlying file.<br>
+ * Files opened afterwards don't use the index anymore, files that are still open keep using it until they are closed.
+ *
+ * @param index     index to free.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    The index has been freed.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "index" is NULL
+ */
+WUHBUtilsStatus WUHBUtils_GzIndexFree(WUHBGzIndex *index);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
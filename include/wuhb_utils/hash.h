@@ -0,0 +1,118 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Checksums that are computed while a file is read, instead of hashing the file again after it has been read.<br>
+ * <br>
+ * Bundles can contain a hash manifest (by default "/meta/hashes.txt", "mkwuhb --hash-manifest" creates one):<br>
+ * The first line is the algorithm ("crc32" or "xxh32"), every following line contains the hash of a file as 8 hex digits,
+ * a space and the path of the file relative to the root of the bundle, e.g. "1a2b3c4d content/level1.bin".<br>
+ * For ".gz" files the path without ".gz" and the hash of the uncompressed data are listed.<br>
+ * Empty lines and lines starting with '#' are ignored.<br>
+ * <br>
+ * Once a manifest has been loaded via WUHBUtils_LoadHashManifest and verification has been enabled via WUHBUtils_SetHashVerification,
+ * WUHBUtils_ReadWholeFile, WUHBUtils_ReadWholeFileInto, WUHBUtils_ReadFiles and all functions based on them verify every listed file
+ * and fail with WUHB_UTILS_RESULT_HASH_MISMATCH if the data doesn't match.
+ */
+
+#define WUHB_HASH_MANIFEST_DEFAULT_PATH "/meta/hashes.txt"
+
+typedef enum WUHBHashType {
+    WUHB_HASH_CRC32 = 0, // CRC-32 (same as zlib's crc32)
+    WUHB_HASH_XXH32 = 1, // xxHash32 with seed 0, faster than CRC-32
+} WUHBHashType;
+
+/**
+ * State of an incremental hash, the members are private.
+ */
+typedef struct WUHBHashState {
+    WUHBHashType type;
+    uint32_t acc[4];
+    uint64_t totalSize;
+    uint8_t pending[16];
+    uint32_t pendingSize;
+} WUHBHashState;
+
+/**
+ * Starts an incremental hash.
+ *
+ * @param state     state to initialize
+ * @param type      hash algorithm
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the state has been initialized.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "state" is NULL or "type" is invalid.
+ */
+WUHBUtilsStatus WUHBUtils_HashInit(WUHBHashState *state, WUHBHashType type);
+
+/**
+ * Adds data to an incremental hash.
+ *
+ * @param state     initialized state
+ * @param data      data to hash, may be NULL if "size" is 0.
+ * @param size      size of "data" in bytes
+ */
+void WUHBUtils_HashUpdate(WUHBHashState *state, const void *data, uint32_t size);
+
+/**
+ * Returns the hash of all data added so far. The state can be updated further afterwards.
+ *
+ * @param state     initialized state
+ * @return the hash
+ */
+uint32_t WUHBUtils_HashFinal(const WUHBHashState *state);
+
+/**
+ * Hashes a buffer in one go.
+ *
+ * @param type      hash algorithm
+ * @param data      data to hash, may be NULL if "size" is 0.
+ * @param size      size of "data" in bytes
+ * @param outHash   the hash will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outHash has been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "outHash" is NULL or "type" is invalid.
+ */
+WUHBUtilsStatus WUHBUtils_HashBuffer(WUHBHashType type, const void *data, uint32_t size, uint32_t *outHash);
+
+/**
+ * Like WUHBUtils_ReadWholeFile, but additionally hashes the data while it is read.
+ *
+ * @param path      path to the file.
+ * @param type      hash algorithm
+ * @param outBuf    address where the buffer address will be stored, clean it up via "WUHBUtils_Free()".
+ * @param outSize   address where the size will be stored
+ * @param outHash   address where the hash of the file will be stored
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outBuf, *outSize and *outHash have been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "outBuf", "outSize" or "outHash" is NULL or "type" is invalid.<br>
+ *          Any error of WUHBUtils_ReadWholeFile.
+ */
+WUHBUtilsStatus WUHBUtils_ReadWholeFileHashed(const char *path, WUHBHashType type, uint8_t **outBuf, uint32_t *outSize, uint32_t *outHash);
+
+/**
+ * Loads the hash manifest of a mounted bundle. A previously loaded manifest of the bundle is replaced.<br>
+ * The manifest is dropped when the bundle is unmounted.
+ *
+ * @param name          name of the mounted bundle (e.g. "bundle")
+ * @param manifestPath  path of the manifest inside the bundle, NULL for WUHB_HASH_MANIFEST_DEFAULT_PATH.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the manifest has been loaded.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "name" is NULL or the manifest is malformed.<br>
+ *          Any error of WUHBUtils_ReadWholeFile.
+ */
+WUHBUtilsStatus WUHBUtils_LoadHashManifest(const char *name, const char *manifestPath);
+
+/**
+ * Enables or disables the verification of files listed in loaded manifests. Disabled by default.
+ *
+ * @param enabled   whether files should be verified
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_SetHashVerification(bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
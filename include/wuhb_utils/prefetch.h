@@ -0,0 +1,90 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Loads files that will be needed soon (e.g. the assets of the next screen) on a background thread into a staging area.<br>
+ * ".gz" files are inflated while loading. A later WUHBUtils_FileOpen, WUHBUtils_ReadWholeFile or WUHBUtils_ReadWholeFileInto
+ * of the same path (exactly as it was passed to WUHBUtils_Prefetch) is served from memory and removes the file from
+ * the staging area. If the file is still being loaded these functions wait for it, if loading has not started yet
+ * the prefetch is dropped and the file is read directly.<br>
+ * <br>
+ * Files opened from the staging area support all functions that take a WUHBFileHandle. Up to 256 of them can be open
+ * at once, further opens are served by the module.<br>
+ * WUHBUtils_UnmountBundle discards all staged files of the unmounted bundle, WUHBUtils_DeInitLibrary all staged files.<br>
+ * All functions are thread-safe.
+ */
+
+#define WUHB_PREFETCH_DEFAULT_BUDGET (16 * 1024 * 1024)
+
+typedef struct WUHBPrefetchStats {
+    uint64_t requested;    // files submitted via WUHBUtils_Prefetch (files that are already queued or staged are not counted)
+    uint64_t used;         // staged files served to WUHBUtils_FileOpen, WUHBUtils_ReadWholeFile or WUHBUtils_ReadWholeFileInto
+    uint64_t wasted;       // (partially) loaded files that have been discarded without being used
+    uint64_t late;         // files that have been opened/read before loading them had started, they have been read directly
+    uint64_t cancelled;    // files cancelled before loading them had started
+    uint64_t dropped;      // files that have not been loaded because they didn't fit into the budget
+    uint64_t failed;       // files that could not be loaded (e.g. because they don't exist)
+    uint32_t queued;       // files waiting to be loaded
+    uint32_t stagedFiles;  // loaded files waiting to be used
+    uint32_t stagedBytes;  // size of the staged files and the file that is currently loaded
+    uint32_t budget;       // see WUHBUtils_PrefetchSetBudget
+} WUHBPrefetchStats;
+
+/**
+ * Queues files to be loaded into the staging area. Files with a higher priority are loaded first, files with the
+ * same priority in the order they have been submitted.<br>
+ * Paths that are already queued or staged are ignored. Starts the background thread if it's not running yet.
+ *
+ * @param paths     paths of the files to load, NULL entries are ignored.
+ * @param count     number of entries in "paths"
+ * @param priority  see WUHB_ASYNC_PRIORITY_* in <wuhb_utils/async.h>
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the files have been queued.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "paths" is NULL.<br>
+ *          WUHB_UTILS_RESULT_NO_MEMORY:            creating the background thread failed.
+ */
+WUHBUtilsStatus WUHBUtils_Prefetch(const char **paths, uint32_t count, int32_t priority);
+
+/**
+ * Cancels queued files and discards staged files. A file that is currently loaded is discarded once loading has
+ * stopped (at the next 1 MiB chunk boundary).
+ *
+ * @param pathPrefix    only files whose path starts with this prefix are affected (e.g. "mount:/"), pass NULL to cancel everything.
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_PrefetchCancel(const char *pathPrefix);
+
+/**
+ * Sets the maximum size of all staged files including the file that is currently loaded. Files that don't fit are
+ * not loaded (see WUHBPrefetchStats::dropped). Files that have been staged already are kept.
+ *
+ * @param budget    maximum size in bytes, WUHB_PREFETCH_DEFAULT_BUDGET by default.
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_PrefetchSetBudget(uint32_t budget);
+
+/**
+ * Returns the counters and the current state of the staging area.
+ *
+ * @param outStats  the stats will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outStats has been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "outStats" is NULL.
+ */
+WUHBUtilsStatus WUHBUtils_PrefetchGetStats(WUHBPrefetchStats *outStats);
+
+/**
+ * Resets the requested, used, wasted, late, cancelled, dropped and failed counters.
+ *
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_PrefetchResetStats();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "allocator.h"
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Gets the RPX info (see WUHBUtils_GetRPXInfo) of all bundles in a directory at once, e.g. for a launcher.<br>
+ * <br>
+ * Bundles are not mounted, only the RomFS header, the directory table and the entries of "/code/" are read from the
+ * bundle file directly. Several bundles are processed concurrently.<br>
+ * The results are kept in a cache keyed by path, size and modification time. If a cache file has been set via
+ * WUHBUtils_SetScanCachePath the cache is loaded from and saved to this file, so bundles that didn't change since the
+ * last scan (even since the last boot) are answered without opening them.
+ */
+
+#define WUHB_SCAN_THREADS 4
+
+// Files a launcher usually needs from every bundle, see WUHBUtils_ReadBundleFiles.
+#define WUHB_META_INI_PATH      "/meta/meta.ini"
+#define WUHB_META_ICON_PATH     "/meta/iconTex.tga"
+#define WUHB_META_BOOT_TV_PATH  "/meta/bootTvTex.tga"
+#define WUHB_META_BOOT_DRC_PATH "/meta/bootDrcTex.tga"
+
+typedef struct WUHBScanEntry {
+    const char *path;       // path of the bundle (directory + "/" + file name)
+    WUHBUtilsStatus status; // WUHB_UTILS_RESULT_SUCCESS, WUHB_UTILS_RESULT_FILE_NOT_FOUND (no .rpx in /code/), WUHB_UTILS_RESULT_MOUNT_FAILED (not a valid bundle
+                            // or can't be opened) or WUHB_UTILS_RESULT_READ_FAILED (I/O error, not cached so the bundle is read again by the next scan)
+    WUHBRPXInfo rpxInfo;    // valid if status is WUHB_UTILS_RESULT_SUCCESS
+    bool cached;            // whether the result has been taken from the cache
+} WUHBScanEntry;
+
+/**
+ * Called once per bundle, on the thread that called WUHBUtils_ScanBundles. "entry" is only valid during the call.
+ */
+typedef void (*WUHBScanCallback)(const WUHBScanEntry *entry, void *context);
+
+/**
+ * Gets the RPX info of every ".wuhb" file in a directory (not recursive). The callback is called in the order of the file names.
+ * Afterwards the cache file is updated if anything has changed, entries of bundles that have been removed from "dir" are dropped.
+ *
+ * @param dir       directory to scan, uses the same path format as WUHBUtils_GetRPXInfo for "source".
+ * @param source    how the bundles are accessed, see BundleSource.
+ * @param callback  called for every bundle
+ * @param context   passed to the callback
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the directory has been scanned.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "dir" or "callback" is NULL.<br>
+ *          WUHB_UTILS_RESULT_FILE_NOT_FOUND:       "dir" can't be opened.
+ */
+WUHBUtilsStatus WUHBUtils_ScanBundles(const char *dir, BundleSource source, WUHBScanCallback callback, void *context);
+
+/**
+ * Sets the file the scan cache is stored in (e.g. "fs:/vol/external01/wiiu/apps/.wuhb_scan_cache"), the cache is loaded
+ * from it right away. Pass NULL to keep the cache in memory only (default).<br>
+ * The file uses the native path format of the C standard library ("fs:/vol/...").
+ *
+ * @param path      path of the cache file or NULL
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_SetScanCachePath(const char *path);
+
+/**
+ * Drops all cached results, the cache file is not touched.
+ *
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_ScanCacheClear();
+
+/**
+ * Reads files of a bundle that is not mounted into an arena, e.g. the meta.ini and the icon of every bundle for a launcher listing.<br>
+ * The bundle file is opened once, only the entries of the directories on the requested paths are looked at and the files
+ * are read in the order they are stored in the bundle. No mount name is registered, WUHBUtils_InitLibrary is not needed.<br>
+ * Files are looked up by their exact name, ".gz" files are returned as they are stored.
+ *
+ * @param bundlePath    path of the bundle, uses the same path format as WUHBUtils_GetRPXInfo for "source".
+ * @param source        how the bundle is accessed, see BundleSource.
+ * @param paths         paths of the files inside the bundle (e.g. WUHB_META_ICON_PATH)
+ * @param count         number of entries in "paths"
+ * @param arena         the files are placed into the arena back-to-back in the order of "paths", like WUHBUtils_ArenaReadWholeFile does.
+ * @param alignment     alignment of each file's data, a power of two. 0x40 is recommended.
+ * @param outBufs       array of "count" entries, the address of each file's data inside the arena (or NULL) will be stored here.
+ * @param outSizes      array of "count" entries, the size of each file (or 0) will be stored here.
+ * @param outStatus     array of "count" entries, the result of each file will be stored here:<br>
+ *                      WUHB_UTILS_RESULT_SUCCESS, WUHB_UTILS_RESULT_FILE_NOT_FOUND,<br>
+ *                      WUHB_UTILS_RESULT_BUFFER_TOO_SMALL (the file doesn't fit into the rest of the arena, no space is used),<br>
+ *                      WUHB_UTILS_RESULT_READ_FAILED (reading failed, space reserved for the file stays used) or<br>
+ *                      WUHB_UTILS_RESULT_UNKNOWN_ERROR (the bundle is broken).
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the bundle has been read, see "outStatus" for the result of each file.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "bundlePath" or "arena" is NULL, an array is NULL while "count" is not 0 or "alignment" is not a power of two.<br>
+ *          WUHB_UTILS_RESULT_MOUNT_FAILED:         the bundle can't be opened or is not a valid bundle.<br>
+ *          WUHB_UTILS_RESULT_READ_FAILED:          reading the header or the directory table of the bundle failed.
+ */
+WUHBUtilsStatus WUHBUtils_ReadBundleFiles(const char *bundlePath, BundleSource source, const char **paths, uint32_t count, WUHBArena *arena, uint32_t alignment,
+                                          uint8_t **outBufs, uint32_t *outSizes, WUHBUtilsStatus *outStatus);
+
+#ifdef __cplusplus
+}
+#endif
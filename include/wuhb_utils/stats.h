@@ -0,0 +1,103 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * I/O statistics of the library, to find out whether slow loads are caused by the WUHBUtilsModule, the storage or the caller.<br>
+ * <br>
+ * The statistics are only collected if the library has been built with WUHB_UTILS_STATS defined
+ * ("make WUHB_UTILS_STATS=1"), otherwise the instrumentation is compiled out and WUHBUtils_GetStats returns
+ * WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND.<br>
+ * All counters are updated atomically, the statistics can be read from any thread or core at any time.
+ */
+
+/**
+ * Latency buckets: bucket 0 counts calls that took less than 1 µs, bucket i (1 <= i < WUHB_STATS_LATENCY_BUCKETS - 1)
+ * calls that took [2^(i-1), 2^i) µs. The last bucket counts everything above.
+ */
+#define WUHB_STATS_LATENCY_BUCKETS 20
+
+typedef enum WUHBStatsCall {
+    WUHB_STATS_CALL_MOUNT_BUNDLE = 0,
+    WUHB_STATS_CALL_UNMOUNT_BUNDLE,
+    WUHB_STATS_CALL_FILE_OPEN,
+    WUHB_STATS_CALL_FILE_READ,
+    WUHB_STATS_CALL_FILE_READ_AT,
+    WUHB_STATS_CALL_FILE_READ_V,
+    WUHB_STATS_CALL_FILE_READ_V_AT,
+    WUHB_STATS_CALL_FILE_CLOSE,
+    WUHB_STATS_CALL_FILE_EXISTS,
+    WUHB_STATS_CALL_FILE_GET_SIZE,
+    WUHB_STATS_CALL_FILE_SEEK,
+    WUHB_STATS_CALL_FILE_TELL,
+    WUHB_STATS_CALL_GET_FILE_INFO,
+    WUHB_STATS_CALL_OPEN_DIR,
+    WUHB_STATS_CALL_READ_DIR_BATCH,
+    WUHB_STATS_CALL_CLOSE_DIR,
+    WUHB_STATS_CALL_READ_WHOLE_FILE,
+    WUHB_STATS_CALL_READ_WHOLE_FILE_INTO,
+    WUHB_STATS_CALL_GET_RPX_INFO,
+    WUHB_STATS_CALL_READ_FILES,
+    WUHB_STATS_CALL_READ_WHOLE_FILE_HASHED,
+    WUHB_STATS_CALL_SCAN_BUNDLES,
+    WUHB_STATS_CALL_READ_BUNDLE_FILES,
+    WUHB_STATS_CALL_FILE_STREAM,
+    WUHB_STATS_CALL_COUNT,
+} WUHBStatsCall;
+
+typedef struct WUHBLatencyHistogram {
+    uint64_t buckets[WUHB_STATS_LATENCY_BUCKETS];
+    uint64_t count;
+    uint64_t totalUs; // sum of all latencies
+    uint64_t maxUs;
+} WUHBLatencyHistogram;
+
+typedef struct WUHBStats {
+    uint64_t calls[WUHB_STATS_CALL_COUNT]; // number of calls per function (including calls made by the library itself, except for the reads of the
+                                           // prefetch thread and of the compressed data behind an index), see WUHBStatsCall
+    uint64_t bytesReadPlain;               // bytes read from files that are stored uncompressed (including reads from the bundle file by WUHBUtils_ReadFiles)
+    uint64_t bytesReadCompressed;          // (uncompressed) bytes read from files that are decompressed on the fly
+                                           // Every read of the application is counted once: reads served from prefetched memory (see
+                                           // <wuhb_utils/prefetch.h>) count as plain when the application reads them, loading them doesn't count.
+                                           // Reads via a <wuhb_utils/gz_index.h> index count the uncompressed bytes, not the compressed data read
+                                           // for them. Bytes of more than 64 compressed files open at the same time count as plain.
+    uint64_t readWholeFileReallocs;        // buffer reallocations of WUHBUtils_ReadWholeFile for files of unknown size
+    uint32_t openFileHandles;              // files that have been opened but not closed yet, including files opened from the staging area
+    uint32_t openDirHandles;               // directories that have been opened but not closed yet
+    WUHBLatencyHistogram openLatency;      // WUHBUtils_FileOpen
+    WUHBLatencyHistogram readLatency;      // WUHBUtils_FileRead, WUHBUtils_FileReadAt, WUHBUtils_FileReadV and WUHBUtils_FileReadVAt
+    WUHBLatencyHistogram closeLatency;     // WUHBUtils_FileClose
+} WUHBStats;
+
+/**
+ * Returns the name of a WUHBStatsCall (e.g. "FileOpen").
+ */
+const char *WUHBUtils_GetStatsCallStr(WUHBStatsCall call);
+
+/**
+ * Takes a snapshot of the statistics.
+ *
+ * @param outStats  the statistics will be stored here.
+ * @return WUHB_UTILS_RESULT_SUCCESS:               *outStats has been set.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "outStats" is NULL.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:   The library has been built without WUHB_UTILS_STATS.
+ */
+WUHBUtilsStatus WUHBUtils_GetStats(WUHBStats *outStats);
+
+/**
+ * Resets all counters and histograms. The number of open handles is not reset.
+ *
+ * @return WUHB_UTILS_RESULT_SUCCESS:               The statistics have been reset.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:   The library has been built without WUHB_UTILS_STATS.
+ */
+WUHBUtilsStatus WUHBUtils_ResetStats();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * Recording which files an application reads while it boots, and prefetching them on the next boot.<br>
+ * <br>
+ * 1. Record a trace: WUHBUtils_TraceStart before mounting, WUHBUtils_TraceStop once the boot has finished. Every
+ *    open, read (offset + size) and close of a file is recorded in memory and written into a compact binary file.
+ *    While recording, these calls take a lock shared by all handles.<br>
+ * 2. Build a profile from one or more traces via WUHBUtils_BuildProfile, on the console or offline via the host tool
+ *    "wuhbprofile". The profile lists the files that have been read during (most of) the boots in the order they
+ *    have been needed, partially read files are left out.<br>
+ * 3. Register the profile via WUHBUtils_SetMountProfile. Every successful WUHBUtils_MountBundle of that name queues the files
+ *    of the profile in the order they are stored inside the bundle into the staging area of <wuhb_utils/prefetch.h>
+ *    (with WUHB_ASYNC_PRIORITY_LOW, files prefetched by the application are loaded first).<br>
+ * <br>
+ * Traces store the paths as they have been passed to WUHBUtils_FileOpen, profiles store them relative to the mount
+ * (e.g. "/content/level1.bin"), so a profile doesn't depend on the mount name.
+ * Traces are written in big-endian byte order, a trace recorded on the console can be read on a PC.
+ */
+
+#define WUHB_TRACE_DEFAULT_MAX_EVENTS 65536
+
+// Files of which less than this percentage has been read are not added to a profile.
+#define WUHB_PROFILE_MIN_COVERAGE 50
+
+typedef struct WUHBTraceInfo {
+    bool recording;      // whether a trace is being recorded
+    uint32_t events;     // recorded events
+    uint32_t dropped;    // events that have been dropped because "maxEvents" had been reached
+    uint32_t paths;      // different paths in the trace
+} WUHBTraceInfo;
+
+/**
+ * Starts recording a trace, a trace that is already being recorded is discarded.<br>
+ * While recording, opening, reading and closing files takes a lock shared by all threads.
+ * Reads done by the prefetch thread are not recorded, files served from the staging area are.
+ *
+ * @param maxEvents maximum number of events kept in memory (16 bytes each), 0 for WUHB_TRACE_DEFAULT_MAX_EVENTS.
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_TraceStart(uint32_t maxEvents);
+
+/**
+ * Stops recording and writes the trace into a file.
+ *
+ * @param path  path of the trace file (e.g. "fs:/vol/external01/wiiu/apps/app/boot.trace"), uses the native path format of
+ *              the C standard library. Pass NULL to discard the trace.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the trace has been written (or discarded).<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     no trace is being recorded.<br>
+ *          WUHB_UTILS_RESULT_UNKNOWN_ERROR:        writing the file failed.
+ */
+WUHBUtilsStatus WUHBUtils_TraceStop(const char *path);
+
+/**
+ * Returns information about the trace that is currently being recorded.
+ *
+ * @param outInfo   the information will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outInfo has been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "outInfo" is NULL
+ */
+WUHBUtilsStatus WUHBUtils_TraceGetInfo(WUHBTraceInfo *outInfo);
+
+/**
+ * Turns traces into a prefetch profile. A file is added if it has been opened in at least half of the traces and
+ * at least WUHB_PROFILE_MIN_COVERAGE percent of it have been read, ordered by the time it has first been opened
+ * (median over the traces). Files that would exceed "budget" are skipped, later files that still fit are added.<br>
+ * The profile is a text file with one "<size> <path>" line per file, lines starting with '#' are comments.
+ *
+ * @param tracePaths    paths of the trace files (native path format)
+ * @param count         number of entries in "tracePaths"
+ * @param budget        maximum sum of the file sizes in the profile, 0 for WUHB_PREFETCH_DEFAULT_BUDGET (see <wuhb_utils/prefetch.h>)
+ * @param profilePath   path the profile will be written to (native path format)
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the profile has been written.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "tracePaths" or "profilePath" is NULL or "count" is 0.<br>
+ *          WUHB_UTILS_RESULT_FILE_NOT_FOUND:       a trace file can't be opened or is not a valid trace.<br>
+ *          WUHB_UTILS_RESULT_UNKNOWN_ERROR:        writing the profile failed.
+ */
+WUHBUtilsStatus WUHBUtils_BuildProfile(const char **tracePaths, uint32_t count, uint32_t budget, const char *profilePath);
+
+/**
+ * Registers a profile for a mount name. After every successful WUHBUtils_MountBundle of "name" the prefetch thread
+ * loads the profile, looks up where the files are stored inside the bundle and queues them like WUHBUtils_Prefetch
+ * in that order, WUHBUtils_MountBundle itself doesn't wait for this.
+ * Files of the profile that don't exist in the bundle are skipped.
+ *
+ * @param name          mount name, e.g. "bundle"
+ * @param profilePath   path of the profile (native path format), NULL to remove the registration.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              the profile has been registered (or removed).<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "name" is NULL.
+ */
+WUHBUtilsStatus WUHBUtils_SetMountProfile(const char *name, const char *profilePath);
+
+#ifdef __cplusplus
+}
+#endif
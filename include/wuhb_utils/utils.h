@@ -4,6 +4,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef enum WUHBUtilsStatus {
@@ -18,6 +19,11 @@ typedef enum WUHBUtilsStatus {
     WUHB_UTILS_RESULT_FILE_NOT_FOUND        = -0x14,
     WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND = -0x15,
     WUHB_UTILS_RESULT_MOUNT_FAILED          = -0x16,
+    WUHB_UTILS_RESULT_BUFFER_TOO_SMALL      = -0x17,
+    WUHB_UTILS_RESULT_REQUEST_CANCELLED     = -0x18,
+    WUHB_UTILS_RESULT_REQUEST_PENDING       = -0x19,
+    WUHB_UTILS_RESULT_HASH_MISMATCH         = -0x1A,
+    WUHB_UTILS_RESULT_READ_FAILED           = -0x1B,
     WUHB_UTILS_RESULT_LIB_UNINITIALIZED     = -0x20,
     WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND   = -0x21,
     WUHB_UTILS_RESULT_UNKNOWN_ERROR         = -0x100,
@@ -25,9 +31,22 @@ typedef enum WUHBUtilsStatus {
 
 typedef uint32_t WUHBUtilsVersion;
 typedef uint32_t WUHBFileHandle;
+typedef uint32_t WUHBDirHandle;
 
 #define WUHB_UTILS_MODULE_VERSION_ERROR 0xFFFFFFFF
 
+// Features of the loaded module as reported by WUHBUtils_GetCapabilities.
+#define WUHB_UTILS_CAPABILITY_MOUNT     (1u << 0) // WUHBUtils_MountBundle and WUHBUtils_UnmountBundle
+#define WUHB_UTILS_CAPABILITY_FILE      (1u << 1) // WUHBUtils_FileOpen, WUHBUtils_FileRead, WUHBUtils_FileClose and WUHBUtils_FileExists
+#define WUHB_UTILS_CAPABILITY_RPX_INFO  (1u << 2) // WUHBUtils_GetRPXInfo
+#define WUHB_UTILS_CAPABILITY_FILE_SIZE (1u << 3) // WUHBUtils_FileGetSize, without it whole files are read into a growing buffer
+#define WUHB_UTILS_CAPABILITY_SEEK      (1u << 4) // WUHBUtils_FileSeek and WUHBUtils_FileTell
+#define WUHB_UTILS_CAPABILITY_READ_AT   (1u << 5) // positional reads in a single call, without it WUHBUtils_FileReadAt seeks (if supported)
+#define WUHB_UTILS_CAPABILITY_READ_V    (1u << 6) // WUHBUtils_FileReadV in a single call, without it every WUHBIoVec is read on its own
+#define WUHB_UTILS_CAPABILITY_READ_V_AT (1u << 7) // WUHBUtils_FileReadVAt in a single call, without it every WUHBIoVec is read on its own
+#define WUHB_UTILS_CAPABILITY_DIR       (1u << 8) // WUHBUtils_OpenDir, WUHBUtils_ReadDirBatch and WUHBUtils_CloseDir
+#define WUHB_UTILS_CAPABILITY_FILE_INFO (1u << 9) // WUHBUtils_GetFileInfo for bundles that haven't been indexed
+
 typedef enum WUHBUtilsApiErrorType {
     WUHB_UTILS_API_ERROR_NONE                  = 0,
     WUHB_UTILS_API_ERROR_INVALID_ARG           = -1,
@@ -37,6 +56,7 @@ typedef enum WUHBUtilsApiErrorType {
     WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND = -5,
     WUHB_UTILS_API_ERROR_NO_MEMORY             = -6,
     WUHB_UTILS_API_ERROR_MOUNT_FAILED          = -7,
+    WUHB_UTILS_API_ERROR_READ_FAILED           = -8,
 } WUHBUtilsApiErrorType;
 
 typedef struct {
@@ -49,10 +69,62 @@ typedef enum {
     BundleSource_FileDescriptor_CafeOS, /* The native CafeOS file api will be used, use paths like /vol/external01/my.wuhb */
 } BundleSource;
 
+typedef struct WUHBBundleIndexInfo {
+    uint32_t files;       // number of files in the bundle
+    uint32_t gzAliases;   // number of "<file>.gz" files that are also indexed as "<file>"
+    uint32_t slots;       // size of the hash table
+    uint32_t memoryUsage; // memory used by the index in bytes
+} WUHBBundleIndexInfo;
+
+typedef struct WUHBIoVec {
+    uint8_t *buffer; // destination buffer, align to 0x40 for best performance
+    uint32_t size;   // number of bytes to read into buffer
+} WUHBIoVec;
+
+#define WUHB_DIR_ENTRY_NAME_LENGTH 256
+
+typedef enum WUHBDirEntryType {
+    WUHB_DIR_ENTRY_TYPE_FILE      = 0,
+    WUHB_DIR_ENTRY_TYPE_DIRECTORY = 1,
+} WUHBDirEntryType;
+
+typedef struct WUHBDirEntry {
+    char name[WUHB_DIR_ENTRY_NAME_LENGTH]; // null-terminated name of the entry, longer names are truncated
+    WUHBDirEntryType type;
+    uint32_t size;     // size of the file as returned by WUHBUtils_FileGetSize, 0 for directories
+    bool isCompressed; // the file is stored as name + ".gz" and decompressed on the fly when opened via "name"
+} WUHBDirEntry;
+
+// Number of chunk buffers used by WUHBUtils_FileStream.
+#define WUHB_STREAM_BUFFER_COUNT 2
+
+/**
+ * Called by WUHBUtils_FileStream for every chunk of the file, in order. "data" is only valid during the call.<br>
+ * Return false to stop streaming.
+ */
+typedef bool (*WUHBStreamCallback)(const uint8_t *data, uint32_t size, uint32_t offset, void *userdata);
+
+typedef enum WUHBSeekOrigin {
+    WUHB_SEEK_SET = 0, /* Seek relative to the start of the file */
+    WUHB_SEEK_CUR = 1, /* Seek relative to the current position */
+    WUHB_SEEK_END = 2, /* Seek relative to the end of the file */
+} WUHBSeekOrigin;
+
+typedef enum WUHBReadFilesMode {
+    WUHB_READ_FILES_SEPARATE_BUFFERS = 0, /* Every file is read into its own buffer, free each of them via WUHBUtils_Free */
+    WUHB_READ_FILES_CONTIGUOUS       = 1, /* All files are read into one allocation, free it once via WUHBUtils_Free */
+} WUHBReadFilesMode;
+
 const char *WUHBUtils_GetStatusStr(WUHBUtilsStatus status);
 
 /**
- * This function has to be called before any other function of this lib (except WUHBUtils_GetVersion) can be used.
+ * This function has to be called before any other function of this lib (except WUHBUtils_GetVersion) can be used.<br>
+ * <br>
+ * Thread safety: WUHBUtils_InitLibrary may be called from multiple threads, the library is only initialized once.
+ * Afterwards all functions can be called from any core at the same time. Calls on different file handles don't share
+ * any lock of this library (unless the statistics are enabled or a trace is recorded, see <wuhb_utils/stats.h> and
+ * <wuhb_utils/trace.h>), calls on the same handle have to be serialized by the caller. This includes handles served by
+ * a <wuhb_utils/gz_index.h> index or from the <wuhb_utils/prefetch.h> staging area.
  *
  * @return  WUHB_UTILS_RESULT_SUCCESS:                 The library has been initialized successfully. Other functions can now be used. <br>
  *          WUHB_UTILS_RESULT_MODULE_NOT_FOUND:        The module could not be found. Make sure the module is loaded.<br>
@@ -62,7 +134,8 @@ const char *WUHBUtils_GetStatusStr(WUHBUtilsStatus status);
 WUHBUtilsStatus WUHBUtils_InitLibrary();
 
 /**
- * Deinitializes the WUHBUtils lib
+ * Deinitializes the WUHBUtils lib, WUHBUtils_InitLibrary has to be called again before using it.<br>
+ * Must not be called while other threads use the library.
  * @return WUHB_UTILS_RESULT_SUCCESS
  */
 WUHBUtilsStatus WUHBUtils_DeInitLibrary();
@@ -80,6 +153,22 @@ WUHBUtilsStatus WUHBUtils_DeInitLibrary();
  */
 WUHBUtilsStatus WUHBUtils_GetVersion(WUHBUtilsVersion *outVersion);
 
+/**
+ * Retrieves the features of the loaded module as a combination of WUHB_UTILS_CAPABILITY_*, e.g. to choose between
+ * positional reads and seeking once instead of checking for WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND on every call.<br>
+ * Functions without their capability either return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND or fall back to slower
+ * calls as described for each capability.<br>
+ * <br>
+ * Rarely used exports are only looked up on their first call, this looks up all of them.
+ *
+ * @param outCapabilities pointer to the variable where the capabilities will be stored.
+ *
+ * @return WUHB_UTILS_RESULT_SUCCESS:               The capabilities have been stored in outCapabilities.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      outCapabilities was NULL.
+ */
+WUHBUtilsStatus WUHBUtils_GetCapabilities(uint32_t *outCapabilities);
+
 /**
  * Mounts a given bundle to a given mount path. Use WUHBUtils_UnmountBundle to unmount it.<br>
  *<br>
@@ -100,6 +189,30 @@ WUHBUtilsStatus WUHBUtils_GetVersion(WUHBUtilsVersion *outVersion);
  */
 WUHBUtilsStatus WUHBUtils_MountBundle(const char *name, const char *path, BundleSource source, int32_t *outRes);
 
+/**
+ * Enables or disables the client-side index for bundles mounted via WUHBUtils_MountBundle (enabled by default).<br>
+ * When a bundle is mounted, the library reads the file table of the bundle once and builds a hash table of all paths.
+ * WUHBUtils_FileExists and failing WUHBUtils_FileOpen calls are then answered by the library in constant time,
+ * without calling into the WUHBUtilsModule. If the bundle can't be read by the library, all lookups go to the module.<br>
+ * <br>
+ * Only affects bundles that are mounted afterwards.
+ *
+ * @param enabled   true to build an index for bundles mounted from now on.
+ * @return WUHB_UTILS_RESULT_SUCCESS
+ */
+WUHBUtilsStatus WUHBUtils_SetBundleIndexEnabled(bool enabled);
+
+/**
+ * Returns information about the client-side index of a mounted bundle, see WUHBUtils_SetBundleIndexEnabled.
+ *
+ * @param name      name the bundle has been mounted to (e.g. "bundle")
+ * @param outInfo   the information will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              *outInfo has been set.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "name" or "outInfo" was NULL<br>
+ *          WUHB_UTILS_RESULT_MOUNT_NOT_FOUND:      There is no index for a bundle mounted to "name".
+ */
+WUHBUtilsStatus WUHBUtils_GetBundleIndexInfo(const char *name, WUHBBundleIndexInfo *outInfo);
+
 /**
  *
  * @param name          path the bundle should be unmounted to (e.g. "bundle")
@@ -188,16 +301,196 @@ WUHBUtilsStatus WUHBUtils_FileClose(WUHBFileHandle handle);
 */
 WUHBUtilsStatus WUHBUtils_FileExists(const char *name, int32_t *outRes);
 
+/**
+ * Gets the location of a file's data inside the bundle file, like WUHBUtils_GetRPXInfo does for the /code/ *.rpx.<br>
+ * This allows reading the data directly from the bundle file (e.g. large aligned reads for streaming) without going
+ * through the WUHBUtilsModule.<br>
+ * <br>
+ * The file is resolved like WUHBUtils_FileOpen does. If only name + ".gz" exists, *outIsCompressed is set to true and
+ * offset and length refer to the gzip compressed data, which has to be decompressed by the caller.<br>
+ * <br>
+ * If the bundle has a client-side index (see WUHBUtils_SetBundleIndexEnabled) the lookup doesn't need the module.
+ *
+ * @param path              path to the file (e.g. "bundle:/content/music.ogg")
+ * @param outOffset         offset of the file's data relative to the start of the bundle file will be stored here.
+ * @param outLength         length of the file's data as stored in the bundle will be stored here.
+ * @param outIsCompressed   whether the data is stored compressed will be stored here.
+ * @return WUHB_UTILS_RESULT_SUCCESS                The information has been stored.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:   Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "path", "outOffset", "outLength" or "outIsCompressed" is NULL<br>
+ *         WUHB_UTILS_RESULT_FILE_NOT_FOUND:        file at "path" was not found.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_GetFileInfo(const char *path, uint64_t *outOffset, uint64_t *outLength, bool *outIsCompressed);
+
+/**
+ * Gets the size of an opened file.<br>
+ * For files that are decompressed on the fly (name + ".gz") the uncompressed size is returned.<br>
+ *
+ * @param handle    File handle to query.
+ * @param outSize   PTR to the uint32_t where the size of the file will be stored.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    The size of the file has been stored in *outSize.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:         "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:       Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "outSize" is NULL<br>
+ *         WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:     file handle is invalid.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_FileGetSize(WUHBFileHandle handle, uint32_t *outSize);
+
+/**
+ * Sets the read position of a file.<br>
+ * For files that are decompressed on the fly, the position refers to the uncompressed data.<br>
+ *
+ * @param handle    File handle to seek in.
+ * @param offset    offset relative to "origin"
+ * @param origin    see WUHBSeekOrigin.
+ * @param outPos    (optional) the new position will be stored here.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    The position has been set.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:         "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:       Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          invalid "origin" or the resulting position is negative.<br>
+ *         WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:     file handle is invalid.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos);
+
+/**
+ * Gets the read position of a file.
+ *
+ * @param handle    File handle to query.
+ * @param outPos    the current position will be stored here.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    The position has been stored in *outPos.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:         "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:       Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "outPos" is NULL<br>
+ *         WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:     file handle is invalid.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_FileTell(WUHBFileHandle handle, uint32_t *outPos);
+
+/**
+ * Reads from a given position of a file without changing the read position of the handle (like pread).<br>
+ * <br>
+ * If the loaded WUHBUtilsModule doesn't support positional reads, but supports seeking, the read is emulated via<br>
+ * WUHBUtils_FileTell/FileSeek/FileRead. In this case the handle must not be used by multiple threads at the same time.
+ *
+ * @param handle    File handle to be read from.
+ * @param offset    position inside the file to read from.
+ * @param buffer    buffer where data will be written to.
+ *                  Align to 0x40 for best performance
+ * @param size      maximum bytes this function should read into buffer
+ * @param outRes    the number of bytes read will be stored here (zero indicates end of file), -1 on error.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    file read has been called successfully. The result has been written to *outRes.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:         "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:       Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "buffer" or "outRes" is NULL<br>
+ *         WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:     file handle is invalid.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes);
+
+/**
+ * Reads consecutive data of a file into multiple buffers (like readv).<br>
+ * The buffers are filled in order, each buffer is filled completely unless the end of the file is reached.<br>
+ * The file position is advanced by the number of bytes read.<br>
+ * <br>
+ * If the loaded WUHBUtilsModule doesn't support WUU_FileReadV, WUHBUtils_FileRead is called for each buffer.
+ *
+ * @param handle    File handle to be read from.
+ * @param vecs      buffers to fill.
+ * @param count     number of entries in "vecs"
+ * @param outTotal  the total number of bytes read will be stored here. Less than the sum of all sizes only
+ *                  if the end of the file has been reached.
+ * @return WUHB_UTILS_RESULT_SUCCESS                    *outTotal bytes have been read.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:         "WUHBUtils_Init()" was not called before.<br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:       Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:          "outTotal" is NULL or "vecs" or one of its buffers is NULL<br>
+ *         WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:     file handle is invalid.<br>
+ *         WUHB_UTILS_RESULT_READ_FAILED:               reading from the bundle failed (I/O error).<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:             Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_FileReadV(WUHBFileHandle handle, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal);
+
+/**
+ * Like WUHBUtils_FileReadV, but reads starting at "offset" without changing the read position of the handle (like preadv).<br>
+ * <br>
+ * If the loaded WUHBUtilsModule doesn't support WUU_FileReadVAt, WUHBUtils_FileReadAt is called for each buffer.
+ *
+ * @param handle    File handle to be read from.
+ * @param offset    position inside the file to read from.
+ * @param vecs      buffers to fill.
+ * @param count     number of entries in "vecs"
+ * @param outTotal  the total number of bytes read will be stored here.
+ * @return see WUHBUtils_FileReadV
+ */
+WUHBUtilsStatus WUHBUtils_FileReadVAt(WUHBFileHandle handle, uint32_t offset, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal);
+
+/**
+ * Opens a directory inside a mounted bundle for enumeration via WUHBUtils_ReadDirBatch.<br>
+ * The content of the directory is captured when it's opened. Close the handle via WUHBUtils_CloseDir.
+ *
+ * @param path          path to the directory (e.g. "bundle:/content/textures"), "bundle:/" is the root of the bundle.
+ * @param outHandle     on success the directory handle will be stored here.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:              The directory has been opened, the handle has been stored in *outHandle.<br>
+ *          WUHB_UTILS_RESULT_LIB_UNINITIALIZED:    "WUHBUtils_Init()" was not called before.<br>
+ *          WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:  Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:     "path" or "outHandle" is NULL<br>
+ *          WUHB_UTILS_RESULT_FILE_NOT_FOUND:       The directory at "path" was not found.<br>
+ *          WUHB_UTILS_RESULT_NO_MEMORY:            Not enough memory.<br>
+ *          WUHB_UTILS_RESULT_UNKNOWN_ERROR:        Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_OpenDir(const char *path, WUHBDirHandle *outHandle);
+
+/**
+ * Reads the next entries of a directory opened via WUHBUtils_OpenDir into "entries".<br>
+ * A single call fills up to "maxEntries" entries, use a large batch to enumerate big directories with few calls.<br>
+ * <br>
+ * Files that are stored compressed (name + ".gz") are returned without the ".gz" extension, isCompressed set and their
+ * uncompressed size, the same way WUHBUtils_FileOpen resolves them. If the directory contains both "name" and "name.gz",
+ * "name.gz" is returned as is.
+ *
+ * @param handle        Directory handle to read from.
+ * @param entries       array where the entries will be written to.
+ * @param maxEntries    number of entries in "entries"
+ * @param outCount      the number of entries written will be stored here, 0 if the end of the directory has been reached.
+ * @return  WUHB_UTILS_RESULT_SUCCESS:                  *outCount entries have been written to "entries".<br>
+ *          WUHB_UTILS_RESULT_LIB_UNINITIALIZED:        "WUHBUtils_Init()" was not called before.<br>
+ *          WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:      Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *          WUHB_UTILS_RESULT_INVALID_ARGUMENT:         "entries" or "outCount" is NULL or "maxEntries" is 0<br>
+ *          WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:    directory handle is invalid.<br>
+ *          WUHB_UTILS_RESULT_UNKNOWN_ERROR:            Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_ReadDirBatch(WUHBDirHandle handle, WUHBDirEntry *entries, uint32_t maxEntries, uint32_t *outCount);
+
+/**
+ * Closes a directory opened via WUHBUtils_OpenDir.
+ *
+ * @param handle    Directory handle to be closed
+ * @return  WUHB_UTILS_RESULT_SUCCESS:                  The directory handle has been closed.<br>
+ *          WUHB_UTILS_RESULT_LIB_UNINITIALIZED:        "WUHBUtils_Init()" was not called before.<br>
+ *          WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:      Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *          WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND:    directory handle is invalid.<br>
+ *          WUHB_UTILS_RESULT_UNKNOWN_ERROR:            Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_CloseDir(WUHBDirHandle handle);
+
 /**
  * Opens a file, reads it completely and returns the data as new buffer, <br>
- * On success the the caller has to call "free()" on the returned buffer after using it.
+ * On success the the caller has to call "WUHBUtils_Free()" on the returned buffer after using it.<br>
+ * The buffer is allocated via the allocator set by WUHBUtils_SetAllocator (see <wuhb_utils/allocator.h>), with the default<br>
+ * allocator "free()" can be used as well.<br>
+ * <br>
+ * If the loaded WUHBUtilsModule supports WUHBUtils_FileGetSize, the file is read into a single buffer of the exact size.<br>
+ * Otherwise the buffer grows while reading.
  *
  * @param path    path to the file.
  * @param buffer  address where the buffer address will be stored
  * @param size    address where the size will be stored
  * @return WUHB_UTILS_RESULT_SUCCESS            file read has been done. The new buffer been written to *outBuf. <br>
  *                                                                       The size of the buffer will be written to *outSize. <br>
- *                                              The buffer returned in *outBuf has be cleaned up via "free()"
+ *                                              The buffer returned in *outBuf has be cleaned up via "WUHBUtils_Free()"
  *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before. <br>
 *          WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:   Command not supported by the currently loaded WUHBUtilsModule version.<br>
  *         WUHB_UTILS_API_ERROR_INVALID_ARG:        "outBuf" or "outSize" is NULL. <br>
@@ -206,6 +499,83 @@ WUHBUtilsStatus WUHBUtils_FileExists(const char *name, int32_t *outRes);
  */
 WUHBUtilsStatus WUHBUtils_ReadWholeFile(const char *path, uint8_t **outBuf, uint32_t *outSize);
 
+/**
+ * Opens a file and reads it completely into a caller provided buffer.<br>
+ * Use WUHBUtils_FileGetSize to determine the required size of the buffer.
+ *
+ * @param path      path to the file.
+ * @param buffer    buffer where the data will be written to.
+ *                  Align to 0x40 for best performance
+ * @param capacity  size of "buffer" in bytes
+ * @param outSize   address where the size of the file will be stored
+ * @return WUHB_UTILS_RESULT_SUCCESS                file read has been done. The size of the file has been written to *outSize.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before. <br>
+ *         WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND:   Command not supported by the currently loaded WUHBUtilsModule version.<br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "buffer" or "outSize" is NULL. <br>
+ *         WUHB_UTILS_RESULT_FILE_NOT_FOUND:        file at "path" was not found.<br>
+ *         WUHB_UTILS_RESULT_BUFFER_TOO_SMALL:      The file doesn't fit into "buffer". If the size of the file could be determined
+ *                                                  it has been written to *outSize, otherwise *outSize is set to 0.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         Unknown error.
+ */
+WUHBUtilsStatus WUHBUtils_ReadWholeFileInto(const char *path, uint8_t *buffer, uint32_t capacity, uint32_t *outSize);
+
+/**
+ * Reads multiple files at once, e.g. all files of a level.<br>
+ * Instead of opening and reading the files one after another in the given order, the location of every file inside
+ * the bundle is resolved via the bundle index, the files are sorted by their offset and read in one sequential sweep
+ * over the bundle file. Small files that are close to each other are read with a single read.<br>
+ * Files that are stored compressed (".gz") or can't be resolved by the bundle index are read via WUHBUtils_ReadWholeFile.<br>
+ * <br>
+ * A missing or unreadable file doesn't fail the whole batch, check "outStatus" for the result of each file.
+ *
+ * @param paths     paths of the files to read
+ * @param count     number of entries in "paths", "outBufs", "outSizes" and "outStatus"
+ * @param mode      WUHB_READ_FILES_SEPARATE_BUFFERS: outBufs[i] has been allocated for file i and has to be cleaned up via
+ *                  "WUHBUtils_Free()".<br>
+ *                  WUHB_READ_FILES_CONTIGUOUS: all files are stored in one allocation (each file 0x40 aligned, in the
+ *                  order of "paths"), outBufs[i] points into it. The allocation is returned in *outBlock and has to be
+ *                  cleaned up via "WUHBUtils_Free()".
+ * @param outBufs   outBufs[i] is set to the data of file i, or NULL if it could not be read.
+ * @param outSizes  outSizes[i] is set to the size of file i, or 0 if it could not be read.
+ * @param outStatus outStatus[i] is set to the result of file i, see WUHBUtils_ReadWholeFile.
+ * @param outBlock  address where the allocation will be stored in WUHB_READ_FILES_CONTIGUOUS mode (NULL if "count" is 0),
+ *                  ignored (may be NULL) in WUHB_READ_FILES_SEPARATE_BUFFERS mode.
+ * @return WUHB_UTILS_RESULT_SUCCESS                All files have been processed, see "outStatus" for the result of each file.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before. <br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "paths", "outBufs", "outSizes" or "outStatus" is NULL, "mode" is invalid or
+ *                                                  "outBlock" is NULL in WUHB_READ_FILES_CONTIGUOUS mode.<br>
+ *         WUHB_UTILS_RESULT_NO_MEMORY:             Not enough memory for the allocation in WUHB_READ_FILES_CONTIGUOUS mode, no
+ *                                                  file has been read.
+ */
+WUHBUtilsStatus WUHBUtils_ReadFiles(const char **paths, uint32_t count, WUHBReadFilesMode mode, uint8_t **outBufs, uint32_t *outSizes, WUHBUtilsStatus *outStatus, uint8_t **outBlock);
+
+/**
+ * Reads a file chunk by chunk and passes every chunk to a callback, e.g. to upload a texture or to feed a decoder
+ * without loading the whole file into memory.<br>
+ * The file is read into WUHB_STREAM_BUFFER_COUNT rotating buffers of "chunkSize" bytes (0x40 aligned). While the callback
+ * processes a chunk, the next chunk is already read by the worker threads of the async API (see <wuhb_utils/async.h>),
+ * so the memory used is bounded by the buffers and not by the size of the file. The read-ahead is executed before all
+ * pending requests of the application, but has to wait for a free worker thread.<br>
+ * Called on a worker thread of the async API (e.g. inside a WUHBAsyncCallback), the chunks are read on the calling
+ * thread without read-ahead, because waiting for the pool there would deadlock once every worker waits.<br>
+ * Compressed files are passed to the callback decompressed. If a hash manifest is used for verification (see <wuhb_utils/hash.h>),
+ * the file is checked after the last chunk has been passed to the callback.
+ *
+ * @param path      path to the file.
+ * @param chunkSize size of each chunk, all chunks except the last one have this size. 64 KiB - 1 MiB is recommended.
+ * @param callback  called for every chunk, on the calling thread
+ * @param userdata  passed to the callback
+ * @return WUHB_UTILS_RESULT_SUCCESS                the whole file has been passed to the callback.<br>
+ *         WUHB_UTILS_RESULT_LIB_UNINITIALIZED:     "WUHBUtils_Init()" was not called before. <br>
+ *         WUHB_UTILS_RESULT_INVALID_ARGUMENT:      "path" or "callback" is NULL or "chunkSize" is 0.<br>
+ *         WUHB_UTILS_RESULT_FILE_NOT_FOUND:        file at "path" was not found.<br>
+ *         WUHB_UTILS_RESULT_NO_MEMORY:             Not enough memory for the buffers.<br>
+ *         WUHB_UTILS_RESULT_REQUEST_CANCELLED:     the callback returned false.<br>
+ *         WUHB_UTILS_RESULT_HASH_MISMATCH:         the file doesn't match the hash manifest, the data passed to the callback must not be used.<br>
+ *         WUHB_UTILS_RESULT_UNKNOWN_ERROR:         reading failed, chunks passed to the callback before are valid.
+ */
+WUHBUtilsStatus WUHBUtils_FileStream(const char *path, uint32_t chunkSize, WUHBStreamCallback callback, void *userdata);
+
 /**
  * Gets the offset and size of the /code/ *.rpx inside a WUHB.
  *
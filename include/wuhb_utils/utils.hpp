@@ -0,0 +1,336 @@
+#pragma once
+
+#if !defined(__cplusplus) || __cplusplus < 201703L
+#error "<wuhb_utils/utils.hpp> requires C++17"
+#endif
+
+#include "allocator.h"
+#include "utils.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Optional header-only C++17 layer on top of <wuhb_utils/utils.h>.<br>
+ * <br>
+ * wuhb::File and wuhb::Mount are move-only, they close the file/unmount the bundle when they are destroyed.
+ * Errors are reported as WUHBUtilsStatus like in the C API, nothing throws.<br>
+ * Reads go into caller provided memory (wuhb::ByteSpan, which can be created from any contiguous byte container,
+ * including std::span), only readAll allocates, and only by resizing the container passed to it.<br>
+ * Buffers allocated by the library can be owned by a wuhb::Buffer, which frees them via WUHBUtils_Free.
+ */
+
+namespace wuhb {
+
+    /**
+     * Non-owning view of writable bytes.
+     */
+    struct ByteSpan {
+        uint8_t *data = nullptr;
+        uint32_t size = 0;
+
+        constexpr ByteSpan() = default;
+
+        ByteSpan(void *data, uint32_t size) : data((uint8_t *) data), size(size) {}
+
+        template<typename T, std::size_t N>
+        ByteSpan(T (&array)[N]) : data((uint8_t *) array), size(N * sizeof(T)) {
+            static_assert(std::is_trivially_copyable_v<T>, "ByteSpan requires trivially copyable elements");
+        }
+
+        /**
+         * Any container with data() and size(), e.g. std::vector<uint8_t>, std::string, std::array or std::span.
+         */
+        template<typename Container, typename = decltype(std::declval<Container &>().data()), typename = decltype(std::declval<Container &>().size())>
+        ByteSpan(Container &container) : data((uint8_t *) container.data()), size((uint32_t) (container.size() * sizeof(*container.data()))) {
+            using Element = std::remove_pointer_t<decltype(container.data())>;
+            static_assert(!std::is_const_v<Element>, "ByteSpan requires a writable container");
+            static_assert(std::is_trivially_copyable_v<Element>, "ByteSpan requires trivially copyable elements");
+        }
+    };
+
+    struct FreeDeleter {
+        void operator()(void *ptr) const {
+            WUHBUtils_Free(ptr);
+        }
+    };
+
+    /**
+     * Owns a buffer allocated by the library, e.g. by WUHBUtils_ReadWholeFile.
+     */
+    using Buffer = std::unique_ptr<uint8_t[], FreeDeleter>;
+
+    /**
+     * Like WUHBUtils_ReadWholeFile, the buffer is stored in "outBuffer".
+     */
+    inline WUHBUtilsStatus readWholeFile(const char *path, Buffer &outBuffer, uint32_t &outSize) {
+        uint8_t *buffer = nullptr;
+        auto res        = WUHBUtils_ReadWholeFile(path, &buffer, &outSize);
+        if (res == WUHB_UTILS_RESULT_SUCCESS) {
+            outBuffer.reset(buffer);
+        }
+        return res;
+    }
+
+    class File {
+    public:
+        File() = default;
+
+        /**
+         * Takes ownership of a handle returned by WUHBUtils_FileOpen.
+         */
+        explicit File(WUHBFileHandle handle) : mHandle(handle), mOpen(true) {}
+
+        File(const File &)            = delete;
+        File &operator=(const File &) = delete;
+
+        File(File &&other) noexcept : mHandle(other.mHandle), mOpen(std::exchange(other.mOpen, false)) {}
+
+        File &operator=(File &&other) noexcept {
+            if (this != &other) {
+                close();
+                mHandle = other.mHandle;
+                mOpen   = std::exchange(other.mOpen, false);
+            }
+            return *this;
+        }
+
+        ~File() {
+            close();
+        }
+
+        /**
+         * Opens "path", on success the file is stored in "outFile" (closing the file it held before).
+         */
+        static WUHBUtilsStatus open(const char *path, File &outFile) {
+            WUHBFileHandle handle;
+            auto res = WUHBUtils_FileOpen(path, &handle);
+            if (res == WUHB_UTILS_RESULT_SUCCESS) {
+                outFile = File(handle);
+            }
+            return res;
+        }
+
+        bool isOpen() const {
+            return mOpen;
+        }
+
+        explicit operator bool() const {
+            return mOpen;
+        }
+
+        WUHBFileHandle handle() const {
+            return mHandle;
+        }
+
+        /**
+         * Gives up ownership of the handle without closing it.
+         */
+        WUHBFileHandle release() {
+            mOpen = false;
+            return mHandle;
+        }
+
+        /**
+         * Closes the file, does nothing if it's not open.
+         */
+        WUHBUtilsStatus close() {
+            if (!mOpen) {
+                return WUHB_UTILS_RESULT_SUCCESS;
+            }
+            mOpen = false;
+            return WUHBUtils_FileClose(mHandle);
+        }
+
+        /**
+         * Reads up to "buffer.size" bytes with a single WUHBUtils_FileRead, *outRead is 0 at the end of the file.
+         */
+        WUHBUtilsStatus read(ByteSpan buffer, uint32_t &outRead) {
+            int32_t readRes = -1;
+            auto res        = WUHBUtils_FileRead(mHandle, buffer.data, buffer.size, &readRes);
+            return ToRead(res, readRes, outRead);
+        }
+
+        /**
+         * Reads until "buffer" is full or the end of the file has been reached.
+         */
+        WUHBUtilsStatus readFully(ByteSpan buffer, uint32_t &outRead) {
+            outRead = 0;
+            while (outRead < buffer.size) {
+                uint32_t chunk;
+                auto res = read(ByteSpan(buffer.data + outRead, buffer.size - outRead), chunk);
+                if (res != WUHB_UTILS_RESULT_SUCCESS) {
+                    return res;
+                }
+                if (chunk == 0) {
+                    break;
+                }
+                outRead += chunk;
+            }
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+
+        /**
+         * Like WUHBUtils_FileReadAt, doesn't change the position.
+         */
+        WUHBUtilsStatus readAt(uint32_t offset, ByteSpan buffer, uint32_t &outRead) {
+            int32_t readRes = -1;
+            auto res        = WUHBUtils_FileReadAt(mHandle, offset, buffer.data, buffer.size, &readRes);
+            return ToRead(res, readRes, outRead);
+        }
+
+        /**
+         * Reads the rest of the file into "out" (e.g. a std::vector<uint8_t> or std::string), which is resized to
+         * the number of bytes read. If the size of the file is known the container is resized once and the data is
+         * read straight into it, otherwise it grows while reading.
+         */
+        template<typename Container>
+        WUHBUtilsStatus readAll(Container &out) {
+            static_assert(sizeof(*out.data()) == 1, "readAll requires a container of bytes");
+            uint32_t size, pos;
+            if (WUHBUtils_FileGetSize(mHandle, &size) == WUHB_UTILS_RESULT_SUCCESS && WUHBUtils_FileTell(mHandle, &pos) == WUHB_UTILS_RESULT_SUCCESS) {
+                out.resize(pos < size ? size - pos : 0);
+                uint32_t total;
+                auto res = readFully(out, total);
+                out.resize(res == WUHB_UTILS_RESULT_SUCCESS ? total : 0);
+                return res;
+            }
+            constexpr uint32_t chunkSize = 128 * 1024;
+            uint32_t total               = 0;
+            while (true) {
+                out.resize(total + chunkSize);
+                uint32_t chunk;
+                auto res = readFully(ByteSpan(out.data() + total, chunkSize), chunk);
+                if (res != WUHB_UTILS_RESULT_SUCCESS) {
+                    out.resize(0);
+                    return res;
+                }
+                total += chunk;
+                if (chunk < chunkSize) {
+                    break;
+                }
+            }
+            out.resize(total);
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+
+        WUHBUtilsStatus size(uint32_t &outSize) const {
+            return WUHBUtils_FileGetSize(mHandle, &outSize);
+        }
+
+        WUHBUtilsStatus seek(int64_t offset, WUHBSeekOrigin origin = WUHB_SEEK_SET, uint32_t *outPos = nullptr) {
+            return WUHBUtils_FileSeek(mHandle, offset, origin, outPos);
+        }
+
+        WUHBUtilsStatus tell(uint32_t &outPos) const {
+            return WUHBUtils_FileTell(mHandle, &outPos);
+        }
+
+    private:
+        static WUHBUtilsStatus ToRead(WUHBUtilsStatus res, int32_t readRes, uint32_t &outRead) {
+            if (res != WUHB_UTILS_RESULT_SUCCESS) {
+                outRead = 0;
+                return res;
+            }
+            if (readRes < 0) {
+                outRead = 0;
+                return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+            }
+            outRead = (uint32_t) readRes;
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+
+        WUHBFileHandle mHandle = 0;
+        bool mOpen             = false;
+    };
+
+    /**
+     * Opens "path" and reads all of it into "out", see File::readAll.
+     */
+    template<typename Container>
+    WUHBUtilsStatus readAll(const char *path, Container &out) {
+        File file;
+        auto res = File::open(path, file);
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        if ((res = file.readAll(out)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        return file.close();
+    }
+
+    class Mount {
+    public:
+        Mount() = default;
+
+        Mount(const Mount &)            = delete;
+        Mount &operator=(const Mount &) = delete;
+
+        Mount(Mount &&other) noexcept : mName(std::move(other.mName)), mMounted(std::exchange(other.mMounted, false)) {}
+
+        Mount &operator=(Mount &&other) noexcept {
+            if (this != &other) {
+                unmount();
+                mName    = std::move(other.mName);
+                mMounted = std::exchange(other.mMounted, false);
+            }
+            return *this;
+        }
+
+        ~Mount() {
+            unmount();
+        }
+
+        /**
+         * Mounts "path" as "name", on success the mount is stored in "outMount" (unmounting the bundle it held before).
+         *
+         * @return Any status of WUHBUtils_MountBundle, WUHB_UTILS_RESULT_MOUNT_FAILED if the module failed to mount the bundle.
+         */
+        static WUHBUtilsStatus mount(const char *name, const char *path, BundleSource source, Mount &outMount) {
+            int32_t outRes = -1;
+            auto res       = WUHBUtils_MountBundle(name, path, source, &outRes);
+            if (res != WUHB_UTILS_RESULT_SUCCESS) {
+                return res;
+            }
+            if (outRes < 0) {
+                return WUHB_UTILS_RESULT_MOUNT_FAILED;
+            }
+            outMount.unmount();
+            outMount.mName    = name;
+            outMount.mMounted = true;
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+
+        bool isMounted() const {
+            return mMounted;
+        }
+
+        explicit operator bool() const {
+            return mMounted;
+        }
+
+        const std::string &name() const {
+            return mName;
+        }
+
+        /**
+         * Unmounts the bundle, does nothing if nothing is mounted.
+         */
+        WUHBUtilsStatus unmount() {
+            if (!mMounted) {
+                return WUHB_UTILS_RESULT_SUCCESS;
+            }
+            mMounted = false;
+            return WUHBUtils_UnmountBundle(mName.c_str(), nullptr);
+        }
+
+    private:
+        std::string mName;
+        bool mMounted = false;
+    };
+
+} // namespace wuhb
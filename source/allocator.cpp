@@ -0,0 +1,82 @@
+#include "allocator.h"
+#include <malloc.h>
+#include <wuhb_utils/allocator.h>
+
+static void *DefaultAlloc(uint32_t size, uint32_t alignment, void *) {
+    return memalign(alignment, size);
+}
+
+static void DefaultFree(void *ptr, void *) {
+    free(ptr);
+}
+
+static WUHBAllocFn sAllocFn = DefaultAlloc;
+static WUHBFreeFn sFreeFn   = DefaultFree;
+static void *sUserdata      = nullptr;
+
+void *Allocator_Alloc(uint32_t size, uint32_t alignment) {
+    // memalign(0x40, 0) may return NULL, so always allocate at least one byte.
+    return sAllocFn(size > 0 ? size : 1, alignment, sUserdata);
+}
+
+void Allocator_Free(void *ptr) {
+    if (ptr) {
+        sFreeFn(ptr, sUserdata);
+    }
+}
+
+WUHBUtilsStatus WUHBUtils_SetAllocator(WUHBAllocFn allocFn, WUHBFreeFn freeFn, void *userdata) {
+    if (!allocFn != !freeFn) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    sAllocFn  = allocFn ? allocFn : DefaultAlloc;
+    sFreeFn   = freeFn ? freeFn : DefaultFree;
+    sUserdata = allocFn ? userdata : nullptr;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void WUHBUtils_Free(void *ptr) {
+    Allocator_Free(ptr);
+}
+
+WUHBUtilsStatus WUHBUtils_ArenaInit(WUHBArena *arena, void *memory, uint32_t size) {
+    if (!arena || !memory) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    arena->base     = (uint8_t *) memory;
+    arena->capacity = size;
+    arena->used     = 0;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void WUHBUtils_ArenaReset(WUHBArena *arena) {
+    if (arena) {
+        arena->used = 0;
+    }
+}
+
+uint64_t Allocator_ArenaAlignedOffset(const WUHBArena *arena, uint32_t alignment) {
+    auto cur = (uintptr_t) (arena->base + arena->used);
+    return arena->used + (((cur + alignment - 1) & ~((uintptr_t) alignment - 1)) - cur);
+}
+
+WUHBUtilsStatus WUHBUtils_ArenaReadWholeFile(WUHBArena *arena, const char *path, uint32_t alignment, uint8_t **outBuf, uint32_t *outSize) {
+    if (!arena || !outBuf || !outSize || alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    uint64_t start = Allocator_ArenaAlignedOffset(arena, alignment);
+    if (start > arena->capacity) {
+        *outSize = 0;
+        return WUHB_UTILS_RESULT_BUFFER_TOO_SMALL;
+    }
+    WUHBUtilsStatus res;
+    uint32_t size = 0;
+    if ((res = WUHBUtils_ReadWholeFileInto(path, arena->base + start, arena->capacity - start, &size)) != WUHB_UTILS_RESULT_SUCCESS) {
+        *outSize = size;
+        return res;
+    }
+    arena->used = start + size;
+    *outBuf     = arena->base + start;
+    *outSize    = size;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
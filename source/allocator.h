@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <wuhb_utils/allocator.h>
+
+/*
+ * Internal allocation functions, every buffer of the library has to be allocated via these. See WUHBUtils_SetAllocator.
+ * Containers whose size depends on the bundles or the application (bundle indices, hash manifests, traces) use
+ * AllocatorAdapter, so their storage comes from the same hooks.
+ */
+
+/**
+ * Allocates at least one byte, even if "size" is 0.
+ */
+void *Allocator_Alloc(uint32_t size, uint32_t alignment);
+
+void Allocator_Free(void *ptr);
+
+/**
+ * Returns the offset of the next free byte of "arena" that is aligned to "alignment" (a power of two), may be bigger than the capacity.
+ */
+uint64_t Allocator_ArenaAlignedOffset(const WUHBArena *arena, uint32_t alignment);
+
+/**
+ * Standard library allocator on top of Allocator_Alloc/Allocator_Free. Throws std::bad_alloc like the default allocator.
+ */
+template <typename T>
+struct AllocatorAdapter {
+    using value_type = T;
+
+    AllocatorAdapter() = default;
+
+    template <typename U>
+    AllocatorAdapter(const AllocatorAdapter<U> &) {}
+
+    T *allocate(size_t n) {
+        // Heaps of the console expect an alignment of at least 4.
+        if (n > UINT32_MAX / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        void *ptr = Allocator_Alloc(n * sizeof(T), alignof(T) < 4 ? 4 : alignof(T));
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return (T *) ptr;
+    }
+
+    void deallocate(T *ptr, size_t) {
+        Allocator_Free(ptr);
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const AllocatorAdapter<T> &, const AllocatorAdapter<U> &) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const AllocatorAdapter<T> &, const AllocatorAdapter<U> &) {
+    return false;
+}
+
+template <typename T>
+using AllocatorVector = std::vector<T, AllocatorAdapter<T>>;
+
+using AllocatorString = std::basic_string<char, std::char_traits<char>, AllocatorAdapter<char>>;
+
+struct AllocatorStringHash {
+    size_t operator()(const AllocatorString &str) const {
+        return std::hash<std::string_view>()(str);
+    }
+};
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+using AllocatorUnorderedMap = std::unordered_map<Key, Value, Hash, std::equal_to<Key>, AllocatorAdapter<std::pair<const Key, Value>>>;
@@ -0,0 +1,492 @@
+#include "allocator.h"
+#include "async.h"
+#include "hash.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <wuhb_utils/async.h>
+
+/*
+ * The worker threads are std::threads, on the console wut maps them to OSThreads.
+ * Requests for the same handle never run at the same time: a worker that pops a request whose handle is used by a
+ * running request parks it, the worker running that request puts it back into the queue once it has finished.
+ */
+
+#define ASYNC_CHUNK_SIZE (1024 * 1024)
+
+enum AsyncRequestType {
+    ASYNC_REQUEST_READ_AT,
+    ASYNC_REQUEST_READ,
+    ASYNC_REQUEST_READ_WHOLE_FILE,
+};
+
+struct WUHBAsyncRequest {
+    AsyncRequestType type;
+    int32_t priority;
+    uint64_t sequence;
+    std::atomic<uint32_t> refCount; // one reference for the caller, one for the queue/worker
+    std::atomic<bool> cancelled;
+    WUHBAsyncState state; // guarded by sMutex
+
+    WUHBFileHandle handle;
+    uint32_t offset;
+    uint8_t *buffer;
+    uint32_t size;
+    std::string path;
+
+    WUHBAsyncCallback callback;
+    void *context;
+
+    WUHBUtilsStatus status;
+    uint32_t resultSize;
+    bool bufferTaken;
+};
+
+static std::mutex sMutex;
+static std::condition_variable sQueueCV;
+static std::condition_variable sDoneCV;
+static std::vector<WUHBAsyncRequest *> sQueue;  // heap, see CompareRequests
+static std::vector<WUHBAsyncRequest *> sParked; // pending requests waiting for their handle, in the order they have been parked
+static std::vector<WUHBFileHandle> sBusyHandles; // handles of running requests
+static std::vector<std::thread> sWorkers;
+static uint64_t sNextSequence            = 0;
+static bool sStopping                    = false;
+static thread_local bool sIsWorkerThread = false;
+
+/**
+ * Orders the heap: highest priority first, same priority in submission order.
+ */
+static bool CompareRequests(const WUHBAsyncRequest *a, const WUHBAsyncRequest *b) {
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+    return a->sequence > b->sequence;
+}
+
+/**
+ * Returns true if "request" reads via a handle of the caller.
+ */
+static bool UsesHandle(const WUHBAsyncRequest *request) {
+    return request->type != ASYNC_REQUEST_READ_WHOLE_FILE;
+}
+
+/**
+ * Must be called with sMutex held.
+ */
+static bool IsHandleBusy(WUHBFileHandle handle) {
+    return std::find(sBusyHandles.begin(), sBusyHandles.end(), handle) != sBusyHandles.end();
+}
+
+/**
+ * Marks the handle of a finished request as free and queues the requests parked for it. Must be called with sMutex held.
+ */
+static void ReleaseHandle(WUHBFileHandle handle) {
+    sBusyHandles.erase(std::find(sBusyHandles.begin(), sBusyHandles.end(), handle));
+    bool queued = false;
+    for (auto it = sParked.begin(); it != sParked.end();) {
+        if ((*it)->handle == handle) {
+            sQueue.push_back(*it);
+            std::push_heap(sQueue.begin(), sQueue.end(), CompareRequests);
+            it     = sParked.erase(it);
+            queued = true;
+        } else {
+            ++it;
+        }
+    }
+    if (queued) {
+        sQueueCV.notify_all();
+    }
+}
+
+static void ReleaseRequest(WUHBAsyncRequest *request) {
+    if (request->refCount.fetch_sub(1) != 1) {
+        return;
+    }
+    if (request->type == ASYNC_REQUEST_READ_WHOLE_FILE && !request->bufferTaken) {
+        Allocator_Free(request->buffer);
+    }
+    delete request;
+}
+
+/**
+ * Sets the final state, wakes up waiting threads and calls the callback. Must be called with "lock" held, returns with "lock" held.
+ */
+static void FinishRequest(std::unique_lock<std::mutex> &lock, WUHBAsyncRequest *request, WUHBAsyncState state, WUHBUtilsStatus status) {
+    request->state  = state;
+    request->status = status;
+    sDoneCV.notify_all();
+    lock.unlock();
+    if (request->callback) {
+        request->callback(request, request->context);
+    }
+    ReleaseRequest(request);
+    lock.lock();
+}
+
+static WUHBUtilsStatus ExecuteReadAt(WUHBAsyncRequest *request) {
+    uint32_t total = 0;
+    while (total < request->size && !request->cancelled) {
+        uint32_t toRead = std::min<uint32_t>(request->size - total, ASYNC_CHUNK_SIZE);
+        int32_t readRes = -1;
+        auto res        = WUHBUtils_FileReadAt(request->handle, request->offset + total, request->buffer + total, toRead, &readRes);
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        if (readRes < 0) {
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (readRes == 0) {
+            break;
+        }
+        total += readRes;
+    }
+    request->resultSize = total;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBUtilsStatus ExecuteRead(WUHBAsyncRequest *request) {
+    uint32_t total = 0;
+    while (total < request->size && !request->cancelled) {
+        int32_t readRes = -1;
+        auto res        = WUHBUtils_FileRead(request->handle, request->buffer + total, std::min<uint32_t>(request->size - total, ASYNC_CHUNK_SIZE), &readRes);
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        if (readRes < 0) {
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (readRes == 0) {
+            break;
+        }
+        total += readRes;
+    }
+    request->resultSize = total;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBUtilsStatus ExecuteReadWholeFile(WUHBAsyncRequest *request) {
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_FileOpen(request->path.c_str(), &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    uint32_t fileSize = 0;
+    if (WUHBUtils_FileGetSize(handle, &fileSize) != WUHB_UTILS_RESULT_SUCCESS) {
+        // Without a known size the file can't be read in chunks, fall back to the blocking call.
+        WUHBUtils_FileClose(handle);
+        return WUHBUtils_ReadWholeFile(request->path.c_str(), &request->buffer, &request->resultSize);
+    }
+
+    auto *buffer = (uint8_t *) Allocator_Alloc(fileSize, 0x40);
+    if (!buffer) {
+        WUHBUtils_FileClose(handle);
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    // Every chunk is hashed right after it has been read, while it's still in the cache.
+    WUHBHashState hash;
+    uint32_t expected;
+    bool verify    = Hash_GetExpected(request->path.c_str(), &hash, &expected);
+    uint32_t total = 0;
+    while (total < fileSize && !request->cancelled) {
+        int32_t readRes = -1;
+        res             = WUHBUtils_FileRead(handle, buffer + total, std::min<uint32_t>(fileSize - total, ASYNC_CHUNK_SIZE), &readRes);
+        if (res == WUHB_UTILS_RESULT_SUCCESS && readRes < 0) {
+            res = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            Allocator_Free(buffer);
+            WUHBUtils_FileClose(handle);
+            return res;
+        }
+        if (readRes == 0) {
+            break;
+        }
+        if (verify) {
+            WUHBUtils_HashUpdate(&hash, buffer + total, readRes);
+        }
+        total += readRes;
+    }
+    if ((res = WUHBUtils_FileClose(handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        Allocator_Free(buffer);
+        return res;
+    }
+    // A cancelled request has not been read completely, its data is never returned.
+    if (verify && !request->cancelled && !Hash_Verify(request->path.c_str(), &hash, expected)) {
+        Allocator_Free(buffer);
+        return WUHB_UTILS_RESULT_HASH_MISMATCH;
+    }
+    request->buffer     = buffer;
+    request->resultSize = total;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBUtilsStatus ExecuteRequest(WUHBAsyncRequest *request) {
+    switch (request->type) {
+        case ASYNC_REQUEST_READ_AT:
+            return ExecuteReadAt(request);
+        case ASYNC_REQUEST_READ:
+            return ExecuteRead(request);
+        case ASYNC_REQUEST_READ_WHOLE_FILE:
+            return ExecuteReadWholeFile(request);
+    }
+    return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+}
+
+static void WorkerMain() {
+    sIsWorkerThread = true;
+    std::unique_lock<std::mutex> lock(sMutex);
+    while (true) {
+        sQueueCV.wait(lock, [] { return sStopping || !sQueue.empty(); });
+        if (sStopping) {
+            return;
+        }
+        std::pop_heap(sQueue.begin(), sQueue.end(), CompareRequests);
+        auto *request = sQueue.back();
+        sQueue.pop_back();
+        bool usesHandle = UsesHandle(request);
+        if (usesHandle) {
+            if (IsHandleBusy(request->handle)) {
+                sParked.push_back(request);
+                continue;
+            }
+            sBusyHandles.push_back(request->handle);
+        }
+
+        request->state = WUHB_ASYNC_STATE_RUNNING;
+        lock.unlock();
+        auto status = ExecuteRequest(request);
+        lock.lock();
+        if (usesHandle) {
+            ReleaseHandle(request->handle);
+        }
+
+        if (request->cancelled) {
+            if (request->type == ASYNC_REQUEST_READ_WHOLE_FILE) {
+                Allocator_Free(request->buffer);
+                request->buffer = nullptr;
+            }
+            request->resultSize = 0;
+            FinishRequest(lock, request, WUHB_ASYNC_STATE_CANCELLED, WUHB_UTILS_RESULT_REQUEST_CANCELLED);
+        } else {
+            FinishRequest(lock, request, WUHB_ASYNC_STATE_DONE, status);
+        }
+    }
+}
+
+/**
+ * Starts the worker threads if they're not running yet. Must be called with sMutex held.
+ */
+static WUHBUtilsStatus StartWorkers(uint32_t numThreads) {
+    if (!sWorkers.empty()) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    sStopping = false;
+    try {
+        for (uint32_t i = 0; i < numThreads; i++) {
+            sWorkers.emplace_back(WorkerMain);
+        }
+    } catch (const std::system_error &) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to create worker thread");
+        if (sWorkers.empty()) {
+            return WUHB_UTILS_RESULT_NO_MEMORY;
+        }
+        // Keep going with the threads that have been created.
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_AsyncInit(uint32_t numThreads) {
+    if (numThreads == 0) {
+        numThreads = WUHB_ASYNC_DEFAULT_THREADS;
+    }
+    if (numThreads > WUHB_ASYNC_MAX_THREADS) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (!sWorkers.empty() && sWorkers.size() != numThreads) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    return StartWorkers(numThreads);
+}
+
+WUHBUtilsStatus WUHBUtils_AsyncDeInit() {
+    std::vector<std::thread> workers;
+    {
+        std::unique_lock<std::mutex> lock(sMutex);
+        for (auto *request : sQueue) {
+            request->cancelled = true;
+        }
+        for (auto *request : sParked) {
+            request->cancelled = true;
+        }
+        sStopping = true;
+        sQueueCV.notify_all();
+        workers.swap(sWorkers);
+    }
+    // Running requests finish their current chunk and see the cancel flag.
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::unique_lock<std::mutex> lock(sMutex);
+    sQueue.insert(sQueue.end(), sParked.begin(), sParked.end());
+    sParked.clear();
+    while (!sQueue.empty()) {
+        auto *request = sQueue.back();
+        sQueue.pop_back();
+        FinishRequest(lock, request, WUHB_ASYNC_STATE_CANCELLED, WUHB_UTILS_RESULT_REQUEST_CANCELLED);
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBUtilsStatus SubmitRequest(WUHBAsyncRequest *request, WUHBAsyncRequest **outRequest) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    WUHBUtilsStatus res;
+    if ((res = StartWorkers(WUHB_ASYNC_DEFAULT_THREADS)) != WUHB_UTILS_RESULT_SUCCESS) {
+        delete request;
+        return res;
+    }
+    request->sequence = sNextSequence++;
+    request->state    = WUHB_ASYNC_STATE_PENDING;
+    sQueue.push_back(request);
+    std::push_heap(sQueue.begin(), sQueue.end(), CompareRequests);
+    sQueueCV.notify_one();
+    *outRequest = request;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBAsyncRequest *CreateRequest(AsyncRequestType type, int32_t priority, WUHBAsyncCallback callback, void *context) {
+    auto *request = new (std::nothrow) WUHBAsyncRequest();
+    if (!request) {
+        return nullptr;
+    }
+    request->type     = type;
+    request->priority = priority;
+    request->refCount = 2;
+    request->callback = callback;
+    request->context  = context;
+    request->status   = WUHB_UTILS_RESULT_REQUEST_PENDING;
+    return request;
+}
+
+WUHBUtilsStatus WUHBUtils_FileReadAsync(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t priority, WUHBAsyncCallback callback, void *context, WUHBAsyncRequest **outRequest) {
+    if (!buffer || !outRequest) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *request = CreateRequest(ASYNC_REQUEST_READ_AT, priority, callback, context);
+    if (!request) {
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    request->handle = handle;
+    request->offset = offset;
+    request->buffer = buffer;
+    request->size   = size;
+    return SubmitRequest(request, outRequest);
+}
+
+bool Async_IsWorkerThread() {
+    return sIsWorkerThread;
+}
+
+WUHBUtilsStatus Async_FileReadSequential(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t priority, WUHBAsyncRequest **outRequest) {
+    if (!buffer || !outRequest) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *request = CreateRequest(ASYNC_REQUEST_READ, priority, nullptr, nullptr);
+    if (!request) {
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    request->handle = handle;
+    request->buffer = buffer;
+    request->size   = size;
+    return SubmitRequest(request, outRequest);
+}
+
+WUHBUtilsStatus WUHBUtils_ReadWholeFileAsync(const char *path, int32_t priority, WUHBAsyncCallback callback, void *context, WUHBAsyncRequest **outRequest) {
+    if (!path || !outRequest) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *request = CreateRequest(ASYNC_REQUEST_READ_WHOLE_FILE, priority, callback, context);
+    if (!request) {
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    request->path = path;
+    return SubmitRequest(request, outRequest);
+}
+
+WUHBUtilsStatus WUHBUtils_AsyncPoll(WUHBAsyncRequest *request, WUHBAsyncState *outState) {
+    if (!request || !outState) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    *outState = request->state;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_AsyncWait(WUHBAsyncRequest *request) {
+    if (!request) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::unique_lock<std::mutex> lock(sMutex);
+    sDoneCV.wait(lock, [request] { return request->state == WUHB_ASYNC_STATE_DONE || request->state == WUHB_ASYNC_STATE_CANCELLED; });
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_AsyncCancel(WUHBAsyncRequest *request) {
+    if (!request) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::unique_lock<std::mutex> lock(sMutex);
+    request->cancelled = true;
+    if (request->state != WUHB_ASYNC_STATE_PENDING) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    // Take pending requests out of the queue right away instead of waiting for a worker to pick them up.
+    auto it = std::find(sQueue.begin(), sQueue.end(), request);
+    if (it != sQueue.end()) {
+        sQueue.erase(it);
+        std::make_heap(sQueue.begin(), sQueue.end(), CompareRequests);
+        FinishRequest(lock, request, WUHB_ASYNC_STATE_CANCELLED, WUHB_UTILS_RESULT_REQUEST_CANCELLED);
+    } else if ((it = std::find(sParked.begin(), sParked.end(), request)) != sParked.end()) {
+        sParked.erase(it);
+        FinishRequest(lock, request, WUHB_ASYNC_STATE_CANCELLED, WUHB_UTILS_RESULT_REQUEST_CANCELLED);
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_AsyncGetResult(WUHBAsyncRequest *request, WUHBUtilsStatus *outStatus, uint8_t **outBuffer, uint32_t *outSize) {
+    if (!request || !outStatus) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (request->state != WUHB_ASYNC_STATE_DONE && request->state != WUHB_ASYNC_STATE_CANCELLED) {
+        return WUHB_UTILS_RESULT_REQUEST_PENDING;
+    }
+    *outStatus = request->status;
+    if (outBuffer) {
+        *outBuffer = nullptr;
+        if (request->type == ASYNC_REQUEST_READ_WHOLE_FILE && !request->bufferTaken) {
+            *outBuffer           = request->buffer;
+            request->bufferTaken = true;
+        }
+    }
+    if (outSize) {
+        *outSize = request->resultSize;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void WUHBUtils_AsyncFree(WUHBAsyncRequest *request) {
+    if (!request) {
+        return;
+    }
+    WUHBUtils_AsyncCancel(request);
+    ReleaseRequest(request);
+}
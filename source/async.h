@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <wuhb_utils/async.h>
+
+/*
+ * Requests of the worker pool of <wuhb_utils/async.h> that are only used inside the library.
+ */
+
+// Priority of the read-ahead of WUHBUtils_FileStream, it's executed before all requests of the application.
+#define ASYNC_PRIORITY_READ_AHEAD INT32_MAX
+
+/**
+ * Like WUHBUtils_FileReadAsync, but reads from the current position of the handle via WUHBUtils_FileRead.
+ * Positional reads of compressed files inflate the file from the start, sequential reads continue the stream.<br>
+ * The handle must not be used by anything else until the request has finished.
+ */
+WUHBUtilsStatus Async_FileReadSequential(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t priority, WUHBAsyncRequest **outRequest);
+
+/**
+ * Returns true on the worker threads of the pool, e.g. inside a WUHBAsyncCallback. Waiting for another request there
+ * deadlocks once every worker waits.
+ */
+bool Async_IsWorkerThread();
@@ -0,0 +1,205 @@
+#include "allocator.h"
+#include <cstring>
+#include <wuhb_utils/buffered_reader.h>
+
+struct WUHBBufferedFile {
+    WUHBFileHandle handle;
+    uint8_t *window;
+    uint32_t capacity; // allocated size of window
+    uint32_t fillSize; // how many bytes the next refill will request
+    uint32_t pos;      // read position inside window
+    uint32_t filled;   // valid bytes in window
+    bool eof;
+};
+
+WUHBUtilsStatus WUHBUtils_BufferedOpen(const char *name, uint32_t windowSize, WUHBBufferedFile **outFile) {
+    if (!name || !outFile) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    if (windowSize == 0) {
+        windowSize = WUHB_BUFFERED_DEFAULT_WINDOW_SIZE;
+    }
+    windowSize = (windowSize + 0x3F) & ~0x3F;
+
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_FileOpen(name, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+
+    // Don't allocate more than we could ever read.
+    uint32_t fileSize = 0;
+    if (WUHBUtils_FileGetSize(handle, &fileSize) == WUHB_UTILS_RESULT_SUCCESS && fileSize < windowSize) {
+        windowSize = (fileSize + 0x3F) & ~0x3F;
+        if (windowSize == 0) {
+            windowSize = 0x40;
+        }
+    }
+
+    auto *file   = (WUHBBufferedFile *) Allocator_Alloc(sizeof(WUHBBufferedFile), alignof(WUHBBufferedFile));
+    auto *window = (uint8_t *) Allocator_Alloc(windowSize, 0x40);
+    if (!file || !window) {
+        Allocator_Free(file);
+        Allocator_Free(window);
+        WUHBUtils_FileClose(handle);
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    file->handle   = handle;
+    file->window   = window;
+    file->capacity = windowSize;
+    file->fillSize = windowSize < WUHB_BUFFERED_MIN_WINDOW_SIZE ? windowSize : WUHB_BUFFERED_MIN_WINDOW_SIZE;
+    file->pos      = 0;
+    file->filled   = 0;
+    file->eof      = false;
+
+    *outFile = file;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Appends up to "size" bytes from the file to the window.
+ */
+static WUHBUtilsStatus FillWindow(WUHBBufferedFile *file, uint32_t size) {
+    int32_t readRes = -1;
+    auto res        = WUHBUtils_FileRead(file->handle, file->window + file->filled, size, &readRes);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    if (readRes < 0) {
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    if (readRes == 0) {
+        file->eof = true;
+    }
+    file->filled += readRes;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Refills the (completely consumed) window. The window grows with each refill while the file is read sequentially.
+ */
+static WUHBUtilsStatus Refill(WUHBBufferedFile *file) {
+    file->pos    = 0;
+    file->filled = 0;
+    auto res     = FillWindow(file, file->fillSize);
+    if (file->fillSize < file->capacity) {
+        file->fillSize = file->fillSize * 2 < file->capacity ? file->fillSize * 2 : file->capacity;
+    }
+    return res;
+}
+
+WUHBUtilsStatus WUHBUtils_BufferedRead(WUHBBufferedFile *file, uint8_t *buffer, uint32_t size, uint32_t *outRead) {
+    if (!file || !buffer || !outRead) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    uint32_t total = 0;
+    WUHBUtilsStatus res;
+    while (total < size) {
+        if (file->pos < file->filled) {
+            uint32_t toCopy = file->filled - file->pos;
+            if (toCopy > size - total) {
+                toCopy = size - total;
+            }
+            memcpy(buffer + total, file->window + file->pos, toCopy);
+            file->pos += toCopy;
+            total += toCopy;
+            continue;
+        }
+        if (file->eof) {
+            break;
+        }
+        if (size - total >= file->fillSize) {
+            // Big reads skip the window to avoid an extra copy.
+            int32_t readRes = -1;
+            if ((res = WUHBUtils_FileRead(file->handle, buffer + total, size - total, &readRes)) != WUHB_UTILS_RESULT_SUCCESS) {
+                return res;
+            }
+            if (readRes < 0) {
+                return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+            }
+            if (readRes == 0) {
+                file->eof = true;
+            }
+            total += readRes;
+            continue;
+        }
+        if ((res = Refill(file)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+    }
+    *outRead = total;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_BufferedPeek(WUHBBufferedFile *file, uint32_t size, const uint8_t **outData, uint32_t *outAvailable) {
+    if (!file || !outData || !outAvailable) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    if (size > file->capacity) {
+        size = file->capacity;
+    }
+    if (file->filled - file->pos < size && !file->eof) {
+        // Move the remaining bytes to the start of the window and append the next bytes of the file.
+        uint32_t remaining = file->filled - file->pos;
+        memmove(file->window, file->window + file->pos, remaining);
+        file->pos    = 0;
+        file->filled = remaining;
+        while (file->filled < size && !file->eof) {
+            WUHBUtilsStatus res;
+            if ((res = FillWindow(file, file->capacity - file->filled)) != WUHB_UTILS_RESULT_SUCCESS) {
+                return res;
+            }
+        }
+    }
+    uint32_t available = file->filled - file->pos;
+    *outData           = file->window + file->pos;
+    *outAvailable      = available < size ? available : size;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_BufferedReadLine(WUHBBufferedFile *file, char *buffer, uint32_t size, uint32_t *outLength) {
+    if (!file || !buffer || !outLength || size < 2) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    uint32_t length = 0;
+    while (length < size - 1) {
+        if (file->pos == file->filled) {
+            if (file->eof) {
+                break;
+            }
+            WUHBUtilsStatus res;
+            if ((res = Refill(file)) != WUHB_UTILS_RESULT_SUCCESS) {
+                return res;
+            }
+            continue;
+        }
+        uint32_t toCopy = file->filled - file->pos;
+        if (toCopy > size - 1 - length) {
+            toCopy = size - 1 - length;
+        }
+        auto *src     = file->window + file->pos;
+        auto *newLine = (uint8_t *) memchr(src, '\n', toCopy);
+        if (newLine) {
+            toCopy = newLine - src + 1;
+        }
+        memcpy(buffer + length, src, toCopy);
+        file->pos += toCopy;
+        length += toCopy;
+        if (newLine) {
+            break;
+        }
+    }
+    buffer[length] = '\0';
+    *outLength     = length;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_BufferedClose(WUHBBufferedFile *file) {
+    if (!file) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto res = WUHBUtils_FileClose(file->handle);
+    Allocator_Free(file->window);
+    Allocator_Free(file);
+    return res;
+}
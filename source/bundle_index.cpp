@@ -0,0 +1,347 @@
+#include "bundle_index.h"
+#include "allocator.h"
+#include "logger.h"
+#include "romfs_format.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * When a bundle is mounted, its directory and file tables are read once and every file path is stored in a flat
+ * open addressing hash table. "<file>.gz" files are additionally stored as "<file>" with INDEX_FLAG_GZ_ALIAS, this
+ * way the ".gz" fallback of WUHBUtils_FileOpen doesn't need a second lookup. The location of each file's data is
+ * kept as well, so WUHBUtils_GetFileInfo doesn't need the module either. The tables (and the RomFS tables they are
+ * built from) are allocated via the allocator hooks.
+ * Lookups only take sMutex shared, so opens on different cores don't serialize on the index. An index is built without
+ * holding the lock and only inserted (if the index is still enabled) under the exclusive lock.
+ */
+
+#define ROMFS_MAX_DIR_DEPTH  64
+#define INDEX_MAX_TABLE_SIZE (16 * 1024 * 1024)
+#define INDEX_MIN_SLOTS      8
+#define INDEX_EMPTY_SLOT     0xFFFFFFFF
+#define INDEX_FLAG_GZ_ALIAS  1
+
+struct IndexSlot {
+    uint32_t hash;
+    uint32_t pathOffset; // offset into BundleIndex::paths, INDEX_EMPTY_SLOT if unused
+    uint32_t pathLength;
+    uint32_t file; // index into BundleIndex::extents
+    uint32_t flags;
+};
+
+struct BundleIndex {
+    AllocatorVector<IndexSlot> slots;               // size is a power of two
+    AllocatorVector<char> paths;                    // all paths relative to the root (without leading '/'), not null-terminated
+    AllocatorVector<BundleIndexFileExtent> extents; // one per file, in file table order
+    std::string bundlePath;                         // path used to open the bundle file
+    uint32_t files     = 0;
+    uint32_t gzAliases = 0;
+};
+
+static std::shared_mutex sMutex;
+static std::map<std::string, std::unique_ptr<BundleIndex>, std::less<>> sIndices;
+static bool sEnabled = true;
+
+static uint32_t HashPath(std::string_view path) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : path) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const IndexSlot *FindSlot(const BundleIndex &index, std::string_view path) {
+    uint32_t hash = HashPath(path);
+    uint32_t mask = index.slots.size() - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        const auto &slot = index.slots[i];
+        if (slot.pathOffset == INDEX_EMPTY_SLOT) {
+            return nullptr;
+        }
+        if (slot.hash == hash && slot.pathLength == path.size() && memcmp(index.paths.data() + slot.pathOffset, path.data(), path.size()) == 0) {
+            return &slot;
+        }
+    }
+}
+
+static void InsertSlot(BundleIndex &index, uint32_t pathOffset, uint32_t pathLength, uint32_t file, uint32_t flags) {
+    std::string_view path(index.paths.data() + pathOffset, pathLength);
+    if (FindSlot(index, path)) {
+        return;
+    }
+    uint32_t hash = HashPath(path);
+    uint32_t mask = index.slots.size() - 1;
+    uint32_t i    = hash & mask;
+    while (index.slots[i].pathOffset != INDEX_EMPTY_SLOT) {
+        i = (i + 1) & mask;
+    }
+    index.slots[i] = {hash, pathOffset, pathLength, file, flags};
+}
+
+static bool ReadAt(FILE *f, uint64_t offset, void *buffer, size_t size) {
+    if (offset > LONG_MAX || fseek(f, (long) offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(buffer, 1, size, f) == size;
+}
+
+static bool ReadTable(FILE *f, const uint8_t *header, uint32_t headerOffset, AllocatorVector<uint8_t> &out) {
+    uint64_t offset = RomFS_ReadBE64(header + headerOffset);
+    uint64_t size   = RomFS_ReadBE64(header + headerOffset + 8);
+    if (size > INDEX_MAX_TABLE_SIZE) {
+        return false;
+    }
+    out.resize(size);
+    return ReadAt(f, offset, out.data(), size);
+}
+
+static bool GetEntryName(const AllocatorVector<uint8_t> &table, uint32_t offset, uint32_t entrySize, std::string_view *outName) {
+    if ((uint64_t) offset + entrySize > table.size()) {
+        return false;
+    }
+    uint32_t nameLen = RomFS_ReadBE32(table.data() + offset + entrySize - 4);
+    if ((uint64_t) offset + entrySize + nameLen > table.size()) {
+        return false;
+    }
+    *outName = std::string_view((const char *) table.data() + offset + entrySize, nameLen);
+    return true;
+}
+
+static bool GetDirPath(const AllocatorVector<uint8_t> &dirTable, uint32_t dir, AllocatorUnorderedMap<uint32_t, AllocatorString> &cache, AllocatorString *outPath) {
+    AllocatorVector<uint32_t> chain;
+    AllocatorString path;
+    // Walk up until the root or a directory whose path is already known.
+    while (dir != 0) {
+        auto it = cache.find(dir);
+        if (it != cache.end()) {
+            path = it->second;
+            break;
+        }
+        if (chain.size() >= ROMFS_MAX_DIR_DEPTH || (uint64_t) dir + ROMFS_DIR_ENTRY_SIZE > dirTable.size()) {
+            return false;
+        }
+        chain.push_back(dir);
+        dir = RomFS_ReadBE32(dirTable.data() + dir);
+    }
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        std::string_view name;
+        if (!GetEntryName(dirTable, *it, ROMFS_DIR_ENTRY_SIZE, &name)) {
+            return false;
+        }
+        if (!path.empty()) {
+            path += '/';
+        }
+        path += name;
+        cache[*it] = path;
+    }
+    *outPath = std::move(path);
+    return true;
+}
+
+static std::unique_ptr<BundleIndex> BuildIndex(FILE *f) {
+    uint8_t header[ROMFS_HEADER_SIZE];
+    if (!ReadAt(f, 0, header, sizeof(header)) || RomFS_ReadBE32(header) != ROMFS_HEADER_MAGIC || RomFS_ReadBE32(header + 4) != ROMFS_HEADER_SIZE) {
+        return nullptr;
+    }
+    AllocatorVector<uint8_t> dirTable, fileTable;
+    if (!ReadTable(f, header, ROMFS_HEADER_DIR_TABLE, dirTable) || !ReadTable(f, header, ROMFS_HEADER_FILE_TABLE, fileTable)) {
+        return nullptr;
+    }
+
+    uint64_t dataOffset = RomFS_ReadBE64(header + ROMFS_HEADER_DATA_OFFSET);
+    auto index          = std::make_unique<BundleIndex>();
+    AllocatorVector<std::pair<uint32_t, uint32_t>> entries; // offset and length inside index->paths
+    AllocatorUnorderedMap<uint32_t, AllocatorString> dirPaths;
+    AllocatorString dirPath;
+    std::string_view name;
+    uint32_t offset = 0;
+    while (GetEntryName(fileTable, offset, ROMFS_FILE_ENTRY_SIZE, &name)) {
+        if (!GetDirPath(dirTable, RomFS_ReadBE32(fileTable.data() + offset), dirPaths, &dirPath)) {
+            return nullptr;
+        }
+        uint32_t pathOffset = index->paths.size();
+        if (!dirPath.empty()) {
+            index->paths.insert(index->paths.end(), dirPath.begin(), dirPath.end());
+            index->paths.push_back('/');
+        }
+        index->paths.insert(index->paths.end(), name.begin(), name.end());
+        entries.emplace_back(pathOffset, index->paths.size() - pathOffset);
+        index->extents.push_back({dataOffset + RomFS_ReadBE64(fileTable.data() + offset + ROMFS_FILE_ENTRY_OFFSET), RomFS_ReadBE64(fileTable.data() + offset + ROMFS_FILE_ENTRY_LENGTH)});
+        // Entries are padded to 4 bytes.
+        offset += ROMFS_FILE_ENTRY_SIZE + ((name.size() + 3) & ~3);
+    }
+
+    // Room for every file and its ".gz" alias at a load factor of at most 50%.
+    uint32_t numSlots = INDEX_MIN_SLOTS;
+    while (numSlots < entries.size() * 2 * 2) {
+        numSlots *= 2;
+    }
+    index->slots.resize(numSlots, {0, INDEX_EMPTY_SLOT, 0, 0, 0});
+    index->paths.shrink_to_fit();
+    index->extents.shrink_to_fit();
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        InsertSlot(*index, entries[i].first, entries[i].second, i, 0);
+    }
+    index->files = entries.size();
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        std::string_view path(index->paths.data() + entries[i].first, entries[i].second);
+        if (path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0 && !FindSlot(*index, path.substr(0, path.size() - 3))) {
+            InsertSlot(*index, entries[i].first, entries[i].second - 3, i, INDEX_FLAG_GZ_ALIAS);
+            index->gzAliases++;
+        }
+    }
+    return index;
+}
+
+void BundleIndex_Add(const char *name, const char *bundlePath, BundleSource source) {
+    {
+        std::shared_lock<std::shared_mutex> lock(sMutex);
+        if (!sEnabled) {
+            return;
+        }
+    }
+    std::string path = bundlePath;
+    if (source == BundleSource_FileDescriptor_CafeOS && path.rfind("fs:", 0) != 0) {
+        path = "fs:" + path;
+    }
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to open %s, lookups for \"%s\" will not be indexed", path.c_str(), name);
+        return;
+    }
+    auto index = BuildIndex(f);
+    fclose(f);
+    if (!index) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to index %s", path.c_str());
+        return;
+    }
+    index->bundlePath = std::move(path);
+    std::lock_guard<std::shared_mutex> lock(sMutex);
+    // The index may have been disabled while the bundle was indexed.
+    if (sEnabled) {
+        sIndices[name] = std::move(index);
+    }
+}
+
+void BundleIndex_Remove(const char *name) {
+    std::lock_guard<std::shared_mutex> lock(sMutex);
+    if (!name) {
+        sIndices.clear();
+        return;
+    }
+    auto it = sIndices.find(name);
+    if (it != sIndices.end()) {
+        sIndices.erase(it);
+    }
+}
+
+/**
+ * Returns false for paths that the module may resolve differently (e.g. "a//b", "./a", "a/../b" or "a/"), these are not handled by the index.
+ */
+static bool IsPlainPath(std::string_view path) {
+    if (path.empty()) {
+        return false;
+    }
+    size_t start = 0;
+    while (start <= path.size()) {
+        auto end = path.find('/', start);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+        auto component = path.substr(start, end - start);
+        if (component.empty() || component == "." || component == "..") {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+/**
+ * Splits a path into the mount name and the path relative to the root of the bundle.
+ */
+static bool SplitPath(const char *path, std::string_view *outMount, std::string_view *outRelative) {
+    if (!path) {
+        return false;
+    }
+    const char *colon = strchr(path, ':');
+    if (!colon || colon == path) {
+        return false;
+    }
+    std::string_view relative(colon + 1);
+    while (!relative.empty() && relative.front() == '/') {
+        relative.remove_prefix(1);
+    }
+    *outMount    = std::string_view(path, colon - path);
+    *outRelative = relative;
+    return true;
+}
+
+BundleIndexLookupResult BundleIndex_Lookup(const char *path, BundleIndexFileExtent *outExtent) {
+    std::string_view mount, relative;
+    if (!SplitPath(path, &mount, &relative) || !IsPlainPath(relative)) {
+        return BUNDLE_INDEX_NO_INDEX;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(sMutex);
+    auto it = sIndices.find(mount);
+    if (it == sIndices.end()) {
+        return BUNDLE_INDEX_NO_INDEX;
+    }
+    auto *slot = FindSlot(*it->second, relative);
+    if (!slot) {
+        return BUNDLE_INDEX_NOT_FOUND;
+    }
+    if (outExtent) {
+        *outExtent = it->second->extents[slot->file];
+    }
+    return (slot->flags & INDEX_FLAG_GZ_ALIAS) ? BUNDLE_INDEX_FOUND_GZ : BUNDLE_INDEX_FOUND;
+}
+
+bool BundleIndex_GetBundlePath(const char *path, std::string *outBundlePath) {
+    std::string_view mount, relative;
+    if (!SplitPath(path, &mount, &relative)) {
+        return false;
+    }
+    std::shared_lock<std::shared_mutex> lock(sMutex);
+    auto it = sIndices.find(mount);
+    if (it == sIndices.end()) {
+        return false;
+    }
+    *outBundlePath = it->second->bundlePath;
+    return true;
+}
+
+WUHBUtilsStatus WUHBUtils_SetBundleIndexEnabled(bool enabled) {
+    std::lock_guard<std::shared_mutex> lock(sMutex);
+    sEnabled = enabled;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_GetBundleIndexInfo(const char *name, WUHBBundleIndexInfo *outInfo) {
+    if (!name || !outInfo) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::shared_lock<std::shared_mutex> lock(sMutex);
+    auto it = sIndices.find(name);
+    if (it == sIndices.end()) {
+        return WUHB_UTILS_RESULT_MOUNT_NOT_FOUND;
+    }
+    auto &index          = *it->second;
+    outInfo->files       = index.files;
+    outInfo->gzAliases   = index.gzAliases;
+    outInfo->slots       = index.slots.size();
+    outInfo->memoryUsage = sizeof(BundleIndex) + index.slots.capacity() * sizeof(IndexSlot) + index.paths.capacity() + index.extents.capacity() * sizeof(BundleIndexFileExtent);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <wuhb_utils/utils.h>
+
+/*
+ * Client-side index of the files inside mounted bundles, see WUHBUtils_SetBundleIndexEnabled.
+ */
+
+enum BundleIndexLookupResult {
+    BUNDLE_INDEX_NO_INDEX,  // the bundle has no index or the path can't be resolved by the index, ask the module
+    BUNDLE_INDEX_NOT_FOUND, // neither the file nor "<file>.gz" exist
+    BUNDLE_INDEX_FOUND,     // the file exists
+    BUNDLE_INDEX_FOUND_GZ,  // only "<file>.gz" exists
+};
+
+struct BundleIndexFileExtent {
+    uint64_t offset; // absolute offset of the data inside the bundle file
+    uint64_t size;   // size of the stored data, for FOUND_GZ the size of the compressed data
+};
+
+void BundleIndex_Add(const char *name, const char *bundlePath, BundleSource source);
+
+/**
+ * Removes the index of a bundle, pass NULL to remove all indices.
+ */
+void BundleIndex_Remove(const char *name);
+
+/**
+ * Looks up a path (e.g. "bundle:/meta/meta.ini"), for FOUND and FOUND_GZ the location of the data is stored in *outExtent (optional).
+ */
+BundleIndexLookupResult BundleIndex_Lookup(const char *path, BundleIndexFileExtent *outExtent);
+
+/**
+ * Stores the path of the bundle file that "path" (e.g. "bundle:/meta/meta.ini") belongs to in *outBundlePath, the data
+ * at the offsets returned by BundleIndex_Lookup can be read from this file directly.
+ */
+bool BundleIndex_GetBundlePath(const char *path, std::string *outBundlePath);
@@ -0,0 +1,262 @@
+#include "allocator.h"
+#include "hash.h"
+#include "logger.h"
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <wuhb_utils/file_cache.h>
+
+/*
+ * Handed out buffers are tracked in sBuffers, WUHBUtils_CacheRelease only touches an entry found there, so releasing a
+ * buffer too often is detected without reading memory that may already have been freed.
+ * Files are loaded without holding the lock, WUHBUtils_CacheInvalidate bumps a generation counter so a file whose load
+ * overlapped an invalidation is handed out uncached instead of re-inserting outdated contents.
+ */
+
+struct CacheEntry {
+    std::string path;
+    uint8_t *block;
+    uint32_t size;
+    uint32_t refCount;  // one reference per handed out buffer, one while cached. Guarded by sMutex
+    uint32_t handedOut; // handed out buffers that have not been released yet. Guarded by sMutex
+    bool cached;
+    std::list<CacheEntry *>::iterator lruIt;
+};
+
+static std::mutex sMutex;
+static std::list<CacheEntry *> sLRU; // most recently used first
+static std::unordered_map<std::string, CacheEntry *> sEntries;
+static std::unordered_map<const uint8_t *, CacheEntry *> sBuffers; // entries with handedOut > 0, by their block
+static uint32_t sBudget      = 0;
+static uint32_t sCachedBytes = 0;
+static uint32_t sGeneration  = 0; // bumped by every WUHBUtils_CacheInvalidate
+static WUHBCacheStats sStats = {};
+
+static void UnrefEntry(CacheEntry *entry) {
+    if (--entry->refCount > 0) {
+        return;
+    }
+    Allocator_Free(entry->block);
+    delete entry;
+}
+
+static void RemoveEntry(CacheEntry *entry) {
+    sLRU.erase(entry->lruIt);
+    sEntries.erase(entry->path);
+    sCachedBytes -= entry->size;
+    entry->cached = false;
+    UnrefEntry(entry);
+}
+
+static void EvictToBudget() {
+    while (sCachedBytes > sBudget && !sLRU.empty()) {
+        RemoveEntry(sLRU.back());
+        sStats.evictions++;
+    }
+}
+
+static CacheEntry *CreateEntry(const char *path, uint32_t size) {
+    auto *entry = new (std::nothrow) CacheEntry();
+    if (!entry) {
+        return nullptr;
+    }
+    // Allocate at least one byte, the block identifies the entry in sBuffers.
+    entry->block = (uint8_t *) Allocator_Alloc(size > 0 ? size : 1, 0x40);
+    if (!entry->block) {
+        delete entry;
+        return nullptr;
+    }
+    entry->path      = path;
+    entry->size      = size;
+    entry->refCount  = 1;
+    entry->handedOut = 0;
+    entry->cached    = false;
+    return entry;
+}
+
+static WUHBUtilsStatus LoadEntry(const char *path, CacheEntry **outEntry) {
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_FileOpen(path, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    uint32_t fileSize = 0;
+    if (WUHBUtils_FileGetSize(handle, &fileSize) != WUHB_UTILS_RESULT_SUCCESS) {
+        // Without a known size the block can't be allocated up front, read into a temporary buffer and copy it.
+        WUHBUtils_FileClose(handle);
+        uint8_t *buffer = nullptr;
+        if ((res = WUHBUtils_ReadWholeFile(path, &buffer, &fileSize)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        auto *entry = CreateEntry(path, fileSize);
+        if (!entry) {
+            Allocator_Free(buffer);
+            return WUHB_UTILS_RESULT_NO_MEMORY;
+        }
+        memcpy(entry->block, buffer, fileSize);
+        Allocator_Free(buffer);
+        *outEntry = entry;
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+
+    auto *entry = CreateEntry(path, fileSize);
+    if (!entry) {
+        WUHBUtils_FileClose(handle);
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    uint32_t total = 0;
+    while (total < fileSize) {
+        int32_t readRes = -1;
+        res             = WUHBUtils_FileRead(handle, entry->block + total, fileSize - total, &readRes);
+        if (res == WUHB_UTILS_RESULT_SUCCESS && readRes < 0) {
+            res = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            UnrefEntry(entry);
+            WUHBUtils_FileClose(handle);
+            return res;
+        }
+        if (readRes == 0) {
+            break;
+        }
+        total += readRes;
+    }
+    entry->size = total;
+    if ((res = WUHBUtils_FileClose(handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        UnrefEntry(entry);
+        return res;
+    }
+    // WUHBUtils_ReadWholeFile above verifies the data itself, here it's read directly into the block.
+    if (!Hash_VerifyBuffer(path, entry->block, entry->size)) {
+        UnrefEntry(entry);
+        return WUHB_UTILS_RESULT_HASH_MISMATCH;
+    }
+    *outEntry = entry;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Hands out a reference of "entry" (already counted in refCount). Must be called with sMutex held.
+ */
+static void HandOut(CacheEntry *entry, const uint8_t **outBuf, uint32_t *outSize) {
+    if (entry->handedOut++ == 0) {
+        sBuffers[entry->block] = entry;
+    }
+    sStats.activeBuffers++;
+    *outBuf  = entry->block;
+    *outSize = entry->size;
+}
+
+WUHBUtilsStatus WUHBUtils_CacheSetBudget(uint32_t budget) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sBudget = budget;
+    EvictToBudget();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_CacheReadWholeFile(const char *path, const uint8_t **outBuf, uint32_t *outSize) {
+    if (!path || !outBuf || !outSize) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        auto it = sEntries.find(path);
+        if (it != sEntries.end()) {
+            auto *entry = it->second;
+            sLRU.splice(sLRU.begin(), sLRU, entry->lruIt);
+            entry->refCount++;
+            sStats.hits++;
+            HandOut(entry, outBuf, outSize);
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+        sStats.misses++;
+        generation = sGeneration;
+    }
+
+    // Don't hold the lock while reading, other files can be served from the cache in the meantime.
+    CacheEntry *entry = nullptr;
+    WUHBUtilsStatus res;
+    if ((res = LoadEntry(path, &entry)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    // If the cache was invalidated during the load the contents may be outdated, don't keep them.
+    if (entry->size <= sBudget && generation == sGeneration) {
+        auto it = sEntries.find(path);
+        if (it != sEntries.end()) {
+            // Another thread has loaded the same file in the meantime.
+            UnrefEntry(entry);
+            entry = it->second;
+            sLRU.splice(sLRU.begin(), sLRU, entry->lruIt);
+            entry->refCount++;
+        } else {
+            sLRU.push_front(entry);
+            entry->lruIt  = sLRU.begin();
+            entry->cached = true;
+            entry->refCount++;
+            sEntries[entry->path] = entry;
+            sCachedBytes += entry->size;
+            EvictToBudget();
+        }
+    }
+    HandOut(entry, outBuf, outSize);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void WUHBUtils_CacheRelease(const uint8_t *buffer) {
+    if (!buffer) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sBuffers.find(buffer);
+    if (it == sBuffers.end()) {
+        DEBUG_FUNCTION_LINE_ERR("%p was not returned by WUHBUtils_CacheReadWholeFile or has already been released", buffer);
+        return;
+    }
+    auto *entry = it->second;
+    if (--entry->handedOut == 0) {
+        sBuffers.erase(it);
+    }
+    sStats.activeBuffers--;
+    UnrefEntry(entry);
+}
+
+WUHBUtilsStatus WUHBUtils_CacheInvalidate(const char *pathPrefix) {
+    size_t prefixLen = pathPrefix ? strlen(pathPrefix) : 0;
+    std::lock_guard<std::mutex> lock(sMutex);
+    sGeneration++;
+    for (auto it = sLRU.begin(); it != sLRU.end();) {
+        auto *entry = *it++;
+        if (entry->path.compare(0, prefixLen, pathPrefix ? pathPrefix : "") == 0) {
+            RemoveEntry(entry);
+            sStats.invalidations++;
+        }
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_CacheGetStats(WUHBCacheStats *outStats) {
+    if (!outStats) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    *outStats             = sStats;
+    outStats->entries     = sEntries.size();
+    outStats->cachedBytes = sCachedBytes;
+    outStats->budget      = sBudget;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_CacheResetStats() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sStats.hits          = 0;
+    sStats.misses        = 0;
+    sStats.evictions     = 0;
+    sStats.invalidations = 0;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
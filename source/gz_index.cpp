@@ -0,0 +1,882 @@
+#include "gz_index.h"
+#include "allocator.h"
+#include "module_io.h"
+#include "romfs_format.h"
+#include "stats.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <wuhb_utils/gz_index.h>
+#include <zlib.h>
+
+/*
+ * Random access into gzip streams, based on the approach of zlib's examples/zran.c:
+ * While inflating the whole stream once, the inflate state is saved at deflate block boundaries.
+ * A saved state consists of the position in the compressed and uncompressed data, the bits of
+ * the last byte that belong to the next block and the last 32 KiB of uncompressed data.
+ *
+ * While an index is registered (from WUHBUtils_GzIndexBuild/WUHBUtils_GzIndexLoad until WUHBUtils_GzIndexFree),
+ * files opened via its path are served by it: the position is tracked here and reads inflate from the nearest point,
+ * or continue the inflate stream of the previous read, e.g. when reading sequentially. The module only reads the
+ * compressed data, via ModuleIO_FileReadAt, or via ModuleIO_FileRead for modules that support neither positional
+ * reads nor seeking. In that case the compressed file is reopened to go back. Reading the compressed data is not
+ * counted in the statistics, the uncompressed bytes read via the indexed handle are.
+ * Every indexed file reads the compressed data via its own handle (opened on the first read) and is found via a fixed
+ * table of atomic slots, so calls on different handles don't share a lock. Only WUHBUtils_GzIndexReadAt calls on the
+ * same index share the compressed file of the index.
+ *
+ * Index file layout, all values big-endian:
+ *   header   u32 magic, u32 version, u32 compressed size, u32 uncompressed size, u32 span, u32 point count
+ *   points   u32 out, u32 in, u32 bits, 32 KiB window per point
+ */
+
+#define GZ_WINDOW_SIZE      32768
+#define GZ_CHUNK_SIZE       (16 * 1024)
+#define GZ_INDEX_MAGIC      0x575A4958 // "WZIX"
+#define GZ_INDEX_VERSION    2
+#define GZ_INITIAL_CAPACITY 8
+#define GZ_FILE_HEADER_SIZE 24
+#define GZ_FILE_POINT_SIZE  (12 + GZ_WINDOW_SIZE)
+#define GZ_MAX_FILES        64 // indexed files that can be open at the same time, further files are served by the module
+
+struct GzIndexPoint {
+    uint32_t out;  // position in the uncompressed data
+    uint32_t in;   // position in the compressed data of the first complete byte of the next block
+    uint32_t bits; // number of bits (1-7) of the byte at in - 1 that belong to the next block, or 0
+    uint8_t window[GZ_WINDOW_SIZE];
+};
+
+/**
+ * A handle of the compressed data.
+ */
+struct GzRawFile {
+    WUHBFileHandle handle = 0;
+    bool open             = false;
+    bool sequential       = false; // the module can't read at a position, "handle" is only read forward
+    uint32_t rawPos       = 0;     // position of "handle"
+};
+
+struct WUHBGzIndex {
+    GzRawFile raw;    // used while building the index and by WUHBUtils_GzIndexReadAt
+    std::string path; // path of the compressed file
+    std::string name; // path the index is registered for
+    std::mutex mutex; // serializes WUHBUtils_GzIndexReadAt calls, they share "raw"
+    uint32_t compressedSize   = 0;
+    uint32_t uncompressedSize = 0;
+    uint32_t span             = 0;
+    uint32_t count            = 0;
+    uint32_t capacity         = 0;
+    GzIndexPoint **points     = nullptr;
+    std::atomic<uint32_t> refs{1}; // one of the caller (dropped by WUHBUtils_GzIndexFree) and one per open file
+};
+
+struct GzStream {
+    z_stream strm;
+    bool active      = false;
+    uint32_t out     = 0;       // position in the uncompressed data of the next byte inflate produces
+    uint32_t rawPos  = 0;       // position in the compressed data of the next input chunk
+    uint8_t *input   = nullptr; // GZ_CHUNK_SIZE bytes
+    uint8_t *discard = nullptr; // GZ_WINDOW_SIZE bytes
+    GzRawFile *raw   = nullptr; // the compressed data is read via this handle
+};
+
+struct GzIndexedFile {
+    WUHBGzIndex *index = nullptr;
+    std::mutex mutex; // serializes the reads of different threads on the handle
+    uint32_t pos = 0;
+    GzRawFile raw;
+    GzStream stream;
+};
+
+/**
+ * A slot is claimed by setting "handle" and released by resetting it to 0. Calls on a handle are serialized by the
+ * caller, so the slot of a handle doesn't change while it's looked up.
+ */
+struct GzFileSlot {
+    std::atomic<WUHBFileHandle> handle;
+    std::atomic<GzIndexedFile *> file;
+};
+
+static std::mutex sRegistryMutex;
+static std::map<std::string, WUHBGzIndex *, std::less<>> sIndices;
+static GzFileSlot sFileSlots[GZ_MAX_FILES];
+// Checked without holding sRegistryMutex, so opens and reads don't look at the tables while no index is used.
+static std::atomic<uint32_t> sIndexCount(0);
+static std::atomic<uint32_t> sFileCount(0); // claimed slots of sFileSlots
+
+static std::string CompressedPath(const char *name) {
+    // Opening name + ".gz" explicitly gives us the compressed data.
+    std::string path = name;
+    if (path.size() < 3 || path.compare(path.size() - 3, 3, ".gz") != 0) {
+        path += ".gz";
+    }
+    return path;
+}
+
+static WUHBUtilsStatus OpenCompressedFile(const char *name, WUHBFileHandle *outHandle) {
+    return ModuleIO_FileOpen(CompressedPath(name).c_str(), outHandle);
+}
+
+static WUHBGzIndex *CreateIndex(const char *name, WUHBFileHandle handle) {
+    void *mem = Allocator_Alloc(sizeof(WUHBGzIndex), alignof(WUHBGzIndex));
+    if (!mem) {
+        return nullptr;
+    }
+    auto *index       = new (mem) WUHBGzIndex();
+    index->raw.handle = handle;
+    index->raw.open   = true;
+    index->path       = CompressedPath(name);
+    index->name       = index->path.substr(0, index->path.size() - 3);
+    return index;
+}
+
+/**
+ * Frees the points, closes the compressed file and frees the index.
+ */
+static void DestroyIndex(WUHBGzIndex *index) {
+    for (uint32_t i = 0; i < index->count; i++) {
+        Allocator_Free(index->points[i]);
+    }
+    Allocator_Free(index->points);
+    if (index->raw.open) {
+        ModuleIO_FileClose(index->raw.handle);
+    }
+    index->~WUHBGzIndex();
+    Allocator_Free(index);
+}
+
+/**
+ * Files opened via the path of "index" are served by it from now on, replacing an index registered before.
+ */
+static void RegisterIndex(WUHBGzIndex *index) {
+    std::lock_guard<std::mutex> lock(sRegistryMutex);
+    auto &slot = sIndices[index->name];
+    if (!slot) {
+        sIndexCount++;
+    }
+    slot = index;
+}
+
+static GzIndexPoint *AddPoint(WUHBGzIndex *index) {
+    if (index->count == index->capacity) {
+        uint32_t newCapacity = index->capacity ? index->capacity * 2 : GZ_INITIAL_CAPACITY;
+        auto *newPoints      = (GzIndexPoint **) Allocator_Alloc(newCapacity * sizeof(GzIndexPoint *), alignof(GzIndexPoint *));
+        if (!newPoints) {
+            return nullptr;
+        }
+        if (index->points) {
+            memcpy(newPoints, index->points, index->count * sizeof(GzIndexPoint *));
+            Allocator_Free(index->points);
+        }
+        index->points   = newPoints;
+        index->capacity = newCapacity;
+    }
+    auto *point = (GzIndexPoint *) Allocator_Alloc(sizeof(GzIndexPoint), alignof(GzIndexPoint));
+    if (point) {
+        index->points[index->count++] = point;
+    }
+    return point;
+}
+
+/**
+ * Drops every second point and doubles the span to stay within the memory budget.
+ */
+static void ThinOut(WUHBGzIndex *index) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (i % 2 == 0) {
+            index->points[kept++] = index->points[i];
+        } else {
+            Allocator_Free(index->points[i]);
+        }
+    }
+    index->count = kept;
+    index->span *= 2;
+}
+
+static voidpf ZlibAlloc(voidpf, uInt items, uInt size) {
+    if (size != 0 && items > UINT32_MAX / size) {
+        return Z_NULL;
+    }
+    return Allocator_Alloc(items * size, 0x40);
+}
+
+static void ZlibFree(voidpf, voidpf ptr) {
+    Allocator_Free(ptr);
+}
+
+static WUHBUtilsStatus MapZlibError(int ret) {
+    return ret == Z_MEM_ERROR ? WUHB_UTILS_RESULT_NO_MEMORY : WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+}
+
+/**
+ * Reads compressed data at "pos" via "raw", opens it first if needed. Modules that can neither read at a position nor
+ * seek only allow reading forward, so the data before "pos" is skipped, or the file is reopened to go back.
+ */
+static WUHBUtilsStatus ReadCompressed(const WUHBGzIndex *index, GzRawFile *raw, uint32_t pos, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    WUHBUtilsStatus res;
+    if (!raw->open) {
+        if ((res = ModuleIO_FileOpen(index->path.c_str(), &raw->handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        raw->open   = true;
+        raw->rawPos = 0;
+    }
+    if (!raw->sequential) {
+        if ((res = ModuleIO_FileReadAt(raw->handle, pos, buffer, size, outRes)) != WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND) {
+            return res;
+        }
+        raw->sequential = true;
+    }
+    if (pos < raw->rawPos) {
+        WUHBFileHandle handle;
+        if ((res = ModuleIO_FileOpen(index->path.c_str(), &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        ModuleIO_FileClose(raw->handle);
+        raw->handle = handle;
+        raw->rawPos = 0;
+    }
+    while (raw->rawPos < pos) {
+        int32_t skipped = -1;
+        uint32_t toSkip = pos - raw->rawPos;
+        if ((res = ModuleIO_FileRead(raw->handle, buffer, toSkip < size ? toSkip : size, &skipped)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        if (skipped <= 0) {
+            *outRes = 0;
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+        raw->rawPos += skipped;
+    }
+    if ((res = ModuleIO_FileRead(raw->handle, buffer, size, outRes)) == WUHB_UTILS_RESULT_SUCCESS && *outRes > 0) {
+        raw->rawPos += *outRes;
+    }
+    return res;
+}
+
+static WUHBUtilsStatus BuildIndex(WUHBGzIndex *index, uint32_t maxPoints, uint8_t *input, uint8_t *window) {
+    z_stream strm{};
+    strm.zalloc = ZlibAlloc;
+    strm.zfree  = ZlibFree;
+    // 47: detect gzip or zlib header
+    int ret = inflateInit2(&strm, 47);
+    if (ret != Z_OK) {
+        return MapZlibError(ret);
+    }
+    uint32_t totalIn = 0, totalOut = 0, last = 0;
+    WUHBUtilsStatus res;
+    do {
+        int32_t readRes = -1;
+        if ((res = ModuleIO_FileRead(index->raw.handle, input, GZ_CHUNK_SIZE, &readRes)) != WUHB_UTILS_RESULT_SUCCESS) {
+            inflateEnd(&strm);
+            return res;
+        }
+        if (readRes <= 0) {
+            // unexpected end of the compressed data
+            inflateEnd(&strm);
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        index->raw.rawPos += readRes;
+        strm.avail_in = readRes;
+        strm.next_in  = input;
+
+        do {
+            if (strm.avail_out == 0) {
+                strm.avail_out = GZ_WINDOW_SIZE;
+                strm.next_out  = window;
+            }
+            totalIn += strm.avail_in;
+            totalOut += strm.avail_out;
+            // Z_BLOCK returns at the end of each deflate block.
+            ret = inflate(&strm, Z_BLOCK);
+            totalIn -= strm.avail_in;
+            totalOut -= strm.avail_out;
+            if (ret == Z_NEED_DICT) {
+                ret = Z_DATA_ERROR;
+            }
+            if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+                inflateEnd(&strm);
+                return MapZlibError(ret);
+            }
+            if (ret == Z_STREAM_END) {
+                break;
+            }
+            // Bit 7 is set at the end of a block, bit 6 for the last block.
+            bool atBlockBoundary = (strm.data_type & 128) && !(strm.data_type & 64);
+            if (atBlockBoundary && (totalOut == 0 || totalOut - last > index->span)) {
+                if (index->count == maxPoints) {
+                    ThinOut(index);
+                    last = index->points[index->count - 1]->out;
+                    if (index->count == maxPoints || totalOut - last <= index->span) {
+                        continue;
+                    }
+                }
+                auto *point = AddPoint(index);
+                if (!point) {
+                    inflateEnd(&strm);
+                    return WUHB_UTILS_RESULT_NO_MEMORY;
+                }
+                point->bits   = strm.data_type & 7;
+                point->in     = totalIn;
+                point->out    = totalOut;
+                uint32_t left = strm.avail_out;
+                if (left) {
+                    memcpy(point->window, window + GZ_WINDOW_SIZE - left, left);
+                }
+                if (left < GZ_WINDOW_SIZE) {
+                    memcpy(point->window + left, window, GZ_WINDOW_SIZE - left);
+                }
+                last = totalOut;
+            }
+        } while (strm.avail_in != 0);
+    } while (ret != Z_STREAM_END);
+    inflateEnd(&strm);
+
+    index->uncompressedSize = totalOut;
+    if (ModuleIO_FileGetSize(index->raw.handle, &index->compressedSize) != WUHB_UTILS_RESULT_SUCCESS) {
+        index->compressedSize = 0;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_GzIndexBuild(const char *name, uint32_t span, uint32_t maxMemory, WUHBGzIndex **outIndex) {
+    if (!name || !outIndex) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    uint32_t maxPoints = maxMemory ? maxMemory / sizeof(GzIndexPoint) : UINT32_MAX;
+    if (maxPoints == 0) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = OpenCompressedFile(name, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    auto *index  = CreateIndex(name, handle);
+    auto *input  = (uint8_t *) Allocator_Alloc(GZ_CHUNK_SIZE, 0x40);
+    auto *window = (uint8_t *) Allocator_Alloc(GZ_WINDOW_SIZE, 0x40);
+    if (!index || !input || !window) {
+        Allocator_Free(input);
+        Allocator_Free(window);
+        if (index) {
+            DestroyIndex(index);
+        } else {
+            ModuleIO_FileClose(handle);
+        }
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    index->span = span ? span : WUHB_GZ_INDEX_DEFAULT_SPAN;
+
+    res = BuildIndex(index, maxPoints, input, window);
+    Allocator_Free(input);
+    Allocator_Free(window);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        DestroyIndex(index);
+        return res;
+    }
+    RegisterIndex(index);
+    *outIndex = index;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static void WriteBE32(uint8_t *p, uint32_t val) {
+    p[0] = (uint8_t) (val >> 24);
+    p[1] = (uint8_t) (val >> 16);
+    p[2] = (uint8_t) (val >> 8);
+    p[3] = (uint8_t) val;
+}
+
+WUHBUtilsStatus WUHBUtils_GzIndexSave(const WUHBGzIndex *index, const char *indexPath) {
+    if (!index || !indexPath) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    FILE *f = fopen(indexPath, "wb");
+    if (!f) {
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    uint8_t header[GZ_FILE_HEADER_SIZE];
+    WriteBE32(header + 0, GZ_INDEX_MAGIC);
+    WriteBE32(header + 4, GZ_INDEX_VERSION);
+    WriteBE32(header + 8, index->compressedSize);
+    WriteBE32(header + 12, index->uncompressedSize);
+    WriteBE32(header + 16, index->span);
+    WriteBE32(header + 20, index->count);
+    bool success = fwrite(header, sizeof(header), 1, f) == 1;
+    for (uint32_t i = 0; success && i < index->count; i++) {
+        auto *point = index->points[i];
+        uint8_t pointHeader[GZ_FILE_POINT_SIZE - GZ_WINDOW_SIZE];
+        WriteBE32(pointHeader + 0, point->out);
+        WriteBE32(pointHeader + 4, point->in);
+        WriteBE32(pointHeader + 8, point->bits);
+        success = fwrite(pointHeader, sizeof(pointHeader), 1, f) == 1 && fwrite(point->window, GZ_WINDOW_SIZE, 1, f) == 1;
+    }
+    success = fclose(f) == 0 && success;
+    if (!success) {
+        remove(indexPath);
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_GzIndexLoad(const char *name, const char *indexPath, WUHBGzIndex **outIndex) {
+    if (!name || !indexPath || !outIndex) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    FILE *f = fopen(indexPath, "rb");
+    if (!f) {
+        return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+    }
+    uint8_t header[GZ_FILE_HEADER_SIZE];
+    if (fread(header, sizeof(header), 1, f) != 1 || RomFS_ReadBE32(header) != GZ_INDEX_MAGIC ||
+        RomFS_ReadBE32(header + 4) != GZ_INDEX_VERSION || RomFS_ReadBE32(header + 20) == 0) {
+        fclose(f);
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    uint32_t count = RomFS_ReadBE32(header + 20);
+
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = OpenCompressedFile(name, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        fclose(f);
+        return res;
+    }
+    auto *index = CreateIndex(name, handle);
+    if (!index) {
+        fclose(f);
+        ModuleIO_FileClose(handle);
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    index->compressedSize   = RomFS_ReadBE32(header + 8);
+    index->uncompressedSize = RomFS_ReadBE32(header + 12);
+    index->span             = RomFS_ReadBE32(header + 16);
+
+    // Make sure the index belongs to this file.
+    uint32_t compressedSize;
+    if (ModuleIO_FileGetSize(handle, &compressedSize) == WUHB_UTILS_RESULT_SUCCESS && compressedSize != index->compressedSize) {
+        res = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    for (uint32_t i = 0; res == WUHB_UTILS_RESULT_SUCCESS && i < count; i++) {
+        uint8_t pointHeader[GZ_FILE_POINT_SIZE - GZ_WINDOW_SIZE];
+        auto *point = AddPoint(index);
+        if (!point) {
+            res = WUHB_UTILS_RESULT_NO_MEMORY;
+            break;
+        }
+        if (fread(pointHeader, sizeof(pointHeader), 1, f) != 1 || fread(point->window, GZ_WINDOW_SIZE, 1, f) != 1) {
+            res = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+            break;
+        }
+        point->out  = RomFS_ReadBE32(pointHeader + 0);
+        point->in   = RomFS_ReadBE32(pointHeader + 4);
+        point->bits = RomFS_ReadBE32(pointHeader + 8);
+        if (point->bits > 7 || (point->bits > 0 && point->in == 0) || point->out > index->uncompressedSize ||
+            (i > 0 && point->out < index->points[i - 1]->out)) {
+            res = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+    }
+    fclose(f);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        DestroyIndex(index);
+        return res;
+    }
+    RegisterIndex(index);
+    *outIndex = index;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static bool StreamAllocBuffers(GzStream *stream) {
+    if (!stream->input) {
+        stream->input = (uint8_t *) Allocator_Alloc(GZ_CHUNK_SIZE, 0x40);
+    }
+    if (!stream->discard) {
+        stream->discard = (uint8_t *) Allocator_Alloc(GZ_WINDOW_SIZE, 0x40);
+    }
+    return stream->input && stream->discard;
+}
+
+static void StreamEnd(GzStream *stream) {
+    if (stream->active) {
+        inflateEnd(&stream->strm);
+        stream->active = false;
+    }
+}
+
+static void StreamFree(GzStream *stream) {
+    StreamEnd(stream);
+    Allocator_Free(stream->input);
+    Allocator_Free(stream->discard);
+    stream->input   = nullptr;
+    stream->discard = nullptr;
+}
+
+static WUHBUtilsStatus StreamStart(WUHBGzIndex *index, GzStream *stream, const GzIndexPoint *point) {
+    StreamEnd(stream);
+    stream->strm        = {};
+    stream->strm.zalloc = ZlibAlloc;
+    stream->strm.zfree  = ZlibFree;
+    // -15: raw deflate data, we start in the middle of the stream.
+    int ret = inflateInit2(&stream->strm, -15);
+    if (ret != Z_OK) {
+        return MapZlibError(ret);
+    }
+    stream->active = true;
+    stream->out    = point->out;
+    stream->rawPos = point->in;
+    if (point->bits) {
+        // The first chunk starts with the byte that holds the first bits of the block.
+        int32_t readRes = -1;
+        auto res        = ReadCompressed(index, stream->raw, point->in - 1, stream->input, GZ_CHUNK_SIZE, &readRes);
+        if (res != WUHB_UTILS_RESULT_SUCCESS || readRes <= 0) {
+            StreamEnd(stream);
+            return res != WUHB_UTILS_RESULT_SUCCESS ? res : WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        inflatePrime(&stream->strm, point->bits, stream->input[0] >> (8 - point->bits));
+        stream->strm.next_in  = stream->input + 1;
+        stream->strm.avail_in = readRes - 1;
+        stream->rawPos        = point->in - 1 + readRes;
+    }
+    inflateSetDictionary(&stream->strm, point->window, GZ_WINDOW_SIZE);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Inflates until "size" bytes at "offset" have been produced or the data ends. "offset" must not be before stream->out.
+ */
+static WUHBUtilsStatus StreamRead(WUHBGzIndex *index, GzStream *stream, uint32_t offset, uint8_t *buffer, uint32_t size, uint32_t *outRead) {
+    z_stream &strm    = stream->strm;
+    uint32_t skip     = offset - stream->out;
+    uint32_t produced = 0;
+    while (produced < size) {
+        if (skip > 0) {
+            strm.next_out  = stream->discard;
+            strm.avail_out = skip < GZ_WINDOW_SIZE ? skip : GZ_WINDOW_SIZE;
+        } else {
+            strm.next_out  = buffer + produced;
+            strm.avail_out = size - produced;
+        }
+        if (strm.avail_in == 0) {
+            int32_t readRes = -1;
+            WUHBUtilsStatus res;
+            if ((res = ReadCompressed(index, stream->raw, stream->rawPos, stream->input, GZ_CHUNK_SIZE, &readRes)) != WUHB_UTILS_RESULT_SUCCESS) {
+                StreamEnd(stream);
+                return res;
+            }
+            if (readRes <= 0) {
+                StreamEnd(stream);
+                return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+            }
+            stream->rawPos += readRes;
+            strm.next_in  = stream->input;
+            strm.avail_in = readRes;
+        }
+        uint32_t before = strm.avail_out;
+        int ret         = inflate(&strm, Z_NO_FLUSH);
+        uint32_t done   = before - strm.avail_out;
+        stream->out += done;
+        if (skip > 0) {
+            skip -= done;
+        } else {
+            produced += done;
+        }
+        if (ret == Z_STREAM_END) {
+            StreamEnd(stream);
+            break;
+        }
+        if (ret == Z_NEED_DICT || ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+            StreamEnd(stream);
+            return MapZlibError(ret == Z_NEED_DICT ? Z_DATA_ERROR : ret);
+        }
+    }
+    *outRead = produced;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static const GzIndexPoint *FindPoint(const WUHBGzIndex *index, uint32_t offset) {
+    // Find the last point at or before offset.
+    uint32_t lo = 0, hi = index->count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index->points[mid]->out <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return index->points[lo];
+}
+
+static WUHBUtilsStatus ReadFromStream(WUHBGzIndex *index, GzStream *stream, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (offset >= index->uncompressedSize || size == 0) {
+        *outRes = 0;
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    if (size > index->uncompressedSize - offset) {
+        size = index->uncompressedSize - offset;
+    }
+    if (size > INT32_MAX) {
+        size = INT32_MAX;
+    }
+    if (!StreamAllocBuffers(stream)) {
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    WUHBUtilsStatus res;
+    auto *point = FindPoint(index, offset);
+    // Continue the previous inflate if it stopped between the point and "offset", e.g. when reading sequentially.
+    if (!stream->active || stream->out > offset || stream->out < point->out) {
+        if ((res = StreamStart(index, stream, point)) != WUHB_UTILS_RESULT_SUCCESS) {
+            *outRes = -1;
+            return res;
+        }
+    }
+    uint32_t read = 0;
+    if ((res = StreamRead(index, stream, offset, buffer, size, &read)) != WUHB_UTILS_RESULT_SUCCESS) {
+        *outRes = -1;
+        return res;
+    }
+    *outRes = (int32_t) read;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_GzIndexReadAt(WUHBGzIndex *index, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (!index || !buffer || !outRes) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(index->mutex);
+    GzStream stream;
+    stream.raw = &index->raw;
+    auto res   = ReadFromStream(index, &stream, offset, buffer, size, outRes);
+    StreamFree(&stream);
+    return res;
+}
+
+WUHBUtilsStatus WUHBUtils_GzIndexGetInfo(const WUHBGzIndex *index, WUHBGzIndexInfo *outInfo) {
+    if (!index || !outInfo) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    outInfo->uncompressedSize = index->uncompressedSize;
+    outInfo->compressedSize   = index->compressedSize;
+    outInfo->span             = index->span;
+    outInfo->points           = index->count;
+    outInfo->memoryUsage      = sizeof(WUHBGzIndex) + index->capacity * sizeof(GzIndexPoint *) + index->count * sizeof(GzIndexPoint);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_GzIndexFree(WUHBGzIndex *index) {
+    if (!index) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        auto it = sIndices.find(index->name);
+        if (it != sIndices.end() && it->second == index) {
+            sIndices.erase(it);
+            sIndexCount--;
+        }
+    }
+    // With files still open the last GzIndex_FileClosed frees it.
+    if (index->refs.fetch_sub(1) == 1) {
+        DestroyIndex(index);
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void GzIndex_FileOpened(const char *name, WUHBFileHandle handle) {
+    if (sIndexCount.load(std::memory_order_relaxed) == 0 || !name) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        if (sIndices.find(name) == sIndices.end()) {
+            return;
+        }
+    }
+    // Only files opened via the ".gz" fallback are served by the index, not a plain file with the same name.
+    uint64_t offset, length;
+    bool compressed = false;
+    if (WUHBUtils_GetFileInfo(name, &offset, &length, &compressed) != WUHB_UTILS_RESULT_SUCCESS || !compressed) {
+        return;
+    }
+    auto *file = new (std::nothrow) GzIndexedFile();
+    if (!file) {
+        // The module serves the file, only slower.
+        return;
+    }
+    file->stream.raw = &file->raw;
+    GzFileSlot *slot = nullptr;
+    for (auto &candidate : sFileSlots) {
+        WUHBFileHandle expected = 0;
+        if (candidate.handle.compare_exchange_strong(expected, handle)) {
+            slot = &candidate;
+            break;
+        }
+    }
+    if (!slot) {
+        delete file;
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sRegistryMutex);
+        auto it = sIndices.find(name);
+        if (it != sIndices.end()) {
+            file->index = it->second;
+            file->index->refs++;
+        }
+    }
+    if (!file->index) {
+        slot->handle.store(0);
+        delete file;
+        return;
+    }
+    slot->file.store(file);
+    sFileCount++;
+}
+
+static GzFileSlot *FindSlot(WUHBFileHandle handle) {
+    if (sFileCount.load(std::memory_order_relaxed) == 0 || handle == 0) {
+        return nullptr;
+    }
+    for (auto &slot : sFileSlots) {
+        if (slot.handle.load(std::memory_order_acquire) == handle) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+static GzIndexedFile *FindFile(WUHBFileHandle handle) {
+    auto *slot = FindSlot(handle);
+    return slot ? slot->file.load(std::memory_order_acquire) : nullptr;
+}
+
+bool GzIndex_IsIndexedHandle(WUHBFileHandle handle) {
+    return FindFile(handle) != nullptr;
+}
+
+bool GzIndex_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes, WUHBUtilsStatus *outStatus) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return false;
+    }
+    if (!buffer || !outRes) {
+        *outStatus = WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    *outStatus = ReadFromStream(file->index, &file->stream, file->pos, buffer, size, outRes);
+    if (*outStatus == WUHB_UTILS_RESULT_SUCCESS) {
+        file->pos += *outRes;
+        STATS_BYTES_READ(handle, *outRes);
+        Trace_FileRead(handle, *outRes);
+    }
+    return true;
+}
+
+bool GzIndex_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes, WUHBUtilsStatus *outStatus) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return false;
+    }
+    if (!buffer || !outRes) {
+        *outStatus = WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    *outStatus = ReadFromStream(file->index, &file->stream, offset, buffer, size, outRes);
+    if (*outStatus == WUHB_UTILS_RESULT_SUCCESS) {
+        STATS_BYTES_READ(handle, *outRes);
+        Trace_FileReadAt(handle, offset, *outRes);
+    }
+    return true;
+}
+
+bool GzIndex_FileGetSize(WUHBFileHandle handle, uint32_t *outSize, WUHBUtilsStatus *outStatus) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return false;
+    }
+    if (!outSize) {
+        *outStatus = WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        return true;
+    }
+    *outSize   = file->index->uncompressedSize;
+    *outStatus = WUHB_UTILS_RESULT_SUCCESS;
+    return true;
+}
+
+bool GzIndex_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos, WUHBUtilsStatus *outStatus) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    int64_t base;
+    switch (origin) {
+        case WUHB_SEEK_SET:
+            base = 0;
+            break;
+        case WUHB_SEEK_CUR:
+            base = file->pos;
+            break;
+        case WUHB_SEEK_END:
+            base = file->index->uncompressedSize;
+            break;
+        default:
+            *outStatus = WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+            return true;
+    }
+    if (base + offset < 0 || base + offset > UINT32_MAX) {
+        *outStatus = WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        return true;
+    }
+    // Only the position changes, the next read decides whether the inflate stream can be continued.
+    file->pos = base + offset;
+    Trace_FileSeek(handle, file->pos);
+    if (outPos) {
+        *outPos = file->pos;
+    }
+    *outStatus = WUHB_UTILS_RESULT_SUCCESS;
+    return true;
+}
+
+bool GzIndex_FileTell(WUHBFileHandle handle, uint32_t *outPos, WUHBUtilsStatus *outStatus) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return false;
+    }
+    if (!outPos) {
+        *outStatus = WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(file->mutex);
+    *outPos    = file->pos;
+    *outStatus = WUHB_UTILS_RESULT_SUCCESS;
+    return true;
+}
+
+void GzIndex_FileClosed(WUHBFileHandle handle) {
+    auto *slot = FindSlot(handle);
+    if (!slot) {
+        return;
+    }
+    auto *file = slot->file.exchange(nullptr);
+    slot->handle.store(0, std::memory_order_release);
+    if (!file) {
+        return;
+    }
+    sFileCount--;
+    StreamFree(&file->stream);
+    if (file->raw.open) {
+        ModuleIO_FileClose(file->raw.handle);
+    }
+    if (file->index->refs.fetch_sub(1) == 1) {
+        DestroyIndex(file->index);
+    }
+    delete file;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <wuhb_utils/utils.h>
+
+/*
+ * Files served by a registered <wuhb_utils/gz_index.h> index, used by the file functions in utils.cpp.
+ * Every function returns false if "handle" is not served by an index, and otherwise stores the result in *outStatus.
+ * Without any such file open they cost a single atomic load.
+ */
+
+/**
+ * Called after "name" has been opened by the module. If an index is registered for "name" and the module opened the
+ * compressed file, the file is served by the index from now on.
+ */
+void GzIndex_FileOpened(const char *name, WUHBFileHandle handle);
+
+bool GzIndex_IsIndexedHandle(WUHBFileHandle handle);
+
+bool GzIndex_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes, WUHBUtilsStatus *outStatus);
+bool GzIndex_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes, WUHBUtilsStatus *outStatus);
+bool GzIndex_FileGetSize(WUHBFileHandle handle, uint32_t *outSize, WUHBUtilsStatus *outStatus);
+bool GzIndex_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos, WUHBUtilsStatus *outStatus);
+bool GzIndex_FileTell(WUHBFileHandle handle, uint32_t *outPos, WUHBUtilsStatus *outStatus);
+
+/**
+ * Called before the module closes "handle".
+ */
+void GzIndex_FileClosed(WUHBFileHandle handle);
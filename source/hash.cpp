@@ -0,0 +1,371 @@
+#include "hash.h"
+#include "allocator.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+ * CRC-32 uses slicing-by-8 (eight 1 KiB tables, 8 bytes per step), xxHash32 processes 16 byte stripes in four
+ * independent lanes. Both read their input as little-endian words, which compiles to byte-reversed loads on the console.
+ */
+
+#define XXH_PRIME1 0x9E3779B1u
+#define XXH_PRIME2 0x85EBCA77u
+#define XXH_PRIME3 0xC2B2AE3Du
+#define XXH_PRIME4 0x27D4EB2Fu
+#define XXH_PRIME5 0x165667B1u
+
+struct HashManifest {
+    WUHBHashType type;
+    AllocatorUnorderedMap<AllocatorString, uint32_t, AllocatorStringHash> hashes; // path relative to the root (without leading '/') -> hash
+};
+
+static std::mutex sMutex;
+static std::map<std::string, std::unique_ptr<HashManifest>, std::less<>> sManifests;
+static bool sVerify = false;
+static std::atomic<bool> sActive(false); // sVerify && !sManifests.empty(), checked without holding sMutex
+
+struct CrcTables {
+    uint32_t table[8][256];
+
+    CrcTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+static const CrcTables &GetCrcTables() {
+    static const CrcTables tables;
+    return tables;
+}
+
+static inline uint32_t ReadLE32(const uint8_t *p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline uint32_t RotL32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t Crc32Update(uint32_t crc, const uint8_t *p, uint32_t size) {
+    const auto &t = GetCrcTables().table;
+    while (size >= 8) {
+        uint32_t one = crc ^ ReadLE32(p);
+        uint32_t two = ReadLE32(p + 4);
+        crc          = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static inline uint32_t XxhRound(uint32_t acc, uint32_t input) {
+    acc += input * XXH_PRIME2;
+    acc = RotL32(acc, 13);
+    acc *= XXH_PRIME1;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // Keeps GCC from vectorizing the four lanes with SSE2, which has no 32 bit multiply and is slower than scalar code (host build only).
+    __asm__("" : "+r"(acc));
+#endif
+    return acc;
+}
+
+/**
+ * Processes all complete 16 byte stripes, returns the number of bytes consumed.
+ */
+static uint32_t XxhStripes(uint32_t *acc, const uint8_t *p, uint32_t size) {
+    uint32_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+    uint32_t consumed = 0;
+    while (size - consumed >= 16) {
+        v1 = XxhRound(v1, ReadLE32(p + consumed));
+        v2 = XxhRound(v2, ReadLE32(p + consumed + 4));
+        v3 = XxhRound(v3, ReadLE32(p + consumed + 8));
+        v4 = XxhRound(v4, ReadLE32(p + consumed + 12));
+        consumed += 16;
+    }
+    acc[0] = v1;
+    acc[1] = v2;
+    acc[2] = v3;
+    acc[3] = v4;
+    return consumed;
+}
+
+WUHBUtilsStatus WUHBUtils_HashInit(WUHBHashState *state, WUHBHashType type) {
+    if (!state || (type != WUHB_HASH_CRC32 && type != WUHB_HASH_XXH32)) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    memset(state, 0, sizeof(*state));
+    state->type = type;
+    if (type == WUHB_HASH_CRC32) {
+        state->acc[0] = 0xFFFFFFFF;
+    } else {
+        state->acc[0] = XXH_PRIME1 + XXH_PRIME2;
+        state->acc[1] = XXH_PRIME2;
+        state->acc[2] = 0;
+        state->acc[3] = 0u - XXH_PRIME1;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void WUHBUtils_HashUpdate(WUHBHashState *state, const void *data, uint32_t size) {
+    if (!state || size == 0) {
+        return;
+    }
+    auto *p = (const uint8_t *) data;
+    state->totalSize += size;
+    if (state->type == WUHB_HASH_CRC32) {
+        state->acc[0] = Crc32Update(state->acc[0], p, size);
+        return;
+    }
+    if (state->pendingSize > 0) {
+        uint32_t toCopy = std::min<uint32_t>(size, sizeof(state->pending) - state->pendingSize);
+        memcpy(state->pending + state->pendingSize, p, toCopy);
+        state->pendingSize += toCopy;
+        p += toCopy;
+        size -= toCopy;
+        if (state->pendingSize < sizeof(state->pending)) {
+            return;
+        }
+        XxhStripes(state->acc, state->pending, sizeof(state->pending));
+        state->pendingSize = 0;
+    }
+    uint32_t consumed = XxhStripes(state->acc, p, size);
+    memcpy(state->pending, p + consumed, size - consumed);
+    state->pendingSize = size - consumed;
+}
+
+uint32_t WUHBUtils_HashFinal(const WUHBHashState *state) {
+    if (!state) {
+        return 0;
+    }
+    if (state->type == WUHB_HASH_CRC32) {
+        return state->acc[0] ^ 0xFFFFFFFF;
+    }
+    uint32_t h;
+    if (state->totalSize >= 16) {
+        h = RotL32(state->acc[0], 1) + RotL32(state->acc[1], 7) + RotL32(state->acc[2], 12) + RotL32(state->acc[3], 18);
+    } else {
+        h = state->acc[2] + XXH_PRIME5; // acc[2] is the seed
+    }
+    h += (uint32_t) state->totalSize;
+    const uint8_t *p = state->pending;
+    uint32_t left    = state->pendingSize;
+    while (left >= 4) {
+        h += ReadLE32(p) * XXH_PRIME3;
+        h = RotL32(h, 17) * XXH_PRIME4;
+        p += 4;
+        left -= 4;
+    }
+    while (left-- > 0) {
+        h += *p++ * XXH_PRIME5;
+        h = RotL32(h, 11) * XXH_PRIME1;
+    }
+    h ^= h >> 15;
+    h *= XXH_PRIME2;
+    h ^= h >> 13;
+    h *= XXH_PRIME3;
+    h ^= h >> 16;
+    return h;
+}
+
+WUHBUtilsStatus WUHBUtils_HashBuffer(WUHBHashType type, const void *data, uint32_t size, uint32_t *outHash) {
+    WUHBHashState state;
+    if (!outHash || WUHBUtils_HashInit(&state, type) != WUHB_UTILS_RESULT_SUCCESS) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    WUHBUtils_HashUpdate(&state, data, size);
+    *outHash = WUHBUtils_HashFinal(&state);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Resolves empty, "." and ".." components of a path relative to the root of a bundle, so e.g. "a//b", "./a/b" and
+ * "a/c/../b" are verified against the manifest entry of "a/b". Returns false if the path leaves the root.
+ */
+static bool NormalizePath(std::string_view path, AllocatorString *outPath) {
+    outPath->clear();
+    while (!path.empty()) {
+        auto end       = path.find('/');
+        auto component = path.substr(0, end);
+        path           = end == std::string_view::npos ? std::string_view() : path.substr(end + 1);
+        if (component.empty() || component == ".") {
+            continue;
+        }
+        if (component == "..") {
+            if (outPath->empty()) {
+                return false;
+            }
+            auto slash = outPath->rfind('/');
+            outPath->erase(slash == AllocatorString::npos ? 0 : slash);
+            continue;
+        }
+        if (!outPath->empty()) {
+            *outPath += '/';
+        }
+        outPath->append(component);
+    }
+    return true;
+}
+
+static bool ParseManifest(std::string_view text, HashManifest *manifest) {
+    bool haveType = false;
+    while (!text.empty()) {
+        auto end  = text.find('\n');
+        auto line = text.substr(0, end);
+        text      = end == std::string_view::npos ? std::string_view() : text.substr(end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        if (!haveType) {
+            if (line == "crc32") {
+                manifest->type = WUHB_HASH_CRC32;
+            } else if (line == "xxh32") {
+                manifest->type = WUHB_HASH_XXH32;
+            } else {
+                return false;
+            }
+            haveType = true;
+            continue;
+        }
+        if (line.size() < 10 || line[8] != ' ') {
+            return false;
+        }
+        uint32_t hash = 0;
+        for (int i = 0; i < 8; i++) {
+            char c = line[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                digit = c - 'A' + 10;
+            } else {
+                return false;
+            }
+            hash = (hash << 4) | digit;
+        }
+        AllocatorString path;
+        if (!NormalizePath(line.substr(9), &path) || path.empty()) {
+            return false;
+        }
+        manifest->hashes[path] = hash;
+    }
+    return haveType;
+}
+
+WUHBUtilsStatus WUHBUtils_LoadHashManifest(const char *name, const char *manifestPath) {
+    if (!name) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::string path = std::string(name) + ":" + (manifestPath ? manifestPath : WUHB_HASH_MANIFEST_DEFAULT_PATH);
+    uint8_t *buffer;
+    uint32_t size;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_ReadWholeFile(path.c_str(), &buffer, &size)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    auto manifest = std::make_unique<HashManifest>();
+    bool valid    = ParseManifest(std::string_view((const char *) buffer, size), manifest.get());
+    Allocator_Free(buffer);
+    if (!valid) {
+        DEBUG_FUNCTION_LINE_WARN("Malformed hash manifest %s", path.c_str());
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    sManifests[name] = std::move(manifest);
+    sActive          = sVerify;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_SetHashVerification(bool enabled) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sVerify = enabled;
+    sActive = sVerify && !sManifests.empty();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void Hash_RemoveManifest(const char *name) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (!name) {
+        sManifests.clear();
+    } else {
+        auto it = sManifests.find(name);
+        if (it != sManifests.end()) {
+            sManifests.erase(it);
+        }
+    }
+    sActive = sVerify && !sManifests.empty();
+}
+
+bool Hash_GetExpected(const char *path, WUHBHashState *outState, uint32_t *outHash) {
+    if (!sActive || !path) {
+        return false;
+    }
+    const char *colon = strchr(path, ':');
+    if (!colon) {
+        return false;
+    }
+    std::string_view mount(path, colon - path);
+    AllocatorString relative;
+    if (!NormalizePath(colon + 1, &relative)) {
+        // The module can't open a path above the root either.
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sManifests.find(mount);
+    if (it == sManifests.end()) {
+        return false;
+    }
+    auto hashIt = it->second->hashes.find(relative);
+    if (hashIt == it->second->hashes.end()) {
+        return false;
+    }
+    WUHBUtils_HashInit(outState, it->second->type);
+    *outHash = hashIt->second;
+    return true;
+}
+
+bool Hash_Verify(const char *path, const WUHBHashState *hash, uint32_t expected) {
+    uint32_t actual = WUHBUtils_HashFinal(hash);
+    if (actual != expected) {
+        DEBUG_FUNCTION_LINE_WARN("Hash mismatch for %s: expected %08X, got %08X", path, expected, actual);
+        return false;
+    }
+    return true;
+}
+
+bool Hash_VerifyBuffer(const char *path, const uint8_t *buffer, uint32_t size) {
+    WUHBHashState hash;
+    uint32_t expected;
+    if (!Hash_GetExpected(path, &hash, &expected)) {
+        return true;
+    }
+    WUHBUtils_HashUpdate(&hash, buffer, size);
+    return Hash_Verify(path, &hash, expected);
+}
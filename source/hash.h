@@ -0,0 +1,30 @@
+#pragma once
+
+#include <wuhb_utils/hash.h>
+
+/*
+ * Hash manifests of mounted bundles, see <wuhb_utils/hash.h>.
+ */
+
+/**
+ * Returns true if verification is enabled and "path" (e.g. "bundle:/content/level1.bin") is listed in a loaded manifest.
+ * Empty, "." and ".." components of "path" are resolved before the lookup.
+ * In this case *outState is initialized for the algorithm of the manifest and the expected hash is stored in *outHash.
+ */
+bool Hash_GetExpected(const char *path, WUHBHashState *outState, uint32_t *outHash);
+
+/**
+ * Returns false (and logs a warning) if the final value of "hash", the hash of the data read from "path", doesn't
+ * match "expected".
+ */
+bool Hash_Verify(const char *path, const WUHBHashState *hash, uint32_t expected);
+
+/**
+ * Returns false (and logs a warning) if "path" is listed in a loaded manifest and the hash of "buffer" doesn't match.
+ */
+bool Hash_VerifyBuffer(const char *path, const uint8_t *buffer, uint32_t size);
+
+/**
+ * Drops the manifest of a bundle, pass NULL to drop all manifests.
+ */
+void Hash_RemoveManifest(const char *name);
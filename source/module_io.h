@@ -0,0 +1,22 @@
+#pragma once
+
+#include <wuhb_utils/utils.h>
+
+/*
+ * File functions of the module for the layers that read on behalf of the application: the compressed data behind a
+ * <wuhb_utils/gz_index.h> index and the prefetch thread. Unlike the WUHBUtils_File* wrappers they don't count
+ * statistics, don't record trace events and don't go through the staging area or an index, so every read of the
+ * application is counted once, by the wrapper it called.
+ */
+
+WUHBUtilsStatus ModuleIO_FileOpen(const char *name, WUHBFileHandle *outHandle);
+WUHBUtilsStatus ModuleIO_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes);
+
+/**
+ * If the module can't read at a position, but can seek, the read seeks to "offset" first and leaves the read position
+ * behind the data. Returns WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND if the module can do neither.
+ */
+WUHBUtilsStatus ModuleIO_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes);
+
+WUHBUtilsStatus ModuleIO_FileGetSize(WUHBFileHandle handle, uint32_t *outSize);
+WUHBUtilsStatus ModuleIO_FileClose(WUHBFileHandle handle);
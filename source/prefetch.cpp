@@ -0,0 +1,625 @@
+#include "prefetch.h"
+#include "allocator.h"
+#include "logger.h"
+#include "module_io.h"
+#include "stats.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <wuhb_utils/prefetch.h>
+
+/*
+ * A single background thread loads the queued files via ModuleIO_FileOpen/FileRead, this way ".gz" files are
+ * inflated by the module while loading. Loading is not counted in the statistics, reading a staged file is. The size of a file is reserved from the budget before its buffer is allocated.
+ * Staged files are handed over to the caller without copying (WUHBUtils_ReadWholeFile, memory files), once handed
+ * over they don't count towards the budget anymore.
+ * Memory files live in a fixed table of slots, the low bits of a handle select its slot, so calls on memory files
+ * don't take a lock.
+ * The thread also runs deferred tasks (Prefetch_QueueDeferred), those go before queued files because they only
+ * decide which files to queue.
+ */
+
+#define PREFETCH_CHUNK_SIZE (1024 * 1024)
+#define PREFETCH_MAX_FILES  256 // memory files that can be open at the same time, a power of two
+
+enum PrefetchState {
+    PREFETCH_STATE_QUEUED,
+    PREFETCH_STATE_LOADING,
+    PREFETCH_STATE_READY,
+};
+
+struct PrefetchEntry {
+    std::string path;
+    int32_t priority;
+    uint64_t sequence;
+    PrefetchState state;
+    std::atomic<bool> cancelled; // removed from sEntries, the worker deletes the entry
+    uint8_t *buffer;
+    uint32_t size;
+};
+
+struct PrefetchTask {
+    std::string pathPrefix;
+    std::function<std::vector<std::string>()> resolve;
+    int32_t priority;
+    bool cancelled; // only set while the task runs
+};
+
+/**
+ * A slot is claimed by setting "handle" and released by resetting it to 0. The other members are only accessed via
+ * the handle, whose calls are serialized by the caller.
+ */
+struct MemoryFile {
+    std::atomic<WUHBFileHandle> handle;
+    uint8_t *buffer;
+    uint32_t size;
+    uint32_t pos;
+};
+
+static std::mutex sMutex;
+static std::condition_variable sQueueCV;
+static std::condition_variable sLoadedCV;
+static std::unordered_map<std::string, PrefetchEntry *> sEntries; // queued, loading and staged files
+static std::vector<PrefetchEntry *> sQueue;                        // heap, see CompareEntries
+static std::atomic<uint32_t> sNumEntries(0);                       // size of sEntries, checked without holding sMutex
+static std::deque<PrefetchTask *> sTasks;                          // see Prefetch_QueueDeferred
+static PrefetchTask *sRunningTask = nullptr;
+static std::thread sWorker;
+static bool sStopping           = false;
+static uint64_t sNextSequence   = 0;
+static uint32_t sBudget         = WUHB_PREFETCH_DEFAULT_BUDGET;
+static uint32_t sReservedBytes  = 0; // staged files and the file that is currently loaded
+static WUHBPrefetchStats sStats = {};
+
+static MemoryFile sFiles[PREFETCH_MAX_FILES];
+static std::atomic<uint32_t> sNextHandle(0);
+
+/**
+ * Orders the heap: highest priority first, same priority in submission order.
+ */
+static bool CompareEntries(const PrefetchEntry *a, const PrefetchEntry *b) {
+    if (a->priority != b->priority) {
+        return a->priority < b->priority;
+    }
+    return a->sequence > b->sequence;
+}
+
+/**
+ * Removes an entry from sEntries. Queued and loading entries are deleted by the worker. Must be called with sMutex held.
+ */
+static void RemoveEntry(PrefetchEntry *entry) {
+    sEntries.erase(entry->path);
+    sNumEntries = sEntries.size();
+    if (entry->state == PREFETCH_STATE_READY) {
+        sReservedBytes -= entry->size;
+        delete entry;
+    } else {
+        entry->cancelled = true;
+    }
+}
+
+static WUHBUtilsStatus LoadFile(PrefetchEntry *entry, uint8_t **outBuf, uint32_t *outSize) {
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = ModuleIO_FileOpen(entry->path.c_str(), &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    uint32_t size = 0;
+    if ((res = ModuleIO_FileGetSize(handle, &size)) != WUHB_UTILS_RESULT_SUCCESS) {
+        // Without a known size the budget can't be checked upfront.
+        ModuleIO_FileClose(handle);
+        return res;
+    }
+    bool fits;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        fits = (uint64_t) sReservedBytes + size <= sBudget;
+        if (fits) {
+            sReservedBytes += size;
+        }
+    }
+    if (!fits) {
+        ModuleIO_FileClose(handle);
+        return WUHB_UTILS_RESULT_BUFFER_TOO_SMALL;
+    }
+
+    auto *buffer = (uint8_t *) Allocator_Alloc(size, 0x40);
+    if (!buffer) {
+        res = WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    uint32_t total = 0;
+    while (buffer && total < size && !entry->cancelled) {
+        int32_t readRes = -1;
+        res             = ModuleIO_FileRead(handle, buffer + total, std::min<uint32_t>(size - total, PREFETCH_CHUNK_SIZE), &readRes);
+        if (res == WUHB_UTILS_RESULT_SUCCESS && readRes <= 0) {
+            res = WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            break;
+        }
+        total += readRes;
+    }
+    ModuleIO_FileClose(handle);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        Allocator_Free(buffer);
+        std::lock_guard<std::mutex> lock(sMutex);
+        sReservedBytes -= size;
+        return res;
+    }
+    *outBuf  = buffer;
+    *outSize = size;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Adds "path" to the queue unless it's already known. Must be called with sMutex held.
+ */
+static WUHBUtilsStatus QueueFileLocked(const char *path, int32_t priority) {
+    if (sEntries.count(path) > 0) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    auto *entry = new (std::nothrow) PrefetchEntry();
+    if (!entry) {
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    entry->path           = path;
+    entry->priority       = priority;
+    entry->sequence       = sNextSequence++;
+    entry->state          = PREFETCH_STATE_QUEUED;
+    entry->cancelled      = false;
+    entry->buffer         = nullptr;
+    entry->size           = 0;
+    sEntries[entry->path] = entry;
+    sQueue.push_back(entry);
+    std::push_heap(sQueue.begin(), sQueue.end(), CompareEntries);
+    sStats.requested++;
+    sNumEntries = sEntries.size();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Runs the next task of sTasks. Must be called with "lock" held.
+ */
+static void RunTask(std::unique_lock<std::mutex> &lock) {
+    auto *task = sTasks.front();
+    sTasks.pop_front();
+    sRunningTask = task;
+    lock.unlock();
+    auto paths = task->resolve();
+    lock.lock();
+    sRunningTask = nullptr;
+    if (!task->cancelled) {
+        for (auto &path : paths) {
+            if (QueueFileLocked(path.c_str(), task->priority) != WUHB_UTILS_RESULT_SUCCESS) {
+                break;
+            }
+        }
+    }
+    delete task;
+}
+
+static void WorkerMain() {
+    // Loading prefetched files is not an access of the application, using them is.
+    Trace_IgnoreCurrentThread();
+    std::unique_lock<std::mutex> lock(sMutex);
+    while (true) {
+        sQueueCV.wait(lock, [] { return sStopping || !sQueue.empty() || !sTasks.empty(); });
+        if (sStopping) {
+            return;
+        }
+        if (!sTasks.empty()) {
+            RunTask(lock);
+            continue;
+        }
+        std::pop_heap(sQueue.begin(), sQueue.end(), CompareEntries);
+        auto *entry = sQueue.back();
+        sQueue.pop_back();
+        if (entry->cancelled) {
+            delete entry;
+            continue;
+        }
+
+        entry->state = PREFETCH_STATE_LOADING;
+        lock.unlock();
+        uint8_t *buffer = nullptr;
+        uint32_t size   = 0;
+        auto res        = LoadFile(entry, &buffer, &size);
+        lock.lock();
+
+        if (entry->cancelled) {
+            sStats.wasted++;
+            if (res == WUHB_UTILS_RESULT_SUCCESS) {
+                Allocator_Free(buffer);
+                sReservedBytes -= size;
+            }
+            delete entry;
+        } else if (res == WUHB_UTILS_RESULT_SUCCESS) {
+            entry->state  = PREFETCH_STATE_READY;
+            entry->buffer = buffer;
+            entry->size   = size;
+        } else {
+            if (res == WUHB_UTILS_RESULT_BUFFER_TOO_SMALL) {
+                sStats.dropped++;
+            } else {
+                DEBUG_FUNCTION_LINE_WARN("Failed to prefetch %s: %s", entry->path.c_str(), WUHBUtils_GetStatusStr(res));
+                sStats.failed++;
+            }
+            sEntries.erase(entry->path);
+            sNumEntries = sEntries.size();
+            delete entry;
+        }
+        sLoadedCV.notify_all();
+    }
+}
+
+/**
+ * Must be called with sMutex held.
+ */
+static WUHBUtilsStatus StartWorkerLocked() {
+    if (sWorker.joinable()) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    try {
+        sWorker = std::thread(WorkerMain);
+    } catch (const std::system_error &) {
+        DEBUG_FUNCTION_LINE_ERR("Failed to create prefetch thread");
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Returns the staged entry of "path", waits if it's currently loaded. Must be called with "lock" held.
+ */
+static PrefetchEntry *GetStagedEntry(std::unique_lock<std::mutex> &lock, const char *path) {
+    auto it = sEntries.find(path);
+    if (it == sEntries.end()) {
+        return nullptr;
+    }
+    auto *entry = it->second;
+    if (entry->state == PREFETCH_STATE_QUEUED) {
+        // Reading the file directly is faster than waiting for the queue.
+        sStats.late++;
+        RemoveEntry(entry);
+        return nullptr;
+    }
+    if (entry->state == PREFETCH_STATE_LOADING) {
+        if (std::this_thread::get_id() == sWorker.get_id()) {
+            // The worker itself is opening the file.
+            return nullptr;
+        }
+        uint64_t sequence = entry->sequence;
+        sLoadedCV.wait(lock, [&] {
+            auto cur = sEntries.find(path);
+            return cur == sEntries.end() || cur->second->sequence != sequence || cur->second->state == PREFETCH_STATE_READY;
+        });
+        it = sEntries.find(path);
+        if (it == sEntries.end() || it->second->sequence != sequence) {
+            return nullptr;
+        }
+        entry = it->second;
+    }
+    return entry;
+}
+
+bool Prefetch_TakeFile(const char *path, uint8_t **outBuf, uint32_t *outSize) {
+    if (sNumEntries == 0 || !path) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(sMutex);
+    auto *entry = GetStagedEntry(lock, path);
+    if (!entry) {
+        return false;
+    }
+    *outBuf  = entry->buffer;
+    *outSize = entry->size;
+    sStats.used++;
+    RemoveEntry(entry);
+    return true;
+}
+
+bool Prefetch_ReadFileInto(const char *path, uint8_t *buffer, uint32_t capacity, uint32_t *outSize, WUHBUtilsStatus *outRes) {
+    if (sNumEntries == 0 || !path) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(sMutex);
+    auto *entry = GetStagedEntry(lock, path);
+    if (!entry) {
+        return false;
+    }
+    *outSize = entry->size;
+    if (entry->size > capacity) {
+        *outRes = WUHB_UTILS_RESULT_BUFFER_TOO_SMALL;
+        return true;
+    }
+    memcpy(buffer, entry->buffer, entry->size);
+    Allocator_Free(entry->buffer);
+    *outRes = WUHB_UTILS_RESULT_SUCCESS;
+    sStats.used++;
+    RemoveEntry(entry);
+    return true;
+}
+
+bool Prefetch_OpenFile(const char *path, WUHBFileHandle *outHandle) {
+    if (sNumEntries == 0 || !outHandle) {
+        return false;
+    }
+    // The upper bits make handles of a reused slot differ.
+    WUHBFileHandle handle = PREFETCH_HANDLE_FLAG | ((sNextHandle.fetch_add(1) * PREFETCH_MAX_FILES) & ~PREFETCH_HANDLE_FLAG);
+    MemoryFile *file      = nullptr;
+    for (uint32_t i = 0; i < PREFETCH_MAX_FILES; i++) {
+        WUHBFileHandle expected = 0;
+        if (sFiles[i].handle.compare_exchange_strong(expected, handle | i)) {
+            file = &sFiles[i];
+            break;
+        }
+    }
+    if (!file) {
+        // The module serves the file, the staged copy stays for WUHBUtils_ReadWholeFile.
+        return false;
+    }
+    if (!Prefetch_TakeFile(path, &file->buffer, &file->size)) {
+        file->handle.store(0);
+        return false;
+    }
+    file->pos  = 0;
+    *outHandle = file->handle.load(std::memory_order_relaxed);
+    // Staged ".gz" files have been inflated already, reading them counts as plain.
+    STATS_FILE_OPENED(*outHandle, false);
+    return true;
+}
+
+static MemoryFile *FindFile(WUHBFileHandle handle) {
+    auto *file = &sFiles[handle % PREFETCH_MAX_FILES];
+    return file->handle.load(std::memory_order_acquire) == handle ? file : nullptr;
+}
+
+WUHBUtilsStatus Prefetch_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (!buffer || !outRes) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *file = FindFile(handle);
+    if (!file) {
+        return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+    }
+    uint32_t toRead = file->pos < file->size ? std::min(size, file->size - file->pos) : 0;
+    if (toRead > 0) {
+        memcpy(buffer, file->buffer + file->pos, toRead);
+        file->pos += toRead;
+    }
+    STATS_BYTES_READ(handle, toRead);
+    Trace_FileRead(handle, toRead);
+    *outRes = (int32_t) toRead;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus Prefetch_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (!buffer || !outRes) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *file = FindFile(handle);
+    if (!file) {
+        return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+    }
+    uint32_t toRead = offset < file->size ? std::min(size, file->size - offset) : 0;
+    if (toRead > 0) {
+        memcpy(buffer, file->buffer + offset, toRead);
+    }
+    STATS_BYTES_READ(handle, toRead);
+    Trace_FileReadAt(handle, offset, toRead);
+    *outRes = (int32_t) toRead;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus Prefetch_FileGetSize(WUHBFileHandle handle, uint32_t *outSize) {
+    if (!outSize) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *file = FindFile(handle);
+    if (!file) {
+        return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+    }
+    *outSize = file->size;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus Prefetch_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+    }
+    int64_t base;
+    switch (origin) {
+        case WUHB_SEEK_SET:
+            base = 0;
+            break;
+        case WUHB_SEEK_CUR:
+            base = file->pos;
+            break;
+        case WUHB_SEEK_END:
+            base = file->size;
+            break;
+        default:
+            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    if (base + offset < 0 || base + offset > UINT32_MAX) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    file->pos = base + offset;
+    Trace_FileSeek(handle, file->pos);
+    if (outPos) {
+        *outPos = file->pos;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus Prefetch_FileTell(WUHBFileHandle handle, uint32_t *outPos) {
+    if (!outPos) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto *file = FindFile(handle);
+    if (!file) {
+        return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+    }
+    *outPos = file->pos;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus Prefetch_FileClose(WUHBFileHandle handle) {
+    auto *file = FindFile(handle);
+    if (!file) {
+        return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+    }
+    Allocator_Free(file->buffer);
+    file->buffer = nullptr;
+    file->handle.store(0, std::memory_order_release);
+    STATS_FILE_CLOSED(handle);
+    Trace_FileClosed(handle);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+void Prefetch_DeInit() {
+    WUHBUtils_PrefetchCancel(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sStopping = true;
+    }
+    sQueueCV.notify_all();
+    if (sWorker.joinable()) {
+        sWorker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        // Only cancelled entries are left.
+        for (auto *entry : sQueue) {
+            delete entry;
+        }
+        sQueue.clear();
+        for (auto *task : sTasks) {
+            delete task;
+        }
+        sTasks.clear();
+        sStopping = false;
+    }
+    for (auto &file : sFiles) {
+        if (file.handle.load() != 0) {
+            Allocator_Free(file.buffer);
+            file.buffer = nullptr;
+            file.handle.store(0);
+        }
+    }
+}
+
+WUHBUtilsStatus WUHBUtils_Prefetch(const char **paths, uint32_t count, int32_t priority) {
+    if (!paths) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    WUHBUtilsStatus res;
+    if ((res = StartWorkerLocked()) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (paths[i] && (res = QueueFileLocked(paths[i], priority)) != WUHB_UTILS_RESULT_SUCCESS) {
+            break;
+        }
+    }
+    sQueueCV.notify_one();
+    return res;
+}
+
+WUHBUtilsStatus Prefetch_QueueDeferred(const std::string &pathPrefix, std::function<std::vector<std::string>()> resolve, int32_t priority) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    WUHBUtilsStatus res;
+    if ((res = StartWorkerLocked()) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    auto *task = new (std::nothrow) PrefetchTask();
+    if (!task) {
+        return WUHB_UTILS_RESULT_NO_MEMORY;
+    }
+    task->pathPrefix = pathPrefix;
+    task->resolve    = std::move(resolve);
+    task->priority   = priority;
+    task->cancelled  = false;
+    sTasks.push_back(task);
+    sQueueCV.notify_one();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_PrefetchCancel(const char *pathPrefix) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto matches = [pathPrefix](const std::string &path) { return !pathPrefix || path.rfind(pathPrefix, 0) == 0; };
+    for (auto it = sTasks.begin(); it != sTasks.end();) {
+        if (matches((*it)->pathPrefix)) {
+            delete *it;
+            it = sTasks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (sRunningTask && matches(sRunningTask->pathPrefix)) {
+        sRunningTask->cancelled = true;
+    }
+    std::vector<PrefetchEntry *> toRemove;
+    for (auto &it : sEntries) {
+        if (matches(it.first)) {
+            toRemove.push_back(it.second);
+        }
+    }
+    for (auto *entry : toRemove) {
+        if (entry->state == PREFETCH_STATE_QUEUED) {
+            sStats.cancelled++;
+        } else if (entry->state == PREFETCH_STATE_READY) {
+            sStats.wasted++;
+            Allocator_Free(entry->buffer);
+        }
+        // Loading entries are counted by the worker.
+        RemoveEntry(entry);
+    }
+    sLoadedCV.notify_all();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_PrefetchSetBudget(uint32_t budget) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sBudget = budget;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_PrefetchGetStats(WUHBPrefetchStats *outStats) {
+    if (!outStats) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    *outStats             = sStats;
+    outStats->queued      = 0;
+    outStats->stagedFiles = 0;
+    for (auto &it : sEntries) {
+        if (it.second->state == PREFETCH_STATE_QUEUED) {
+            outStats->queued++;
+        } else if (it.second->state == PREFETCH_STATE_READY) {
+            outStats->stagedFiles++;
+        }
+    }
+    outStats->stagedBytes = sReservedBytes;
+    outStats->budget      = sBudget;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_PrefetchResetStats() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sStats = {};
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <wuhb_utils/utils.h>
+
+/*
+ * Staging area of <wuhb_utils/prefetch.h>, used by the file functions in utils.cpp.
+ */
+
+/**
+ * Handles of files opened from the staging area have this bit set, that's the only way they are told apart from
+ * handles of the module. The module's handles are addresses inside its heap (counters on the host), which never have
+ * this bit set. WUHBUtils_FileOpen checks this: a module handle with the bit set is closed again and the open fails
+ * with WUHB_UTILS_RESULT_UNKNOWN_ERROR instead of being routed to the staging area.
+ */
+#define PREFETCH_HANDLE_FLAG 0x80000000
+
+static inline bool Prefetch_IsMemoryHandle(WUHBFileHandle handle) {
+    return (handle & PREFETCH_HANDLE_FLAG) != 0;
+}
+
+/**
+ * If "path" is staged, hands over its buffer (allocated via Allocator_Alloc) and returns true.
+ */
+bool Prefetch_TakeFile(const char *path, uint8_t **outBuf, uint32_t *outSize);
+
+/**
+ * If "path" is staged, copies it into "buffer" (or reports WUHB_UTILS_RESULT_BUFFER_TOO_SMALL via *outRes) and returns true.
+ */
+bool Prefetch_ReadFileInto(const char *path, uint8_t *buffer, uint32_t capacity, uint32_t *outSize, WUHBUtilsStatus *outRes);
+
+/**
+ * If "path" is staged, opens it as memory file and returns true.<br>
+ * Returns false without taking the file if PREFETCH_MAX_FILES memory files are open.
+ */
+bool Prefetch_OpenFile(const char *path, WUHBFileHandle *outHandle);
+
+WUHBUtilsStatus Prefetch_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes);
+WUHBUtilsStatus Prefetch_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes);
+WUHBUtilsStatus Prefetch_FileGetSize(WUHBFileHandle handle, uint32_t *outSize);
+WUHBUtilsStatus Prefetch_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos);
+WUHBUtilsStatus Prefetch_FileTell(WUHBFileHandle handle, uint32_t *outPos);
+WUHBUtilsStatus Prefetch_FileClose(WUHBFileHandle handle);
+
+/**
+ * Calls "resolve" on the background thread, before any queued file is loaded, and queues the paths it returns like
+ * WUHBUtils_Prefetch with "priority". All paths must start with "pathPrefix", a WUHBUtils_PrefetchCancel matching
+ * "pathPrefix" drops the paths even if it happens while "resolve" runs.
+ */
+WUHBUtilsStatus Prefetch_QueueDeferred(const std::string &pathPrefix, std::function<std::vector<std::string>()> resolve, int32_t priority);
+
+/**
+ * Discards everything, stops the background thread and closes all memory files.
+ */
+void Prefetch_DeInit();
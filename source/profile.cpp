@@ -0,0 +1,254 @@
+#include "logger.h"
+#include "prefetch.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <wuhb_utils/async.h>
+#include <wuhb_utils/prefetch.h>
+
+/*
+ * Building a profile only looks at which byte ranges of a file have been read and when the file has been opened
+ * first, the order of reads inside a file doesn't matter because the staging area always holds whole files.
+ * Files are added in the order of their first access as long as they fit into the budget, a file that doesn't fit is
+ * skipped so later, smaller files can still use the rest of it.
+ * Replaying resolves the position of every file inside the bundle via WUHBUtils_GetFileInfo, so the prefetch thread
+ * reads the bundle front to back instead of seeking back and forth in the order the application opens the files.
+ * Reading the profile and resolving the positions happens on the prefetch thread, not during WUHBUtils_MountBundle.
+ */
+
+#define PROFILE_MAX_FILE_SIZE (4 * 1024 * 1024)
+
+struct ProfileFile {
+    std::vector<uint32_t> firstUs; // first access per trace
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    uint32_t size      = 0;
+    uint32_t lastTrace = UINT32_MAX; // the same file may be accessed via different mount names
+};
+
+static std::mutex sMutex;
+static std::map<std::string, std::string, std::less<>> sProfiles; // mount name -> profile path
+
+/**
+ * "bundle:/content/level1.bin" -> "/content/level1.bin"
+ */
+static std::string_view StripMountName(std::string_view path) {
+    auto pos = path.find(':');
+    return pos != std::string_view::npos ? path.substr(pos + 1) : path;
+}
+
+/**
+ * Number of bytes covered by "ranges" (begin, end), overlapping ranges are counted once.
+ */
+static uint64_t CoveredBytes(std::vector<std::pair<uint32_t, uint32_t>> &ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    uint64_t covered = 0;
+    uint32_t end     = 0;
+    for (auto &[rangeBegin, rangeEnd] : ranges) {
+        if (rangeEnd <= end) {
+            continue;
+        }
+        covered += rangeEnd - std::max(rangeBegin, end);
+        end = rangeEnd;
+    }
+    return covered;
+}
+
+static void AddTrace(uint32_t traceIndex, const TraceData &trace, std::unordered_map<std::string, ProfileFile> &files) {
+    std::vector<ProfileFile *> byIndex(trace.paths.size(), nullptr);
+    for (auto &event : trace.events) {
+        auto *&file = byIndex[event.path];
+        if (!file) {
+            file = &files[std::string(StripMountName(trace.paths[event.path]))];
+            if (file->lastTrace != traceIndex) {
+                file->lastTrace = traceIndex;
+                file->firstUs.push_back(event.timeUs);
+            }
+        }
+        if (event.type == TRACE_EVENT_OPEN) {
+            file->size = std::max(file->size, event.size);
+        } else if (event.type == TRACE_EVENT_READ && event.size > 0) {
+            uint32_t end = event.offset + event.size < event.offset ? UINT32_MAX : event.offset + event.size;
+            file->ranges.emplace_back(event.offset, end);
+        }
+    }
+}
+
+WUHBUtilsStatus WUHBUtils_BuildProfile(const char **tracePaths, uint32_t count, uint32_t budget, const char *profilePath) {
+    if (!tracePaths || count == 0 || !profilePath) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    if (budget == 0) {
+        budget = WUHB_PREFETCH_DEFAULT_BUDGET;
+    }
+    std::unordered_map<std::string, ProfileFile> files;
+    for (uint32_t i = 0; i < count; i++) {
+        TraceData trace;
+        if (!tracePaths[i] || !Trace_Load(tracePaths[i], &trace)) {
+            DEBUG_FUNCTION_LINE_WARN("Failed to load trace %s", tracePaths[i] ? tracePaths[i] : "(null)");
+            return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+        }
+        if (trace.dropped > 0) {
+            DEBUG_FUNCTION_LINE_WARN("Trace %s is incomplete, %u events have been dropped", tracePaths[i], trace.dropped);
+        }
+        AddTrace(i, trace, files);
+    }
+
+    struct Candidate {
+        const std::string *path;
+        uint32_t size;
+        uint32_t medianUs;
+    };
+    std::vector<Candidate> candidates;
+    for (auto &[path, file] : files) {
+        if (file.firstUs.size() * 2 < count) {
+            continue;
+        }
+        uint64_t covered = std::min<uint64_t>(CoveredBytes(file.ranges), file.size);
+        if (covered * 100 < (uint64_t) file.size * WUHB_PROFILE_MIN_COVERAGE) {
+            continue;
+        }
+        std::sort(file.firstUs.begin(), file.firstUs.end());
+        candidates.push_back({&path, file.size, file.firstUs[file.firstUs.size() / 2]});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.medianUs != b.medianUs ? a.medianUs < b.medianUs : *a.path < *b.path;
+    });
+
+    FILE *f = fopen(profilePath, "w");
+    if (!f) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to create %s", profilePath);
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    fprintf(f, "# WUHBUtils prefetch profile, built from %u trace(s)\n# <size> <path>\n", count);
+    uint64_t total = 0;
+    for (auto &candidate : candidates) {
+        if (total + candidate.size > budget) {
+            continue;
+        }
+        total += candidate.size;
+        fprintf(f, "%u %s\n", candidate.size, candidate.path->c_str());
+    }
+    if (fclose(f) != 0) {
+        remove(profilePath);
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Returns the paths of a profile, relative to the mount.
+ */
+static bool LoadProfile(const char *path, std::vector<std::string> *outPaths) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    std::string data;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && size <= PROFILE_MAX_FILE_SIZE && fseek(f, 0, SEEK_SET) == 0) {
+        data.resize(size);
+        if (fread(data.data(), 1, data.size(), f) != data.size()) {
+            size = -1;
+        }
+    }
+    fclose(f);
+    if (size < 0) {
+        return false;
+    }
+
+    std::string_view rest = data;
+    while (!rest.empty()) {
+        auto end  = rest.find('\n');
+        auto line = rest.substr(0, end);
+        rest      = end != std::string_view::npos ? rest.substr(end + 1) : std::string_view();
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        auto space = line.find(' ');
+        if (line.empty() || line[0] == '#' || space == std::string_view::npos || space + 1 == line.size()) {
+            continue;
+        }
+        outPaths->emplace_back(line.substr(space + 1));
+    }
+    return true;
+}
+
+/**
+ * Returns the paths of the profile with the mount name prepended, ordered by their position inside the bundle.
+ * Runs on the prefetch thread.
+ */
+static std::vector<std::string> ResolveProfile(const std::string &name, const std::string &profilePath) {
+    std::vector<std::string> paths;
+    if (!LoadProfile(profilePath.c_str(), &paths)) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to load profile %s", profilePath.c_str());
+        return {};
+    }
+
+    struct ReplayFile {
+        std::string path;
+        uint64_t offset;
+    };
+    std::vector<ReplayFile> files;
+    for (auto &path : paths) {
+        auto fullPath = name + ":" + path;
+        uint64_t offset, length;
+        bool compressed;
+        auto res = WUHBUtils_GetFileInfo(fullPath.c_str(), &offset, &length, &compressed);
+        if (res != WUHB_UTILS_RESULT_SUCCESS && res != WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND) {
+            // Not part of the bundle (anymore), or the bundle has been unmounted in the meantime.
+            continue;
+        }
+        // Without WUU_GetFileInfo the files are loaded in the order of the profile.
+        files.push_back({std::move(fullPath), res == WUHB_UTILS_RESULT_SUCCESS ? offset : UINT64_MAX});
+    }
+    std::stable_sort(files.begin(), files.end(), [](const ReplayFile &a, const ReplayFile &b) { return a.offset < b.offset; });
+
+    std::vector<std::string> replayPaths;
+    replayPaths.reserve(files.size());
+    for (auto &file : files) {
+        replayPaths.push_back(std::move(file.path));
+    }
+    return replayPaths;
+}
+
+void Profile_OnMount(const char *name) {
+    std::string profilePath;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        auto it = sProfiles.find(name);
+        if (it == sProfiles.end()) {
+            return;
+        }
+        profilePath = it->second;
+    }
+    // Unmounting cancels the files of "name:" and with them the pending replay.
+    std::string mountName = name;
+    auto res              = Prefetch_QueueDeferred(mountName + ":", [mountName, profilePath] { return ResolveProfile(mountName, profilePath); }, WUHB_ASYNC_PRIORITY_LOW);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to replay profile %s: %s", profilePath.c_str(), WUHBUtils_GetStatusStr(res));
+    }
+}
+
+void Profile_DeInit() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sProfiles.clear();
+}
+
+WUHBUtilsStatus WUHBUtils_SetMountProfile(const char *name, const char *profilePath) {
+    if (!name) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    if (profilePath) {
+        sProfiles[name] = profilePath;
+    } else {
+        sProfiles.erase(std::string(name));
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
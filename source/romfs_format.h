@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * On-disk layout of the RomFS image inside a .wuhb file, used by the code that reads bundle files directly.
+ */
+
+#define ROMFS_HEADER_MAGIC         0x57554842 // WUHB
+#define ROMFS_HEADER_SIZE          0x50
+#define ROMFS_HEADER_DIR_TABLE     0x18 // offset + size of the directory table
+#define ROMFS_HEADER_FILE_TABLE    0x38 // offset + size of the file table
+#define ROMFS_HEADER_DATA_OFFSET   0x48
+#define ROMFS_DIR_ENTRY_SIZE       0x18
+#define ROMFS_DIR_ENTRY_CHILD_DIR  0x08
+#define ROMFS_DIR_ENTRY_CHILD_FILE 0x0C
+#define ROMFS_FILE_ENTRY_SIZE      0x20
+#define ROMFS_ENTRY_SIBLING        0x04 // same offset in directory and file entries
+#define ROMFS_FILE_ENTRY_OFFSET    0x08
+#define ROMFS_FILE_ENTRY_LENGTH    0x10
+#define ROMFS_NONE                 0xFFFFFFFF
+
+static inline uint32_t RomFS_ReadBE32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static inline uint64_t RomFS_ReadBE64(const uint8_t *p) {
+    return ((uint64_t) RomFS_ReadBE32(p) << 32) | RomFS_ReadBE32(p + 4);
+}
@@ -0,0 +1,510 @@
+#include "allocator.h"
+#include "logger.h"
+#include "romfs_format.h"
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <strings.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <wuhb_utils/scan.h>
+
+/*
+ * The RPX info of a bundle only depends on three places of the bundle file: the RomFS header, the directory table
+ * (to find "/code/") and the file entries of "/code/". Those are read with plain stdio instead of mounting the bundle.
+ * Results are cached per path together with the size and modification time of the bundle file. The cache file is
+ * written in native byte order, it's only meant to be read by the same device.
+ * WUHBUtils_ReadBundleFiles uses the same code to look up files by path without building a full index.
+ */
+
+#define SCAN_CACHE_MAGIC         0x57534332 // WSC2, caches of version 1 may contain results of failed reads
+#define SCAN_MAX_DIR_TABLE_SIZE  (1024 * 1024)
+#define SCAN_MAX_NAME_LENGTH     0x300
+#define SCAN_MAX_CACHE_FILE_SIZE (16 * 1024 * 1024)
+
+struct ScanCacheEntry {
+    uint64_t size;
+    uint64_t mtime;
+    WUHBUtilsStatus status;
+    WUHBRPXInfo rpxInfo;
+};
+
+struct ScanJob {
+    std::string path;       // as reported to the callback
+    std::string nativePath; // as passed to fopen
+    uint64_t size;
+    uint64_t mtime;
+    WUHBUtilsStatus status;
+    WUHBRPXInfo rpxInfo;
+    bool cached;
+    bool cacheable; // false if the bundle couldn't be opened or read (e.g. I/O error), the result is not cached
+};
+
+static std::mutex sMutex;
+static std::map<std::string, ScanCacheEntry> sCache;
+static std::string sCachePath;
+
+static bool ReadAt(FILE *f, uint64_t offset, void *buffer, size_t size) {
+    if (offset > LONG_MAX || fseek(f, (long) offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(buffer, 1, size, f) == size;
+}
+
+static std::string GetNativePath(const char *path, BundleSource source) {
+    std::string result = path;
+    if (source == BundleSource_FileDescriptor_CafeOS && result.rfind("fs:", 0) != 0) {
+        result = "fs:" + result;
+    }
+    return result;
+}
+
+static bool IsBundleName(std::string_view name) {
+    if (name.size() <= 5) {
+        return false;
+    }
+    auto ext = name.substr(name.size() - 5);
+    return strncasecmp(ext.data(), ".wuhb", 5) == 0;
+}
+
+struct BundleTables {
+    FILE *f;
+    uint64_t fileTableOffset;
+    uint64_t fileTableSize;
+    uint64_t dataOffset;
+    std::vector<uint8_t> dirTable;
+};
+
+/**
+ * Reads the RomFS header and the directory table. File entries are read on demand, usually only a few of them are needed.
+ * Returns WUHB_UTILS_RESULT_READ_FAILED if reading failed and WUHB_UTILS_RESULT_MOUNT_FAILED if the file is not a valid bundle.
+ */
+static WUHBUtilsStatus LoadBundleTables(FILE *f, BundleTables *outTables) {
+    uint8_t header[ROMFS_HEADER_SIZE];
+    if (!ReadAt(f, 0, header, sizeof(header))) {
+        return WUHB_UTILS_RESULT_READ_FAILED;
+    }
+    if (RomFS_ReadBE32(header) != ROMFS_HEADER_MAGIC || RomFS_ReadBE32(header + 4) != ROMFS_HEADER_SIZE) {
+        return WUHB_UTILS_RESULT_MOUNT_FAILED;
+    }
+    uint64_t dirTableOffset    = RomFS_ReadBE64(header + ROMFS_HEADER_DIR_TABLE);
+    uint64_t dirTableSize      = RomFS_ReadBE64(header + ROMFS_HEADER_DIR_TABLE + 8);
+    outTables->f               = f;
+    outTables->fileTableOffset = RomFS_ReadBE64(header + ROMFS_HEADER_FILE_TABLE);
+    outTables->fileTableSize   = RomFS_ReadBE64(header + ROMFS_HEADER_FILE_TABLE + 8);
+    outTables->dataOffset      = RomFS_ReadBE64(header + ROMFS_HEADER_DATA_OFFSET);
+    if (dirTableSize < ROMFS_DIR_ENTRY_SIZE || dirTableSize > SCAN_MAX_DIR_TABLE_SIZE) {
+        return WUHB_UTILS_RESULT_MOUNT_FAILED;
+    }
+    outTables->dirTable.resize(dirTableSize);
+    return ReadAt(f, dirTableOffset, outTables->dirTable.data(), dirTableSize) ? WUHB_UTILS_RESULT_SUCCESS : WUHB_UTILS_RESULT_READ_FAILED;
+}
+
+/**
+ * Looks up a sub directory of "dir" (0 is the root), *outDir is set to ROMFS_NONE if it doesn't exist.
+ * Returns false if the directory table is broken.
+ */
+static bool FindChildDir(const BundleTables &tables, uint32_t dir, std::string_view name, uint32_t *outDir) {
+    const auto &dirTable = tables.dirTable;
+    *outDir              = ROMFS_NONE;
+    if ((uint64_t) dir + ROMFS_DIR_ENTRY_SIZE > dirTable.size()) {
+        return false;
+    }
+    // The loop guards protect against cycles in broken images.
+    uint32_t cur      = RomFS_ReadBE32(dirTable.data() + dir + ROMFS_DIR_ENTRY_CHILD_DIR);
+    uint64_t maxSteps = dirTable.size() / ROMFS_DIR_ENTRY_SIZE;
+    while (cur != ROMFS_NONE && maxSteps-- > 0) {
+        if ((uint64_t) cur + ROMFS_DIR_ENTRY_SIZE > dirTable.size()) {
+            return false;
+        }
+        uint32_t nameLen = RomFS_ReadBE32(dirTable.data() + cur + ROMFS_DIR_ENTRY_SIZE - 4);
+        if ((uint64_t) cur + ROMFS_DIR_ENTRY_SIZE + nameLen > dirTable.size()) {
+            return false;
+        }
+        if (std::string_view((const char *) dirTable.data() + cur + ROMFS_DIR_ENTRY_SIZE, nameLen) == name) {
+            *outDir = cur;
+            return true;
+        }
+        cur = RomFS_ReadBE32(dirTable.data() + cur + ROMFS_ENTRY_SIBLING);
+    }
+    return true;
+}
+
+/**
+ * Returns the location of the first file in "dir" whose name is accepted by "match".
+ * Returns WUHB_UTILS_RESULT_READ_FAILED if reading failed and WUHB_UTILS_RESULT_MOUNT_FAILED if the file table is broken.
+ */
+template<typename Match>
+static WUHBUtilsStatus FindFile(const BundleTables &tables, uint32_t dir, Match &&match, WUHBRPXInfo *outExtent) {
+    if ((uint64_t) dir + ROMFS_DIR_ENTRY_SIZE > tables.dirTable.size()) {
+        return WUHB_UTILS_RESULT_MOUNT_FAILED;
+    }
+    uint8_t entry[ROMFS_FILE_ENTRY_SIZE];
+    char name[SCAN_MAX_NAME_LENGTH];
+    uint32_t cur      = RomFS_ReadBE32(tables.dirTable.data() + dir + ROMFS_DIR_ENTRY_CHILD_FILE);
+    uint64_t maxSteps = tables.fileTableSize / ROMFS_FILE_ENTRY_SIZE;
+    while (cur != ROMFS_NONE && maxSteps-- > 0) {
+        if ((uint64_t) cur + ROMFS_FILE_ENTRY_SIZE > tables.fileTableSize) {
+            return WUHB_UTILS_RESULT_MOUNT_FAILED;
+        }
+        if (!ReadAt(tables.f, tables.fileTableOffset + cur, entry, sizeof(entry))) {
+            return WUHB_UTILS_RESULT_READ_FAILED;
+        }
+        uint32_t nameLen = RomFS_ReadBE32(entry + ROMFS_FILE_ENTRY_SIZE - 4);
+        if (nameLen > sizeof(name) || (uint64_t) cur + ROMFS_FILE_ENTRY_SIZE + nameLen > tables.fileTableSize) {
+            return WUHB_UTILS_RESULT_MOUNT_FAILED;
+        }
+        if (fread(name, 1, nameLen, tables.f) != nameLen) {
+            return WUHB_UTILS_RESULT_READ_FAILED;
+        }
+        if (match(std::string_view(name, nameLen))) {
+            outExtent->offset = tables.dataOffset + RomFS_ReadBE64(entry + ROMFS_FILE_ENTRY_OFFSET);
+            outExtent->length = RomFS_ReadBE64(entry + ROMFS_FILE_ENTRY_LENGTH);
+            return WUHB_UTILS_RESULT_SUCCESS;
+        }
+        cur = RomFS_ReadBE32(entry + ROMFS_ENTRY_SIBLING);
+    }
+    return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+}
+
+/**
+ * Finds the first ".rpx" in "/code/" like the module does.
+ */
+static WUHBUtilsStatus ReadRPXInfo(FILE *f, WUHBRPXInfo *outInfo) {
+    BundleTables tables;
+    uint32_t codeDir;
+    WUHBUtilsStatus res;
+    if ((res = LoadBundleTables(f, &tables)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    if (!FindChildDir(tables, 0, "code", &codeDir)) {
+        return WUHB_UTILS_RESULT_MOUNT_FAILED;
+    }
+    if (codeDir == ROMFS_NONE) {
+        return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+    }
+    auto isRpx = [](std::string_view name) { return name.size() > 4 && name.compare(name.size() - 4, 4, ".rpx") == 0; };
+    return FindFile(tables, codeDir, isRpx, outInfo);
+}
+
+/**
+ * Looks up a path relative to the root of the bundle (e.g. "/meta/iconTex.tga").
+ */
+static WUHBUtilsStatus LookupBundleFile(const BundleTables &tables, std::string_view path, WUHBRPXInfo *outExtent) {
+    while (!path.empty() && path.front() == '/') {
+        path.remove_prefix(1);
+    }
+    uint32_t dir = 0;
+    size_t slash;
+    while ((slash = path.find('/')) != std::string_view::npos) {
+        if (!FindChildDir(tables, dir, path.substr(0, slash), &dir)) {
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (dir == ROMFS_NONE) {
+            return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+        }
+        path.remove_prefix(slash + 1);
+    }
+    if (path.empty()) {
+        return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+    }
+    auto res = FindFile(tables, dir, [path](std::string_view name) { return name == path; }, outExtent);
+    return res == WUHB_UTILS_RESULT_MOUNT_FAILED ? WUHB_UTILS_RESULT_UNKNOWN_ERROR : res;
+}
+
+static void ScanBundle(ScanJob &job) {
+    FILE *f = fopen(job.nativePath.c_str(), "rb");
+    if (!f) {
+        job.status    = WUHB_UTILS_RESULT_MOUNT_FAILED;
+        job.cacheable = false;
+        return;
+    }
+    job.status = ReadRPXInfo(f, &job.rpxInfo);
+    fclose(f);
+    // A failed read may be a transient SD card error, only format errors are cached.
+    job.cacheable = job.status != WUHB_UTILS_RESULT_READ_FAILED;
+}
+
+template<typename T>
+static void Append(std::vector<uint8_t> &out, const T &val) {
+    auto *p = (const uint8_t *) &val;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template<typename T>
+static bool Consume(const std::vector<uint8_t> &in, size_t &pos, T *outVal) {
+    if (in.size() - pos < sizeof(T)) {
+        return false;
+    }
+    memcpy(outVal, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+/**
+ * Replaces sCache with the content of the cache file, sMutex has to be held.
+ */
+static void LoadCacheLocked() {
+    sCache.clear();
+    FILE *f = fopen(sCachePath.c_str(), "rb");
+    if (!f) {
+        return;
+    }
+    std::vector<uint8_t> data;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 && size <= SCAN_MAX_CACHE_FILE_SIZE && fseek(f, 0, SEEK_SET) == 0) {
+        data.resize(size);
+        if (fread(data.data(), 1, data.size(), f) != data.size()) {
+            data.clear();
+        }
+    }
+    fclose(f);
+
+    size_t pos = 0;
+    uint32_t magic, count;
+    if (!Consume(data, pos, &magic) || magic != SCAN_CACHE_MAGIC || !Consume(data, pos, &count)) {
+        DEBUG_FUNCTION_LINE_WARN("Ignoring invalid scan cache %s", sCachePath.c_str());
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t pathLen;
+        ScanCacheEntry entry;
+        if (!Consume(data, pos, &pathLen) || data.size() - pos < pathLen) {
+            break;
+        }
+        std::string path((const char *) data.data() + pos, pathLen);
+        pos += pathLen;
+        if (!Consume(data, pos, &entry.size) || !Consume(data, pos, &entry.mtime) || !Consume(data, pos, &entry.status) ||
+            !Consume(data, pos, &entry.rpxInfo.offset) || !Consume(data, pos, &entry.rpxInfo.length)) {
+            break;
+        }
+        sCache[std::move(path)] = entry;
+    }
+    if (sCache.size() != count) {
+        DEBUG_FUNCTION_LINE_WARN("Scan cache %s is truncated, dropping it", sCachePath.c_str());
+        sCache.clear();
+    }
+}
+
+/**
+ * Writes sCache to the cache file, sMutex has to be held. The file is replaced atomically so an interrupted write
+ * doesn't leave a broken cache behind.
+ */
+static void SaveCacheLocked() {
+    std::vector<uint8_t> data;
+    Append(data, (uint32_t) SCAN_CACHE_MAGIC);
+    Append(data, (uint32_t) sCache.size());
+    for (auto &[path, entry] : sCache) {
+        Append(data, (uint32_t) path.size());
+        data.insert(data.end(), path.begin(), path.end());
+        Append(data, entry.size);
+        Append(data, entry.mtime);
+        Append(data, entry.status);
+        Append(data, entry.rpxInfo.offset);
+        Append(data, entry.rpxInfo.length);
+    }
+
+    auto tmpPath = sCachePath + ".tmp";
+    FILE *f      = fopen(tmpPath.c_str(), "wb");
+    if (!f) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to create %s", tmpPath.c_str());
+        return;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok      = fclose(f) == 0 && ok;
+    if (!ok || (remove(sCachePath.c_str()) != 0 && errno != ENOENT) || rename(tmpPath.c_str(), sCachePath.c_str()) != 0) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to write scan cache %s", sCachePath.c_str());
+        remove(tmpPath.c_str());
+    }
+}
+
+WUHBUtilsStatus WUHBUtils_ScanBundles(const char *dir, BundleSource source, WUHBScanCallback callback, void *context) {
+    STATS_SCOPE(WUHB_STATS_CALL_SCAN_BUNDLES);
+    if (!dir || !callback) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::string dirPath = dir;
+    while (dirPath.size() > 1 && dirPath.back() == '/') {
+        dirPath.pop_back();
+    }
+    if (dirPath.empty()) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    auto prefix    = dirPath.back() == '/' ? dirPath : dirPath + "/";
+    auto nativeDir = GetNativePath(prefix.c_str(), source);
+    DIR *d         = opendir(nativeDir.c_str());
+    if (!d) {
+        return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+    }
+    std::vector<std::string> names;
+    while (auto *ent = readdir(d)) {
+        if (IsBundleName(ent->d_name)) {
+            names.emplace_back(ent->d_name);
+        }
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+
+    // Everything that is unchanged since it has been cached doesn't need to be opened.
+    std::vector<ScanJob> jobs;
+    std::vector<ScanJob *> misses;
+    jobs.reserve(names.size());
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        for (auto &name : names) {
+            ScanJob job{prefix + name, nativeDir + name, 0, 0, WUHB_UTILS_RESULT_SUCCESS, {0, 0}, false, true};
+            struct stat st {};
+            if (stat(job.nativePath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+                continue;
+            }
+            job.size  = st.st_size;
+            job.mtime = st.st_mtime;
+            auto it   = sCache.find(job.path);
+            if (it != sCache.end() && it->second.size == job.size && it->second.mtime == job.mtime) {
+                job.status  = it->second.status;
+                job.rpxInfo = it->second.rpxInfo;
+                job.cached  = true;
+            }
+            jobs.push_back(std::move(job));
+        }
+    }
+    for (auto &job : jobs) {
+        if (!job.cached) {
+            misses.push_back(&job);
+        }
+    }
+
+    // Most of the time is spent waiting for the SD card, so several bundles are read at once.
+    std::atomic<uint32_t> next(0);
+    auto worker = [&misses, &next]() {
+        uint32_t i;
+        while ((i = next++) < misses.size()) {
+            ScanBundle(*misses[i]);
+        }
+    };
+    std::vector<std::thread> threads;
+    uint32_t numThreads = std::min<uint32_t>(WUHB_SCAN_THREADS, misses.size());
+    for (uint32_t i = 1; i < numThreads; i++) {
+        try {
+            threads.emplace_back(worker);
+        } catch (const std::system_error &) {
+            DEBUG_FUNCTION_LINE_WARN("Failed to create scan thread, continuing with %u threads", (uint32_t) threads.size() + 1);
+            break;
+        }
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        bool dirty = false;
+        for (auto *job : misses) {
+            if (job->cacheable) {
+                sCache[job->path] = {job->size, job->mtime, job->status, job->rpxInfo};
+                dirty             = true;
+            }
+        }
+        // Drop bundles of this directory that don't exist anymore.
+        for (auto it = sCache.lower_bound(prefix); it != sCache.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+            bool inDir = it->first.find('/', prefix.size()) == std::string::npos;
+            if (inDir && !std::binary_search(names.begin(), names.end(), it->first.substr(prefix.size()))) {
+                it    = sCache.erase(it);
+                dirty = true;
+            } else {
+                ++it;
+            }
+        }
+        if (dirty && !sCachePath.empty()) {
+            SaveCacheLocked();
+        }
+    }
+
+    for (auto &job : jobs) {
+        WUHBScanEntry entry{job.path.c_str(), job.status, job.rpxInfo, job.cached};
+        callback(&entry, context);
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_SetScanCachePath(const char *path) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sCachePath = path ? path : "";
+    if (sCachePath.empty()) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    LoadCacheLocked();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_ScanCacheClear() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    sCache.clear();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_ReadBundleFiles(const char *bundlePath, BundleSource source, const char **paths, uint32_t count, WUHBArena *arena, uint32_t alignment,
+                                          uint8_t **outBufs, uint32_t *outSizes, WUHBUtilsStatus *outStatus) {
+    STATS_SCOPE(WUHB_STATS_CALL_READ_BUNDLE_FILES);
+    if (!bundlePath || !arena || (count > 0 && (!paths || !outBufs || !outSizes || !outStatus)) || alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    FILE *f = fopen(GetNativePath(bundlePath, source).c_str(), "rb");
+    if (!f) {
+        return WUHB_UTILS_RESULT_MOUNT_FAILED;
+    }
+    BundleTables tables;
+    WUHBUtilsStatus res;
+    if ((res = LoadBundleTables(f, &tables)) != WUHB_UTILS_RESULT_SUCCESS) {
+        fclose(f);
+        return res;
+    }
+
+    // Reserve the space of every file in request order, then read them in on-disk order.
+    std::vector<std::pair<uint64_t, uint32_t>> reads; // offset inside the bundle file, index into "paths"
+    for (uint32_t i = 0; i < count; i++) {
+        outBufs[i]  = nullptr;
+        outSizes[i] = 0;
+        WUHBRPXInfo extent;
+        if (!paths[i]) {
+            outStatus[i] = WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+            continue;
+        }
+        if ((outStatus[i] = LookupBundleFile(tables, paths[i], &extent)) != WUHB_UTILS_RESULT_SUCCESS) {
+            continue;
+        }
+        uint64_t start = Allocator_ArenaAlignedOffset(arena, alignment);
+        if (start > arena->capacity || extent.length > arena->capacity - start) {
+            outStatus[i] = WUHB_UTILS_RESULT_BUFFER_TOO_SMALL;
+            continue;
+        }
+        arena->used = start + extent.length;
+        outBufs[i]  = arena->base + start;
+        outSizes[i] = extent.length;
+        reads.emplace_back(extent.offset, i);
+    }
+    std::sort(reads.begin(), reads.end());
+    for (auto &[offset, i] : reads) {
+        if (!ReadAt(f, offset, outBufs[i], outSizes[i])) {
+            outStatus[i] = WUHB_UTILS_RESULT_READ_FAILED;
+            outBufs[i]   = nullptr;
+            outSizes[i]  = 0;
+            continue;
+        }
+        STATS_BYTES_READ_PLAIN(outSizes[i]);
+    }
+    fclose(f);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+#include "stats.h"
+
+#ifdef WUHB_UTILS_STATS
+#include <atomic>
+
+#ifdef __WIIU__
+#include <coreinit/time.h>
+#else
+#include <chrono>
+#endif
+
+/*
+ * All counters are relaxed atomics, a snapshot is not taken atomically as a whole.
+ * To split the bytes read, open compressed files are kept in a small table of atomic slots. Reads only scan it while
+ * a compressed file is open, so the read path never takes a lock.
+ */
+
+#define STATS_COMPRESSED_SLOTS 64
+#define STATS_SLOT_USED        (1ull << 32) // marks a used slot, the handle is stored in the lower 32 bits
+
+struct AtomicHistogram {
+    std::atomic<uint64_t> buckets[WUHB_STATS_LATENCY_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> totalUs;
+    std::atomic<uint64_t> maxUs;
+};
+
+static std::atomic<uint64_t> sCalls[WUHB_STATS_CALL_COUNT];
+static std::atomic<uint64_t> sBytesReadPlain;
+static std::atomic<uint64_t> sBytesReadCompressed;
+static std::atomic<uint64_t> sReadWholeFileReallocs;
+static std::atomic<uint32_t> sOpenFileHandles;
+static std::atomic<uint32_t> sOpenDirHandles;
+static AtomicHistogram sOpenLatency;
+static AtomicHistogram sReadLatency;
+static AtomicHistogram sCloseLatency;
+
+static std::atomic<uint64_t> sCompressedSlots[STATS_COMPRESSED_SLOTS];
+static std::atomic<uint32_t> sCompressedHandles; // used slots
+
+static uint64_t NowUs() {
+#ifdef __WIIU__
+    return (uint64_t) OSTicksToMicroseconds(OSGetSystemTime());
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static AtomicHistogram *GetHistogram(WUHBStatsCall call) {
+    switch (call) {
+        case WUHB_STATS_CALL_FILE_OPEN:
+            return &sOpenLatency;
+        case WUHB_STATS_CALL_FILE_READ:
+        case WUHB_STATS_CALL_FILE_READ_AT:
+        case WUHB_STATS_CALL_FILE_READ_V:
+        case WUHB_STATS_CALL_FILE_READ_V_AT:
+            return &sReadLatency;
+        case WUHB_STATS_CALL_FILE_CLOSE:
+            return &sCloseLatency;
+        default:
+            return nullptr;
+    }
+}
+
+static void AddLatency(AtomicHistogram &histogram, uint64_t us) {
+    uint32_t bucket = 0;
+    while (bucket < WUHB_STATS_LATENCY_BUCKETS - 1 && us >= (1ull << bucket)) {
+        bucket++;
+    }
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.totalUs.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = histogram.maxUs.load(std::memory_order_relaxed);
+    while (us > max && !histogram.maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+static void LoadHistogram(const AtomicHistogram &histogram, WUHBLatencyHistogram *out) {
+    for (uint32_t i = 0; i < WUHB_STATS_LATENCY_BUCKETS; i++) {
+        out->buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+    }
+    out->count   = histogram.count.load(std::memory_order_relaxed);
+    out->totalUs = histogram.totalUs.load(std::memory_order_relaxed);
+    out->maxUs   = histogram.maxUs.load(std::memory_order_relaxed);
+}
+
+static void ResetHistogram(AtomicHistogram &histogram) {
+    for (auto &bucket : histogram.buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    histogram.count.store(0, std::memory_order_relaxed);
+    histogram.totalUs.store(0, std::memory_order_relaxed);
+    histogram.maxUs.store(0, std::memory_order_relaxed);
+}
+
+StatsScope::StatsScope(WUHBStatsCall call) : mCall(call), mStartUs(GetHistogram(call) ? NowUs() : 0) {
+    sCalls[call].fetch_add(1, std::memory_order_relaxed);
+}
+
+StatsScope::~StatsScope() {
+    auto *histogram = GetHistogram(mCall);
+    if (histogram) {
+        AddLatency(*histogram, NowUs() - mStartUs);
+    }
+}
+
+static bool IsCompressedHandle(WUHBFileHandle handle) {
+    if (sCompressedHandles.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    uint64_t value = STATS_SLOT_USED | handle;
+    for (auto &slot : sCompressedSlots) {
+        if (slot.load(std::memory_order_relaxed) == value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Stats_FileOpened(WUHBFileHandle handle, bool compressed) {
+    sOpenFileHandles.fetch_add(1, std::memory_order_relaxed);
+    if (!compressed) {
+        return;
+    }
+    // If all slots are in use, the bytes read from this file are counted as plain.
+    for (auto &slot : sCompressedSlots) {
+        uint64_t expected = 0;
+        if (slot.compare_exchange_strong(expected, STATS_SLOT_USED | handle, std::memory_order_relaxed)) {
+            sCompressedHandles.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void Stats_FileClosed(WUHBFileHandle handle) {
+    sOpenFileHandles.fetch_sub(1, std::memory_order_relaxed);
+    if (sCompressedHandles.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    for (auto &slot : sCompressedSlots) {
+        uint64_t expected = STATS_SLOT_USED | handle;
+        if (slot.compare_exchange_strong(expected, 0, std::memory_order_relaxed)) {
+            sCompressedHandles.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+void Stats_BytesRead(WUHBFileHandle handle, int64_t bytes) {
+    if (bytes <= 0) {
+        return;
+    }
+    (IsCompressedHandle(handle) ? sBytesReadCompressed : sBytesReadPlain).fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Stats_BytesReadPlain(uint64_t bytes) {
+    sBytesReadPlain.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Stats_DirOpened() {
+    sOpenDirHandles.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Stats_DirClosed() {
+    sOpenDirHandles.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Stats_ReadWholeFileRealloc() {
+    sReadWholeFileReallocs.fetch_add(1, std::memory_order_relaxed);
+}
+
+WUHBUtilsStatus WUHBUtils_GetStats(WUHBStats *outStats) {
+    if (!outStats) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    for (uint32_t i = 0; i < WUHB_STATS_CALL_COUNT; i++) {
+        outStats->calls[i] = sCalls[i].load(std::memory_order_relaxed);
+    }
+    outStats->bytesReadPlain        = sBytesReadPlain.load(std::memory_order_relaxed);
+    outStats->bytesReadCompressed   = sBytesReadCompressed.load(std::memory_order_relaxed);
+    outStats->readWholeFileReallocs = sReadWholeFileReallocs.load(std::memory_order_relaxed);
+    outStats->openFileHandles       = sOpenFileHandles.load(std::memory_order_relaxed);
+    outStats->openDirHandles        = sOpenDirHandles.load(std::memory_order_relaxed);
+    LoadHistogram(sOpenLatency, &outStats->openLatency);
+    LoadHistogram(sReadLatency, &outStats->readLatency);
+    LoadHistogram(sCloseLatency, &outStats->closeLatency);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_ResetStats() {
+    for (auto &calls : sCalls) {
+        calls.store(0, std::memory_order_relaxed);
+    }
+    sBytesReadPlain.store(0, std::memory_order_relaxed);
+    sBytesReadCompressed.store(0, std::memory_order_relaxed);
+    sReadWholeFileReallocs.store(0, std::memory_order_relaxed);
+    ResetHistogram(sOpenLatency);
+    ResetHistogram(sReadLatency);
+    ResetHistogram(sCloseLatency);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+#else
+
+WUHBUtilsStatus WUHBUtils_GetStats(WUHBStats *) {
+    return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+}
+
+WUHBUtilsStatus WUHBUtils_ResetStats() {
+    return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+}
+
+#endif
+
+const char *WUHBUtils_GetStatsCallStr(WUHBStatsCall call) {
+    switch (call) {
+        case WUHB_STATS_CALL_MOUNT_BUNDLE:
+            return "MountBundle";
+        case WUHB_STATS_CALL_UNMOUNT_BUNDLE:
+            return "UnmountBundle";
+        case WUHB_STATS_CALL_FILE_OPEN:
+            return "FileOpen";
+        case WUHB_STATS_CALL_FILE_READ:
+            return "FileRead";
+        case WUHB_STATS_CALL_FILE_READ_AT:
+            return "FileReadAt";
+        case WUHB_STATS_CALL_FILE_READ_V:
+            return "FileReadV";
+        case WUHB_STATS_CALL_FILE_READ_V_AT:
+            return "FileReadVAt";
+        case WUHB_STATS_CALL_FILE_CLOSE:
+            return "FileClose";
+        case WUHB_STATS_CALL_FILE_EXISTS:
+            return "FileExists";
+        case WUHB_STATS_CALL_FILE_GET_SIZE:
+            return "FileGetSize";
+        case WUHB_STATS_CALL_FILE_SEEK:
+            return "FileSeek";
+        case WUHB_STATS_CALL_FILE_TELL:
+            return "FileTell";
+        case WUHB_STATS_CALL_GET_FILE_INFO:
+            return "GetFileInfo";
+        case WUHB_STATS_CALL_OPEN_DIR:
+            return "OpenDir";
+        case WUHB_STATS_CALL_READ_DIR_BATCH:
+            return "ReadDirBatch";
+        case WUHB_STATS_CALL_CLOSE_DIR:
+            return "CloseDir";
+        case WUHB_STATS_CALL_READ_WHOLE_FILE:
+            return "ReadWholeFile";
+        case WUHB_STATS_CALL_READ_WHOLE_FILE_INTO:
+            return "ReadWholeFileInto";
+        case WUHB_STATS_CALL_GET_RPX_INFO:
+            return "GetRPXInfo";
+        case WUHB_STATS_CALL_READ_FILES:
+            return "ReadFiles";
+        case WUHB_STATS_CALL_READ_WHOLE_FILE_HASHED:
+            return "ReadWholeFileHashed";
+        case WUHB_STATS_CALL_SCAN_BUNDLES:
+            return "ScanBundles";
+        case WUHB_STATS_CALL_READ_BUNDLE_FILES:
+            return "ReadBundleFiles";
+        case WUHB_STATS_CALL_FILE_STREAM:
+            return "FileStream";
+        case WUHB_STATS_CALL_COUNT:
+            break;
+    }
+    return "Unknown";
+}
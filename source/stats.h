@@ -0,0 +1,53 @@
+#pragma once
+
+#include <wuhb_utils/stats.h>
+
+/*
+ * Instrumentation hooks for the statistics, see <wuhb_utils/stats.h>.
+ * Without WUHB_UTILS_STATS all macros expand to nothing and their arguments are not evaluated.
+ */
+
+#ifdef WUHB_UTILS_STATS
+
+class StatsScope {
+public:
+    explicit StatsScope(WUHBStatsCall call);
+    ~StatsScope();
+
+    StatsScope(const StatsScope &)            = delete;
+    StatsScope &operator=(const StatsScope &) = delete;
+
+private:
+    WUHBStatsCall mCall;
+    uint64_t mStartUs;
+};
+
+void Stats_FileOpened(WUHBFileHandle handle, bool compressed);
+void Stats_FileClosed(WUHBFileHandle handle);
+void Stats_BytesRead(WUHBFileHandle handle, int64_t bytes);
+void Stats_BytesReadPlain(uint64_t bytes);
+void Stats_DirOpened();
+void Stats_DirClosed();
+void Stats_ReadWholeFileRealloc();
+
+#define STATS_SCOPE(call)                     StatsScope statsScope_(call)
+#define STATS_FILE_OPENED(handle, compressed) Stats_FileOpened(handle, compressed)
+#define STATS_FILE_CLOSED(handle)             Stats_FileClosed(handle)
+#define STATS_BYTES_READ(handle, bytes)       Stats_BytesRead(handle, bytes)
+#define STATS_BYTES_READ_PLAIN(bytes)         Stats_BytesReadPlain(bytes)
+#define STATS_DIR_OPENED()                    Stats_DirOpened()
+#define STATS_DIR_CLOSED()                    Stats_DirClosed()
+#define STATS_READ_WHOLE_FILE_REALLOC()       Stats_ReadWholeFileRealloc()
+
+#else
+
+#define STATS_SCOPE(call)
+#define STATS_FILE_OPENED(handle, compressed)
+#define STATS_FILE_CLOSED(handle)
+#define STATS_BYTES_READ(handle, bytes)
+#define STATS_BYTES_READ_PLAIN(bytes)
+#define STATS_DIR_OPENED()
+#define STATS_DIR_CLOSED()
+#define STATS_READ_WHOLE_FILE_REALLOC()
+
+#endif
@@ -0,0 +1,314 @@
+#include "trace.h"
+#include "logger.h"
+#include "romfs_format.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+
+#ifdef __WIIU__
+#include <coreinit/time.h>
+#else
+#include <chrono>
+#endif
+
+/*
+ * Events are appended to a vector under a single mutex, paths are stored once and referenced by index. The position
+ * of every handle opened while recording is tracked here, so sequential reads can be recorded with their offset
+ * without asking the module. Handles that have been opened before WUHBUtils_TraceStart are ignored. All of it is
+ * allocated via the allocator hooks and released when the recording stops.
+ *
+ * File layout, all values big-endian:
+ *   header   u32 magic, u32 version, u32 path count, u32 event count, u32 dropped events
+ *   paths    u16 length + bytes (no terminator) per path
+ *   events   u32 timeUs, u16 path, u8 type, u8 reserved, u32 offset, u32 size
+ */
+
+#define TRACE_HEADER_SIZE   20
+#define TRACE_EVENT_SIZE    16
+#define TRACE_MAX_PATHS     0xFFFF
+#define TRACE_MAX_FILE_SIZE (64 * 1024 * 1024)
+
+struct TraceHandle {
+    uint16_t path;
+    uint32_t pos;
+};
+
+static std::mutex sMutex;
+static TraceData sTrace;
+static AllocatorUnorderedMap<AllocatorString, uint16_t, AllocatorStringHash> sPathIndices;
+static AllocatorUnorderedMap<WUHBFileHandle, TraceHandle> sHandles;
+static uint32_t sMaxEvents = 0;
+static uint64_t sStartUs   = 0;
+static std::atomic<bool> sActive(false); // checked without holding sMutex
+static thread_local bool sIgnoreThread = false;
+
+static uint64_t NowUs() {
+#ifdef __WIIU__
+    return (uint64_t) OSTicksToMicroseconds(OSGetSystemTime());
+#else
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static inline bool IsRecording() {
+    return sActive.load(std::memory_order_relaxed) && !sIgnoreThread;
+}
+
+/**
+ * Returns the index of "path", or false if the path table is full. sMutex has to be held.
+ */
+static bool GetPathIndexLocked(const char *path, uint16_t *outIndex) {
+    auto it = sPathIndices.find(path);
+    if (it != sPathIndices.end()) {
+        *outIndex = it->second;
+        return true;
+    }
+    if (sTrace.paths.size() >= TRACE_MAX_PATHS) {
+        return false;
+    }
+    *outIndex = (uint16_t) sTrace.paths.size();
+    sTrace.paths.emplace_back(path);
+    sPathIndices.emplace(path, *outIndex);
+    return true;
+}
+
+/**
+ * sMutex has to be held.
+ */
+static void AddEventLocked(uint16_t path, TraceEventType type, uint32_t offset, uint32_t size) {
+    if (sTrace.events.size() >= sMaxEvents) {
+        sTrace.dropped++;
+        return;
+    }
+    sTrace.events.push_back({(uint32_t) (NowUs() - sStartUs), path, (uint8_t) type, 0, offset, size});
+}
+
+static void ClearLocked() {
+    sActive = false;
+    // Swapping releases the memory, clear() would keep it.
+    decltype(sTrace.paths)().swap(sTrace.paths);
+    decltype(sTrace.events)().swap(sTrace.events);
+    sTrace.dropped = 0;
+    decltype(sPathIndices)().swap(sPathIndices);
+    decltype(sHandles)().swap(sHandles);
+}
+
+void Trace_FileOpened(WUHBFileHandle handle, const char *path) {
+    if (!IsRecording()) {
+        return;
+    }
+    uint32_t size = 0;
+    WUHBUtils_FileGetSize(handle, &size);
+    std::lock_guard<std::mutex> lock(sMutex);
+    uint16_t index;
+    if (!sActive || !GetPathIndexLocked(path, &index)) {
+        return;
+    }
+    sHandles[handle] = {index, 0};
+    AddEventLocked(index, TRACE_EVENT_OPEN, 0, size);
+}
+
+void Trace_FileRead(WUHBFileHandle handle, int64_t bytes) {
+    if (!IsRecording() || bytes <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sHandles.find(handle);
+    if (it == sHandles.end()) {
+        return;
+    }
+    AddEventLocked(it->second.path, TRACE_EVENT_READ, it->second.pos, (uint32_t) bytes);
+    it->second.pos += (uint32_t) bytes;
+}
+
+void Trace_FileReadAt(WUHBFileHandle handle, uint32_t offset, int64_t bytes) {
+    if (!IsRecording() || bytes <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sHandles.find(handle);
+    if (it != sHandles.end()) {
+        AddEventLocked(it->second.path, TRACE_EVENT_READ, offset, (uint32_t) bytes);
+    }
+}
+
+void Trace_FileSeek(WUHBFileHandle handle, uint32_t pos) {
+    if (!IsRecording()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sHandles.find(handle);
+    if (it != sHandles.end()) {
+        it->second.pos = pos;
+    }
+}
+
+void Trace_FileClosed(WUHBFileHandle handle) {
+    if (!IsRecording()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sHandles.find(handle);
+    if (it != sHandles.end()) {
+        AddEventLocked(it->second.path, TRACE_EVENT_CLOSE, 0, 0);
+        sHandles.erase(it);
+    }
+}
+
+void Trace_FileReadWhole(const char *path, uint32_t size) {
+    if (!IsRecording()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    uint16_t index;
+    if (!sActive || !GetPathIndexLocked(path, &index)) {
+        return;
+    }
+    AddEventLocked(index, TRACE_EVENT_OPEN, 0, size);
+    if (size > 0) {
+        AddEventLocked(index, TRACE_EVENT_READ, 0, size);
+    }
+    AddEventLocked(index, TRACE_EVENT_CLOSE, 0, 0);
+}
+
+void Trace_IgnoreCurrentThread() {
+    sIgnoreThread = true;
+}
+
+static void AppendBE(AllocatorVector<uint8_t> &out, uint32_t val, uint32_t bytes) {
+    for (uint32_t i = bytes; i > 0; i--) {
+        out.push_back((uint8_t) (val >> ((i - 1) * 8)));
+    }
+}
+
+static inline uint16_t ReadBE16(const uint8_t *p) {
+    return (uint16_t) ((p[0] << 8) | p[1]);
+}
+
+bool Trace_Load(const char *path, TraceData *outData) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= TRACE_HEADER_SIZE && size <= TRACE_MAX_FILE_SIZE && fseek(f, 0, SEEK_SET) == 0) {
+        data.resize(size);
+        if (fread(data.data(), 1, data.size(), f) != data.size()) {
+            data.clear();
+        }
+    }
+    fclose(f);
+    if (data.size() < TRACE_HEADER_SIZE || RomFS_ReadBE32(data.data()) != TRACE_MAGIC || RomFS_ReadBE32(data.data() + 4) != TRACE_VERSION) {
+        return false;
+    }
+    uint32_t pathCount  = RomFS_ReadBE32(data.data() + 8);
+    uint32_t eventCount = RomFS_ReadBE32(data.data() + 12);
+    outData->dropped    = RomFS_ReadBE32(data.data() + 16);
+    outData->paths.clear();
+    outData->events.clear();
+
+    size_t pos = TRACE_HEADER_SIZE;
+    for (uint32_t i = 0; i < pathCount; i++) {
+        if (data.size() - pos < 2 || data.size() - pos - 2 < ReadBE16(data.data() + pos)) {
+            return false;
+        }
+        uint16_t len = ReadBE16(data.data() + pos);
+        outData->paths.emplace_back((const char *) data.data() + pos + 2, len);
+        pos += 2 + len;
+    }
+    if ((data.size() - pos) / TRACE_EVENT_SIZE < eventCount) {
+        return false;
+    }
+    outData->events.resize(eventCount);
+    for (auto &event : outData->events) {
+        const uint8_t *p = data.data() + pos;
+        event.timeUs     = RomFS_ReadBE32(p);
+        event.path       = ReadBE16(p + 4);
+        event.type       = p[6];
+        event.reserved   = 0;
+        event.offset     = RomFS_ReadBE32(p + 8);
+        event.size       = RomFS_ReadBE32(p + 12);
+        if (event.path >= pathCount) {
+            return false;
+        }
+        pos += TRACE_EVENT_SIZE;
+    }
+    return true;
+}
+
+void Trace_DeInit() {
+    std::lock_guard<std::mutex> lock(sMutex);
+    ClearLocked();
+}
+
+WUHBUtilsStatus WUHBUtils_TraceStart(uint32_t maxEvents) {
+    std::lock_guard<std::mutex> lock(sMutex);
+    ClearLocked();
+    sMaxEvents = maxEvents != 0 ? maxEvents : WUHB_TRACE_DEFAULT_MAX_EVENTS;
+    sStartUs   = NowUs();
+    sActive    = true;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_TraceStop(const char *path) {
+    AllocatorVector<uint8_t> data;
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (!sActive) {
+            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        }
+        if (path) {
+            AppendBE(data, TRACE_MAGIC, 4);
+            AppendBE(data, TRACE_VERSION, 4);
+            AppendBE(data, sTrace.paths.size(), 4);
+            AppendBE(data, sTrace.events.size(), 4);
+            AppendBE(data, sTrace.dropped, 4);
+            for (auto &tracePath : sTrace.paths) {
+                auto len = std::min<size_t>(tracePath.size(), 0xFFFF);
+                AppendBE(data, len, 2);
+                data.insert(data.end(), tracePath.begin(), tracePath.begin() + len);
+            }
+            for (auto &event : sTrace.events) {
+                AppendBE(data, event.timeUs, 4);
+                AppendBE(data, event.path, 2);
+                AppendBE(data, event.type, 1);
+                AppendBE(data, 0, 1);
+                AppendBE(data, event.offset, 4);
+                AppendBE(data, event.size, 4);
+            }
+        }
+        ClearLocked();
+    }
+    if (!path) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to create %s", path);
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    ok      = fclose(f) == 0 && ok;
+    if (!ok) {
+        DEBUG_FUNCTION_LINE_WARN("Failed to write trace %s", path);
+        remove(path);
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_TraceGetInfo(WUHBTraceInfo *outInfo) {
+    if (!outInfo) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    std::lock_guard<std::mutex> lock(sMutex);
+    outInfo->recording = sActive;
+    outInfo->events    = sTrace.events.size();
+    outInfo->dropped   = sTrace.dropped;
+    outInfo->paths     = sTrace.paths.size();
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "allocator.h"
+#include <wuhb_utils/trace.h>
+
+/*
+ * Recording of file accesses (see <wuhb_utils/trace.h>), used by the file functions in utils.cpp and prefetch.cpp.
+ * All hooks return immediately if no trace is being recorded.
+ */
+
+#define TRACE_MAGIC   0x57545243 // WTRC
+#define TRACE_VERSION 1
+
+enum TraceEventType {
+    TRACE_EVENT_OPEN  = 0, // "size" is the size of the file
+    TRACE_EVENT_READ  = 1,
+    TRACE_EVENT_CLOSE = 2,
+};
+
+struct TraceEvent {
+    uint32_t timeUs; // since WUHBUtils_TraceStart
+    uint16_t path;   // index into TraceData::paths
+    uint8_t type;    // TraceEventType
+    uint8_t reserved;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct TraceData {
+    AllocatorVector<AllocatorString> paths; // as passed to WUHBUtils_FileOpen, e.g. "bundle:/content/level1.bin"
+    AllocatorVector<TraceEvent> events;
+    uint32_t dropped;
+};
+
+void Trace_FileOpened(WUHBFileHandle handle, const char *path);
+
+/**
+ * Sequential read of "bytes" bytes at the current position of "handle".
+ */
+void Trace_FileRead(WUHBFileHandle handle, int64_t bytes);
+
+void Trace_FileReadAt(WUHBFileHandle handle, uint32_t offset, int64_t bytes);
+
+void Trace_FileSeek(WUHBFileHandle handle, uint32_t pos);
+
+void Trace_FileClosed(WUHBFileHandle handle);
+
+/**
+ * A whole file that has been read without a file handle, e.g. served from the staging area.
+ */
+void Trace_FileReadWhole(const char *path, uint32_t size);
+
+/**
+ * Accesses of the calling thread are not recorded, used by the prefetch thread.
+ */
+void Trace_IgnoreCurrentThread();
+
+/**
+ * Loads a trace written by WUHBUtils_TraceStop.
+ */
+bool Trace_Load(const char *path, TraceData *outData);
+
+/**
+ * Discards the trace that is being recorded and all profile registrations.
+ */
+void Trace_DeInit();
+
+/**
+ * Queues the files of the profile registered for "name" (if any), called after "name" has been mounted.
+ */
+void Profile_OnMount(const char *name);
+
+void Profile_DeInit();
@@ -1,20 +1,96 @@
+#include "allocator.h"
+#include "async.h"
+#include "bundle_index.h"
+#include "gz_index.h"
+#include "hash.h"
 #include "logger.h"
+#include "module_io.h"
+#include "prefetch.h"
+#include "stats.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
 #include <coreinit/debug.h>
 #include <coreinit/dynload.h>
+#include <cstdio>
 #include <cstring>
-#include <malloc.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <wuhb_utils/async.h>
+#include <wuhb_utils/file_cache.h>
+#include <wuhb_utils/hash.h>
+#include <wuhb_utils/prefetch.h>
 #include <wuhb_utils/utils.h>
 
+/*
+ * The exports of the module are described by sExportInfos and resolved into sExports. WUHBUtils_InitLibrary (holding
+ * sInitMutex) looks up the eager exports and marks the lazy ones as EXPORT_UNRESOLVED before wuhbUtilsVersion is
+ * published with release semantics. Lazy exports are looked up on their first call (or by WUHBUtils_GetCapabilities),
+ * again holding sInitMutex, and published via their slot with release semantics. Every wrapper loads the version with
+ * acquire semantics first, so after the first call of a lazy export a call costs two atomic loads, and calls from all
+ * cores only share the state of the module itself (and of the opt-in features like the cache or the statistics).
+ */
+
 static OSDynLoad_Module sModuleHandle = nullptr;
 
-static WUHBUtilsApiErrorType (*sWUUGetVersion)(WUHBUtilsVersion *)                                   = nullptr;
-static WUHBUtilsApiErrorType (*sWUUMountBundle)(const char *, const char *, BundleSource, int32_t *) = nullptr;
-static WUHBUtilsApiErrorType (*sWUUUnmountBundle)(const char *, int32_t *)                           = nullptr;
-static WUHBUtilsApiErrorType (*sWUUFileOpen)(const char *, WUHBFileHandle *)                         = nullptr;
-static WUHBUtilsApiErrorType (*sWUUFileRead)(WUHBFileHandle, uint8_t *, uint32_t, int32_t *)         = nullptr;
-static WUHBUtilsApiErrorType (*sWUUFileClose)(WUHBFileHandle)                                        = nullptr;
-static WUHBUtilsApiErrorType (*sWUUFileExists)(const char *, int32_t *)                              = nullptr;
-static WUHBUtilsApiErrorType (*sWUUGetRPXInfo)(const char *, BundleSource, WUHBRPXInfo *)            = nullptr;
+static WUHBUtilsApiErrorType (*sWUUGetVersion)(WUHBUtilsVersion *) = nullptr;
+
+enum ModuleExport {
+    EXPORT_MOUNT_BUNDLE,
+    EXPORT_UNMOUNT_BUNDLE,
+    EXPORT_FILE_OPEN,
+    EXPORT_FILE_READ,
+    EXPORT_FILE_CLOSE,
+    EXPORT_FILE_EXISTS,
+    EXPORT_GET_RPX_INFO,
+    EXPORT_FILE_GET_SIZE,
+    EXPORT_FILE_SEEK,
+    EXPORT_FILE_TELL,
+    EXPORT_FILE_READ_AT,
+    EXPORT_FILE_READ_V,
+    EXPORT_FILE_READ_V_AT,
+    EXPORT_OPEN_DIR,
+    EXPORT_READ_DIR_BATCH,
+    EXPORT_CLOSE_DIR,
+    EXPORT_GET_FILE_INFO,
+    EXPORT_COUNT,
+};
+
+struct ModuleExportInfo {
+    const char *name;
+    WUHBUtilsVersion minVersion; // first module version that provides the export
+    bool lazy;                   // looked up on the first call instead of by WUHBUtils_InitLibrary
+    uint32_t capability;         // WUHB_UTILS_CAPABILITY_* that needs the export
+};
+
+// Same order as ModuleExport.
+static const ModuleExportInfo sExportInfos[EXPORT_COUNT] = {
+        {"WUU_MountBundle", 1, false, WUHB_UTILS_CAPABILITY_MOUNT},
+        {"WUU_UnmountBundle", 1, false, WUHB_UTILS_CAPABILITY_MOUNT},
+        {"WUU_FileOpen", 1, false, WUHB_UTILS_CAPABILITY_FILE},
+        {"WUU_FileRead", 1, false, WUHB_UTILS_CAPABILITY_FILE},
+        {"WUU_FileClose", 1, false, WUHB_UTILS_CAPABILITY_FILE},
+        {"WUU_FileExists", 1, false, WUHB_UTILS_CAPABILITY_FILE},
+        {"WUU_GetRPXInfo", 1, true, WUHB_UTILS_CAPABILITY_RPX_INFO},
+        {"WUU_FileGetSize", 1, false, WUHB_UTILS_CAPABILITY_FILE_SIZE},
+        {"WUU_FileSeek", 1, false, WUHB_UTILS_CAPABILITY_SEEK},
+        {"WUU_FileTell", 1, false, WUHB_UTILS_CAPABILITY_SEEK},
+        {"WUU_FileReadAt", 1, false, WUHB_UTILS_CAPABILITY_READ_AT},
+        {"WUU_FileReadV", 1, true, WUHB_UTILS_CAPABILITY_READ_V},
+        {"WUU_FileReadVAt", 1, true, WUHB_UTILS_CAPABILITY_READ_V_AT},
+        {"WUU_OpenDir", 1, true, WUHB_UTILS_CAPABILITY_DIR},
+        {"WUU_ReadDirBatch", 1, true, WUHB_UTILS_CAPABILITY_DIR},
+        {"WUU_CloseDir", 1, true, WUHB_UTILS_CAPABILITY_DIR},
+        {"WUU_GetFileInfo", 1, false, WUHB_UTILS_CAPABILITY_FILE_INFO},
+};
+
+// Marks a lazy export that hasn't been looked up yet, exports that don't exist are stored as nullptr.
+static char sUnresolvedExport;
+#define EXPORT_UNRESOLVED ((void *) &sUnresolvedExport)
+
+static std::atomic<void *> sExports[EXPORT_COUNT];
 
 const char *WUHBUtils_GetStatusStr(WUHBUtilsStatus status) {
     switch (status) {
@@ -40,6 +116,16 @@ const char *WUHBUtils_GetStatusStr(WUHBUtilsStatus status) {
             return "WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND";
         case WUHB_UTILS_RESULT_MOUNT_FAILED:
             return "WUHB_UTILS_RESULT_MOUNT_FAILED";
+        case WUHB_UTILS_RESULT_BUFFER_TOO_SMALL:
+            return "WUHB_UTILS_RESULT_BUFFER_TOO_SMALL";
+        case WUHB_UTILS_RESULT_REQUEST_CANCELLED:
+            return "WUHB_UTILS_RESULT_REQUEST_CANCELLED";
+        case WUHB_UTILS_RESULT_REQUEST_PENDING:
+            return "WUHB_UTILS_RESULT_REQUEST_PENDING";
+        case WUHB_UTILS_RESULT_HASH_MISMATCH:
+            return "WUHB_UTILS_RESULT_HASH_MISMATCH";
+        case WUHB_UTILS_RESULT_READ_FAILED:
+            return "WUHB_UTILS_RESULT_READ_FAILED";
         case WUHB_UTILS_RESULT_LIB_UNINITIALIZED:
             return "WUHB_UTILS_RESULT_LIB_UNINITIALIZED";
         case WUHB_UTILS_RESULT_UNKNOWN_ERROR:
@@ -50,9 +136,26 @@ const char *WUHBUtils_GetStatusStr(WUHBUtilsStatus status) {
     return "WUHB_UTILS_RESULT_UNKNOWN_ERROR";
 }
 
-static WUHBUtilsVersion wuhbUtilsVersion = WUHB_UTILS_MODULE_VERSION_ERROR;
+static std::atomic<WUHBUtilsVersion> wuhbUtilsVersion(WUHB_UTILS_MODULE_VERSION_ERROR);
+static std::mutex sInitMutex;
 
-WUHBUtilsStatus WUHBUtils_InitLibrary() {
+/**
+ * Version of the loaded module, WUHB_UTILS_MODULE_VERSION_ERROR until WUHBUtils_InitLibrary succeeded.
+ * The function pointers may only be used after this returned a valid version.
+ */
+static inline WUHBUtilsVersion GetModuleVersion() {
+    return wuhbUtilsVersion.load(std::memory_order_acquire);
+}
+
+WUHBUtilsApiErrorType GetVersion(WUHBUtilsVersion *);
+
+/**
+ * Acquires the module and finds WUU_GetVersion if that didn't happen yet, must be called while holding sInitMutex.
+ */
+static WUHBUtilsStatus AcquireModuleLocked() {
+    if (sWUUGetVersion != nullptr) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
     if (OSDynLoad_Acquire("homebrew_wuhb_utils", &sModuleHandle) != OS_DYNLOAD_OK) {
         DEBUG_FUNCTION_LINE_ERR("OSDynLoad_Acquire homebrew_wuhb_utils failed.");
         return WUHB_UTILS_RESULT_MODULE_NOT_FOUND;
@@ -60,247 +163,764 @@ WUHBUtilsStatus WUHBUtils_InitLibrary() {
 
     if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_GetVersion", (void **) &sWUUGetVersion) != OS_DYNLOAD_OK) {
         DEBUG_FUNCTION_LINE_ERR("FindExport WUU_GetVersion failed.");
+        sWUUGetVersion = nullptr;
         return WUHB_UTILS_RESULT_MODULE_MISSING_EXPORT;
     }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
 
-    auto res = WUHBUtils_GetVersion(&wuhbUtilsVersion);
-    if (res != WUHB_UTILS_RESULT_SUCCESS) {
-        return WUHB_UTILS_RESULT_UNSUPPORTED_VERSION;
+/**
+ * Looks up an export of the module, returns NULL if the module (or its version) doesn't provide it.
+ * Must be called while holding sInitMutex.
+ */
+static void *FindExportLocked(ModuleExport index, WUHBUtilsVersion version) {
+    const auto &info = sExportInfos[index];
+    if (version < info.minVersion) {
+        return nullptr;
+    }
+    void *addr = nullptr;
+    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, info.name, &addr) != OS_DYNLOAD_OK) {
+        DEBUG_FUNCTION_LINE_WARN("FindExport %s failed.", info.name);
+        return nullptr;
     }
+    return addr;
+}
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_MountBundle", (void **) &sWUUMountBundle) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_MountBundle failed.");
-        sWUUMountBundle = nullptr;
+/**
+ * Slow path of GetExport for lazy exports that haven't been looked up yet.
+ */
+static void *ResolveExport(ModuleExport index) {
+    std::lock_guard<std::mutex> lock(sInitMutex);
+    void *addr = sExports[index].load(std::memory_order_relaxed);
+    if (addr == EXPORT_UNRESOLVED) {
+        addr = FindExportLocked(index, wuhbUtilsVersion.load(std::memory_order_relaxed));
+        sExports[index].store(addr, std::memory_order_release);
     }
+    return addr;
+}
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_UnmountBundle", (void **) &sWUUUnmountBundle) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_UnmountBundle failed.");
-        sWUUUnmountBundle = nullptr;
+/**
+ * Returns the function of an export as "Func", or NULL if the loaded module doesn't provide it.
+ * The library has to be initialized.
+ */
+template<typename Func>
+static inline Func GetExport(ModuleExport index) {
+    void *addr = sExports[index].load(std::memory_order_acquire);
+    if (addr == EXPORT_UNRESOLVED) {
+        addr = ResolveExport(index);
     }
+    return reinterpret_cast<Func>(addr);
+}
+
+static inline bool HasExport(ModuleExport index) {
+    return GetExport<void *>(index) != nullptr;
+}
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_FileOpen", (void **) &sWUUFileOpen) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_FileOpen failed.");
-        sWUUFileOpen = nullptr;
+/**
+ * Maps the result of a module function to the status returned by the wrappers.
+ */
+static WUHBUtilsStatus ToStatus(WUHBUtilsApiErrorType res) {
+    switch (res) {
+        case WUHB_UTILS_API_ERROR_NONE:
+            return WUHB_UTILS_RESULT_SUCCESS;
+        case WUHB_UTILS_API_ERROR_INVALID_ARG:
+            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+        case WUHB_UTILS_API_ERROR_MOUNT_NAME_TAKEN:
+            return WUHB_UTILS_RESULT_MOUNT_NAME_TAKEN;
+        case WUHB_UTILS_API_ERROR_MOUNT_NOT_FOUND:
+            return WUHB_UTILS_RESULT_MOUNT_NOT_FOUND;
+        case WUHB_UTILS_API_ERROR_FILE_NOT_FOUND:
+            return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+        case WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND:
+            return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
+        case WUHB_UTILS_API_ERROR_NO_MEMORY:
+            return WUHB_UTILS_RESULT_NO_MEMORY;
+        case WUHB_UTILS_API_ERROR_MOUNT_FAILED:
+            return WUHB_UTILS_RESULT_MOUNT_FAILED;
+        case WUHB_UTILS_API_ERROR_READ_FAILED:
+            return WUHB_UTILS_RESULT_READ_FAILED;
+        default:
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
     }
+}
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_FileRead", (void **) &sWUUFileRead) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_FileRead failed.");
-        sWUUFileRead = nullptr;
+WUHBUtilsStatus WUHBUtils_InitLibrary() {
+    if (GetModuleVersion() != WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    std::lock_guard<std::mutex> lock(sInitMutex);
+    if (GetModuleVersion() != WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_SUCCESS;
     }
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_FileClose", (void **) &sWUUFileClose) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_FileClose failed.");
-        sWUUFileClose = nullptr;
+    WUHBUtilsStatus res;
+    if ((res = AcquireModuleLocked()) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
     }
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_FileExists", (void **) &sWUUFileExists) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_FileExists failed.");
-        sWUUFileExists = nullptr;
+    WUHBUtilsVersion version = WUHB_UTILS_MODULE_VERSION_ERROR;
+    if (reinterpret_cast<decltype(&GetVersion)>(sWUUGetVersion)(&version) != WUHB_UTILS_API_ERROR_NONE || version == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_VERSION;
     }
 
-    if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_GetRPXInfo", (void **) &sWUUGetRPXInfo) != OS_DYNLOAD_OK) {
-        DEBUG_FUNCTION_LINE_WARN("FindExport WUU_GetRPXInfo failed.");
-        sWUUGetRPXInfo = nullptr;
+    for (uint32_t i = 0; i < EXPORT_COUNT; i++) {
+        sExports[i].store(sExportInfos[i].lazy ? EXPORT_UNRESOLVED : FindExportLocked((ModuleExport) i, version), std::memory_order_relaxed);
     }
 
+    wuhbUtilsVersion.store(version, std::memory_order_release);
     return WUHB_UTILS_RESULT_SUCCESS;
 }
 
 WUHBUtilsStatus WUHBUtils_DeInitLibrary() {
+    WUHBUtils_AsyncDeInit();
+    Prefetch_DeInit();
+    WUHBUtils_CacheInvalidate(nullptr);
+    Hash_RemoveManifest(nullptr);
+    BundleIndex_Remove(nullptr);
+    Trace_DeInit();
+    Profile_DeInit();
+
+    // The module stays acquired, the next WUHBUtils_InitLibrary looks up the exports again.
+    std::lock_guard<std::mutex> lock(sInitMutex);
+    wuhbUtilsVersion.store(WUHB_UTILS_MODULE_VERSION_ERROR, std::memory_order_release);
     return WUHB_UTILS_RESULT_SUCCESS;
 }
 
-WUHBUtilsApiErrorType GetVersion(WUHBUtilsVersion *);
 WUHBUtilsStatus WUHBUtils_GetVersion(WUHBUtilsVersion *outVersion) {
-    if (sWUUGetVersion == nullptr) {
-        if (OSDynLoad_Acquire("homebrew_wuhb_utils", &sModuleHandle) != OS_DYNLOAD_OK) {
-            DEBUG_FUNCTION_LINE_WARN("OSDynLoad_Acquire failed.");
-            return WUHB_UTILS_RESULT_MODULE_NOT_FOUND;
-        }
-
-        if (OSDynLoad_FindExport(sModuleHandle, OS_DYNLOAD_EXPORT_FUNC, "WUU_GetVersion", (void **) &sWUUGetVersion) != OS_DYNLOAD_OK) {
-            DEBUG_FUNCTION_LINE_WARN("FindExport WUU_GetVersion failed.");
-            return WUHB_UTILS_RESULT_MODULE_MISSING_EXPORT;
+    decltype(sWUUGetVersion) getVersion;
+    if (GetModuleVersion() != WUHB_UTILS_MODULE_VERSION_ERROR) {
+        getVersion = sWUUGetVersion;
+    } else {
+        // Not initialized yet, WUHBUtils_InitLibrary may be running on another core.
+        std::lock_guard<std::mutex> lock(sInitMutex);
+        WUHBUtilsStatus status;
+        if ((status = AcquireModuleLocked()) != WUHB_UTILS_RESULT_SUCCESS) {
+            return status;
         }
+        getVersion = sWUUGetVersion;
     }
     if (outVersion == nullptr) {
         return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
     }
 
-    auto res = reinterpret_cast<decltype(&GetVersion)>(sWUUGetVersion)(outVersion);
-    if (res == WUHB_UTILS_API_ERROR_NONE) {
-        return WUHB_UTILS_RESULT_SUCCESS;
+    return ToStatus(reinterpret_cast<decltype(&GetVersion)>(getVersion)(outVersion));
+}
+
+WUHBUtilsStatus WUHBUtils_GetCapabilities(uint32_t *outCapabilities) {
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (outCapabilities == nullptr) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    // A capability is only reported if every export it needs exists.
+    uint32_t available = 0;
+    uint32_t missing   = 0;
+    for (uint32_t i = 0; i < EXPORT_COUNT; i++) {
+        if (HasExport((ModuleExport) i)) {
+            available |= sExportInfos[i].capability;
+        } else {
+            missing |= sExportInfos[i].capability;
+        }
     }
-    return res == WUHB_UTILS_API_ERROR_INVALID_ARG ? WUHB_UTILS_RESULT_INVALID_ARGUMENT : WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    *outCapabilities = available & ~missing;
+    return WUHB_UTILS_RESULT_SUCCESS;
 }
 
 WUHBUtilsApiErrorType MountBundle(const char *, const char *, BundleSource, int32_t *);
 WUHBUtilsStatus WUHBUtils_MountBundle(const char *name, const char *path, BundleSource source, int32_t *outRes) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+    STATS_SCOPE(WUHB_STATS_CALL_MOUNT_BUNDLE);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUMountBundle == nullptr || wuhbUtilsVersion < 1) {
+    auto mountBundle = GetExport<decltype(&MountBundle)>(EXPORT_MOUNT_BUNDLE);
+    if (mountBundle == nullptr) {
         return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
     }
-    auto res = reinterpret_cast<decltype(&MountBundle)>(sWUUMountBundle)(name, path, source, outRes);
-
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_INVALID_ARG:
-            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
-        case WUHB_UTILS_API_ERROR_MOUNT_NAME_TAKEN:
-            return WUHB_UTILS_RESULT_MOUNT_NAME_TAKEN;
-        default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    auto res = mountBundle(name, path, source, outRes);
+    if (res == WUHB_UTILS_API_ERROR_NONE && *outRes >= 0) {
+        BundleIndex_Add(name, path, source);
+        Profile_OnMount(name);
     }
+    return ToStatus(res);
 }
 
 WUHBUtilsApiErrorType UnmountBundle(const char *, int32_t *);
 WUHBUtilsStatus WUHBUtils_UnmountBundle(const char *name, int32_t *outRes) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+    STATS_SCOPE(WUHB_STATS_CALL_UNMOUNT_BUNDLE);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUUnmountBundle == nullptr || wuhbUtilsVersion < 1) {
+    auto unmountBundle = GetExport<decltype(&UnmountBundle)>(EXPORT_UNMOUNT_BUNDLE);
+    if (unmountBundle == nullptr) {
         return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
     }
-    auto res = reinterpret_cast<decltype(&UnmountBundle)>(sWUUUnmountBundle)(name, outRes);
+    auto res = unmountBundle(name, outRes);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        // Cached files of this bundle may be replaced by a different bundle under the same name.
+        WUHBUtils_CacheInvalidate((std::string(name) + ":").c_str());
+        WUHBUtils_PrefetchCancel((std::string(name) + ":").c_str());
+        Hash_RemoveManifest(name);
+        BundleIndex_Remove(name);
+    }
+    return ToStatus(res);
+}
 
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_INVALID_ARG:
-            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
-        case WUHB_UTILS_API_ERROR_MOUNT_NOT_FOUND:
-            return WUHB_UTILS_RESULT_MOUNT_NOT_FOUND;
+WUHBUtilsApiErrorType GetFileInfo(const char *, uint64_t *, uint64_t *, bool *);
+
+#ifdef WUHB_UTILS_STATS
+/**
+ * Whether "name" is opened via the ".gz" fallback, only needed to split the bytes read in the statistics.
+ */
+static bool IsCompressedFile(const char *name, BundleIndexLookupResult lookup) {
+    switch (lookup) {
+        case BUNDLE_INDEX_FOUND_GZ:
+            return true;
+        case BUNDLE_INDEX_NO_INDEX:
+            break;
         default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+            return false;
     }
+    auto getFileInfo = GetExport<decltype(&GetFileInfo)>(EXPORT_GET_FILE_INFO);
+    uint64_t offset, length;
+    bool compressed = false;
+    return getFileInfo != nullptr && getFileInfo(name, &offset, &length, &compressed) == WUHB_UTILS_API_ERROR_NONE && compressed;
 }
+#endif
 
 WUHBUtilsApiErrorType FileOpen(const char *, WUHBFileHandle *);
-WUHBUtilsStatus WUHBUtils_FileOpen(const char *name, WUHBFileHandle *outHandle) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+WUHBUtilsApiErrorType FileClose(WUHBFileHandle);
+/**
+ * Opens "name" via the module, the library has to be initialized.
+ */
+static WUHBUtilsStatus ModuleFileOpen(const char *name, WUHBFileHandle *outHandle, BundleIndexLookupResult *outLookup) {
+    auto fileOpen = GetExport<decltype(&FileOpen)>(EXPORT_FILE_OPEN);
+    if (fileOpen == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    *outLookup = BundleIndex_Lookup(name, nullptr);
+    if (*outLookup == BUNDLE_INDEX_NOT_FOUND) {
+        return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+    }
+    auto res = fileOpen(name, outHandle);
+    if (res == WUHB_UTILS_API_ERROR_NONE && Prefetch_IsMemoryHandle(*outHandle)) {
+        // The handle would be mistaken for a memory file, see PREFETCH_HANDLE_FLAG.
+        DEBUG_FUNCTION_LINE_ERR("Module returned file handle %08X, which has PREFETCH_HANDLE_FLAG set", *outHandle);
+        auto fileClose = GetExport<decltype(&FileClose)>(EXPORT_FILE_CLOSE);
+        if (fileClose != nullptr) {
+            fileClose(*outHandle);
+        }
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    return ToStatus(res);
+}
+
+static WUHBUtilsStatus FileOpenImpl(const char *name, WUHBFileHandle *outHandle, BundleIndexLookupResult *outLookup, bool *outModuleHandle) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_OPEN);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUFileOpen == nullptr || wuhbUtilsVersion < 1) {
-        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    if (Prefetch_OpenFile(name, outHandle)) {
+        Trace_FileOpened(*outHandle, name);
+        return WUHB_UTILS_RESULT_SUCCESS;
     }
-    auto res = reinterpret_cast<decltype(&FileOpen)>(sWUUFileOpen)(name, outHandle);
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_INVALID_ARG:
-            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
-        case WUHB_UTILS_API_ERROR_FILE_NOT_FOUND:
-            return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
-        case WUHB_UTILS_API_ERROR_NO_MEMORY:
-            return WUHB_UTILS_RESULT_NO_MEMORY;
-        default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    auto res = ModuleFileOpen(name, outHandle, outLookup);
+    if (res == WUHB_UTILS_RESULT_SUCCESS) {
+        *outModuleHandle = true;
+        Trace_FileOpened(*outHandle, name);
+        GzIndex_FileOpened(name, *outHandle);
     }
+    return res;
+}
+
+WUHBUtilsStatus WUHBUtils_FileOpen(const char *name, WUHBFileHandle *outHandle) {
+    BundleIndexLookupResult lookup = BUNDLE_INDEX_NO_INDEX;
+    bool moduleHandle              = false;
+    auto res                       = FileOpenImpl(name, outHandle, &lookup, &moduleHandle);
+    if (moduleHandle) {
+        // Outside of the measured scope, without an index this asks the module.
+        STATS_FILE_OPENED(*outHandle, IsCompressedFile(name, lookup));
+    }
+    return res;
 }
 
 WUHBUtilsApiErrorType FileRead(WUHBFileHandle, uint8_t *, uint32_t, int32_t *);
 WUHBUtilsStatus WUHBUtils_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_READ);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUFileRead == nullptr || wuhbUtilsVersion < 1) {
+    if (Prefetch_IsMemoryHandle(handle)) {
+        return Prefetch_FileRead(handle, buffer, size, outRes);
+    }
+    WUHBUtilsStatus indexedRes;
+    if (GzIndex_FileRead(handle, buffer, size, outRes, &indexedRes)) {
+        return indexedRes;
+    }
+    auto fileRead = GetExport<decltype(&FileRead)>(EXPORT_FILE_READ);
+    if (fileRead == nullptr) {
         return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
     }
-    auto res = reinterpret_cast<decltype(&FileRead)>(sWUUFileRead)(handle, buffer, size, outRes);
-
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_INVALID_ARG:
-            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
-        case WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND:
-            return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
-        default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    auto res = fileRead(handle, buffer, size, outRes);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_BYTES_READ(handle, *outRes);
+        Trace_FileRead(handle, *outRes);
     }
+    return ToStatus(res);
 }
 
-WUHBUtilsApiErrorType FileClose(WUHBFileHandle);
 WUHBUtilsStatus WUHBUtils_FileClose(WUHBFileHandle handle) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_CLOSE);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUFileClose == nullptr || wuhbUtilsVersion < 1) {
+    if (Prefetch_IsMemoryHandle(handle)) {
+        return Prefetch_FileClose(handle);
+    }
+    GzIndex_FileClosed(handle);
+    auto fileClose = GetExport<decltype(&FileClose)>(EXPORT_FILE_CLOSE);
+    if (fileClose == nullptr) {
         return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
     }
-    auto res = reinterpret_cast<decltype(&FileClose)>(sWUUFileClose)(handle);
-
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_FILE_HANDLE_NOT_FOUND:
-            return WUHB_UTILS_RESULT_FILE_HANDLE_NOT_FOUND;
-        default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    auto res = fileClose(handle);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_FILE_CLOSED(handle);
+        Trace_FileClosed(handle);
     }
+    return ToStatus(res);
 }
 
 WUHBUtilsApiErrorType FileExists(const char *, int32_t *);
 WUHBUtilsStatus WUHBUtils_FileExists(const char *name, int32_t *outRes) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_EXISTS);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUFileExists == nullptr || wuhbUtilsVersion < 1) {
+    auto fileExists = GetExport<decltype(&FileExists)>(EXPORT_FILE_EXISTS);
+    if (fileExists == nullptr) {
         return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
     }
-    auto res = reinterpret_cast<decltype(&FileExists)>(sWUUFileExists)(name, outRes);
-
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_INVALID_ARG:
-            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
-        default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    if (outRes) {
+        switch (BundleIndex_Lookup(name, nullptr)) {
+            case BUNDLE_INDEX_FOUND:
+                *outRes = 1;
+                return WUHB_UTILS_RESULT_SUCCESS;
+            case BUNDLE_INDEX_NOT_FOUND:
+            case BUNDLE_INDEX_FOUND_GZ:
+                *outRes = 0;
+                return WUHB_UTILS_RESULT_SUCCESS;
+            case BUNDLE_INDEX_NO_INDEX:
+                break;
+        }
     }
+    return ToStatus(fileExists(name, outRes));
 }
 
 WUHBUtilsApiErrorType GetRPXInfo(const char *, BundleSource, WUHBRPXInfo *);
 WUHBUtilsStatus WUHBUtils_GetRPXInfo(const char *path, BundleSource source, WUHBRPXInfo *outFileInfo) {
-    if (wuhbUtilsVersion == WUHB_UTILS_MODULE_VERSION_ERROR) {
+    STATS_SCOPE(WUHB_STATS_CALL_GET_RPX_INFO);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
         return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    if (sWUUGetRPXInfo == nullptr || wuhbUtilsVersion < 1) {
+    auto getRPXInfo = GetExport<decltype(&GetRPXInfo)>(EXPORT_GET_RPX_INFO);
+    if (getRPXInfo == nullptr) {
         return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
     }
-    auto res = reinterpret_cast<decltype(&GetRPXInfo)>(sWUUGetRPXInfo)(path, source, outFileInfo);
+    return ToStatus(getRPXInfo(path, source, outFileInfo));
+}
 
-    switch (res) {
-        case WUHB_UTILS_API_ERROR_NONE:
-            return WUHB_UTILS_RESULT_SUCCESS;
-        case WUHB_UTILS_API_ERROR_INVALID_ARG:
-            return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
-        case WUHB_UTILS_API_ERROR_MOUNT_FAILED:
-            return WUHB_UTILS_RESULT_MOUNT_FAILED;
-        case WUHB_UTILS_API_ERROR_FILE_NOT_FOUND:
-            return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
-        default:
-            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+WUHBUtilsStatus WUHBUtils_GetFileInfo(const char *path, uint64_t *outOffset, uint64_t *outLength, bool *outIsCompressed) {
+    STATS_SCOPE(WUHB_STATS_CALL_GET_FILE_INFO);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
+    if (!path || !outOffset || !outLength || !outIsCompressed) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    BundleIndexFileExtent extent;
+    auto lookup = BundleIndex_Lookup(path, &extent);
+    if (lookup == BUNDLE_INDEX_NOT_FOUND) {
+        return WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+    }
+    if (lookup != BUNDLE_INDEX_NO_INDEX) {
+        *outOffset       = extent.offset;
+        *outLength       = extent.size;
+        *outIsCompressed = lookup == BUNDLE_INDEX_FOUND_GZ;
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    auto getFileInfo = GetExport<decltype(&GetFileInfo)>(EXPORT_GET_FILE_INFO);
+    if (getFileInfo == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(getFileInfo(path, outOffset, outLength, outIsCompressed));
 }
 
-WUHBUtilsStatus WUHBUtils_ReadWholeFile(const char *name, uint8_t **outBuf, uint32_t *outSize) {
-    if (!outBuf || !outSize) {
-        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+WUHBUtilsApiErrorType FileGetSize(WUHBFileHandle, uint32_t *);
+WUHBUtilsStatus WUHBUtils_FileGetSize(WUHBFileHandle handle, uint32_t *outSize) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_GET_SIZE);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
     }
-    auto DEFAULT_READ_BUFFER_SIZE = 128 * 1024;
-    WUHBFileHandle handle;
+    if (Prefetch_IsMemoryHandle(handle)) {
+        return Prefetch_FileGetSize(handle, outSize);
+    }
+    WUHBUtilsStatus indexedRes;
+    if (GzIndex_FileGetSize(handle, outSize, &indexedRes)) {
+        return indexedRes;
+    }
+    auto fileGetSize = GetExport<decltype(&FileGetSize)>(EXPORT_FILE_GET_SIZE);
+    if (fileGetSize == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(fileGetSize(handle, outSize));
+}
+
+WUHBUtilsApiErrorType FileSeek(WUHBFileHandle, int64_t, WUHBSeekOrigin, uint32_t *);
+WUHBUtilsStatus WUHBUtils_FileSeek(WUHBFileHandle handle, int64_t offset, WUHBSeekOrigin origin, uint32_t *outPos) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_SEEK);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (Prefetch_IsMemoryHandle(handle)) {
+        return Prefetch_FileSeek(handle, offset, origin, outPos);
+    }
+    WUHBUtilsStatus indexedRes;
+    if (GzIndex_FileSeek(handle, offset, origin, outPos, &indexedRes)) {
+        return indexedRes;
+    }
+    auto fileSeek = GetExport<decltype(&FileSeek)>(EXPORT_FILE_SEEK);
+    if (fileSeek == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    uint32_t pos;
+    auto res = fileSeek(handle, offset, origin, &pos);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        if (outPos) {
+            *outPos = pos;
+        }
+        Trace_FileSeek(handle, pos);
+    }
+    return ToStatus(res);
+}
+
+WUHBUtilsApiErrorType FileTell(WUHBFileHandle, uint32_t *);
+WUHBUtilsStatus WUHBUtils_FileTell(WUHBFileHandle handle, uint32_t *outPos) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_TELL);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (Prefetch_IsMemoryHandle(handle)) {
+        return Prefetch_FileTell(handle, outPos);
+    }
+    WUHBUtilsStatus indexedRes;
+    if (GzIndex_FileTell(handle, outPos, &indexedRes)) {
+        return indexedRes;
+    }
+    auto fileTell = GetExport<decltype(&FileTell)>(EXPORT_FILE_TELL);
+    if (fileTell == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(fileTell(handle, outPos));
+}
+
+/**
+ * Emulates WUHBUtils_FileReadAt for modules without WUU_FileReadAt by restoring the position after reading.
+ */
+static WUHBUtilsStatus FileReadAtViaSeek(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    uint32_t oldPos;
     WUHBUtilsStatus res;
-    if ((res = WUHBUtils_FileOpen(name, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+    if ((res = WUHBUtils_FileTell(handle, &oldPos)) != WUHB_UTILS_RESULT_SUCCESS) {
         return res;
     }
+    if ((res = WUHBUtils_FileSeek(handle, offset, WUHB_SEEK_SET, nullptr)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    res          = WUHBUtils_FileRead(handle, buffer, size, outRes);
+    auto seekRes = WUHBUtils_FileSeek(handle, oldPos, WUHB_SEEK_SET, nullptr);
+    return res != WUHB_UTILS_RESULT_SUCCESS ? res : seekRes;
+}
+
+WUHBUtilsApiErrorType FileReadAt(WUHBFileHandle, uint32_t, uint8_t *, uint32_t, int32_t *);
+WUHBUtilsStatus WUHBUtils_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_READ_AT);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (Prefetch_IsMemoryHandle(handle)) {
+        return Prefetch_FileReadAt(handle, offset, buffer, size, outRes);
+    }
+    WUHBUtilsStatus indexedRes;
+    if (GzIndex_FileReadAt(handle, offset, buffer, size, outRes, &indexedRes)) {
+        return indexedRes;
+    }
+    auto fileReadAt = GetExport<decltype(&FileReadAt)>(EXPORT_FILE_READ_AT);
+    if (fileReadAt == nullptr) {
+        if (HasExport(EXPORT_FILE_SEEK) && HasExport(EXPORT_FILE_TELL)) {
+            if (!buffer || !outRes) {
+                return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+            }
+            return FileReadAtViaSeek(handle, offset, buffer, size, outRes);
+        }
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    auto res = fileReadAt(handle, offset, buffer, size, outRes);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_BYTES_READ(handle, *outRes);
+        Trace_FileReadAt(handle, offset, *outRes);
+    }
+    return ToStatus(res);
+}
+
+WUHBUtilsStatus ModuleIO_FileOpen(const char *name, WUHBFileHandle *outHandle) {
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    BundleIndexLookupResult lookup;
+    return ModuleFileOpen(name, outHandle, &lookup);
+}
+
+WUHBUtilsStatus ModuleIO_FileRead(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto fileRead = GetExport<decltype(&FileRead)>(EXPORT_FILE_READ);
+    if (fileRead == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(fileRead(handle, buffer, size, outRes));
+}
+
+WUHBUtilsStatus ModuleIO_FileReadAt(WUHBFileHandle handle, uint32_t offset, uint8_t *buffer, uint32_t size, int32_t *outRes) {
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto fileReadAt = GetExport<decltype(&FileReadAt)>(EXPORT_FILE_READ_AT);
+    if (fileReadAt != nullptr) {
+        return ToStatus(fileReadAt(handle, offset, buffer, size, outRes));
+    }
+    auto fileSeek = GetExport<decltype(&FileSeek)>(EXPORT_FILE_SEEK);
+    if (fileSeek == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    auto res = ToStatus(fileSeek(handle, offset, WUHB_SEEK_SET, nullptr));
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    return ModuleIO_FileRead(handle, buffer, size, outRes);
+}
+
+WUHBUtilsStatus ModuleIO_FileGetSize(WUHBFileHandle handle, uint32_t *outSize) {
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto fileGetSize = GetExport<decltype(&FileGetSize)>(EXPORT_FILE_GET_SIZE);
+    if (fileGetSize == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(fileGetSize(handle, outSize));
+}
+
+WUHBUtilsStatus ModuleIO_FileClose(WUHBFileHandle handle) {
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto fileClose = GetExport<decltype(&FileClose)>(EXPORT_FILE_CLOSE);
+    if (fileClose == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(fileClose(handle));
+}
+
+static bool IsValidIoVec(const WUHBIoVec *vecs, uint32_t count) {
+    if (!vecs && count > 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!vecs[i].buffer && vecs[i].size > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Fallback for modules without WUU_FileReadV/WUU_FileReadVAt, also used for memory and gz index handles.
+ */
+static WUHBUtilsStatus FileReadVFallback(WUHBFileHandle handle, bool positional, uint32_t offset, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t done = 0;
+        while (done < vecs[i].size) {
+            int32_t readRes = -1;
+            WUHBUtilsStatus res;
+            if (positional) {
+                res = WUHBUtils_FileReadAt(handle, offset + total, vecs[i].buffer + done, vecs[i].size - done, &readRes);
+            } else {
+                res = WUHBUtils_FileRead(handle, vecs[i].buffer + done, vecs[i].size - done, &readRes);
+            }
+            if (res != WUHB_UTILS_RESULT_SUCCESS) {
+                return res;
+            }
+            if (readRes < 0) {
+                return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+            }
+            if (readRes == 0) {
+                *outTotal = total;
+                return WUHB_UTILS_RESULT_SUCCESS;
+            }
+            done += readRes;
+            total += readRes;
+        }
+    }
+    *outTotal = total;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsApiErrorType FileReadV(WUHBFileHandle, const WUHBIoVec *, uint32_t, uint32_t *);
+WUHBUtilsStatus WUHBUtils_FileReadV(WUHBFileHandle handle, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_READ_V);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (!IsValidIoVec(vecs, count) || !outTotal) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    if (Prefetch_IsMemoryHandle(handle) || GzIndex_IsIndexedHandle(handle)) {
+        return FileReadVFallback(handle, false, 0, vecs, count, outTotal);
+    }
+    auto fileReadV = GetExport<decltype(&FileReadV)>(EXPORT_FILE_READ_V);
+    if (fileReadV == nullptr) {
+        if (!HasExport(EXPORT_FILE_READ)) {
+            return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+        }
+        return FileReadVFallback(handle, false, 0, vecs, count, outTotal);
+    }
+    auto res = fileReadV(handle, vecs, count, outTotal);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_BYTES_READ(handle, *outTotal);
+        Trace_FileRead(handle, *outTotal);
+    }
+    return ToStatus(res);
+}
+
+WUHBUtilsApiErrorType FileReadVAt(WUHBFileHandle, uint32_t, const WUHBIoVec *, uint32_t, uint32_t *);
+WUHBUtilsStatus WUHBUtils_FileReadVAt(WUHBFileHandle handle, uint32_t offset, const WUHBIoVec *vecs, uint32_t count, uint32_t *outTotal) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_READ_V_AT);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (!IsValidIoVec(vecs, count) || !outTotal) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    if (Prefetch_IsMemoryHandle(handle) || GzIndex_IsIndexedHandle(handle)) {
+        return FileReadVFallback(handle, true, offset, vecs, count, outTotal);
+    }
+    auto fileReadVAt = GetExport<decltype(&FileReadVAt)>(EXPORT_FILE_READ_V_AT);
+    if (fileReadVAt == nullptr) {
+        if (!HasExport(EXPORT_FILE_READ_AT) && (!HasExport(EXPORT_FILE_SEEK) || !HasExport(EXPORT_FILE_TELL))) {
+            return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+        }
+        return FileReadVFallback(handle, true, offset, vecs, count, outTotal);
+    }
+    auto res = fileReadVAt(handle, offset, vecs, count, outTotal);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_BYTES_READ(handle, *outTotal);
+        Trace_FileReadAt(handle, offset, *outTotal);
+    }
+    return ToStatus(res);
+}
+
+WUHBUtilsApiErrorType OpenDir(const char *, WUHBDirHandle *);
+WUHBUtilsStatus WUHBUtils_OpenDir(const char *path, WUHBDirHandle *outHandle) {
+    STATS_SCOPE(WUHB_STATS_CALL_OPEN_DIR);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto openDir = GetExport<decltype(&OpenDir)>(EXPORT_OPEN_DIR);
+    if (openDir == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    auto res = openDir(path, outHandle);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_DIR_OPENED();
+    }
+    return ToStatus(res);
+}
+
+WUHBUtilsApiErrorType ReadDirBatch(WUHBDirHandle, WUHBDirEntry *, uint32_t, uint32_t *);
+WUHBUtilsStatus WUHBUtils_ReadDirBatch(WUHBDirHandle handle, WUHBDirEntry *entries, uint32_t maxEntries, uint32_t *outCount) {
+    STATS_SCOPE(WUHB_STATS_CALL_READ_DIR_BATCH);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto readDirBatch = GetExport<decltype(&ReadDirBatch)>(EXPORT_READ_DIR_BATCH);
+    if (readDirBatch == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    return ToStatus(readDirBatch(handle, entries, maxEntries, outCount));
+}
+
+WUHBUtilsApiErrorType CloseDir(WUHBDirHandle);
+WUHBUtilsStatus WUHBUtils_CloseDir(WUHBDirHandle handle) {
+    STATS_SCOPE(WUHB_STATS_CALL_CLOSE_DIR);
+    if (GetModuleVersion() == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    auto closeDir = GetExport<decltype(&CloseDir)>(EXPORT_CLOSE_DIR);
+    if (closeDir == nullptr) {
+        return WUHB_UTILS_RESULT_UNSUPPORTED_COMMAND;
+    }
+    auto res = closeDir(handle);
+    if (res == WUHB_UTILS_API_ERROR_NONE) {
+        STATS_DIR_CLOSED();
+    }
+    return ToStatus(res);
+}
+
+// Reads are split into chunks of this size while hashing, so the data is hashed while it's still in the cache.
+#define HASH_READ_CHUNK_SIZE (128 * 1024)
+
+/**
+ * Reads until "size" bytes have been read or the end of the file has been reached.
+ * If "hash" is not NULL, the data is added to it as it's read.
+ */
+static WUHBUtilsStatus ReadFully(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, uint32_t *outRead, WUHBHashState *hash) {
+    uint32_t totalRead = 0;
+    while (totalRead < size) {
+        uint32_t toRead = size - totalRead;
+        if (hash && toRead > HASH_READ_CHUNK_SIZE) {
+            toRead = HASH_READ_CHUNK_SIZE;
+        }
+        int32_t readRes = -1;
+        auto res        = WUHBUtils_FileRead(handle, buffer + totalRead, toRead, &readRes);
+        if (res != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        if (readRes < 0) {
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (readRes == 0) {
+            break;
+        }
+        if (hash) {
+            WUHBUtils_HashUpdate(hash, buffer + totalRead, readRes);
+        }
+        totalRead += readRes;
+    }
+    *outRead = totalRead;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Reads a file of unknown size by growing the buffer while reading.
+ * Used when the loaded module doesn't support WUHBUtils_FileGetSize.
+ */
+static WUHBUtilsStatus ReadWholeFileGrowing(WUHBFileHandle handle, uint8_t **outBuf, uint32_t *outSize, WUHBHashState *hash) {
+    auto DEFAULT_READ_BUFFER_SIZE = 128 * 1024;
+    WUHBUtilsStatus res;
     uint32_t buffer_size = DEFAULT_READ_BUFFER_SIZE;
-    auto *buffer         = (uint8_t *) memalign(0x40, buffer_size);
+    auto *buffer         = (uint8_t *) Allocator_Alloc(buffer_size, 0x40);
     if (!buffer) {
-        WUHBUtils_FileClose(handle);
         return WUHB_UTILS_RESULT_NO_MEMORY;
     }
 
@@ -313,8 +933,7 @@ WUHBUtilsStatus WUHBUtils_ReadWholeFile(const char *name, uint8_t **outBuf, uint
         }
 
         if ((res = WUHBUtils_FileRead(handle, buffer + totalRead, readSize, &readRes)) != WUHB_UTILS_RESULT_SUCCESS) {
-            free(buffer);
-            WUHBUtils_FileClose(handle);
+            Allocator_Free(buffer);
             return res;
         }
 
@@ -322,6 +941,9 @@ WUHBUtilsStatus WUHBUtils_ReadWholeFile(const char *name, uint8_t **outBuf, uint
             break;
         }
 
+        if (hash) {
+            WUHBUtils_HashUpdate(hash, buffer + totalRead, readRes);
+        }
         totalRead += readRes;
 
         if (totalRead == buffer_size) {
@@ -329,41 +951,506 @@ WUHBUtilsStatus WUHBUtils_ReadWholeFile(const char *name, uint8_t **outBuf, uint
             if (buffer_size >= 1024 * 1024) {
                 newBufferSize = buffer_size + 1024 * 1024;
             }
-            auto *newBuffer = (uint8_t *) memalign(0x40, newBufferSize);
+            auto *newBuffer = (uint8_t *) Allocator_Alloc(newBufferSize, 0x40);
             if (!newBuffer) {
                 newBufferSize = buffer_size + DEFAULT_READ_BUFFER_SIZE;
-                newBuffer     = (uint8_t *) memalign(0x40, newBufferSize);
+                newBuffer     = (uint8_t *) Allocator_Alloc(newBufferSize, 0x40);
                 if (!newBuffer) {
-                    free(buffer);
-                    WUHBUtils_FileClose(handle);
+                    Allocator_Free(buffer);
                     return WUHB_UTILS_RESULT_NO_MEMORY;
                 }
             }
             memcpy(newBuffer, buffer, totalRead);
-            free(buffer);
+            Allocator_Free(buffer);
             buffer      = newBuffer;
             buffer_size = newBufferSize;
+            STATS_READ_WHOLE_FILE_REALLOC();
         }
 
         //reset read size
         readSize = DEFAULT_READ_BUFFER_SIZE;
     }
 
+    auto *newBuffer = (uint8_t *) Allocator_Alloc(totalRead, 0x40);
+    if (newBuffer) {
+        STATS_READ_WHOLE_FILE_REALLOC();
+        memcpy(newBuffer, buffer, totalRead);
+        Allocator_Free(buffer);
+        buffer = newBuffer;
+    }
+
+    *outSize = totalRead;
+    *outBuf  = buffer;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBUtilsStatus ReadWholeFileImpl(const char *name, uint8_t **outBuf, uint32_t *outSize, WUHBHashState *hash) {
+    if (Prefetch_TakeFile(name, outBuf, outSize)) {
+        STATS_BYTES_READ_PLAIN(*outSize);
+        Trace_FileReadWhole(name, *outSize);
+        if (hash) {
+            WUHBUtils_HashUpdate(hash, *outBuf, *outSize);
+        }
+        return WUHB_UTILS_RESULT_SUCCESS;
+    }
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_FileOpen(name, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+
+    uint8_t *buffer    = nullptr;
+    uint32_t totalRead = 0;
+    uint32_t fileSize  = 0;
+    if (WUHBUtils_FileGetSize(handle, &fileSize) == WUHB_UTILS_RESULT_SUCCESS) {
+        buffer = (uint8_t *) Allocator_Alloc(fileSize, 0x40);
+        if (!buffer) {
+            WUHBUtils_FileClose(handle);
+            return WUHB_UTILS_RESULT_NO_MEMORY;
+        }
+        if ((res = ReadFully(handle, buffer, fileSize, &totalRead, hash)) != WUHB_UTILS_RESULT_SUCCESS) {
+            Allocator_Free(buffer);
+            WUHBUtils_FileClose(handle);
+            return res;
+        }
+    } else if ((res = ReadWholeFileGrowing(handle, &buffer, &totalRead, hash)) != WUHB_UTILS_RESULT_SUCCESS) {
+        WUHBUtils_FileClose(handle);
+        return res;
+    }
+
     auto closeRes = WUHBUtils_FileClose(handle);
 
     if (closeRes != WUHB_UTILS_RESULT_SUCCESS) {
-        free(buffer);
+        Allocator_Free(buffer);
         return closeRes;
     }
 
-    auto *newBuffer = (uint8_t *) malloc(totalRead);
-    if (newBuffer) {
-        memcpy(newBuffer, buffer, totalRead);
-        free(buffer);
-        buffer = newBuffer;
+    *outSize = totalRead;
+    *outBuf  = buffer;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_ReadWholeFile(const char *name, uint8_t **outBuf, uint32_t *outSize) {
+    STATS_SCOPE(WUHB_STATS_CALL_READ_WHOLE_FILE);
+    if (!outBuf || !outSize) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    WUHBHashState hash;
+    uint32_t expected;
+    bool verify = Hash_GetExpected(name, &hash, &expected);
+    auto res    = ReadWholeFileImpl(name, outBuf, outSize, verify ? &hash : nullptr);
+    if (res == WUHB_UTILS_RESULT_SUCCESS && verify && !Hash_Verify(name, &hash, expected)) {
+        Allocator_Free(*outBuf);
+        *outBuf  = nullptr;
+        *outSize = 0;
+        return WUHB_UTILS_RESULT_HASH_MISMATCH;
+    }
+    return res;
+}
+
+WUHBUtilsStatus WUHBUtils_ReadWholeFileHashed(const char *path, WUHBHashType type, uint8_t **outBuf, uint32_t *outSize, uint32_t *outHash) {
+    STATS_SCOPE(WUHB_STATS_CALL_READ_WHOLE_FILE_HASHED);
+    WUHBHashState hash;
+    if (!outBuf || !outSize || !outHash || WUHBUtils_HashInit(&hash, type) != WUHB_UTILS_RESULT_SUCCESS) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    WUHBHashState expectedHash;
+    uint32_t expected;
+    bool verify = Hash_GetExpected(path, &expectedHash, &expected);
+    if (verify && expectedHash.type != type) {
+        // The manifest uses a different algorithm, both hashes are needed.
+        auto res = WUHBUtils_ReadWholeFile(path, outBuf, outSize);
+        if (res == WUHB_UTILS_RESULT_SUCCESS) {
+            WUHBUtils_HashBuffer(type, *outBuf, *outSize, outHash);
+        }
+        return res;
+    }
+    auto res = ReadWholeFileImpl(path, outBuf, outSize, &hash);
+    if (res != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    if (verify && !Hash_Verify(path, &hash, expected)) {
+        Allocator_Free(*outBuf);
+        *outBuf  = nullptr;
+        *outSize = 0;
+        return WUHB_UTILS_RESULT_HASH_MISMATCH;
+    }
+    *outHash = WUHBUtils_HashFinal(&hash);
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+static WUHBUtilsStatus ReadWholeFileIntoImpl(const char *name, uint8_t *buffer, uint32_t capacity, uint32_t *outSize, WUHBHashState *hash) {
+    WUHBUtilsStatus prefetchRes;
+    if (Prefetch_ReadFileInto(name, buffer, capacity, outSize, &prefetchRes)) {
+        if (prefetchRes == WUHB_UTILS_RESULT_SUCCESS) {
+            STATS_BYTES_READ_PLAIN(*outSize);
+            Trace_FileReadWhole(name, *outSize);
+        }
+        if (hash && prefetchRes == WUHB_UTILS_RESULT_SUCCESS) {
+            WUHBUtils_HashUpdate(hash, buffer, *outSize);
+        }
+        return prefetchRes;
+    }
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_FileOpen(name, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+
+    uint32_t fileSize = 0;
+    bool sizeKnown    = WUHBUtils_FileGetSize(handle, &fileSize) == WUHB_UTILS_RESULT_SUCCESS;
+    if (sizeKnown && fileSize > capacity) {
+        WUHBUtils_FileClose(handle);
+        *outSize = fileSize;
+        return WUHB_UTILS_RESULT_BUFFER_TOO_SMALL;
+    }
+
+    uint32_t totalRead = 0;
+    if ((res = ReadFully(handle, buffer, capacity, &totalRead, hash)) != WUHB_UTILS_RESULT_SUCCESS) {
+        WUHBUtils_FileClose(handle);
+        return res;
+    }
+
+    if (!sizeKnown && totalRead == capacity) {
+        // Make sure we have actually reached the end of the file.
+        uint8_t probe;
+        int32_t readRes = -1;
+        if ((res = WUHBUtils_FileRead(handle, &probe, sizeof(probe), &readRes)) != WUHB_UTILS_RESULT_SUCCESS) {
+            WUHBUtils_FileClose(handle);
+            return res;
+        }
+        if (readRes > 0) {
+            WUHBUtils_FileClose(handle);
+            *outSize = 0;
+            return WUHB_UTILS_RESULT_BUFFER_TOO_SMALL;
+        }
+    }
+
+    if ((res = WUHBUtils_FileClose(handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
     }
 
     *outSize = totalRead;
-    *outBuf  = buffer;
     return WUHB_UTILS_RESULT_SUCCESS;
 }
+
+WUHBUtilsStatus WUHBUtils_ReadWholeFileInto(const char *name, uint8_t *buffer, uint32_t capacity, uint32_t *outSize) {
+    STATS_SCOPE(WUHB_STATS_CALL_READ_WHOLE_FILE_INTO);
+    if (!buffer || !outSize) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    WUHBHashState hash;
+    uint32_t expected;
+    bool verify = Hash_GetExpected(name, &hash, &expected);
+    auto res    = ReadWholeFileIntoImpl(name, buffer, capacity, outSize, verify ? &hash : nullptr);
+    if (res == WUHB_UTILS_RESULT_SUCCESS && verify && !Hash_Verify(name, &hash, expected)) {
+        *outSize = 0;
+        return WUHB_UTILS_RESULT_HASH_MISMATCH;
+    }
+    return res;
+}
+
+#define READ_FILES_ALIGNMENT    0x40
+#define READ_FILES_STAGING_SIZE (1024 * 1024)
+#define READ_FILES_MAX_GAP      (64 * 1024)
+
+struct ReadFilesEntry {
+    uint32_t request; // index into the arrays passed to WUHBUtils_ReadFiles
+    uint32_t bundle;  // index into the bundle paths
+    uint64_t offset;  // absolute offset of the data inside the bundle file
+    uint32_t size;
+    uint8_t *buffer;
+};
+
+static uint64_t AlignReadFilesSize(uint64_t size) {
+    return (size + READ_FILES_ALIGNMENT - 1) & ~((uint64_t) READ_FILES_ALIGNMENT - 1);
+}
+
+static bool ReadBundleAt(FILE *f, uint64_t offset, uint8_t *buffer, uint64_t size) {
+    if (offset > LONG_MAX || fseek(f, (long) offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(buffer, 1, size, f) == size;
+}
+
+/**
+ * Used if a file can't be read from the bundle file directly.
+ */
+static WUHBUtilsStatus ReadFileFallback(const char *path, uint8_t *buffer, uint32_t size) {
+    uint32_t read = 0;
+    auto res      = WUHBUtils_ReadWholeFileInto(path, buffer, size, &read);
+    if (res == WUHB_UTILS_RESULT_SUCCESS && read != size) {
+        return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+    }
+    return res;
+}
+
+/**
+ * Reads the files of one bundle, "entries" have to be sorted by offset. Runs of files with gaps of at most
+ * READ_FILES_MAX_GAP bytes are read into the staging buffer with a single read and copied out, everything else is
+ * read directly into its destination.
+ */
+static void ReadBundleFiles(FILE *f, const char **paths, ReadFilesEntry *entries, uint32_t count, uint8_t **staging, WUHBUtilsStatus *outStatus) {
+    uint32_t i = 0;
+    while (i < count) {
+        uint64_t start = entries[i].offset;
+        uint64_t end   = start + entries[i].size;
+        uint32_t j     = i + 1;
+        while (j < count && entries[j].offset <= end + READ_FILES_MAX_GAP && std::max(end, entries[j].offset + entries[j].size) - start <= READ_FILES_STAGING_SIZE) {
+            end = std::max(end, entries[j].offset + entries[j].size);
+            j++;
+        }
+
+        bool ok = false;
+        if (f && j == i + 1) {
+            ok = ReadBundleAt(f, start, entries[i].buffer, entries[i].size);
+        } else if (f) {
+            if (!*staging) {
+                *staging = (uint8_t *) Allocator_Alloc(READ_FILES_STAGING_SIZE, READ_FILES_ALIGNMENT);
+            }
+            if (*staging && (ok = ReadBundleAt(f, start, *staging, end - start))) {
+                for (uint32_t k = i; k < j; k++) {
+                    memcpy(entries[k].buffer, *staging + (entries[k].offset - start), entries[k].size);
+                }
+            }
+        }
+        for (uint32_t k = i; k < j; k++) {
+            if (ok) {
+                STATS_BYTES_READ_PLAIN(entries[k].size);
+                Trace_FileReadWhole(paths[entries[k].request], entries[k].size);
+                outStatus[entries[k].request] = Hash_VerifyBuffer(paths[entries[k].request], entries[k].buffer, entries[k].size) ? WUHB_UTILS_RESULT_SUCCESS : WUHB_UTILS_RESULT_HASH_MISMATCH;
+            } else {
+                outStatus[entries[k].request] = ReadFileFallback(paths[entries[k].request], entries[k].buffer, entries[k].size);
+            }
+        }
+        i = j;
+    }
+}
+
+WUHBUtilsStatus WUHBUtils_ReadFiles(const char **paths, uint32_t count, WUHBReadFilesMode mode, uint8_t **outBufs, uint32_t *outSizes, WUHBUtilsStatus *outStatus, uint8_t **outBlock) {
+    STATS_SCOPE(WUHB_STATS_CALL_READ_FILES);
+    auto version = GetModuleVersion();
+    if (version == WUHB_UTILS_MODULE_VERSION_ERROR) {
+        return WUHB_UTILS_RESULT_LIB_UNINITIALIZED;
+    }
+    if (!paths || !outBufs || !outSizes || !outStatus ||
+        (mode != WUHB_READ_FILES_SEPARATE_BUFFERS && mode != WUHB_READ_FILES_CONTIGUOUS) ||
+        (mode == WUHB_READ_FILES_CONTIGUOUS && !outBlock)) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+
+    // Resolve the location of every file, everything that can't be read from the bundle file directly is read right away.
+    std::vector<std::string> bundlePaths;
+    std::vector<ReadFilesEntry> entries;
+    for (uint32_t i = 0; i < count; i++) {
+        outBufs[i]   = nullptr;
+        outSizes[i]  = 0;
+        outStatus[i] = WUHB_UTILS_RESULT_SUCCESS;
+
+        BundleIndexFileExtent extent;
+        std::string bundlePath;
+        auto lookup = BundleIndex_Lookup(paths[i], &extent);
+        if (lookup == BUNDLE_INDEX_NOT_FOUND) {
+            outStatus[i] = WUHB_UTILS_RESULT_FILE_NOT_FOUND;
+            continue;
+        }
+        if (lookup == BUNDLE_INDEX_FOUND && extent.size <= UINT32_MAX && BundleIndex_GetBundlePath(paths[i], &bundlePath)) {
+            auto it = std::find(bundlePaths.begin(), bundlePaths.end(), bundlePath);
+            if (it == bundlePaths.end()) {
+                it = bundlePaths.insert(it, std::move(bundlePath));
+            }
+            entries.push_back({i, (uint32_t) (it - bundlePaths.begin()), extent.offset, (uint32_t) extent.size, nullptr});
+            outSizes[i] = extent.size;
+            continue;
+        }
+        outStatus[i] = WUHBUtils_ReadWholeFile(paths[i], &outBufs[i], &outSizes[i]);
+    }
+
+    // Assign the destination of every file.
+    if (mode == WUHB_READ_FILES_CONTIGUOUS) {
+        uint64_t totalSize = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (outStatus[i] == WUHB_UTILS_RESULT_SUCCESS) {
+                totalSize += AlignReadFilesSize(outSizes[i]);
+            }
+        }
+        uint8_t *block = nullptr;
+        if (count > 0 && (totalSize > UINT32_MAX || !(block = (uint8_t *) Allocator_Alloc(totalSize, READ_FILES_ALIGNMENT)))) {
+            for (uint32_t i = 0; i < count; i++) {
+                Allocator_Free(outBufs[i]);
+                outBufs[i]  = nullptr;
+                outSizes[i] = 0;
+            }
+            return WUHB_UTILS_RESULT_NO_MEMORY;
+        }
+        uint64_t pos = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (outStatus[i] != WUHB_UTILS_RESULT_SUCCESS) {
+                continue;
+            }
+            if (outBufs[i]) {
+                memcpy(block + pos, outBufs[i], outSizes[i]);
+                Allocator_Free(outBufs[i]);
+            }
+            outBufs[i] = block + pos;
+            pos += AlignReadFilesSize(outSizes[i]);
+        }
+        for (auto &entry : entries) {
+            entry.buffer = outBufs[entry.request];
+        }
+        *outBlock = block;
+    } else {
+        for (auto &entry : entries) {
+            entry.buffer = (uint8_t *) Allocator_Alloc(entry.size, READ_FILES_ALIGNMENT);
+            if (!entry.buffer) {
+                outStatus[entry.request] = WUHB_UTILS_RESULT_NO_MEMORY;
+            }
+        }
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const ReadFilesEntry &entry) { return entry.buffer == nullptr; }), entries.end());
+    }
+
+    // One sweep over each bundle file in on-disk order.
+    std::sort(entries.begin(), entries.end(), [](const ReadFilesEntry &a, const ReadFilesEntry &b) {
+        return a.bundle != b.bundle ? a.bundle < b.bundle : a.offset < b.offset;
+    });
+    uint8_t *staging = nullptr;
+    for (size_t first = 0; first < entries.size();) {
+        size_t last = first;
+        while (last < entries.size() && entries[last].bundle == entries[first].bundle) {
+            last++;
+        }
+        FILE *f = fopen(bundlePaths[entries[first].bundle].c_str(), "rb");
+        if (f) {
+            // All reads are large or go into the staging buffer, stdio buffering would only add a copy.
+            setvbuf(f, nullptr, _IONBF, 0);
+        } else {
+            DEBUG_FUNCTION_LINE_WARN("Failed to open %s, falling back to reading the files one by one", bundlePaths[entries[first].bundle].c_str());
+        }
+        ReadBundleFiles(f, paths, &entries[first], last - first, &staging, outStatus);
+        if (f) {
+            fclose(f);
+        }
+        first = last;
+    }
+    Allocator_Free(staging);
+
+    for (auto &entry : entries) {
+        if (outStatus[entry.request] == WUHB_UTILS_RESULT_SUCCESS) {
+            outBufs[entry.request] = entry.buffer;
+        } else if (mode == WUHB_READ_FILES_SEPARATE_BUFFERS) {
+            Allocator_Free(entry.buffer);
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (outStatus[i] != WUHB_UTILS_RESULT_SUCCESS) {
+            outBufs[i]  = nullptr;
+            outSizes[i] = 0;
+        }
+    }
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+/**
+ * Reads up to "size" bytes from the current position of "handle", less only at the end of the file.
+ */
+static WUHBUtilsStatus StreamReadChunk(WUHBFileHandle handle, uint8_t *buffer, uint32_t size, uint32_t *outRead) {
+    uint32_t total = 0;
+    while (total < size) {
+        int32_t readRes = -1;
+        WUHBUtilsStatus res;
+        if ((res = WUHBUtils_FileRead(handle, buffer + total, size - total, &readRes)) != WUHB_UTILS_RESULT_SUCCESS) {
+            return res;
+        }
+        if (readRes < 0) {
+            return WUHB_UTILS_RESULT_UNKNOWN_ERROR;
+        }
+        if (readRes == 0) {
+            break;
+        }
+        total += readRes;
+    }
+    *outRead = total;
+    return WUHB_UTILS_RESULT_SUCCESS;
+}
+
+WUHBUtilsStatus WUHBUtils_FileStream(const char *path, uint32_t chunkSize, WUHBStreamCallback callback, void *userdata) {
+    STATS_SCOPE(WUHB_STATS_CALL_FILE_STREAM);
+    if (!path || !callback || chunkSize == 0) {
+        return WUHB_UTILS_RESULT_INVALID_ARGUMENT;
+    }
+    WUHBFileHandle handle;
+    WUHBUtilsStatus res;
+    if ((res = WUHBUtils_FileOpen(path, &handle)) != WUHB_UTILS_RESULT_SUCCESS) {
+        return res;
+    }
+    uint8_t *buffers[WUHB_STREAM_BUFFER_COUNT] = {};
+    for (auto &buffer : buffers) {
+        if (!(buffer = (uint8_t *) Allocator_Alloc(chunkSize, 0x40))) {
+            res = WUHB_UTILS_RESULT_NO_MEMORY;
+        }
+    }
+    WUHBHashState hash;
+    uint32_t expected;
+    bool verify = Hash_GetExpected(path, &hash, &expected);
+
+    // The chunks are read sequentially via the handle (a positional read of a compressed file would inflate it from the
+    // start every time), so only one read is in flight at a time. It's queued before all requests of the application,
+    // otherwise it would wait behind them and not overlap with the callback. On a worker thread of the pool (e.g. in a
+    // WUHBAsyncCallback) waiting for the read-ahead could wait for the calling thread itself, so the chunks are read
+    // on the calling thread there.
+    bool readAhead            = !Async_IsWorkerThread();
+    WUHBAsyncRequest *request = nullptr;
+    uint32_t offset           = 0;
+    uint32_t current          = 0;
+    if (res == WUHB_UTILS_RESULT_SUCCESS && readAhead) {
+        res = Async_FileReadSequential(handle, buffers[0], chunkSize, ASYNC_PRIORITY_READ_AHEAD, &request);
+    }
+    while (res == WUHB_UTILS_RESULT_SUCCESS) {
+        uint32_t read = 0;
+        if (readAhead) {
+            WUHBUtils_AsyncWait(request);
+            WUHBUtils_AsyncGetResult(request, &res, nullptr, &read);
+            WUHBUtils_AsyncFree(request);
+            request = nullptr;
+        } else {
+            res = StreamReadChunk(handle, buffers[current], chunkSize, &read);
+        }
+        if (res != WUHB_UTILS_RESULT_SUCCESS || read == 0) {
+            break;
+        }
+        // A short read means the end of the file has been reached.
+        bool last = read < chunkSize;
+        if (!last && readAhead) {
+            uint32_t next = (current + 1) % WUHB_STREAM_BUFFER_COUNT;
+            if ((res = Async_FileReadSequential(handle, buffers[next], chunkSize, ASYNC_PRIORITY_READ_AHEAD, &request)) != WUHB_UTILS_RESULT_SUCCESS) {
+                break;
+            }
+        }
+        if (verify) {
+            WUHBUtils_HashUpdate(&hash, buffers[current], read);
+        }
+        if (!callback(buffers[current], read, offset, userdata)) {
+            res = WUHB_UTILS_RESULT_REQUEST_CANCELLED;
+            break;
+        }
+        offset += read;
+        current = (current + 1) % WUHB_STREAM_BUFFER_COUNT;
+        if (last) {
+            break;
+        }
+    }
+    if (request) {
+        // Stopped early, the buffers and the handle are in use until the read has finished.
+        WUHBUtils_AsyncCancel(request);
+        WUHBUtils_AsyncWait(request);
+        WUHBUtils_AsyncFree(request);
+    }
+    if (res == WUHB_UTILS_RESULT_SUCCESS && verify && !Hash_Verify(path, &hash, expected)) {
+        res = WUHB_UTILS_RESULT_HASH_MISMATCH;
+    }
+    for (auto *buffer : buffers) {
+        Allocator_Free(buffer);
+    }
+    auto closeRes = WUHBUtils_FileClose(handle);
+    return res != WUHB_UTILS_RESULT_SUCCESS ? res : closeRes;
+}